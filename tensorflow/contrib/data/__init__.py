@@ -25,6 +25,7 @@ See @{$guide/datasets$Importing Data} for an overview.
 @@Counter
 @@CheckpointInputPipelineHook
 @@CsvDataset
+@@ParallelTFRecordDataset
 @@RandomDataset
 @@Reducer
 @@SqlDataset
@@ -32,9 +33,11 @@ See @{$guide/datasets$Importing Data} for an overview.
 
 @@assert_element_shape
 @@batch_and_drop_remainder
+@@bounded_memory_shuffle
 @@bucket_by_sequence_length
 @@choose_from_datasets
 @@copy_to_device
+@@decode_and_crop_jpeg_batch
 @@dense_to_sparse_batch
 @@enumerate_dataset
 
@@ -58,6 +61,8 @@ See @{$guide/datasets$Importing Data} for an overview.
 @@shuffle_and_repeat
 @@sliding_window_batch
 @@sloppy_interleave
+@@sloppy_map
+@@spilling_cache
 @@unbatch
 @@unique
 """
@@ -74,6 +79,7 @@ from tensorflow.contrib.data.python.ops.batching import dense_to_sparse_batch
 from tensorflow.contrib.data.python.ops.batching import map_and_batch
 from tensorflow.contrib.data.python.ops.batching import padded_batch_and_drop_remainder
 from tensorflow.contrib.data.python.ops.batching import unbatch
+from tensorflow.contrib.data.python.ops.caching import spilling_cache
 from tensorflow.contrib.data.python.ops.counter import Counter
 from tensorflow.contrib.data.python.ops.enumerate_ops import enumerate_dataset
 from tensorflow.contrib.data.python.ops.error_ops import ignore_errors
@@ -83,22 +89,26 @@ from tensorflow.contrib.data.python.ops.grouping import bucket_by_sequence_lengt
 from tensorflow.contrib.data.python.ops.grouping import group_by_reducer
 from tensorflow.contrib.data.python.ops.grouping import group_by_window
 from tensorflow.contrib.data.python.ops.grouping import Reducer
+from tensorflow.contrib.data.python.ops.image_ops import decode_and_crop_jpeg_batch
 from tensorflow.contrib.data.python.ops.interleave_ops import choose_from_datasets
 from tensorflow.contrib.data.python.ops.interleave_ops import parallel_interleave
 from tensorflow.contrib.data.python.ops.interleave_ops import sample_from_datasets
 from tensorflow.contrib.data.python.ops.interleave_ops import sloppy_interleave
 from tensorflow.contrib.data.python.ops.iterator_ops import CheckpointInputPipelineHook
 from tensorflow.contrib.data.python.ops.iterator_ops import make_saveable_from_iterator
+from tensorflow.contrib.data.python.ops.map_ops import sloppy_map
 from tensorflow.contrib.data.python.ops.prefetching_ops import copy_to_device
 from tensorflow.contrib.data.python.ops.prefetching_ops import prefetch_to_device
 from tensorflow.contrib.data.python.ops.random_ops import RandomDataset
 from tensorflow.contrib.data.python.ops.readers import CsvDataset
 from tensorflow.contrib.data.python.ops.readers import make_batched_features_dataset
 from tensorflow.contrib.data.python.ops.readers import make_csv_dataset
+from tensorflow.contrib.data.python.ops.readers import ParallelTFRecordDataset
 from tensorflow.contrib.data.python.ops.readers import read_batch_features
 from tensorflow.contrib.data.python.ops.readers import SqlDataset
 from tensorflow.contrib.data.python.ops.resampling import rejection_resample
 from tensorflow.contrib.data.python.ops.scan_ops import scan
+from tensorflow.contrib.data.python.ops.shuffle_ops import bounded_memory_shuffle
 from tensorflow.contrib.data.python.ops.shuffle_ops import shuffle_and_repeat
 from tensorflow.contrib.data.python.ops.sliding import sliding_window_batch
 from tensorflow.contrib.data.python.ops.unique import unique
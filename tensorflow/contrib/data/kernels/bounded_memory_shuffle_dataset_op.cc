@@ -0,0 +1,429 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+
+namespace {
+
+const int64 kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
+
+// The size of the read buffer of each spilled block.
+const int64 kSpillReadBufferSize = 256 << 10;  // 256 KiB.
+
+// See documentation in ../ops/dataset_ops.cc for a high-level
+// description of the following op.
+
+class BoundedMemoryShuffleDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit BoundedMemoryShuffleDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {}
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    int64 window_size;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<int64>(ctx, "window_size", &window_size));
+    OP_REQUIRES(ctx, window_size > 0 || window_size == -1,
+                errors::InvalidArgument(
+                    "window_size must be greater than zero, or -1."));
+    int64 memory_budget;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "memory_budget",
+                                                   &memory_budget));
+    OP_REQUIRES(
+        ctx, memory_budget > 0,
+        errors::InvalidArgument("memory_budget must be greater than zero."));
+    string directory;
+    OP_REQUIRES_OK(ctx,
+                   ParseScalarArgument<string>(ctx, "directory", &directory));
+    int64 seed;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "seed", &seed));
+    int64 seed2;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "seed2", &seed2));
+
+    // By TensorFlow convention, passing 0 for both seeds indicates
+    // that the shuffling should be seeded non-deterministically.
+    if (seed == 0 && seed2 == 0) {
+      seed = random::New64();
+      seed2 = random::New64();
+    }
+
+    *output = new Dataset(ctx, input, window_size, memory_budget, directory,
+                          seed, seed2);
+  }
+
+ private:
+  class Dataset : public GraphDatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 window_size,
+            int64 memory_budget, const string& directory, int64 seed,
+            int64 seed2)
+        : GraphDatasetBase(ctx),
+          input_(input),
+          window_size_(window_size),
+          memory_budget_(memory_budget),
+          directory_(directory),
+          seed_(seed),
+          seed2_(seed2),
+          parent_generator_(seed, seed2),
+          generator_(&parent_generator_) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      // Each iterator shuffles in a different order, drawn from the seeds of
+      // the dataset.
+      int64 iterator_seed;
+      int64 iterator_seed2;
+      {
+        mutex_lock l(mu_);
+        iterator_seed = generator_();
+        iterator_seed2 = generator_();
+      }
+      return std::unique_ptr<IteratorBase>(new Iterator(
+          {this, strings::StrCat(prefix, "::BoundedMemoryShuffle")},
+          iterator_seed, iterator_seed2));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() const override {
+      return strings::StrCat("BoundedMemoryShuffleDatasetOp(", window_size_,
+                             ", ", memory_budget_, ")::Dataset");
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+      Node* window_size = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(window_size_, &window_size));
+      Node* memory_budget = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(memory_budget_, &memory_budget));
+      Node* directory = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(directory_, &directory));
+      Node* seed = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(seed_, &seed));
+      Node* seed2 = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(seed2_, &seed2));
+      TF_RETURN_IF_ERROR(b->AddDataset(this,
+                                       {input_graph_node, window_size,
+                                        memory_budget, directory, seed, seed2},
+                                       output));
+      return Status::OK();
+    }
+
+   private:
+    // Shuffles the input in consecutive windows of elements, each of which
+    // is produced in a uniformly random order.
+    //
+    // The elements of a window are held in memory up to the memory budget.
+    // When the next element would exceed the budget, the elements in memory
+    // are shuffled and written to a scratch file as a "block". Once the
+    // whole window has been read, each element is drawn from a block chosen
+    // with probability proportional to the number of elements left in it,
+    // and the elements of each block are read sequentially. Since the blocks
+    // are uniformly shuffled, this produces a uniformly random permutation of
+    // the window.
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      Iterator(const Params& params, int64 seed, int64 seed2)
+          : DatasetIterator<Dataset>(params),
+            parent_generator_(seed, seed2),
+            generator_(&parent_generator_) {}
+
+      ~Iterator() override {
+        mutex_lock l(mu_);
+        DeleteSpilledBlocks();
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        if (!started_) {
+          started_ = true;
+          TF_RETURN_IF_ERROR(
+              dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+        }
+        if (NumElementsLeft() == 0) {
+          TF_RETURN_IF_ERROR(ReadWindow(ctx));
+          if (NumElementsLeft() == 0) {
+            *end_of_sequence = true;
+            return Status::OK();
+          }
+        }
+        *end_of_sequence = false;
+        int64 index = RandomIndex(NumElementsLeft());
+        if (index < memory_.size()) {
+          // Drawing uniformly from the elements in memory, and removing the
+          // element drawn, shuffles them in place.
+          *out_tensors = std::move(memory_[index]);
+          std::swap(memory_[index], memory_.back());
+          memory_.pop_back();
+          return Status::OK();
+        }
+        index -= memory_.size();
+        for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
+          if (index >= it->num_elements_left) {
+            index -= it->num_elements_left;
+            continue;
+          }
+          TF_RETURN_IF_ERROR(ReadSpilledElement(ctx, &*it, out_tensors));
+          if (--it->num_elements_left == 0) {
+            it->reader.reset();
+            it->file.reset();
+            it->env->DeleteFile(it->filename).IgnoreError();
+            blocks_.erase(it);
+          }
+          return Status::OK();
+        }
+        return errors::Internal("Shuffle block bookkeeping is inconsistent.");
+      }
+
+     private:
+      // A shuffled block of elements that were written to a scratch file,
+      // one record per component.
+      struct SpilledBlock {
+        Env* env = nullptr;
+        string filename;
+        int64 num_elements_left = 0;
+        std::unique_ptr<RandomAccessFile> file;
+        std::unique_ptr<io::SequentialRecordReader> reader;
+      };
+
+      int64 NumElementsLeft() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        int64 n = memory_.size();
+        for (const SpilledBlock& block : blocks_) {
+          n += block.num_elements_left;
+        }
+        return n;
+      }
+
+      // Reads the next window of the input, spilling blocks of elements to
+      // scratch files if it does not fit in the memory budget.
+      Status ReadWindow(IteratorContext* ctx) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        const int64 start_micros = ctx->env()->NowMicros();
+        int64 num_log_entries = 0;
+        int64 memory_bytes = 0;
+        int64 num_elements = 0;
+        while (dataset()->window_size_ == -1 ||
+               num_elements < dataset()->window_size_) {
+          if (ctx->env()->NowMicros() >
+              ((num_log_entries + 1) * kLogIntervalMicros) + start_micros) {
+            num_log_entries++;
+            LOG(INFO) << "Filling up shuffle window (this may take a while): "
+                      << num_elements << " elements, " << blocks_.size()
+                      << " spilled blocks";
+          }
+          std::vector<Tensor> element;
+          if (!pending_element_.empty()) {
+            element = std::move(pending_element_);
+            pending_element_.clear();
+          } else {
+            if (!input_impl_) break;
+            bool end_of_input = false;
+            TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &element,
+                                                    &end_of_input));
+            if (end_of_input) {
+              input_impl_.reset();
+              break;
+            }
+          }
+          const int64 element_bytes = ElementBytes(element);
+          if (!memory_.empty() &&
+              memory_bytes + element_bytes > dataset()->memory_budget_) {
+            if (dataset()->window_size_ == -1) {
+              // The window is whatever fits in memory; the element that does
+              // not fit starts the next one.
+              pending_element_ = std::move(element);
+              break;
+            }
+            TF_RETURN_IF_ERROR(SpillMemory(ctx));
+            memory_bytes = 0;
+          }
+          memory_.push_back(std::move(element));
+          memory_bytes += element_bytes;
+          ++num_elements;
+        }
+        if (num_log_entries > 0) {
+          LOG(INFO) << "Shuffle window filled.";
+        }
+        return Status::OK();
+      }
+
+      // Shuffles the elements in memory and writes them to a new block.
+      Status SpillMemory(IteratorContext* ctx) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        for (int64 i = memory_.size() - 1; i > 0; --i) {
+          std::swap(memory_[i], memory_[RandomIndex(i + 1)]);
+        }
+        SpilledBlock block;
+        block.env = ctx->env();
+        block.filename = ScratchFilename(ctx->env());
+        std::unique_ptr<WritableFile> file;
+        TF_RETURN_IF_ERROR(ctx->env()->NewWritableFile(block.filename, &file));
+        // Record the block first, so that its file is deleted even if writing
+        // it fails.
+        blocks_.push_back(std::move(block));
+        SpilledBlock* spilled = &blocks_.back();
+        io::RecordWriter writer(file.get());
+        string record;
+        for (const std::vector<Tensor>& element : memory_) {
+          for (const Tensor& component : element) {
+            TensorProto proto;
+            component.AsProtoTensorContent(&proto);
+            if (!proto.SerializeToString(&record)) {
+              return errors::Internal(
+                  "Failed to serialize a shuffled tensor.");
+            }
+            TF_RETURN_IF_ERROR(writer.WriteRecord(record));
+          }
+          ++spilled->num_elements_left;
+        }
+        TF_RETURN_IF_ERROR(writer.Close());
+        TF_RETURN_IF_ERROR(file->Close());
+        memory_.clear();
+        return Status::OK();
+      }
+
+      Status ReadSpilledElement(IteratorContext* ctx, SpilledBlock* block,
+                                std::vector<Tensor>* out_tensors)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (!block->reader) {
+          TF_RETURN_IF_ERROR(
+              ctx->env()->NewRandomAccessFile(block->filename, &block->file));
+          io::RecordReaderOptions options;
+          options.buffer_size = kSpillReadBufferSize;
+          block->reader.reset(
+              new io::SequentialRecordReader(block->file.get(), options));
+        }
+        const size_t num_components = dataset()->output_dtypes().size();
+        out_tensors->reserve(num_components);
+        string record;
+        for (size_t i = 0; i < num_components; ++i) {
+          TF_RETURN_IF_ERROR(block->reader->ReadRecord(&record));
+          TensorProto proto;
+          out_tensors->emplace_back();
+          if (!proto.ParseFromString(record) ||
+              !out_tensors->back().FromProto(proto)) {
+            return errors::DataLoss("Failed to parse a shuffled tensor.");
+          }
+        }
+        return Status::OK();
+      }
+
+      // Returns a name for a scratch file that no other block uses.
+      string ScratchFilename(Env* env) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        string prefix;
+        if (!dataset()->directory_.empty()) {
+          prefix = io::JoinPath(dataset()->directory_, "tf_data_shuffle");
+        } else if (!env->LocalTempFilename(&prefix)) {
+          prefix = "tf_data_shuffle";
+        }
+        return strings::StrCat(prefix, ".block-",
+                               strings::Hex(random::New64()));
+      }
+
+      void DeleteSpilledBlocks() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        for (SpilledBlock& block : blocks_) {
+          block.reader.reset();
+          block.file.reset();
+          block.env->DeleteFile(block.filename).IgnoreError();
+        }
+        blocks_.clear();
+      }
+
+      // Returns the number of bytes held by the tensors of `element`, which
+      // includes the contents of strings.
+      static int64 ElementBytes(const std::vector<Tensor>& element) {
+        int64 bytes = 0;
+        for (const Tensor& component : element) {
+          bytes += component.TotalBytes();
+        }
+        return bytes;
+      }
+
+      // Returns an index drawn uniformly from [0, n). A 64-bit draw is
+      // rejected if it falls in the incomplete run of n values at the top of
+      // its range, which would favor the lower indices.
+      int64 RandomIndex(int64 n) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        const uint64 limit = std::numeric_limits<uint64>::max() / n * n;
+        while (true) {
+          const uint64 hi = generator_();
+          const uint64 sample = (hi << 32) | generator_();
+          if (sample < limit) return sample % n;
+        }
+      }
+
+      mutex mu_;
+      bool started_ GUARDED_BY(mu_) = false;
+      std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+      // The elements of the current window that are held in memory, and the
+      // blocks of those that were spilled.
+      std::vector<std::vector<Tensor>> memory_ GUARDED_BY(mu_);
+      std::vector<SpilledBlock> blocks_ GUARDED_BY(mu_);
+      // An element read past the end of a window, when windows are delimited
+      // by the memory budget.
+      std::vector<Tensor> pending_element_ GUARDED_BY(mu_);
+      random::PhiloxRandom parent_generator_ GUARDED_BY(mu_);
+      random::SingleSampleAdapter<random::PhiloxRandom> generator_
+          GUARDED_BY(mu_);
+    };
+
+    const DatasetBase* const input_;
+    const int64 window_size_;
+    const int64 memory_budget_;
+    const string directory_;
+    const int64 seed_;
+    const int64 seed2_;
+    mutable mutex mu_;
+    mutable random::PhiloxRandom parent_generator_ GUARDED_BY(mu_);
+    mutable random::SingleSampleAdapter<random::PhiloxRandom> generator_
+        GUARDED_BY(mu_);
+  };
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("BoundedMemoryShuffleDataset").Device(DEVICE_CPU),
+    BoundedMemoryShuffleDatasetOp);
+
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,362 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <deque>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/parallel_record_reader.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+
+namespace tensorflow {
+namespace {
+
+// See documentation in ../ops/dataset_ops.cc for a high-level
+// description of the following op.
+
+class ParallelTFRecordDatasetOp : public DatasetOpKernel {
+ public:
+  using DatasetOpKernel::DatasetOpKernel;
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
+    const Tensor* filenames_tensor;
+    OP_REQUIRES_OK(ctx, ctx->input("filenames", &filenames_tensor));
+    OP_REQUIRES(
+        ctx, filenames_tensor->dims() <= 1,
+        errors::InvalidArgument("`filenames` must be a scalar or a vector."));
+
+    std::vector<string> filenames;
+    filenames.reserve(filenames_tensor->NumElements());
+    for (int i = 0; i < filenames_tensor->NumElements(); ++i) {
+      filenames.push_back(filenames_tensor->flat<string>()(i));
+    }
+
+    string compression_type;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<string>(ctx, "compression_type",
+                                                    &compression_type));
+
+    int64 buffer_size = -1;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<int64>(ctx, "buffer_size", &buffer_size));
+    OP_REQUIRES(ctx, buffer_size >= 0,
+                errors::InvalidArgument(
+                    "`buffer_size` must be >= 0 (0 == no buffering)"));
+
+    int64 num_parallel_reads;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "num_parallel_reads",
+                                                   &num_parallel_reads));
+    OP_REQUIRES(
+        ctx, num_parallel_reads > 0,
+        errors::InvalidArgument("`num_parallel_reads` must be > 0"));
+
+    int64 range_size;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<int64>(ctx, "range_size", &range_size));
+    OP_REQUIRES(ctx, range_size > 0,
+                errors::InvalidArgument("`range_size` must be > 0"));
+
+    *output = new Dataset(ctx, std::move(filenames), compression_type,
+                          buffer_size, num_parallel_reads, range_size);
+  }
+
+ private:
+  class Dataset : public GraphDatasetBase {
+   public:
+    explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
+                     const string& compression_type, int64 buffer_size,
+                     int64 num_parallel_reads, int64 range_size)
+        : GraphDatasetBase(ctx),
+          filenames_(std::move(filenames)),
+          compression_type_(compression_type),
+          buffer_size_(buffer_size),
+          options_(io::RecordReaderOptions::CreateRecordReaderOptions(
+              compression_type)) {
+      if (buffer_size > 0) {
+        options_.buffer_size = buffer_size;
+      }
+      parallel_options_.num_parallel_reads = num_parallel_reads;
+      parallel_options_.range_size = range_size;
+    }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return std::unique_ptr<IteratorBase>(new Iterator(
+          {this, strings::StrCat(prefix, "::ParallelTFRecord")}));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      static DataTypeVector* dtypes = new DataTypeVector({DT_STRING});
+      return *dtypes;
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      static std::vector<PartialTensorShape>* shapes =
+          new std::vector<PartialTensorShape>({{}});
+      return *shapes;
+    }
+
+    string DebugString() const override {
+      return "ParallelTFRecordDatasetOp::Dataset";
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* filenames = nullptr;
+      TF_RETURN_IF_ERROR(b->AddVector(filenames_, &filenames));
+      Node* compression_type = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
+      Node* buffer_size = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(buffer_size_, &buffer_size));
+      Node* num_parallel_reads = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(parallel_options_.num_parallel_reads,
+                                      &num_parallel_reads));
+      Node* range_size = nullptr;
+      TF_RETURN_IF_ERROR(
+          b->AddScalar(parallel_options_.range_size, &range_size));
+      TF_RETURN_IF_ERROR(b->AddDataset(this,
+                                       {filenames, compression_type,
+                                        buffer_size, num_parallel_reads,
+                                        range_size},
+                                       output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        do {
+          // We are currently processing a file, so try to read the next record.
+          if (file_) {
+            Tensor result_tensor(ctx->allocator({}), DT_STRING, {});
+            Status s;
+            if (parallel_reader_) {
+              OpenFilesAheadLocked(ctx->env());
+              s = parallel_reader_->ReadRecord(
+                  &result_tensor.scalar<string>()());
+            } else {
+              s = reader_->ReadRecord(&result_tensor.scalar<string>()());
+            }
+            if (s.ok()) {
+              out_tensors->emplace_back(std::move(result_tensor));
+              *end_of_sequence = false;
+              return Status::OK();
+            } else if (!errors::IsOutOfRange(s)) {
+              return s;
+            }
+
+            // We have reached the end of the current file, so maybe
+            // move on to next file.
+            ResetStreamsLocked();
+            ++current_file_index_;
+          }
+
+          // Iteration ends when there are no more files to process.
+          if (current_file_index_ == dataset()->filenames_.size()) {
+            *end_of_sequence = true;
+            return Status::OK();
+          }
+
+          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env(), 0));
+        } while (true);
+      }
+
+     protected:
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("current_file_index"),
+                                               current_file_index_));
+
+        if (file_) {
+          const uint64 offset = parallel_reader_
+                                    ? parallel_reader_->TellOffset()
+                                    : reader_->TellOffset();
+          TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("offset"),
+                                                 static_cast<int64>(offset)));
+        }
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        ResetAllStreamsLocked();
+        int64 current_file_index;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("current_file_index"),
+                                              &current_file_index));
+        current_file_index_ = size_t(current_file_index);
+        if (reader->Contains(full_name("offset"))) {
+          int64 offset;
+          TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("offset"), &offset));
+          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env(), offset));
+        }
+        return Status::OK();
+      }
+
+     private:
+      // Sets up reader streams to read from the file at `current_file_index_`,
+      // starting at the record at `offset`.
+      Status SetupStreamsLocked(Env* env, uint64 offset)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (current_file_index_ >= dataset()->filenames_.size()) {
+          return errors::InvalidArgument(
+              "current_file_index_:", current_file_index_,
+              " >= filenames_.size():", dataset()->filenames_.size());
+        }
+
+        if (!files_ahead_.empty()) {
+          // The file was opened ahead, and has been read since.
+          file_ = std::move(files_ahead_.front().file);
+          parallel_reader_ = std::move(files_ahead_.front().reader);
+          files_ahead_.pop_front();
+          parallel_reader_->SetNumParallelReads(
+              dataset()->parallel_options_.num_parallel_reads);
+          return Status::OK();
+        }
+
+        // Actually move on to next file.
+        open_ahead_failed_ = false;
+        const string& next_filename =
+            dataset()->filenames_[current_file_index_];
+        TF_RETURN_IF_ERROR(env->NewRandomAccessFile(next_filename, &file_));
+        if (dataset()->options_.compression_type !=
+            io::RecordReaderOptions::NONE) {
+          // Compressed files can only be read sequentially.
+          reader_.reset(
+              new io::SequentialRecordReader(file_.get(), dataset()->options_));
+          return reader_->SeekOffset(offset);
+        }
+        return NewParallelReaderLocked(
+            env, next_filename, file_.get(), offset,
+            dataset()->parallel_options_.num_parallel_reads,
+            &parallel_reader_);
+      }
+
+      // Creates a reader of the uncompressed file "*file", which reads up to
+      // "num_parallel_reads" ranges ahead.
+      Status NewParallelReaderLocked(
+          Env* env, const string& filename, RandomAccessFile* file,
+          uint64 offset, int64 num_parallel_reads,
+          std::unique_ptr<io::ParallelRecordReader>* reader)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        uint64 file_size;
+        TF_RETURN_IF_ERROR(env->GetFileSize(filename, &file_size));
+        if (!pool_) {
+          pool_.reset(new thread::ThreadPool(
+              env, "parallel_tfrecord",
+              dataset()->parallel_options_.num_parallel_reads));
+        }
+        io::ParallelRecordReaderOptions options = dataset()->parallel_options_;
+        options.num_parallel_reads = num_parallel_reads;
+        reader->reset(new io::ParallelRecordReader(file, file_size, offset,
+                                                   options, pool_.get()));
+        return Status::OK();
+      }
+
+      // Once the readers of the current file and of the files opened ahead
+      // have scheduled all their ranges, opens the next file, which reads
+      // ranges ahead with the remaining "num_parallel_reads", so that the
+      // reads do not stop at the end of each file.
+      void OpenFilesAheadLocked(Env* env) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        const size_t next_file_index =
+            current_file_index_ + 1 + files_ahead_.size();
+        if (next_file_index >= dataset()->filenames_.size() ||
+            open_ahead_failed_) {
+          return;
+        }
+        int64 num_free_reads = dataset()->parallel_options_.num_parallel_reads;
+        bool all_scheduled;
+        num_free_reads -= parallel_reader_->NumRangesAhead(&all_scheduled);
+        if (!all_scheduled) return;
+        for (FileAhead& file_ahead : files_ahead_) {
+          num_free_reads -= file_ahead.reader->NumRangesAhead(&all_scheduled);
+          if (!all_scheduled) return;
+        }
+        if (num_free_reads <= 0) return;
+
+        const string& filename = dataset()->filenames_[next_file_index];
+        FileAhead file_ahead;
+        Status s = env->NewRandomAccessFile(filename, &file_ahead.file);
+        if (s.ok()) {
+          s = NewParallelReaderLocked(env, filename, file_ahead.file.get(), 0,
+                                      num_free_reads, &file_ahead.reader);
+        }
+        if (!s.ok()) {
+          // The error is returned when the consumer reaches the file.
+          open_ahead_failed_ = true;
+          return;
+        }
+        files_ahead_.push_back(std::move(file_ahead));
+      }
+
+      // Resets all reader streams.
+      void ResetStreamsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        parallel_reader_.reset();
+        reader_.reset();
+        file_.reset();
+      }
+
+      // Resets the streams of the current file and the files opened ahead.
+      void ResetAllStreamsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        ResetStreamsLocked();
+        files_ahead_.clear();
+        open_ahead_failed_ = false;
+      }
+
+      // An uncompressed file after the current one that is read ahead.
+      struct FileAhead {
+        // The reader borrows "*file", so it is destroyed first.
+        std::unique_ptr<RandomAccessFile> file;
+        std::unique_ptr<io::ParallelRecordReader> reader;
+      };
+
+      mutex mu_;
+      size_t current_file_index_ GUARDED_BY(mu_) = 0;
+
+      // Reads the ranges of uncompressed files.
+      std::unique_ptr<thread::ThreadPool> pool_ GUARDED_BY(mu_);
+      // The readers will borrow the object that `file_` points to, so
+      // we must destroy them before `file_`. Only one of them is set.
+      std::unique_ptr<RandomAccessFile> file_ GUARDED_BY(mu_);
+      std::unique_ptr<io::SequentialRecordReader> reader_ GUARDED_BY(mu_);
+      std::unique_ptr<io::ParallelRecordReader> parallel_reader_
+          GUARDED_BY(mu_);
+      // The files after the current one that are opened ahead, in order.
+      std::deque<FileAhead> files_ahead_ GUARDED_BY(mu_);
+      bool open_ahead_failed_ GUARDED_BY(mu_) = false;
+    };
+
+    const std::vector<string> filenames_;
+    const string compression_type_;
+    const int64 buffer_size_;
+    io::RecordReaderOptions options_;
+    io::ParallelRecordReaderOptions parallel_options_;
+  };
+};
+
+REGISTER_KERNEL_BUILDER(Name("ParallelTFRecordDataset").Device(DEVICE_CPU),
+                        ParallelTFRecordDatasetOp);
+
+}  // namespace
+}  // namespace tensorflow
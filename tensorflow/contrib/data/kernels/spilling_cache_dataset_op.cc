@@ -0,0 +1,545 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <deque>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/snappy.h"
+
+namespace tensorflow {
+
+namespace {
+
+// See documentation in ../ops/dataset_ops.cc for a high-level
+// description of the following op.
+
+class SpillingCacheDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit SpillingCacheDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {}
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    string filename;
+    OP_REQUIRES_OK(ctx,
+                   ParseScalarArgument<string>(ctx, "filename", &filename));
+    int64 memory_budget;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "memory_budget",
+                                                   &memory_budget));
+    OP_REQUIRES(ctx, memory_budget >= 0,
+                errors::InvalidArgument("memory_budget must be >= 0"));
+    string compression_type;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<string>(ctx, "compression_type",
+                                                    &compression_type));
+    OP_REQUIRES(ctx, compression_type.empty() || compression_type == "SNAPPY",
+                errors::InvalidArgument("Unsupported compression_type: ",
+                                        compression_type));
+
+    *output = new Dataset(ctx, input, filename, memory_budget,
+                          compression_type);
+  }
+
+ private:
+  // A thread-safe cache of the elements of a dataset, of which the first ones
+  // are held in memory, up to a budget, and the others are spilled to a
+  // file.
+  //
+  // A single writer appends the elements of the input in order. Readers may
+  // start before the writer is done: they wait for each element that is not
+  // yet cached. As every element is read once per epoch, the cache keeps
+  // the elements that come first in memory, rather than evicting any, so that
+  // each epoch reads a prefix from memory followed by one sequential pass over
+  // the file.
+  class SpillingCache {
+   public:
+    // The position of a reader in the cache.
+    struct Cursor {
+      // The cache contents that the reader reads; see `MaybeClaim()`.
+      int64 generation = 0;
+      int64 index = 0;
+      // The reader's handle to the spill file, opened by the first read of a
+      // spilled element, and the offset of the next record to read.
+      std::unique_ptr<RandomAccessFile> file;
+      std::unique_ptr<io::RecordReader> reader;
+      uint64 offset = 0;
+    };
+
+    SpillingCache(Env* env, string filename, int64 memory_budget,
+                  bool compress, int num_components)
+        : env_(env),
+          filename_(std::move(filename)),
+          memory_budget_(memory_budget),
+          compress_(compress),
+          num_components_(num_components) {}
+
+    ~SpillingCache() {
+      mutex_lock write_l(write_mu_);
+      DiscardSpillFileLocked();
+    }
+
+    // Claims the cache for a writer, unless another writer has claimed it
+    // already. Either way, sets `*generation` to the generation of the
+    // contents that the caller will write or read; the generation changes
+    // when the contents are discarded.
+    bool MaybeClaim(int64* generation) {
+      mutex_lock l(mu_);
+      *generation = generation_;
+      if (claimed_) return false;
+      claimed_ = true;
+      return true;
+    }
+
+    // Called when the writer is done. Discards the contents unless the
+    // writer has completed them, so that the cache is not truncated.
+    void ReleaseWriter() {
+      mutex_lock write_l(write_mu_);
+      mutex_lock l(mu_);
+      if (completed_) return;
+      if (num_elements_ > 0) {
+        LOG(WARNING) << "The calling iterator did not fully read the dataset "
+                        "being cached. In order to avoid unexpected "
+                        "truncation of the dataset, the partially cached "
+                        "contents of the dataset will be discarded.";
+      }
+      DiscardSpillFileLocked();
+      memory_.clear();
+      memory_bytes_ = 0;
+      spilling_ = false;
+      status_ = Status::OK();
+      num_elements_ = 0;
+      num_visible_ = 0;
+      claimed_ = false;
+      ++generation_;
+      cond_var_.notify_all();
+    }
+
+    // Appends an element. Only called by the writer.
+    //
+    // Once writing the spill file fails, it may end in a partial record, so
+    // every later call returns the same error, as do reads of the elements
+    // that were not made visible before; the contents are discarded when the
+    // writer is released.
+    Status Append(const std::vector<Tensor>& element)
+        LOCKS_EXCLUDED(mu_, write_mu_) {
+      bool spilling;
+      {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(status_);
+        spilling = spilling_;
+      }
+      if (!spilling) {
+        std::shared_ptr<CachedElement> cached(new CachedElement);
+        int64 bytes = 0;
+        if (compress_) {
+          cached->compressed.resize(element.size());
+          for (size_t i = 0; i < element.size(); ++i) {
+            TF_RETURN_IF_ERROR(
+                EncodeTensor(element[i], &cached->compressed[i]));
+            bytes += cached->compressed[i].size();
+          }
+        } else {
+          cached->tensors = element;
+          for (const Tensor& t : element) {
+            bytes += t.TotalBytes();
+          }
+        }
+        mutex_lock l(mu_);
+        if (memory_bytes_ + bytes <= memory_budget_) {
+          memory_.push_back(std::move(cached));
+          memory_bytes_ += bytes;
+          ++num_elements_;
+          num_visible_ = num_elements_;
+          cond_var_.notify_all();
+          return Status::OK();
+        }
+        // Once an element does not fit, this and all later elements go to
+        // the file, so that the file holds the cache's suffix in order.
+        spilling_ = true;
+      }
+
+      std::vector<string> records(element.size());
+      for (size_t i = 0; i < element.size(); ++i) {
+        TF_RETURN_IF_ERROR(EncodeTensor(element[i], &records[i]));
+      }
+      mutex_lock write_l(write_mu_);
+      Status s = WriteSpilledElementLocked(records);
+      {
+        mutex_lock l(mu_);
+        if (s.ok()) {
+          ++num_elements_;
+        } else {
+          status_.Update(s);
+        }
+        cond_var_.notify_all();
+      }
+      if (s.ok() && unflushed_bytes_ >= kFlushBytes) {
+        return FlushSpillFileLocked();
+      }
+      return s;
+    }
+
+    // Marks the cache as completed. Only called by the writer.
+    Status Complete() LOCKS_EXCLUDED(mu_, write_mu_) {
+      mutex_lock write_l(write_mu_);
+      TF_RETURN_IF_ERROR(FlushSpillFileLocked());
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(status_);
+      completed_ = true;
+      cond_var_.notify_all();
+      return Status::OK();
+    }
+
+    // Reads the element at `cursor`, waiting for the writer to cache it if
+    // needed, and advances `cursor`.
+    Status Read(Cursor* cursor, std::vector<Tensor>* out_tensors,
+                bool* end_of_sequence) LOCKS_EXCLUDED(mu_) {
+      std::shared_ptr<const CachedElement> cached;
+      while (true) {
+        {
+          mutex_lock l(mu_);
+          while (cursor->generation == generation_ && !completed_ &&
+                 status_.ok() && cursor->index >= num_elements_) {
+            cond_var_.wait(l);
+          }
+          if (cursor->generation != generation_) {
+            return errors::Aborted(
+                "The cache was discarded, because the iterator that was "
+                "writing it did not read the whole dataset.");
+          }
+          if (!status_.ok() && cursor->index >= num_visible_) {
+            return status_;
+          }
+          if (completed_ && cursor->index >= num_elements_) {
+            *end_of_sequence = true;
+            return Status::OK();
+          }
+          if (cursor->index < num_visible_) {
+            if (cursor->index < memory_.size()) {
+              cached = memory_[cursor->index];
+            }
+            break;
+          }
+        }
+        // The element has been written to the spill file, but not flushed.
+        TF_RETURN_IF_ERROR(FlushSpillFile());
+      }
+      ++cursor->index;
+      *end_of_sequence = false;
+      out_tensors->reserve(num_components_);
+      if (cached) {
+        if (!compress_) {
+          out_tensors->insert(out_tensors->end(), cached->tensors.begin(),
+                              cached->tensors.end());
+          return Status::OK();
+        }
+        for (const string& compressed : cached->compressed) {
+          out_tensors->emplace_back();
+          TF_RETURN_IF_ERROR(DecodeTensor(compressed, &out_tensors->back()));
+        }
+        return Status::OK();
+      }
+
+      // The spilled elements are read sequentially, so a reader that got
+      // here reads the file from the start.
+      if (!cursor->reader) {
+        TF_RETURN_IF_ERROR(
+            env_->NewRandomAccessFile(filename_, &cursor->file));
+        cursor->reader.reset(new io::RecordReader(cursor->file.get()));
+        cursor->offset = 0;
+      }
+      string record;
+      for (int i = 0; i < num_components_; ++i) {
+        TF_RETURN_IF_ERROR(
+            cursor->reader->ReadRecord(&cursor->offset, &record));
+        out_tensors->emplace_back();
+        TF_RETURN_IF_ERROR(DecodeTensor(record, &out_tensors->back()));
+      }
+      return Status::OK();
+    }
+
+   private:
+    // An element held in memory, either as is or, if `compress_`, as
+    // compressed `TensorProto`s.
+    struct CachedElement {
+      std::vector<Tensor> tensors;
+      std::vector<string> compressed;
+    };
+
+    // The writer flushes the spill file every `kFlushBytes`; readers flush
+    // it when they need an element that has not been flushed yet.
+    static constexpr int64 kFlushBytes = 4 << 20;
+
+    Status EncodeTensor(const Tensor& tensor, string* out) {
+      TensorProto proto;
+      tensor.AsProtoTensorContent(&proto);
+      if (!compress_) {
+        if (!proto.SerializeToString(out)) {
+          return errors::Internal("Failed to serialize a cached tensor.");
+        }
+        return Status::OK();
+      }
+      string serialized;
+      if (!proto.SerializeToString(&serialized)) {
+        return errors::Internal("Failed to serialize a cached tensor.");
+      }
+      if (!port::Snappy_Compress(serialized.data(), serialized.size(), out)) {
+        return errors::Unimplemented(
+            "Snappy compression is not supported on this platform.");
+      }
+      return Status::OK();
+    }
+
+    Status DecodeTensor(const string& encoded, Tensor* tensor) {
+      TensorProto proto;
+      if (!compress_) {
+        if (!proto.ParseFromString(encoded)) {
+          return errors::DataLoss("Failed to parse a cached tensor.");
+        }
+      } else {
+        size_t length;
+        if (!port::Snappy_GetUncompressedLength(encoded.data(),
+                                                encoded.size(), &length)) {
+          return errors::DataLoss("Failed to uncompress a cached tensor.");
+        }
+        string serialized(length, '\0');
+        if (!port::Snappy_Uncompress(encoded.data(), encoded.size(),
+                                     &serialized[0]) ||
+            !proto.ParseFromString(serialized)) {
+          return errors::DataLoss("Failed to uncompress a cached tensor.");
+        }
+      }
+      if (!tensor->FromProto(proto)) {
+        return errors::DataLoss("Failed to parse a cached tensor.");
+      }
+      return Status::OK();
+    }
+
+    // Writes the records of a spilled element, creating the spill file if
+    // needed.
+    Status WriteSpilledElementLocked(const std::vector<string>& records)
+        EXCLUSIVE_LOCKS_REQUIRED(write_mu_) {
+      if (!writer_) {
+        TF_RETURN_IF_ERROR(env_->NewWritableFile(filename_, &file_));
+        writer_.reset(new io::RecordWriter(file_.get()));
+      }
+      for (const string& record : records) {
+        TF_RETURN_IF_ERROR(writer_->WriteRecord(record));
+        unflushed_bytes_ += record.size();
+      }
+      return Status::OK();
+    }
+
+    // Makes the spilled elements written so far visible to readers.
+    Status FlushSpillFile() LOCKS_EXCLUDED(mu_, write_mu_) {
+      mutex_lock write_l(write_mu_);
+      return FlushSpillFileLocked();
+    }
+
+    Status FlushSpillFileLocked() EXCLUSIVE_LOCKS_REQUIRED(write_mu_)
+        LOCKS_EXCLUDED(mu_) {
+      Status s;
+      if (writer_) {
+        s = writer_->Flush();
+        if (s.ok()) s = file_->Flush();
+        unflushed_bytes_ = 0;
+      }
+      mutex_lock l(mu_);
+      if (!s.ok()) {
+        status_.Update(s);
+        cond_var_.notify_all();
+        return s;
+      }
+      TF_RETURN_IF_ERROR(status_);
+      num_visible_ = num_elements_;
+      cond_var_.notify_all();
+      return Status::OK();
+    }
+
+    void DiscardSpillFileLocked() EXCLUSIVE_LOCKS_REQUIRED(write_mu_) {
+      if (!writer_) return;
+      writer_->Close().IgnoreError();
+      writer_.reset();
+      file_.reset();
+      // Readers that still have the file open keep reading the old contents
+      // until they notice the new generation.
+      env_->DeleteFile(filename_).IgnoreError();
+    }
+
+    Env* const env_;
+    const string filename_;
+    const int64 memory_budget_;
+    const bool compress_;
+    const int num_components_;
+
+    mutex mu_;
+    condition_variable cond_var_;
+    bool claimed_ GUARDED_BY(mu_) = false;
+    bool completed_ GUARDED_BY(mu_) = false;
+    int64 generation_ GUARDED_BY(mu_) = 0;
+    // The elements held in memory, which are the first ones.
+    std::deque<std::shared_ptr<const CachedElement>> memory_ GUARDED_BY(mu_);
+    int64 memory_bytes_ GUARDED_BY(mu_) = 0;
+    bool spilling_ GUARDED_BY(mu_) = false;
+    // The number of cached elements, of which readers may read the first
+    // `num_visible_`.
+    int64 num_elements_ GUARDED_BY(mu_) = 0;
+    int64 num_visible_ GUARDED_BY(mu_) = 0;
+    // The first error writing the spill file.
+    Status status_ GUARDED_BY(mu_);
+    // Guards the spill file, which the writer writes and readers may flush.
+    mutex write_mu_ ACQUIRED_BEFORE(mu_);
+    std::unique_ptr<WritableFile> file_ GUARDED_BY(write_mu_);
+    std::unique_ptr<io::RecordWriter> writer_ GUARDED_BY(write_mu_);
+    int64 unflushed_bytes_ GUARDED_BY(write_mu_) = 0;
+  };
+
+  class Dataset : public GraphDatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const DatasetBase* input,
+            const string& filename, int64 memory_budget,
+            const string& compression_type)
+        : GraphDatasetBase(ctx),
+          input_(input),
+          filename_(filename),
+          memory_budget_(memory_budget),
+          compression_type_(compression_type),
+          cache_(new SpillingCache(ctx->env(), SpillFilename(ctx->env()),
+                                   memory_budget, !compression_type.empty(),
+                                   input->output_dtypes().size())) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return std::unique_ptr<IteratorBase>(new Iterator(
+          {this, strings::StrCat(prefix, "::SpillingCache")}, cache_));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() const override {
+      return "SpillingCacheDatasetOp::Dataset";
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+      Node* filename = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(filename_, &filename));
+      Node* memory_budget = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(memory_budget_, &memory_budget));
+      Node* compression_type = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this, {input_graph_node, filename, memory_budget, compression_type},
+          output));
+      return Status::OK();
+    }
+
+   private:
+    // Returns a name for the spill file that no other dataset uses.
+    string SpillFilename(Env* env) const {
+      string prefix = filename_;
+      if (prefix.empty() && !env->LocalTempFilename(&prefix)) {
+        prefix = "tf_data_spilling_cache";
+      }
+      return strings::StrCat(prefix, ".spill-", strings::Hex(random::New64()));
+    }
+
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      Iterator(const Params& params,
+               const std::shared_ptr<SpillingCache>& cache)
+          : DatasetIterator<Dataset>(params), cache_(cache) {}
+
+      ~Iterator() override {
+        mutex_lock l(mu_);
+        if (writer_) cache_->ReleaseWriter();
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        // The cache is claimed by the first call rather than on creation,
+        // so that an iterator that replaces a writer (e.g. when an
+        // initializable iterator is re-initialized) finds the cache released.
+        if (!started_) {
+          started_ = true;
+          writer_ = cache_->MaybeClaim(&cursor_.generation);
+          if (writer_) {
+            TF_RETURN_IF_ERROR(
+                dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+          }
+        }
+        if (!writer_) {
+          return cache_->Read(&cursor_, out_tensors, end_of_sequence);
+        }
+        if (!input_impl_) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+        if (*end_of_sequence) {
+          input_impl_.reset();
+          return cache_->Complete();
+        }
+        return cache_->Append(*out_tensors);
+      }
+
+     private:
+      mutex mu_;
+      const std::shared_ptr<SpillingCache> cache_;
+      bool started_ GUARDED_BY(mu_) = false;
+      // Whether this iterator writes the cache, passing through the elements
+      // of the input; otherwise it reads the cache.
+      bool writer_ GUARDED_BY(mu_) = false;
+      SpillingCache::Cursor cursor_ GUARDED_BY(mu_);
+      std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+    };
+
+    const DatasetBase* const input_;
+    const string filename_;
+    const int64 memory_budget_;
+    const string compression_type_;
+    const std::shared_ptr<SpillingCache> cache_;
+  };
+};
+
+REGISTER_KERNEL_BUILDER(Name("SpillingCacheDataset").Device(DEVICE_CPU),
+                        SpillingCacheDatasetOp);
+
+}  // namespace
+
+}  // namespace tensorflow
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/dataset_thread_pool.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/lib/core/threadpool.h"
@@ -193,6 +194,10 @@ class ThreadPoolDatasetOp : public UnaryDatasetOpKernel {
         params.lib = ctx->lib();
         params.function_library = ctx->function_library();
         params.allocator_getter = ctx->allocator_getter();
+        params.model = ctx->model();
+        params.thread_pool = ctx->thread_pool();
+        params.pipeline_id = ctx->pipeline_id();
+        params.pipeline_name = ctx->pipeline_name();
         IteratorContext threadpool_ctx(params);
         return input_impl_->GetNext(&threadpool_ctx, out_tensors,
                                     end_of_sequence);
@@ -207,10 +212,121 @@ class ThreadPoolDatasetOp : public UnaryDatasetOpKernel {
   };
 };
 
+class SharedThreadPoolDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit SharedThreadPoolDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {}
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    int64 num_threads;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<int64>(ctx, "num_threads", &num_threads));
+    OP_REQUIRES(ctx, num_threads >= 0,
+                errors::InvalidArgument(
+                    "`num_threads` must be greater than or equal to zero."));
+
+    *output = new Dataset(ctx, input, num_threads);
+  }
+
+ private:
+  class Dataset : public GraphDatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 num_threads)
+        : GraphDatasetBase(ctx), input_(input), num_threads_(num_threads) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return std::unique_ptr<IteratorBase>(
+          new Iterator({this, strings::StrCat(prefix, "::SharedThreadPool")}));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() const override {
+      return strings::StrCat("SharedThreadPoolDatasetOp(", num_threads_,
+                             ")::Dataset");
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+      Node* num_threads = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(num_threads_, &num_threads));
+      TF_RETURN_IF_ERROR(
+          b->AddDataset(this, {input_graph_node, num_threads}, output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params),
+            thread_pool_(params.dataset->num_threads_ > 0
+                             ? DatasetThreadPool::Shared(
+                                   params.dataset->num_threads_)
+                             : nullptr),
+            pipeline_id_(DatasetThreadPool::NewPipelineId()) {}
+
+      Status Initialize(IteratorContext* ctx) override {
+        IteratorContext pool_ctx(*ctx);
+        pool_ctx.set_thread_pool(thread_pool_, pipeline_id_);
+        return dataset()->input_->MakeIterator(&pool_ctx, prefix(),
+                                               &input_impl_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        IteratorContext pool_ctx(*ctx);
+        pool_ctx.set_thread_pool(thread_pool_, pipeline_id_);
+        return input_impl_->GetNext(&pool_ctx, out_tensors, end_of_sequence);
+      }
+
+     protected:
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        TF_RETURN_IF_ERROR(SaveInput(writer, input_impl_));
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        IteratorContext pool_ctx(*ctx);
+        pool_ctx.set_thread_pool(thread_pool_, pipeline_id_);
+        TF_RETURN_IF_ERROR(RestoreInput(&pool_ctx, reader, input_impl_));
+        return Status::OK();
+      }
+
+     private:
+      DatasetThreadPool* const thread_pool_;  // Not owned.
+      const int64 pipeline_id_;
+      std::unique_ptr<IteratorBase> input_impl_;
+    };
+
+    const DatasetBase* const input_;
+    const int64 num_threads_;
+  };
+};
+
 REGISTER_KERNEL_BUILDER(Name("ThreadPoolHandle").Device(DEVICE_CPU),
                         ThreadPoolHandleOp);
 REGISTER_KERNEL_BUILDER(Name("ThreadPoolDataset").Device(DEVICE_CPU),
                         ThreadPoolDatasetOp);
+REGISTER_KERNEL_BUILDER(Name("SharedThreadPoolDataset").Device(DEVICE_CPU),
+                        SharedThreadPoolDatasetOp);
 
 }  // namespace
 }  // namespace tensorflow
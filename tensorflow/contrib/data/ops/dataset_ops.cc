@@ -90,6 +90,120 @@ REGISTER_OP("UniqueDataset")
 Creates a dataset that contains the unique elements of `input_dataset`.
 )doc");
 
+REGISTER_OP("SpillingCacheDataset")
+    .Input("input_dataset: variant")
+    .Input("filename: string")
+    .Input("memory_budget: int64")
+    .Input("compression_type: string")
+    .Output("handle: variant")
+    .Attr("output_types: list(type) >= 1")
+    .Attr("output_shapes: list(shape) >= 1")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      // `filename`, `memory_budget` and `compression_type` must be scalars.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      return shape_inference::ScalarShape(c);
+    })
+    .Doc(R"doc(
+Creates a dataset that caches the elements of `input_dataset`, in memory up to
+a budget and in a file beyond it.
+
+The first iterator reads `input_dataset` and caches its elements; later
+iterators read the cache, waiting for elements that are not yet cached. The
+elements that come first are kept in memory, and the others are written to a
+file that is deleted with the dataset.
+
+filename: A path prefix for the file to which elements are spilled. If empty,
+  the file is created in the local temporary directory.
+memory_budget: The maximum number of bytes of elements to keep in memory.
+compression_type: "SNAPPY" to compress the cached elements, both in memory and
+  in the file, or "" to leave them uncompressed.
+)doc");
+
+REGISTER_OP("BoundedMemoryShuffleDataset")
+    .Input("input_dataset: variant")
+    .Input("window_size: int64")
+    .Input("memory_budget: int64")
+    .Input("directory: string")
+    .Input("seed: int64")
+    .Input("seed2: int64")
+    .Output("handle: variant")
+    .Attr("output_types: list(type) >= 1")
+    .Attr("output_shapes: list(shape) >= 1")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      // `window_size`, `memory_budget`, `directory`, `seed` and `seed2` must
+      // be scalars.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(5), 0, &unused));
+      return shape_inference::ScalarShape(c);
+    })
+    .Doc(R"doc(
+Creates a dataset that shuffles consecutive windows of elements of
+`input_dataset`, holding at most a budget of bytes of elements in memory.
+
+Each window is produced in a uniformly random order. If a window does not fit
+in `memory_budget`, it is split into blocks that are shuffled in memory and
+written to scratch files, and the blocks are merged at random.
+
+window_size: The number of elements in each window, or -1 to make each window
+  as many elements as fit in `memory_budget`.
+memory_budget: The maximum number of bytes of elements to keep in memory.
+directory: The directory in which to create scratch files. If empty, they are
+  created in the local temporary directory.
+seed: A scalar seed for the random number generator. If either seed or
+  seed2 is set to be non-zero, the random number generator is seeded
+  by the given seed.  Otherwise, a random seed is used.
+seed2: A second scalar seed to avoid seed collision.
+)doc");
+
+REGISTER_OP("ParallelTFRecordDataset")
+    .Input("filenames: string")
+    .Input("compression_type: string")
+    .Input("buffer_size: int64")
+    .Input("num_parallel_reads: int64")
+    .Input("range_size: int64")
+    .Output("handle: variant")
+    .SetIsStateful()  // TODO(b/65524810): Source dataset ops must be marked
+                      // stateful to inhibit constant folding.
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      // `filenames` must be a scalar or a vector.
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(0), 1, &unused));
+      // `compression_type`, `buffer_size`, `num_parallel_reads` and
+      // `range_size` must be scalars.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 0, &unused));
+      return shape_inference::ScalarShape(c);
+    })
+    .Doc(R"doc(
+Creates a dataset that emits the records from one or more TFRecord files,
+reading each file with several threads.
+
+Uncompressed files are split into ranges of `range_size` bytes, which are read
+and parsed concurrently. Once the ranges of a file have all been scheduled, the
+ranges of the next files are read ahead, so that files smaller than
+`num_parallel_reads * range_size` are read concurrently too. The records are
+emitted in the same order as `TFRecordDataset` emits them.
+
+filenames: A scalar or vector containing the name(s) of the file(s) to be
+  read.
+compression_type: A scalar containing either (i) the empty string (no
+  compression), (ii) "ZLIB", or (iii) "GZIP". Compressed files are read
+  sequentially.
+buffer_size: A scalar representing the number of bytes to buffer when reading
+  compressed files. A value of 0 means no buffering will be performed.
+num_parallel_reads: The maximum number of ranges to read concurrently.
+range_size: The size in bytes of the ranges into which files are split.
+)doc");
+
 REGISTER_OP("IteratorGetDevice")
     .Input("resource: resource")
     .Output("device: string")
@@ -253,6 +367,28 @@ display_name: A human-readable name for the threads that may be visible in
   some visualizations.
 )doc");
 
+REGISTER_OP("SharedThreadPoolDataset")
+    .Input("input_dataset: variant")
+    .Input("num_threads: int64")
+    .Output("handle: variant")
+    .Attr("output_types: list(type) >= 1")
+    .Attr("output_shapes: list(shape) >= 1")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      // num_threads should be a scalar.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      return shape_inference::ScalarShape(c);
+    })
+    .Doc(R"doc(
+Creates a dataset that runs the background work of `input_dataset` on a
+process-wide thread pool, which it shares with the other input pipelines that
+use a pool of the same size.
+
+num_threads: The number of threads in the shared pool. If 0, the background
+  work of `input_dataset` runs on threads of its own, even if the pool set by
+  TF_DATA_SHARED_THREADPOOL_SIZE is enabled.
+)doc");
+
 REGISTER_OP("AssertNextDataset")
     .Input("input_dataset: variant")
     .Input("transformations: string")
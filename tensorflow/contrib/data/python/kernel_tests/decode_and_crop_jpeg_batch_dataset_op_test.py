@@ -0,0 +1,251 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for the experimental input pipeline ops."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import multiprocessing
+import time
+
+import numpy as np
+
+from tensorflow.contrib.data.python.ops import image_ops
+from tensorflow.core.protobuf import config_pb2
+from tensorflow.python.client import session
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import errors
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import image_ops as core_image_ops
+from tensorflow.python.ops import math_ops
+from tensorflow.python.platform import test
+
+
+def _encode_jpegs(shapes):
+  """Returns smooth random images of `shapes`, encoded as JPEG."""
+  with ops.Graph().as_default(), session.Session() as sess:
+    images = []
+    for height, width, channels in shapes:
+      gradient = np.add.outer(
+          np.linspace(0, 128, height), np.linspace(0, 96, width))
+      noise = np.random.randint(0, 32, size=(height, width, channels))
+      image = (gradient[:, :, np.newaxis] + noise).astype(np.uint8)
+      images.append(sess.run(core_image_ops.encode_jpeg(image)))
+    return images
+
+
+class DecodeAndCropJpegBatchDatasetTest(test.TestCase):
+
+  def _getBatches(self, dataset):
+    get_next = dataset.make_one_shot_iterator().get_next()
+    batches = []
+    with self.test_session() as sess:
+      while True:
+        try:
+          batches.append(sess.run(get_next))
+        except errors.OutOfRangeError:
+          return batches
+
+  def testSmallCropIsDecodedExactly(self):
+    # A crop window smaller than twice the output size is decoded at full
+    # scale, straight into the batch.
+    jpegs = _encode_jpegs([(48, 64, 3)] * 3)
+    windows = [[0, 0, 16, 24], [5, 7, 16, 24], [32, 40, 16, 24]]
+    dataset = dataset_ops.Dataset.from_tensor_slices((jpegs, windows)).apply(
+        image_ops.decode_and_crop_jpeg_batch(2, [16, 24]))
+    batches = self._getBatches(dataset)
+
+    with self.test_session() as sess:
+      expected = sess.run([
+          core_image_ops.decode_and_crop_jpeg(jpeg, window, channels=3)
+          for jpeg, window in zip(jpegs, windows)
+      ])
+    self.assertEqual(2, len(batches))
+    self.assertAllEqual(np.stack(expected[:2]), batches[0])
+    self.assertAllEqual(np.stack(expected[2:]), batches[1])
+
+  def testWholeImageIsDecodedAtReducedScale(self):
+    jpegs = _encode_jpegs([(64, 96, 3)] * 2)
+    for ratio in [2, 4, 8]:
+      dataset = dataset_ops.Dataset.from_tensor_slices(jpegs).apply(
+          image_ops.decode_and_crop_jpeg_batch(2, [64 // ratio, 96 // ratio]))
+      batches = self._getBatches(dataset)
+
+      with self.test_session() as sess:
+        expected = sess.run([
+            core_image_ops.decode_jpeg(jpeg, channels=3, ratio=ratio)
+            for jpeg in jpegs
+        ])
+      self.assertEqual(1, len(batches))
+      self.assertAllEqual(np.stack(expected), batches[0])
+
+  def testReducedScaleCropKeepsItsWindow(self):
+    # Crop windows that are not aligned to the scale of 2 they are decoded at.
+    # The first one is decoded straight into the batch, the others resized.
+    jpegs = _encode_jpegs([(64, 96, 3)] * 3)
+    windows = [[2, 4, 32, 48], [3, 5, 33, 50], [7, 9, 32, 48]]
+    output_size = [16, 24]
+    dataset = dataset_ops.Dataset.from_tensor_slices((jpegs, windows)).apply(
+        image_ops.decode_and_crop_jpeg_batch(3, output_size))
+    batches = self._getBatches(dataset)
+
+    with self.test_session() as sess:
+      expected = []
+      for jpeg, (y, x, height, width) in zip(jpegs, windows):
+        # The end of the window is rounded to the scaled image.
+        image = core_image_ops.decode_jpeg(jpeg, channels=3, ratio=2)
+        image = image[y // 2:(y + height + 1) // 2, x // 2:(x + width + 1) // 2]
+        expected.append(
+            sess.run(core_image_ops.resize_bilinear([image], output_size)[0]))
+    self.assertEqual(1, len(batches))
+    self.assertAllClose(np.stack(expected), batches[0], rtol=0, atol=1)
+
+  def testResizedCropIsCloseToMapPipeline(self):
+    jpegs = _encode_jpegs([(120, 160, 3), (90, 100, 3), (64, 64, 3)])
+    windows = [[10, 20, 90, 120], [0, 0, 90, 100], [8, 8, 40, 48]]
+    output_size = [24, 36]
+    dataset = dataset_ops.Dataset.from_tensor_slices((jpegs, windows)).apply(
+        image_ops.decode_and_crop_jpeg_batch(3, output_size))
+    batches = self._getBatches(dataset)
+
+    with self.test_session() as sess:
+      expected = sess.run([
+          core_image_ops.resize_bilinear(
+              [core_image_ops.decode_and_crop_jpeg(jpeg, window)],
+              output_size)[0] for jpeg, window in zip(jpegs, windows)
+      ])
+    self.assertEqual(1, len(batches))
+    self.assertEqual((3, 24, 36, 3), batches[0].shape)
+    # The images decoded at a reduced scale are averaged over blocks of
+    # pixels rather than interpolated between them.
+    self.assertLess(
+        np.mean(np.abs(batches[0].astype(np.float32) - np.stack(expected))),
+        8)
+
+  def testGrayscale(self):
+    jpegs = _encode_jpegs([(32, 32, 1), (32, 32, 3)])
+    dataset = dataset_ops.Dataset.from_tensor_slices(jpegs).apply(
+        image_ops.decode_and_crop_jpeg_batch(2, [32, 32], channels=1))
+    self.assertEqual([None, 32, 32, 1], dataset.output_shapes.as_list())
+    batches = self._getBatches(dataset)
+
+    with self.test_session() as sess:
+      expected = sess.run([
+          core_image_ops.decode_jpeg(jpeg, channels=1) for jpeg in jpegs
+      ])
+    self.assertAllEqual(np.stack(expected), batches[0])
+
+  def testDropRemainder(self):
+    jpegs = _encode_jpegs([(16, 16, 3)] * 5)
+    dataset = dataset_ops.Dataset.from_tensor_slices(jpegs).apply(
+        image_ops.decode_and_crop_jpeg_batch(2, [8, 8]))
+    self.assertEqual([None, 8, 8, 3], dataset.output_shapes.as_list())
+    self.assertEqual([2, 2, 1],
+                     [batch.shape[0] for batch in self._getBatches(dataset)])
+
+    dataset = dataset_ops.Dataset.from_tensor_slices(jpegs).apply(
+        image_ops.decode_and_crop_jpeg_batch(2, [8, 8], drop_remainder=True))
+    self.assertEqual([2, 8, 8, 3], dataset.output_shapes.as_list())
+    self.assertEqual([2, 2],
+                     [batch.shape[0] for batch in self._getBatches(dataset)])
+
+  def testInvalidCropWindow(self):
+    jpegs = _encode_jpegs([(16, 16, 3)])
+    dataset = dataset_ops.Dataset.from_tensor_slices(
+        (jpegs, [[8, 8, 16, 16]])).apply(
+            image_ops.decode_and_crop_jpeg_batch(1, [8, 8]))
+    get_next = dataset.make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                   "Invalid crop window"):
+        sess.run(get_next)
+
+  def testInvalidJpeg(self):
+    dataset = dataset_ops.Dataset.from_tensors("not a jpeg").apply(
+        image_ops.decode_and_crop_jpeg_batch(1, [8, 8]))
+    get_next = dataset.make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                   "Invalid JPEG data"):
+        sess.run(get_next)
+
+  def testInvalidInputTypes(self):
+    dataset = dataset_ops.Dataset.from_tensors(0)
+    with self.assertRaisesRegexp(TypeError, "requires an input whose"):
+      dataset.apply(image_ops.decode_and_crop_jpeg_batch(1, [8, 8]))
+
+
+class DecodeAndCropJpegBatchBenchmark(test.Benchmark):
+
+  # Compares the images per second per core of the fused transformation with
+  # those of the equivalent pipeline of `map()` and `batch()`.
+  def benchmarkDecodeAndCropJpegBatch(self):
+    num_cores = multiprocessing.cpu_count()
+    batch_size = 64
+    num_iters = 20
+    jpegs = _encode_jpegs([(375, 500, 3)] * 16)
+    # Random crops of 40% to 100% of each side, as when training on ImageNet.
+    windows = []
+    for _ in jpegs:
+      height = np.random.randint(150, 376)
+      width = np.random.randint(200, 501)
+      windows.append([
+          np.random.randint(0, 376 - height),
+          np.random.randint(0, 501 - width), height, width
+      ])
+    output_size = [224, 224]
+    dataset = dataset_ops.Dataset.from_tensor_slices((jpegs, windows)).repeat()
+
+    def decode_and_resize(jpeg, window):
+      image = core_image_ops.decode_and_crop_jpeg(jpeg, window, channels=3)
+      image = core_image_ops.resize_bilinear([image], output_size)[0]
+      return math_ops.cast(image, dtypes.uint8)
+
+    pipelines = [
+        ("map_and_batch",
+         dataset.map(decode_and_resize, num_parallel_calls=num_cores).batch(
+             batch_size)),
+        ("decode_and_crop_jpeg_batch",
+         dataset.apply(
+             image_ops.decode_and_crop_jpeg_batch(batch_size, output_size))),
+    ]
+    for name, pipeline in pipelines:
+      get_next = pipeline.prefetch(1).make_one_shot_iterator().get_next()
+      deltas = []
+      with session.Session(
+          config=config_pb2.ConfigProto(
+              intra_op_parallelism_threads=num_cores,
+              inter_op_parallelism_threads=num_cores,
+              use_per_session_threads=True)) as sess:
+        for _ in range(5):
+          sess.run(get_next.op)
+        for _ in range(num_iters):
+          start = time.time()
+          sess.run(get_next.op)
+          deltas.append(time.time() - start)
+
+      images_per_second_per_core = batch_size / np.median(deltas) / num_cores
+      print("%s: %f images/s/core (%d cores)" %
+            (name, images_per_second_per_core, num_cores))
+      self.report_benchmark(
+          iters=num_iters,
+          wall_time=np.median(deltas),
+          extras={"images_per_second_per_core": images_per_second_per_core},
+          name="%s_batch_size_%d" % (name, batch_size))
+
+
+if __name__ == "__main__":
+  test.main()
@@ -20,21 +20,25 @@ from __future__ import print_function
 import hashlib
 import itertools
 import os
+import threading
 import time
 
 import numpy as np
 
 from tensorflow.contrib.data.python.ops import batching
 from tensorflow.contrib.data.python.ops import error_ops
+from tensorflow.contrib.data.python.ops import map_ops
 from tensorflow.contrib.data.python.ops import optimization
 from tensorflow.core.protobuf import config_pb2
 from tensorflow.python.client import session
 from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import errors
 from tensorflow.python.framework import ops
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import io_ops
 from tensorflow.python.ops import math_ops
+from tensorflow.python.ops import script_ops
 from tensorflow.python.platform import test
 from tensorflow.python.util import compat
 
@@ -147,6 +151,70 @@ class MapDatasetTest(test.TestCase):
         with self.assertRaises(errors.OutOfRangeError):
           sess.run(get_next)
 
+  def _blockedMapFn(self, blocked, unblock):
+    """Returns a map function whose call on `blocked` waits for `unblock`."""
+
+    def _py_fn(x):
+      if x == blocked:
+        unblock.wait()
+      return x
+
+    return lambda x: script_ops.py_func(_py_fn, [x], dtypes.int64)
+
+  def testSloppyMapDoesNotWaitForSlowElements(self):
+    unblock = threading.Event()
+    dataset = dataset_ops.Dataset.range(10).apply(
+        map_ops.sloppy_map(self._blockedMapFn(0, unblock),
+                           num_parallel_calls=4))
+    get_next = dataset.make_one_shot_iterator().get_next()
+
+    with self.test_session() as sess:
+      # Elements 1 to 3 are produced while the call on 0 is blocked.
+      results = [sess.run(get_next) for _ in range(3)]
+      self.assertNotIn(0, results)
+      unblock.set()
+      results.extend(sess.run(get_next) for _ in range(7))
+      self.assertItemsEqual(range(10), results)
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testSloppyMapEndsAfterAllElements(self):
+    unblock = threading.Event()
+    dataset = dataset_ops.Dataset.range(3).apply(
+        map_ops.sloppy_map(self._blockedMapFn(0, unblock),
+                           num_parallel_calls=4))
+    get_next = dataset.make_one_shot_iterator().get_next()
+
+    with self.test_session() as sess:
+      # The calls past the end of the input complete immediately, but must not
+      # end the sequence before the blocked element.
+      self.assertItemsEqual([1, 2], [sess.run(get_next) for _ in range(2)])
+      unblock.set()
+      self.assertEqual(0, sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testSloppyMapAndBatchDoesNotWaitForSlowBatches(self):
+    unblock = threading.Event()
+    dataset = dataset_ops.Dataset.range(10).apply(
+        batching.map_and_batch(
+            self._blockedMapFn(0, unblock),
+            batch_size=2,
+            num_parallel_calls=6,
+            sloppy=True))
+    get_next = dataset.make_one_shot_iterator().get_next()
+
+    with self.test_session() as sess:
+      results = [sess.run(get_next) for _ in range(2)]
+      self.assertNotIn(0, np.concatenate(results))
+      unblock.set()
+      results.extend(sess.run(get_next) for _ in range(3))
+      # The elements of each batch are still consecutive.
+      self.assertItemsEqual([[0, 1], [2, 3], [4, 5], [6, 7], [8, 9]],
+                            [list(batch) for batch in results])
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
 
 class MapDatasetBenchmark(test.Benchmark):
 
@@ -268,6 +336,55 @@ class MapDatasetBenchmark(test.Benchmark):
     benchmark("Transformation parallelism evaluation", par_num_calls_series)
     benchmark("Threadpool size evaluation", par_inter_op_series)
 
+  # This benchmark compares the latency and throughput of an ordered and a
+  # sloppy map whose cost per element has a heavy tail, as decoding images of
+  # varying sizes does.
+  def benchmarkSloppyMapWithHeavyTailedLatency(self):
+    num_elements = 2000
+    np.random.seed(_NUMPY_RANDOM_SEED)
+    # Pareto distributed costs: 1ms at least, 4ms on average, about 1% of the
+    # elements over 50ms.
+    costs = 0.001 * (1 + np.random.pareto(1.33, num_elements))
+
+    def _py_fn(cost):
+      time.sleep(cost)
+      return cost
+
+    def _map_fn(cost):
+      return script_ops.py_func(_py_fn, [cost], dtypes.float64)
+
+    for num_calls in [4, 16]:
+      for sloppy in [False, True]:
+        dataset = dataset_ops.Dataset.from_tensor_slices(costs)
+        if sloppy:
+          dataset = dataset.apply(map_ops.sloppy_map(_map_fn, num_calls))
+        else:
+          dataset = dataset.map(_map_fn, num_parallel_calls=num_calls)
+        get_next = dataset.make_one_shot_iterator().get_next()
+
+        deltas = []
+        with session.Session(
+            config=config_pb2.ConfigProto(
+                inter_op_parallelism_threads=2 * num_calls,
+                use_per_session_threads=True)) as sess:
+          start = time.time()
+          for _ in range(num_elements):
+            element_start = time.time()
+            sess.run(get_next.op)
+            deltas.append(time.time() - element_start)
+          total = time.time() - start
+
+        label = "sloppy" if sloppy else "ordered"
+        print("%s map, num parallel calls: %d\n  get_next latency: %f "
+              "(median), %f (p99), %f (max)\n  throughput: %f elements/s" %
+              (label, num_calls, np.median(deltas), np.percentile(deltas, 99),
+               np.max(deltas), num_elements / total))
+        self.report_benchmark(
+            iters=num_elements,
+            wall_time=total / num_elements,
+            name="heavy_tailed_%s_num_calls_%d" % (label, num_calls),
+            extras={"p99_latency": np.percentile(deltas, 99)})
+
   # This benchmark compares the performance of pipeline with multiple chained
   # maps with and without map fusion.
   def benchmarkChainOfMaps(self):
@@ -354,5 +471,50 @@ class MapAndFilterBenchmark(test.Benchmark):
                 opt_mark, chain_length))
 
 
+class MapVectorizationBenchmark(test.Benchmark):
+
+  # This benchmark compares the throughput of map followed by batch with and
+  # without map vectorization, which runs the map function once per batch
+  # instead of once per element.
+  def benchmarkMapAndBatch(self):
+    for batch_size in [1, 10, 100, 1000]:
+      self._benchmarkMapAndBatch(batch_size, False)
+      self._benchmarkMapAndBatch(batch_size, True)
+
+  def _benchmarkMapAndBatch(self, batch_size, optimize_dataset):
+    with ops.Graph().as_default():
+      dataset = dataset_ops.Dataset.from_tensors(
+          np.zeros([32], dtype=np.float32)).repeat(None)
+      dataset = dataset.map(
+          lambda x: math_ops.sqrt(math_ops.abs(x) * 2.0 + 1.0)).batch(
+              batch_size)
+      if optimize_dataset:
+        dataset = dataset.apply(optimization.optimize(["map_vectorization"]))
+
+      iterator = dataset.make_one_shot_iterator()
+      next_element = iterator.get_next()
+
+      with session.Session() as sess:
+        for _ in range(10):
+          sess.run(next_element.op)
+        deltas = []
+        for _ in range(20):
+          start = time.time()
+          for _ in range(10):
+            sess.run(next_element.op)
+          end = time.time()
+          deltas.append(end - start)
+
+        median_wall_time = np.median(deltas) / (10 * batch_size)
+        opt_mark = "opt" if optimize_dataset else "no-opt"
+        print("Map and batch dataset {} batch size: {} Median wall time per "
+              "element: {}".format(opt_mark, batch_size, median_wall_time))
+        self.report_benchmark(
+            iters=200 * batch_size,
+            wall_time=median_wall_time,
+            name="benchmark_map_and_batch_vectorization_{}_{}".format(
+                opt_mark, batch_size))
+
+
 if __name__ == "__main__":
   test.main()
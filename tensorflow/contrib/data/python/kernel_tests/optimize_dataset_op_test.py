@@ -18,6 +18,7 @@ from __future__ import division
 from __future__ import print_function
 
 from absl.testing import parameterized
+import numpy as np
 
 from tensorflow.contrib.data.python.kernel_tests import stats_dataset_test_base
 from tensorflow.contrib.data.python.ops import optimization
@@ -26,7 +27,9 @@ from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.framework import constant_op
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import errors
+from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import math_ops
+from tensorflow.python.ops import parsing_ops
 from tensorflow.python.platform import test
 
 
@@ -247,6 +250,81 @@ class OptimizeDatasetTest(test.TestCase, parameterized.TestCase):
 
     self._testMapAndFilter(dataset, function, predicate)
 
+  def _assertDatasetsProduceSameElements(self, expected, actual):
+    expected_next = expected.make_one_shot_iterator().get_next()
+    actual_next = actual.make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      while True:
+        try:
+          expected_element = sess.run(expected_next)
+        except errors.OutOfRangeError:
+          break
+        self.assertAllEqual(expected_element, sess.run(actual_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(actual_next)
+
+  @staticmethod
+  def map_vectorization_functions():
+
+    def numbers():
+      return dataset_ops.Dataset.from_tensor_slices(
+          np.arange(40, dtype=np.int64).reshape([10, 4]))
+
+    def strings():
+      return dataset_ops.Dataset.from_tensor_slices(
+          ["%04d" % i for i in range(10)])
+
+    def subtract_captured():
+      captured = constant_op.constant([1, 2, 3, 4], dtype=dtypes.int64)
+      return lambda x: x - captured
+
+    return (
+        ("Cast", numbers,
+         lambda: lambda x: math_ops.cast(x, dtypes.float32)),
+        ("Unary", numbers,
+         lambda: lambda x: math_ops.sqrt(math_ops.cast(x, dtypes.float64))),
+        ("Binary", numbers, lambda: lambda x: x * x + 1),
+        ("Broadcast", numbers,
+         lambda: lambda x: x * constant_op.constant([[1], [2]], dtypes.int64)),
+        ("Captured", numbers, subtract_captured),
+        ("Reshape", numbers, lambda: lambda x: array_ops.reshape(x, [2, 2])),
+        ("DecodeRaw", strings,
+         lambda: lambda x: parsing_ops.decode_raw(x, dtypes.uint8)),
+    )
+
+  @parameterized.named_parameters(*map_vectorization_functions.__func__())
+  def testMapVectorization(self, make_input_dataset, make_function):
+    input_dataset = make_input_dataset()
+    function = make_function()
+    expected = input_dataset.map(function).batch(4)
+    actual = input_dataset.apply(optimization.assert_next(
+        ["Batch", "Map"])).map(function).batch(4).apply(
+            optimization.optimize(["map_vectorization"]))
+    self._assertDatasetsProduceSameElements(expected, actual)
+
+  def testMapVectorizationFallsBackForUnsupportedFunctions(self):
+    input_dataset = dataset_ops.Dataset.from_tensor_slices(
+        np.arange(40, dtype=np.float32).reshape([10, 2, 2]))
+    # MatMul has no vectorizer, so the map is left as it is.
+    function = lambda x: math_ops.matmul(x, x)
+    expected = input_dataset.map(function).batch(4)
+    actual = input_dataset.apply(optimization.assert_next(
+        ["Map", "Batch"])).map(function).batch(4).apply(
+            optimization.optimize(["map_vectorization"]))
+    self._assertDatasetsProduceSameElements(expected, actual)
+
+  def testMapVectorizationKeepsElementsOfUnknownShape(self):
+    # Batching the elements of different shapes would fail, even though the
+    # map turns them into scalars.
+    input_dataset = dataset_ops.Dataset.range(10).map(
+        lambda x: array_ops.fill([x], x))
+    function = lambda x: math_ops.reduce_sum(x) + 1
+    expected = input_dataset.map(function).batch(4)
+    actual = input_dataset.apply(optimization.assert_next(
+        ["Map", "Batch"])).map(function).batch(4).apply(
+            optimization.optimize(["map_vectorization"]))
+    self._assertDatasetsProduceSameElements(expected, actual)
+
 
 class OptimizeStatsDatasetTest(stats_dataset_test_base.StatsDatasetTestBase):
 
@@ -19,18 +19,21 @@ from __future__ import print_function
 
 import gzip
 import os
+import time
 import zlib
 
 import numpy as np
 
 from tensorflow.contrib.data.python.kernel_tests import reader_dataset_ops_test_base
 from tensorflow.contrib.data.python.ops import readers
+from tensorflow.python.client import session
 from tensorflow.python.data.ops import readers as core_readers
 from tensorflow.python.data.util import nest
 from tensorflow.python.framework import constant_op
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import errors
 from tensorflow.python.framework import ops
+from tensorflow.python.lib.io import python_io
 from tensorflow.python.ops import parsing_ops
 from tensorflow.python.ops import string_ops
 from tensorflow.python.platform import test
@@ -1027,5 +1030,183 @@ class MakeTFRecordDatasetTest(
       self.assertEqual(32, shape[0])
 
 
+class ParallelTFRecordDatasetTest(
+    reader_dataset_ops_test_base.TFRecordDatasetTestBase):
+
+  def _read_all(self, dataset):
+    get_next = dataset.make_one_shot_iterator().get_next()
+    records = []
+    with self.test_session() as sess:
+      while True:
+        try:
+          records.append(sess.run(get_next))
+        except errors.OutOfRangeError:
+          break
+    return records
+
+  def testMatchesTFRecordDataset(self):
+    # Records of various sizes, some of which span several ranges.
+    filenames = []
+    for i in range(3):
+      fn = os.path.join(self.get_temp_dir(), "parallel.%d.tfrecord" % i)
+      writer = python_io.TFRecordWriter(fn)
+      for j in range(100):
+        writer.write(b"%d" % i * (j * 7 % 150))
+      writer.close()
+      filenames.append(fn)
+    expected = self._read_all(core_readers.TFRecordDataset(filenames))
+    self.assertEqual(300, len(expected))
+    for num_parallel_reads in [1, 4]:
+      for range_size in [64, 1000, 1 << 20]:
+        self.assertEqual(
+            expected,
+            self._read_all(
+                readers.ParallelTFRecordDataset(
+                    filenames,
+                    num_parallel_reads=num_parallel_reads,
+                    range_size=range_size)))
+
+  def testManySmallFiles(self):
+    # The files are smaller than a range, so the reads continue into the
+    # next files.
+    filenames = []
+    for i in range(20):
+      fn = os.path.join(self.get_temp_dir(), "small.%d.tfrecord" % i)
+      writer = python_io.TFRecordWriter(fn)
+      for j in range(i % 4):
+        writer.write(b"%d.%d" % (i, j))
+      writer.close()
+      filenames.append(fn)
+    expected = self._read_all(core_readers.TFRecordDataset(filenames))
+    for num_parallel_reads in [1, 4]:
+      for range_size in [8, 1 << 20]:
+        self.assertEqual(
+            expected,
+            self._read_all(
+                readers.ParallelTFRecordDataset(
+                    filenames,
+                    num_parallel_reads=num_parallel_reads,
+                    range_size=range_size)))
+
+  def testMissingFileAfterReadAhead(self):
+    filenames = self.test_filenames[:1] + [
+        os.path.join(self.get_temp_dir(), "missing.tfrecord")
+    ] + self.test_filenames[1:]
+    get_next = readers.ParallelTFRecordDataset(
+        filenames, range_size=1 << 20).make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      # The error is only returned once the records of the first file have
+      # been read.
+      for j in range(self._num_records):
+        self.assertEqual(self._record(0, j), sess.run(get_next))
+      with self.assertRaises(errors.NotFoundError):
+        sess.run(get_next)
+
+  def testCompressedFiles(self):
+    gzip_files = []
+    for i, fn in enumerate(self.test_filenames):
+      with open(fn, "rb") as f:
+        gzfn = os.path.join(self.get_temp_dir(), "tfrecord_%s.gz" % i)
+        with gzip.GzipFile(gzfn, "wb") as gzf:
+          gzf.write(f.read())
+        gzip_files.append(gzfn)
+    expected = [
+        self._record(i, j)
+        for i in range(self._num_files)
+        for j in range(self._num_records)
+    ]
+    self.assertEqual(
+        expected,
+        self._read_all(
+            readers.ParallelTFRecordDataset(
+                gzip_files, compression_type="GZIP", range_size=10)))
+
+  def testCorruptRecord(self):
+    fn = self.test_filenames[0]
+    with open(fn, "rb") as f:
+      contents = bytearray(f.read())
+    # Each record takes 34 bytes; corrupt the data of the second one.
+    contents[34 + 12] ^= 1
+    with open(fn, "wb") as f:
+      f.write(contents)
+    get_next = readers.ParallelTFRecordDataset(
+        fn, range_size=20).make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      self.assertEqual(self._record(0, 0), sess.run(get_next))
+      with self.assertRaisesRegexp(errors.DataLossError,
+                                   "corrupted record at 46"):
+        sess.run(get_next)
+
+  def testInvalidArguments(self):
+    with self.test_session() as sess:
+      with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                   "`num_parallel_reads` must be > 0"):
+        sess.run(
+            readers.ParallelTFRecordDataset(
+                self.test_filenames,
+                num_parallel_reads=0).make_one_shot_iterator().get_next())
+      with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                   "`range_size` must be > 0"):
+        sess.run(
+            readers.ParallelTFRecordDataset(
+                self.test_filenames,
+                range_size=0).make_one_shot_iterator().get_next())
+
+
+class ParallelTFRecordDatasetBenchmark(test.Benchmark):
+
+  # Compares the throughput of `TFRecordDataset`, with and without
+  # `parallel_interleave`, and `ParallelTFRecordDataset` over 4 files of
+  # 512MB. Set TEST_TMPDIR to a directory on the device to measure.
+  def benchmarkReadThroughput(self):
+    num_files = 4
+    record_size = 100 * 1024
+    records_per_file = 512 * 1024 * 1024 // record_size
+    filenames = []
+    for i in range(num_files):
+      fn = os.path.join(self.get_temp_dir(), "benchmark.%d.tfrecord" % i)
+      writer = python_io.TFRecordWriter(fn)
+      record = os.urandom(record_size)
+      for _ in range(records_per_file):
+        writer.write(record)
+      writer.close()
+      filenames.append(fn)
+    num_records = num_files * records_per_file
+
+    configs = [
+        ("sequential", lambda: core_readers.TFRecordDataset(filenames)),
+        ("parallel_interleave",
+         lambda: core_readers.TFRecordDataset(
+             filenames, num_parallel_reads=num_files)),
+    ]
+    for num_parallel_reads in [1, 4, 16]:
+      configs.append(
+          ("parallel_ranges_%d" % num_parallel_reads,
+           lambda n=num_parallel_reads: readers.ParallelTFRecordDataset(
+               filenames, num_parallel_reads=n)))
+    for name, make_dataset in configs:
+      with ops.Graph().as_default():
+        # Batching keeps the per-element session overhead off the
+        # measurement.
+        get_next = make_dataset().batch(128).make_one_shot_iterator(
+        ).get_next()
+        with session.Session() as sess:
+          start = time.time()
+          try:
+            while True:
+              sess.run(get_next.op)
+          except errors.OutOfRangeError:
+            pass
+          wall_time = time.time() - start
+
+      print("%s: %f MB/s" % (name, num_records * record_size / wall_time / 1e6))
+      self.report_benchmark(
+          iters=num_records,
+          wall_time=wall_time / num_records,
+          name="benchmark_read_throughput_%s" % name)
+    for fn in filenames:
+      os.remove(fn)
+
+
 if __name__ == "__main__":
   test.main()
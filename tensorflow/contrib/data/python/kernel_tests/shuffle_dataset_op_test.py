@@ -17,12 +17,17 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+import resource
+import time
+
 import numpy as np
 
 from tensorflow.contrib.data.python.ops import shuffle_ops
+from tensorflow.python.client import session
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.framework import errors
 from tensorflow.python.framework import ops
+from tensorflow.python.platform import gfile
 from tensorflow.python.platform import test
 
 
@@ -110,5 +115,128 @@ class ShuffleAndRepeatTest(test.TestCase):
         sess.run(get_next_op)
 
 
+class BoundedMemoryShuffleTest(test.TestCase):
+
+  def _gen_outputs(self, ds_fn):
+    get_next = ds_fn().make_one_shot_iterator().get_next()
+    outputs = []
+    with self.test_session() as sess:
+      while True:
+        try:
+          outputs.append(sess.run(get_next))
+        except errors.OutOfRangeError:
+          break
+    return outputs
+
+  def _build_ds(self, memory_budget, window_size=None, seed=10,
+                num_elements=100):
+    return dataset_ops.Dataset.range(num_elements).apply(
+        shuffle_ops.bounded_memory_shuffle(
+            memory_budget, window_size=window_size,
+            directory=self.get_temp_dir(), seed=seed))
+
+  def _assertWindowsArePermutations(self, output, window_size, num_elements):
+    self.assertEqual(num_elements, len(output))
+    for start in range(0, num_elements, window_size):
+      end = min(start + window_size, num_elements)
+      self.assertSequenceEqual(list(range(start, end)),
+                               sorted(output[start:end]))
+
+  def testShufflesWindowsInMemory(self):
+    output = self._gen_outputs(
+        lambda: self._build_ds(memory_budget=1 << 20, window_size=30))
+    self._assertWindowsArePermutations(output, 30, 100)
+    self.assertNotEqual(list(range(100)), output)
+
+  def testShufflesWindowsLargerThanBudget(self):
+    # Each int64 element takes 8 bytes, so the windows of 30 elements are
+    # split into blocks of at most 5 elements.
+    output = self._gen_outputs(
+        lambda: self._build_ds(memory_budget=40, window_size=30))
+    self._assertWindowsArePermutations(output, 30, 100)
+    self.assertNotEqual(list(range(100)), output)
+    # The scratch files are deleted once consumed.
+    self.assertEqual([], gfile.ListDirectory(self.get_temp_dir()))
+
+  def testWindowsDefaultToMemoryBudget(self):
+    output = self._gen_outputs(lambda: self._build_ds(memory_budget=80))
+    self._assertWindowsArePermutations(output, 10, 100)
+
+  def testElementLargerThanBudget(self):
+    output = self._gen_outputs(
+        lambda: self._build_ds(memory_budget=1, window_size=10))
+    self._assertWindowsArePermutations(output, 10, 100)
+
+  def testSameOrderForSameSeeds(self):
+    output1 = self._gen_outputs(
+        lambda: self._build_ds(memory_budget=40, window_size=30))
+    output2 = self._gen_outputs(
+        lambda: self._build_ds(memory_budget=40, window_size=30))
+    self.assertEqual(output1, output2)
+
+  def testDifferentOrderForDifferentSeeds(self):
+    output1 = self._gen_outputs(
+        lambda: self._build_ds(memory_budget=40, window_size=30, seed=10))
+    output2 = self._gen_outputs(
+        lambda: self._build_ds(memory_budget=40, window_size=30, seed=20))
+    self.assertNotEqual(output1, output2)
+    self.assertEqual(sorted(output1), sorted(output2))
+
+  def testShufflesStrings(self):
+    components = [("%d" % i).encode() * (i % 7 + 1) for i in range(50)]
+    output = self._gen_outputs(
+        lambda: dataset_ops.Dataset.from_tensor_slices(components).apply(
+            shuffle_ops.bounded_memory_shuffle(
+                100, window_size=50, directory=self.get_temp_dir())))
+    self.assertEqual(sorted(components), sorted(output))
+
+  def testEmptyInput(self):
+    self.assertEqual([], self._gen_outputs(
+        lambda: self._build_ds(memory_budget=40, num_elements=0)))
+
+  def testInvalidArguments(self):
+    with self.assertRaises(errors.InvalidArgumentError):
+      self._gen_outputs(lambda: self._build_ds(memory_budget=0))
+    with self.assertRaises(errors.InvalidArgumentError):
+      self._gen_outputs(
+          lambda: self._build_ds(memory_budget=40, window_size=0))
+
+
+class BoundedMemoryShuffleBenchmark(test.Benchmark):
+
+  def benchmarkMemoryBudgets(self):
+    # 4096 elements of 64 KiB, shuffled in a single window of 256 MiB. The
+    # budgets are increasing, so that the growth of the peak resident memory
+    # of the process reflects the memory used with each budget.
+    num_elements = 4096
+    element = np.random.rand(16384).astype(np.float32)
+    for memory_budget in [16 << 20, 64 << 20, 512 << 20]:
+      dataset = dataset_ops.Dataset.from_tensors(element).repeat(
+          num_elements).apply(
+              shuffle_ops.bounded_memory_shuffle(
+                  memory_budget, window_size=num_elements))
+      next_element = dataset.make_one_shot_iterator().get_next()
+
+      with session.Session() as sess:
+        start_rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        start = time.time()
+        for _ in range(num_elements):
+          sess.run(next_element.op)
+        end = time.time()
+        # `ru_maxrss` is in KiB on Linux.
+        peak_rss_growth = (resource.getrusage(resource.RUSAGE_SELF).ru_maxrss -
+                           start_rss) * 1024
+
+      wall_time = (end - start) / num_elements
+      print("Bounded memory shuffle budget: %d bytes wall time: %f "
+            "peak memory growth: %d bytes" %
+            (memory_budget, wall_time, peak_rss_growth))
+      self.report_benchmark(
+          iters=num_elements,
+          wall_time=wall_time,
+          extras={"peak_memory_growth_bytes": peak_rss_growth},
+          name="benchmark_bounded_memory_shuffle_budget_%d" % memory_budget)
+
+
 if __name__ == "__main__":
   test.main()
@@ -0,0 +1,196 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for the experimental input pipeline ops."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import os
+import time
+
+from absl.testing import parameterized
+import numpy as np
+
+from tensorflow.contrib.data.python.ops import caching
+from tensorflow.python.client import session
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import errors
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import array_ops
+from tensorflow.python.platform import test
+
+
+class SpillingCacheDatasetTest(test.TestCase, parameterized.TestCase):
+
+  def _makeDataset(self, memory_budget, compression_type=None):
+    # Each element takes 8 + 4 * 10 = 48 bytes in memory.
+    return dataset_ops.Dataset.range(100).map(
+        lambda x: (x, array_ops.fill([10], x))).apply(
+            caching.spilling_cache(
+                memory_budget,
+                filename=os.path.join(self.get_temp_dir(), "cache"),
+                compression_type=compression_type))
+
+  @parameterized.named_parameters(
+      ("InMemory", 1 << 20, None),
+      ("Spilled", 0, None),
+      ("PartlySpilled", 48 * 40, None),
+      ("Compressed", 1 << 20, "SNAPPY"),
+      ("CompressedAndSpilled", 0, "SNAPPY"),
+  )
+  def testRepeatedEpochs(self, memory_budget, compression_type):
+    dataset = self._makeDataset(memory_budget, compression_type).repeat(3)
+    get_next = dataset.make_one_shot_iterator().get_next()
+
+    with self.test_session() as sess:
+      for _ in range(3):
+        for i in range(100):
+          x, y = sess.run(get_next)
+          self.assertEqual(i, x)
+          self.assertAllEqual([i] * 10, y)
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  @parameterized.named_parameters(
+      ("InMemory", 1 << 20),
+      ("Spilled", 0),
+  )
+  def testReadWhileWriting(self, memory_budget):
+    dataset = self._makeDataset(memory_budget)
+    # The first iterator writes the cache, and the second one reads it.
+    writer_next = dataset.make_one_shot_iterator().get_next()
+    reader_next = dataset.make_one_shot_iterator().get_next()
+
+    with self.test_session() as sess:
+      for i in range(100):
+        self.assertEqual(i, sess.run(writer_next)[0])
+        self.assertEqual(i, sess.run(reader_next)[0])
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(writer_next)
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(reader_next)
+
+  def testPartialWriteIsDiscarded(self):
+    dataset = self._makeDataset(0)
+    iterator = dataset.make_initializable_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      sess.run(iterator.initializer)
+      for i in range(10):
+        self.assertEqual(i, sess.run(get_next)[0])
+      # Re-initializing releases the partly written cache, which the new
+      # iterator writes again from the start.
+      sess.run(iterator.initializer)
+      for i in range(100):
+        self.assertEqual(i, sess.run(get_next)[0])
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testSpillErrorIsSticky(self):
+    # The first 10 elements fit in memory, and the spill file cannot be
+    # created.
+    dataset = dataset_ops.Dataset.range(100).map(
+        lambda x: (x, array_ops.fill([10], x))).apply(
+            caching.spilling_cache(
+                48 * 10,
+                filename=os.path.join(self.get_temp_dir(), "missing",
+                                      "cache")))
+    writer_next = dataset.make_one_shot_iterator().get_next()
+    reader_next = dataset.make_one_shot_iterator().get_next()
+
+    with self.test_session() as sess:
+      for i in range(10):
+        self.assertEqual(i, sess.run(writer_next)[0])
+        self.assertEqual(i, sess.run(reader_next)[0])
+      with self.assertRaises(errors.NotFoundError):
+        sess.run(writer_next)
+      # The writer does not cache later elements after the one it failed to
+      # spill, and the reader fails rather than waiting for it.
+      with self.assertRaises(errors.NotFoundError):
+        sess.run(writer_next)
+      with self.assertRaises(errors.NotFoundError):
+        sess.run(reader_next)
+
+  def testInvalidArguments(self):
+    with self.test_session() as sess:
+      with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                   "memory_budget must be >= 0"):
+        sess.run(self._makeDataset(-1).make_one_shot_iterator().get_next())
+      with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                   "Unsupported compression_type"):
+        sess.run(
+            self._makeDataset(0, "ZLIB").make_one_shot_iterator().get_next())
+
+
+class SpillingCacheDatasetBenchmark(test.Benchmark):
+
+  # Compares the throughput of the second epoch over a cached dataset with
+  # `Dataset.cache()` in memory and in files, and with `spilling_cache()` at
+  # various memory budgets.
+  def benchmarkSecondEpoch(self):
+    num_elements = 1000
+    element_size = 256 * 1024
+    dataset_size = num_elements * element_size
+    temp_dir = self.get_temp_dir()
+
+    def memory_cache(dataset):
+      return dataset.cache()
+
+    def file_cache(dataset):
+      return dataset.cache(os.path.join(temp_dir, "file_cache"))
+
+    def spilling_cache(fraction, compression_type=None):
+      return caching.spilling_cache(
+          int(fraction * dataset_size),
+          filename=os.path.join(temp_dir, "spilling_cache"),
+          compression_type=compression_type)
+
+    configs = [
+        ("memory", memory_cache),
+        ("file", file_cache),
+        ("spilling_in_memory", spilling_cache(1.0)),
+        ("spilling_two_thirds_in_memory", spilling_cache(2.0 / 3)),
+        ("spilling_on_disk", spilling_cache(0.0)),
+        ("spilling_compressed", spilling_cache(2.0 / 3, "SNAPPY")),
+    ]
+    for name, cache_fn in configs:
+      with ops.Graph().as_default():
+        dataset = dataset_ops.Dataset.from_tensors(
+            np.random.randint(
+                0, 16, size=[element_size], dtype=np.uint8)).repeat(
+                    num_elements)
+        dataset = dataset.apply(cache_fn).repeat(2)
+        get_next = dataset.make_one_shot_iterator().get_next()
+
+        with session.Session() as sess:
+          # The first epoch fills the cache.
+          for _ in range(num_elements):
+            sess.run(get_next.op)
+          start = time.time()
+          for _ in range(num_elements):
+            sess.run(get_next.op)
+          wall_time = (time.time() - start) / num_elements
+
+      print("Cache %s: %f MB/s in the second epoch" %
+            (name, element_size / wall_time / 1e6))
+      self.report_benchmark(
+          iters=num_elements,
+          wall_time=wall_time,
+          name="benchmark_second_epoch_%s" % name)
+
+
+if __name__ == "__main__":
+  test.main()
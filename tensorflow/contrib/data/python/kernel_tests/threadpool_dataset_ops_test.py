@@ -17,16 +17,23 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+import multiprocessing
 import threading
+import time
 
 from absl.testing import parameterized
 import numpy as np
 
 from tensorflow.contrib.data.python.ops import threadpool
 from tensorflow.contrib.data.python.ops import unique
+from tensorflow.core.protobuf import config_pb2
+from tensorflow.python.client import session
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import errors
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import array_ops
+from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import script_ops
 from tensorflow.python.platform import test
 
@@ -76,5 +83,144 @@ class OverrideThreadpoolDatasetTest(test.TestCase, parameterized.TestCase):
       self.assertLessEqual(len(thread_ids), num_threads)
 
 
+def _slow_identity(delay_s):
+  """Returns a map function that passes elements through after `delay_s`."""
+
+  def sleep_then_return(x):
+    time.sleep(delay_s)
+    return x
+
+  return lambda x: script_ops.py_func(sleep_then_return, [x], dtypes.int64)
+
+
+class OverrideSharedThreadpoolDatasetTest(test.TestCase,
+                                          parameterized.TestCase):
+
+  @parameterized.parameters(0, 1, 4)
+  def testProducesElementsInOrder(self, num_threads):
+    # The prefetches and parallel maps downstream of another one block on it,
+    # which a pool with a single thread must tolerate.
+    dataset = (
+        dataset_ops.Dataset.range(1000)
+        .map(lambda x: x * x, num_parallel_calls=8).prefetch(4)
+        .map(lambda x: x + 1, num_parallel_calls=2).prefetch(1))
+    dataset = threadpool.override_shared_threadpool(dataset, num_threads)
+    iterator = dataset.make_initializable_iterator()
+    next_element = iterator.get_next()
+
+    with self.test_session() as sess:
+      sess.run(iterator.initializer)
+      for i in range(1000):
+        self.assertEqual(i * i + 1, sess.run(next_element))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(next_element)
+
+  def testPipelinesShareASingleThread(self):
+    iterators = []
+    for i in range(8):
+      dataset = (
+          dataset_ops.Dataset.range(100)
+          .map(lambda x, i=i: x + i, num_parallel_calls=4).prefetch(2))
+      dataset = threadpool.override_shared_threadpool(dataset, 1)
+      iterators.append(dataset.make_initializable_iterator())
+    next_elements = [iterator.get_next() for iterator in iterators]
+
+    with self.test_session() as sess:
+      sess.run([iterator.initializer for iterator in iterators])
+      for j in range(100):
+        self.assertEqual([j + i for i in range(8)], sess.run(next_elements))
+
+  def testDestroyIteratorWhileProducing(self):
+    # Each re-initialization destroys the previous iterator while its producer
+    # and runner tasks are still in flight on the pool.
+    dataset = (
+        dataset_ops.Dataset.range(100)
+        .map(_slow_identity(0.01), num_parallel_calls=4).prefetch(8))
+    dataset = threadpool.override_shared_threadpool(dataset, 2)
+    iterator = dataset.make_initializable_iterator()
+    next_element = iterator.get_next()
+
+    with self.test_session() as sess:
+      for _ in range(10):
+        sess.run(iterator.initializer)
+        for i in range(3):
+          self.assertEqual(i, sess.run(next_element))
+    # Closing the session destroys the last iterator mid-flight too.
+
+  def testCancelGetNextWhileProducing(self):
+    dataset = (
+        dataset_ops.Dataset.range(10)
+        .map(_slow_identity(0.2), num_parallel_calls=2).prefetch(2))
+    dataset = threadpool.override_shared_threadpool(dataset, 1)
+    iterator = dataset.make_initializable_iterator()
+    next_element = iterator.get_next()
+
+    with self.test_session() as sess:
+      sess.run(iterator.initializer)
+      with self.assertRaises(errors.DeadlineExceededError):
+        sess.run(next_element,
+                 options=config_pb2.RunOptions(timeout_in_ms=10))
+      # The cancelled step may have consumed the first element.
+      results = []
+      while True:
+        try:
+          results.append(sess.run(next_element))
+        except errors.OutOfRangeError:
+          break
+      self.assertEqual(list(range(10 - len(results), 10)), results)
+
+  def testNegativeNumThreads(self):
+    dataset = threadpool.override_shared_threadpool(
+        dataset_ops.Dataset.range(10), -1)
+    iterator = dataset.make_initializable_iterator()
+
+    with self.test_session() as sess:
+      with self.assertRaisesRegexp(errors.InvalidArgumentError,
+                                   "`num_threads`"):
+        sess.run(iterator.initializer)
+
+
+class SharedThreadpoolBenchmark(test.Benchmark):
+
+  def benchmarkConcurrentPipelines(self):
+    # Many input pipelines that each map a small matrix computation over
+    # their elements and prefetch the results, consumed together, either with
+    # threads of their own or on a shared pool with a thread per core.
+    num_pipelines = 32
+    for num_threads in [0, max(multiprocessing.cpu_count(), 1)]:
+      with ops.Graph().as_default():
+        next_elements = []
+        for _ in range(num_pipelines):
+          dataset = (
+              dataset_ops.Dataset.range(32).repeat(None)
+              .map(lambda x: math_ops.reduce_sum(math_ops.matmul(
+                  array_ops.fill([64, 64], math_ops.to_float(x)),
+                  array_ops.fill([64, 64], 1.0))), num_parallel_calls=4)
+              .prefetch(4))
+          dataset = threadpool.override_shared_threadpool(dataset,
+                                                          num_threads)
+          next_elements.append(dataset.make_one_shot_iterator().get_next())
+        next_ops = [next_element.op for next_element in next_elements]
+
+        with session.Session() as sess:
+          for _ in range(5):
+            sess.run(next_ops)
+          deltas = []
+          for _ in range(20):
+            start = time.time()
+            for _ in range(10):
+              sess.run(next_ops)
+            end = time.time()
+            deltas.append(end - start)
+
+          median_wall_time = np.median(deltas) / 10
+          print("Concurrent pipelines: %d Shared threads: %d Median wall "
+                "time: %f" % (num_pipelines, num_threads, median_wall_time))
+          self.report_benchmark(
+              iters=200, wall_time=median_wall_time,
+              name="benchmark_concurrent_pipelines_%d_shared_threads_%d" %
+              (num_pipelines, num_threads))
+
+
 if __name__ == "__main__":
   test.main()
@@ -687,7 +687,7 @@ class _MapAndBatchDataset(dataset_ops.MapDataset):
   """A `Dataset` that maps a function over a batch of elements."""
 
   def __init__(self, input_dataset, map_func, batch_size, num_parallel_calls,
-               drop_remainder):
+               drop_remainder, sloppy=False):
     """See `Dataset.map()` for details."""
     super(_MapAndBatchDataset, self).__init__(input_dataset, map_func)
     self._batch_size_t = ops.convert_to_tensor(
@@ -699,6 +699,7 @@ class _MapAndBatchDataset(dataset_ops.MapDataset):
 
     self._batch_size = batch_size
     self._drop_remainder = drop_remainder
+    self._sloppy = sloppy
 
   def _as_variant_tensor(self):
     # pylint: disable=protected-access
@@ -710,6 +711,7 @@ class _MapAndBatchDataset(dataset_ops.MapDataset):
         batch_size=self._batch_size_t,
         num_parallel_calls=self._num_parallel_calls_t,
         drop_remainder=self._drop_remainder_t,
+        sloppy=self._sloppy,
         **dataset_ops.flat_structure(self))
     # pylint: enable=protected-access
 
@@ -730,7 +732,8 @@ def map_and_batch(map_func,
                   batch_size,
                   num_parallel_batches=None,
                   drop_remainder=False,
-                  num_parallel_calls=None):
+                  num_parallel_calls=None,
+                  sloppy=False):
   """Fused implementation of `map` and `batch`.
 
   Maps `map_func` across `batch_size` consecutive elements of this dataset
@@ -757,6 +760,12 @@ def map_and_batch(map_func,
         representing the number of elements to process in parallel. If not
         specified, `batch_size * num_parallel_batches` elements will be
         processed in parallel.
+    sloppy: (Optional.) A boolean controlling whether determinism should be
+      traded for performance. If true, each batch is produced as soon as it is
+      complete, even if the batches before it are still waiting for slow calls
+      of `map_func`, so the batches may not be in input order. Partial batches
+      and errors are still produced in order. The elements of a batch are
+      always consecutive input elements.
 
   Returns:
     A `Dataset` transformation function, which can be passed to
@@ -777,6 +786,6 @@ def map_and_batch(map_func,
 
   def _apply_fn(dataset):
     return _MapAndBatchDataset(dataset, map_func, batch_size,
-                               num_parallel_calls, drop_remainder)
+                               num_parallel_calls, drop_remainder, sloppy)
 
   return _apply_fn
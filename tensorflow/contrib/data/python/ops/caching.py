@@ -0,0 +1,106 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Caching dataset transformations."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from tensorflow.contrib.data.python.ops import contrib_op_loader  # pylint: disable=unused-import
+from tensorflow.contrib.data.python.ops import gen_dataset_ops
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
+
+
+def spilling_cache(memory_budget, filename="", compression_type=None):
+  """Caches the elements of a dataset in memory, spilling to disk if needed.
+
+  Like `tf.data.Dataset.cache()`, the first iteration over the resulting
+  dataset reads the input, and later iterations read the cache. Unlike it,
+  the cache holds at most `memory_budget` bytes of elements in memory, and
+  writes the remaining elements to a local file, which is deleted with the
+  dataset. This suits datasets that are somewhat larger than the available
+  memory. Iterations may overlap: an iteration that starts while the first
+  one is still running reads the elements as they are cached.
+
+  ```python
+  dataset = tf.data.TFRecordDataset(filenames).map(parse_fn)
+  # Keep up to 8 GiB of compressed elements in memory.
+  dataset = dataset.apply(tf.contrib.data.spilling_cache(
+      8 << 30, compression_type="SNAPPY"))
+  dataset = dataset.repeat()
+  ```
+
+  Unlike `tf.data.Dataset.cache()`, iterators over the resulting dataset
+  cannot be saved.
+
+  Args:
+    memory_budget: A `tf.int64` scalar `tf.Tensor`, representing the maximum
+      number of bytes of elements to keep in memory.
+    filename: (Optional.) A `tf.string` scalar `tf.Tensor`, representing a path
+      prefix for the file to which elements are spilled. Defaults to a file in
+      the local temporary directory.
+    compression_type: (Optional.) A `tf.string` scalar evaluating to one of
+      `""` (no compression) or `"SNAPPY"`, which compresses the cached elements
+      both in memory and on disk.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+  """
+
+  def _apply_fn(dataset):
+    return _SpillingCacheDataset(dataset, memory_budget, filename,
+                                 compression_type)
+
+  return _apply_fn
+
+
+class _SpillingCacheDataset(dataset_ops.Dataset):
+  """A `Dataset` that caches its input in memory and on disk."""
+
+  def __init__(self, input_dataset, memory_budget, filename,
+               compression_type):
+    """See `spilling_cache()` for details."""
+    super(_SpillingCacheDataset, self).__init__()
+    self._input_dataset = input_dataset
+    self._memory_budget = ops.convert_to_tensor(
+        memory_budget, dtype=dtypes.int64, name="memory_budget")
+    self._filename = ops.convert_to_tensor(
+        filename, dtype=dtypes.string, name="filename")
+    self._compression_type = ops.convert_to_tensor(
+        "" if compression_type is None else compression_type,
+        dtype=dtypes.string,
+        name="compression_type")
+
+  def _as_variant_tensor(self):
+    return gen_dataset_ops.spilling_cache_dataset(
+        self._input_dataset._as_variant_tensor(),  # pylint: disable=protected-access
+        filename=self._filename,
+        memory_budget=self._memory_budget,
+        compression_type=self._compression_type,
+        **dataset_ops.flat_structure(self))
+
+  @property
+  def output_classes(self):
+    return self._input_dataset.output_classes
+
+  @property
+  def output_shapes(self):
+    return self._input_dataset.output_shapes
+
+  @property
+  def output_types(self):
+    return self._input_dataset.output_types
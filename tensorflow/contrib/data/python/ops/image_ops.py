@@ -0,0 +1,144 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Image decoding dataset transformations."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
+from tensorflow.python.framework import tensor_shape
+from tensorflow.python.framework import tensor_util
+from tensorflow.python.ops import gen_dataset_ops
+
+
+class _DecodeAndCropJpegBatchDataset(dataset_ops.Dataset):
+  """A `Dataset` that decodes, crops, resizes and batches JPEG images."""
+
+  def __init__(self, input_dataset, batch_size, output_size, channels,
+               dct_method, drop_remainder):
+    """See `decode_and_crop_jpeg_batch()` for details."""
+    super(_DecodeAndCropJpegBatchDataset, self).__init__()
+    input_types = input_dataset.output_types
+    if input_types != dtypes.string and input_types != (dtypes.string,
+                                                        dtypes.int32):
+      raise TypeError(
+          "`decode_and_crop_jpeg_batch()` requires an input whose elements "
+          "are a `tf.string` or a (`tf.string`, `tf.int32`) tuple, whereas "
+          "the input has %r." % (input_types,))
+    if channels not in (1, 3):
+      raise ValueError("`channels` must be 1 or 3, got %r." % channels)
+    self._input_dataset = input_dataset
+    self._batch_size = ops.convert_to_tensor(
+        batch_size, dtype=dtypes.int64, name="batch_size")
+    self._output_size = ops.convert_to_tensor(
+        output_size, dtype=dtypes.int32, name="output_size")
+    self._drop_remainder = ops.convert_to_tensor(
+        drop_remainder, dtype=dtypes.bool, name="drop_remainder")
+    self._channels = channels
+    self._dct_method = dct_method
+
+  def _as_variant_tensor(self):
+    return gen_dataset_ops.decode_and_crop_jpeg_batch_dataset(
+        self._input_dataset._as_variant_tensor(),  # pylint: disable=protected-access
+        batch_size=self._batch_size,
+        output_size=self._output_size,
+        drop_remainder=self._drop_remainder,
+        channels=self._channels,
+        dct_method=self._dct_method,
+        **dataset_ops.flat_structure(self))
+
+  @property
+  def output_classes(self):
+    return ops.Tensor
+
+  @property
+  def output_shapes(self):
+    batch_dim = None
+    if tensor_util.constant_value(self._drop_remainder):
+      batch_dim = tensor_util.constant_value(self._batch_size)
+    output_size = tensor_util.constant_value_as_shape(self._output_size)
+    return tensor_shape.TensorShape([batch_dim]).concatenate(
+        output_size.with_rank(2)).concatenate([self._channels])
+
+  @property
+  def output_types(self):
+    return dtypes.uint8
+
+
+def decode_and_crop_jpeg_batch(batch_size,
+                               output_size,
+                               channels=3,
+                               dct_method="",
+                               drop_remainder=False):
+  """Decodes, crops, resizes and batches JPEG images in one transformation.
+
+  Each element of the input dataset is either a scalar `tf.string` of
+  JPEG-encoded image data, or a tuple of such a string and a `tf.int32` crop
+  window `[crop_y, crop_x, crop_height, crop_width]` in the coordinates of the
+  image, like the one `tf.image.decode_and_crop_jpeg()` takes. Each batch is a
+  `tf.uint8` tensor of shape `[batch_size, height, width, channels]`, with the
+  crop window (or the whole image) of each image resized bilinearly to
+  `output_size`.
+
+  Functionally, this is close to mapping `tf.image.decode_and_crop_jpeg()`,
+  `tf.image.resize_images()` and a cast over the elements and batching the
+  results, but it is faster in three ways:
+
+  * Only the crop window is decoded, and when the crop window is at least twice
+    as large as `output_size`, it is decoded at a scale of 1/2, 1/4 or 1/8 in
+    the DCT domain, which skips most of the decoding work.
+  * Each image is written straight to its slice of the batch, rather than
+    being copied there from a tensor of its own.
+  * The images of a batch are decoded in parallel on the intra-op thread pool.
+
+  The images differ slightly from those of the map-based pipeline when they
+  are decoded at a reduced scale. The input elements are read sequentially,
+  so add a `prefetch()` after this transformation to overlap reading with
+  decoding.
+
+  Example usage:
+
+  ```python
+  dataset = tf.data.TFRecordDataset(filenames).map(parse_jpeg_and_window)
+  dataset = dataset.apply(
+      tf.contrib.data.decode_and_crop_jpeg_batch(256, [224, 224]))
+  dataset = dataset.prefetch(1)
+  ```
+
+  Args:
+    batch_size: A `tf.int64` scalar `tf.Tensor`, representing the number of
+      consecutive images to combine in a single batch.
+    output_size: A `tf.int32` vector `tf.Tensor` of two elements, `[height,
+      width]`, representing the size of the images of the batch.
+    channels: (Optional.) The number of color channels of the images, 1 for
+      grayscale or 3 for RGB. Defaults to 3.
+    dct_method: (Optional.) A string specifying the algorithm used for the
+      inverse DCT, as in `tf.image.decode_jpeg()`.
+    drop_remainder: (Optional.) A `tf.bool` scalar `tf.Tensor`, representing
+      whether the last batch should be dropped in case its size is smaller than
+      desired; the default behavior is not to drop the smaller batch.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+  """
+
+  def _apply_fn(dataset):
+    return _DecodeAndCropJpegBatchDataset(dataset, batch_size, output_size,
+                                          channels, dct_method, drop_remainder)
+
+  return _apply_fn
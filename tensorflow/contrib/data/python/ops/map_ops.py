@@ -0,0 +1,68 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Non-deterministic map transformations."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from tensorflow.python.data.ops import dataset_ops
+
+
+def sloppy_map(map_func, num_parallel_calls):
+  """A non-deterministic version of the `Dataset.map()` transformation.
+
+  `sloppy_map()` maps `map_func` across the elements of the dataset with up to
+  `num_parallel_calls` concurrent calls, like
+  `Dataset.map(map_func, num_parallel_calls)`. The difference is that each
+  result is produced as soon as its call completes, rather than after the
+  results of all the elements before it. A slow element (e.g. a large image to
+  decode) therefore no longer holds back the elements after it, which reduces
+  the tail latency of `get_next` and keeps all the calls busy when the cost of
+  `map_func` varies a lot between elements.
+
+  The end of the input, and an `OutOfRange` error raised by `map_func` to end
+  the iteration early, are only produced after all the elements before them.
+  Saving the iterator is supported: the saved state holds the results that
+  were not produced yet, which a restored iterator produces in any order.
+
+  Example usage:
+
+  ```python
+  dataset = tf.data.TFRecordDataset(filenames)
+  dataset = dataset.apply(
+      tf.contrib.data.sloppy_map(decode_and_resize, num_parallel_calls=8))
+  ```
+
+  WARNING: The order of elements in the resulting dataset is not
+  deterministic. Use `Dataset.map()` if you want the elements to have a
+  deterministic order.
+
+  Args:
+    map_func: A function mapping a nested structure of tensors (having shapes
+      and types defined by `self.output_shapes` and `self.output_types`) to
+      another nested structure of tensors.
+    num_parallel_calls: A `tf.int32` scalar `tf.Tensor`, representing the
+      number of elements to process in parallel.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+  """
+
+  def _apply_fn(dataset):
+    return dataset_ops.ParallelMapDataset(
+        dataset, map_func, num_parallel_calls, sloppy=True)
+
+  return _apply_fn
@@ -17,6 +17,8 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+from tensorflow.contrib.data.python.ops import contrib_op_loader  # pylint: disable=unused-import
+from tensorflow.contrib.data.python.ops import gen_dataset_ops as contrib_gen_dataset_ops
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.util import random_seed
 from tensorflow.python.framework import constant_op
@@ -103,3 +105,109 @@ def shuffle_and_repeat(buffer_size, count=None, seed=None):
     return _ShuffleAndRepeatDataset(dataset, buffer_size, count, seed)
 
   return _apply_fn
+
+
+class _BoundedMemoryShuffleDataset(dataset_ops.Dataset):
+  """A `Dataset` that shuffles windows of its input within a memory budget."""
+
+  def __init__(self, input_dataset, memory_budget, window_size, directory,
+               seed):
+    """See `bounded_memory_shuffle()` for details."""
+    super(_BoundedMemoryShuffleDataset, self).__init__()
+    self._input_dataset = input_dataset
+    self._memory_budget = ops.convert_to_tensor(
+        memory_budget, dtype=dtypes.int64, name="memory_budget")
+    if window_size is None:
+      window_size = -1
+    self._window_size = ops.convert_to_tensor(
+        window_size, dtype=dtypes.int64, name="window_size")
+    self._directory = ops.convert_to_tensor(
+        "" if directory is None else directory,
+        dtype=dtypes.string,
+        name="directory")
+    self._seed, self._seed2 = random_seed.get_seed(seed)
+
+  def _as_variant_tensor(self):
+    return contrib_gen_dataset_ops.bounded_memory_shuffle_dataset(
+        self._input_dataset._as_variant_tensor(),  # pylint: disable=protected-access
+        window_size=self._window_size,
+        memory_budget=self._memory_budget,
+        directory=self._directory,
+        seed=self._seed,
+        seed2=self._seed2,
+        **dataset_ops.flat_structure(self))
+
+  @property
+  def output_classes(self):
+    return self._input_dataset.output_classes
+
+  @property
+  def output_shapes(self):
+    return self._input_dataset.output_shapes
+
+  @property
+  def output_types(self):
+    return self._input_dataset.output_types
+
+
+def bounded_memory_shuffle(memory_budget, window_size=None, directory=None,
+                           seed=None):
+  """Shuffles a Dataset in windows, holding at most `memory_budget` bytes.
+
+  The input is split into consecutive windows of `window_size` elements, and
+  the elements of each window are produced in a uniformly random order. At
+  most `memory_budget` bytes of elements are held in memory. A window that does
+  not fit is split into blocks that fit; each block is shuffled in memory and
+  written to a scratch file in `directory`, and the blocks are merged by
+  drawing each element from a block chosen with probability proportional to
+  the number of elements left in it. The scratch files are read sequentially
+  and deleted as soon as they are consumed.
+
+  ```python
+  dataset = tf.data.TFRecordDataset(filenames)
+  # Shuffle windows of one million records, keeping at most 4 GiB in memory.
+  dataset = dataset.apply(tf.contrib.data.bounded_memory_shuffle(
+      4 << 30, window_size=1000000, directory="/local/scratch"))
+  ```
+
+  If `window_size` is `None`, each window holds as many elements as fit in
+  `memory_budget`, and nothing is written to disk.
+
+  The randomness differs from that of `tf.data.Dataset.shuffle(buffer_size)`:
+
+  * Each window is a uniformly random permutation of its elements, whereas
+    the output of a shuffle buffer is biased towards the input order: an
+    element can move at most `buffer_size - 1` positions earlier, and the
+    first output element is always one of the first `buffer_size` inputs.
+  * Elements never move out of their window, so two elements that are more
+    than `window_size` elements apart in the input keep their relative order.
+    A shuffle buffer may move an element arbitrarily far later.
+
+  A window is read entirely before its first element is produced, and each
+  window of an iterator is shuffled in a different order. Unlike
+  `tf.data.Dataset.shuffle()`, iterators over the resulting dataset cannot be
+  saved.
+
+  Args:
+    memory_budget: A `tf.int64` scalar `tf.Tensor`, representing the maximum
+      number of bytes of elements to hold in memory.
+    window_size: (Optional.) A `tf.int64` scalar `tf.Tensor`, representing the
+      number of consecutive elements shuffled together. Defaults to as many as
+      fit in `memory_budget`.
+    directory: (Optional.) A `tf.string` scalar `tf.Tensor`, representing the
+      directory in which to create scratch files. Defaults to the local
+      temporary directory.
+    seed: (Optional.) A `tf.int64` scalar `tf.Tensor`, representing the
+      random seed that will be used to create the distribution. See
+      `tf.set_random_seed` for behavior.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+  """
+
+  def _apply_fn(dataset):
+    return _BoundedMemoryShuffleDataset(dataset, memory_budget, window_size,
+                                        directory, seed)
+
+  return _apply_fn
@@ -23,6 +23,8 @@ from tensorflow.contrib.data.python.ops import contrib_op_loader  # pylint: disa
 from tensorflow.contrib.data.python.ops import gen_dataset_ops
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.eager import context
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
 from tensorflow.python.ops import resource_variable_ops
 
 _uid_counter = 0
@@ -103,3 +105,55 @@ def override_threadpool(dataset, thread_pool):
     `tf.data.Dataset.map`).
   """
   return _ThreadPoolDataset(dataset, thread_pool)
+
+
+class _SharedThreadPoolDataset(dataset_ops.Dataset):
+  """A `Dataset` that acts as an identity, and sets the shared threadpool."""
+
+  def __init__(self, input_dataset, num_threads):
+    super(_SharedThreadPoolDataset, self).__init__()
+    self._input_dataset = input_dataset
+    self._num_threads = ops.convert_to_tensor(
+        num_threads, dtype=dtypes.int64, name="num_threads")
+
+  def _as_variant_tensor(self):
+    return gen_dataset_ops.shared_thread_pool_dataset(
+        self._input_dataset._as_variant_tensor(),  # pylint: disable=protected-access
+        self._num_threads,
+        **dataset_ops.flat_structure(self))
+
+  @property
+  def output_shapes(self):
+    return self._input_dataset.output_shapes
+
+  @property
+  def output_types(self):
+    return self._input_dataset.output_types
+
+  @property
+  def output_classes(self):
+    return self._input_dataset.output_classes
+
+
+# TODO(b/73383364): Properly export in the `tf.contrib.data` API when stable
+# or make private / remove.
+def override_shared_threadpool(dataset, num_threads):
+  """Returns a new dataset that runs its background work on a shared pool.
+
+  The prefetching and parallel map transformations in `dataset` produce their
+  elements from short tasks on a process-wide thread pool, in place of threads
+  of their own. All input pipelines that ask for a pool of the same size share
+  it, and take turns on it, so that many concurrent pipelines use a bounded
+  number of threads.
+
+  Args:
+    dataset: A `tf.data.Dataset` object.
+    num_threads: A `tf.int64` scalar `tf.Tensor`, the number of threads in the
+      shared pool. If 0, `dataset` uses threads of its own, even if the pool
+      set by the `TF_DATA_SHARED_THREADPOOL_SIZE` environment variable is
+      enabled.
+
+  Returns:
+    A dataset containing the same values as `dataset`.
+  """
+  return _SharedThreadPoolDataset(dataset, num_threads)
@@ -14,12 +14,10 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/base_collective_executor.h"
 
-#include "tensorflow/core/common_runtime/broadcaster.h"
 #include "tensorflow/core/common_runtime/copy_tensor.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/process_util.h"
-#include "tensorflow/core/common_runtime/ring_reducer.h"
 #include "tensorflow/core/lib/core/notification.h"
 
 #define VALUE_IN_DEBUG_STRING false
@@ -182,11 +180,88 @@ CollectiveAdapter* MakeCollectiveAdapter(Tensor* output, int num_chunks,
   }
 }
 
-BaseCollectiveExecutor::~BaseCollectiveExecutor() {}
+namespace {
+// Used for executing a sub-operation, e.g. a merge_op instance, with
+// an OpKernelContext based on the one passed into the collective Op.
+class SubContext {
+ public:
+  OpKernelContext::Params sub_params_;
+  gtl::InlinedVector<TensorValue, 4> sub_inputs_;
+  gtl::InlinedVector<AllocatorAttributes, 4> sub_input_attr_;
+  gtl::InlinedVector<DeviceContext*, 4> sub_input_dc_;
+  // Used only for Binary and Unary Ops for which we require
+  // the calculation to be in-place on the first input.
+  int forward_from_ = 0;
+  OpKernelContext* sub_ctx_;
+  SubContext(OpKernelContext* ctx, OpKernelContext::Params* params,
+             OpKernel* op, Tensor* output, Tensor* input);
+  ~SubContext() { delete sub_ctx_; }
+};
+
+SubContext::SubContext(OpKernelContext* ctx, OpKernelContext::Params* params,
+                       OpKernel* op, Tensor* output, Tensor* input)
+    : sub_params_(*params),
+      sub_inputs_({output, input}),
+      sub_input_attr_({ctx->input_alloc_attr(0), ctx->input_alloc_attr(0)}),
+      sub_input_dc_(
+          {ctx->input_device_context(0), ctx->input_device_context(0)}) {
+  sub_params_.op_kernel = op;
+  sub_params_.inputs = &sub_inputs_;
+  sub_params_.input_alloc_attrs = &sub_input_attr_;
+  sub_params_.input_device_contexts = &sub_input_dc_;
+  sub_params_.eigen_gpu_device = nullptr;
+  sub_params_.ensure_eigen_gpu_device();
+  sub_params_.forward_from_array = &forward_from_;
+  sub_ctx_ = new OpKernelContext(&sub_params_, 1);
+}
+
+// Largest tensor, in bytes, that the default choice reduces with one of the
+// halving/doubling algorithms rather than the ring.
+const int64 kMaxHalvingDoublingBytes = 256 << 10;
+}  // namespace
+
+Status ComputeBinOp(OpKernelContext* ctx, OpKernelContext::Params* params,
+                    Device* device, OpKernel* op, Tensor* output,
+                    Tensor* input) {
+  // Prepare an OpKernelContext that is identical to that of the original Op
+  // (i.e. the collective), except for the input output sizes and identities and
+  // the Op itself.
+  // TODO(tucker): Is it possible to cache and reuse these objects?  They're
+  // mostly identical inside one device execution.
+  std::unique_ptr<SubContext> sub_ctx(
+      new SubContext(ctx, params, op, output, input));
+  device->Compute(op, sub_ctx->sub_ctx_);
+  return sub_ctx->sub_ctx_->status();
+}
+
+BaseCollectiveExecutor::BaseCollectiveExecutor(
+    CollectiveExecutorMgrInterface* cem,
+    PerStepCollectiveRemoteAccess* remote_access, int64 step_id,
+    const DeviceMgr* dev_mgr, const CollectiveFusionOptions& fusion_options)
+    : CollectiveExecutor(cem),
+      step_id_(step_id),
+      dev_mgr_(dev_mgr),
+      remote_access_(remote_access),
+      fusion_(nullptr) {
+  if (fusion_options.threshold_bytes > 0) {
+    fusion_ = new CollectiveFusion(
+        this, dev_mgr, fusion_options,
+        [this](OpKernelContext* ctx, const CollectiveParams& col_params,
+               const string& exec_key, Tensor* input,
+               const StatusCallback& done) {
+          RunCollective(ctx, col_params, exec_key, input, input, done);
+        });
+  }
+}
+
+BaseCollectiveExecutor::~BaseCollectiveExecutor() {
+  if (fusion_) fusion_->Unref();
+}
 
 void BaseCollectiveExecutor::StartAbort(const Status& s) {
   LOG(WARNING) << "BaseCollectiveExecutor::StartAbort " << s;
   remote_access_->StartAbort(s);
+  if (fusion_) fusion_->StartAbort(s);
 }
 
 void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
@@ -210,104 +285,121 @@ void BaseCollectiveExecutor::ExecuteAsync(OpKernelContext* ctx,
     done(s);
   };
 
+  const Tensor* input = (ctx->num_inputs() > 0) ? &ctx->input(0) : nullptr;
   Tensor* output = ctx->mutable_output(0);
-  string error;
+  Status status = CheckDataType(col_params);
+  if (!status.ok()) {
+    done_safe(status);
+    return;
+  }
+  if (fusion_ && fusion_->ShouldFuse(ctx, col_params)) {
+    fusion_->Add(ctx, col_params, exec_key, done_safe);
+    return;
+  }
+  RunCollective(ctx, col_params, exec_key, input, output, done_safe);
+}
+
+void BaseCollectiveExecutor::RunCollective(OpKernelContext* ctx,
+                                           const CollectiveParams& col_params,
+                                           const string& exec_key,
+                                           const Tensor* input, Tensor* output,
+                                           const StatusCallback& done) {
+  string name = col_params.instance.impl_details.collective_name;
+  if (name.empty()) {
+    name = DefaultImplementation(
+        col_params, input ? input->TotalBytes() : output->TotalBytes());
+  }
+  CollectiveRegistry::Factory factory;
+  Status status =
+      CollectiveRegistry::Lookup(name, col_params.instance.type, &factory);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  CollectiveImplementationInterface* impl =
+      factory(this, dev_mgr_, ctx, CtxParams(ctx), col_params, exec_key,
+              step_id_, input, output);
+  // Run in an I/O thread, so as not to starve the executor threads.
+  // TODO(tucker): Instead of forking every per-device Collective
+  // Op off into its own thread, consider queuing them on a
+  // fixed-size thread-pool dedicated to running CollectiveOps.
+  SchedClosure([impl, done]() {
+    impl->Run([impl, done](const Status& s) {
+      done(s);
+      delete impl;
+    });
+  });
+}
+
+/*static*/
+string BaseCollectiveExecutor::DefaultImplementation(
+    const CollectiveParams& col_params, int64 num_bytes) {
   switch (col_params.instance.type) {
     case REDUCTION_COLLECTIVE: {
-      // TODO(tucker): support other reduction algorithms,
-      // e.g. tree-reduce, hybrid tree/ring, delegate-to-NCCL, etc.
-      const Tensor* input = &ctx->input(0);
-      RingReducer* reducer =
-          CreateReducer(ctx, CtxParams(ctx), col_params, exec_key, step_id_,
-                        input, output, &error);
-      if (!reducer) {
-        done_safe(errors::Internal(error));
-        return;
+      // The ring moves the least data through each device, but takes
+      // 2(n-1) sequential steps where the halving/doubling algorithms take
+      // O(log n), so those win when latency dominates: small tensors in
+      // large groups.  Compression and subdivisions are only implemented by
+      // the ring, and the others only run on CPU.
+      const CollInstanceParams& instance = col_params.instance;
+      if (col_params.group.device_type != DEVICE_CPU ||
+          instance.compression != COMPRESSION_NONE ||
+          instance.impl_details.subdiv_offsets.size() > 1 ||
+          col_params.group.group_size <= 2 ||
+          num_bytes > kMaxHalvingDoublingBytes) {
+        return "RingReduce";
       }
-      // Run in an I/O thread, so as not to starve the executor threads.
-      // TODO(tucker): Instead of forking every per-device Collective
-      // Op off into its own thread, consider queuing them on a
-      // fixed-size thread-pool dedicated to running CollectiveOps.
-      SchedClosure([reducer, done_safe]() {
-        reducer->Run([reducer, done_safe](const Status& s) {
-          done_safe(s);
-          delete reducer;
-        });
-      });
-    } break;
-
-    case BROADCAST_COLLECTIVE: {
-      Broadcaster* broadcaster = CreateBroadcaster(
-          ctx, CtxParams(ctx), col_params, exec_key, step_id_, output, &error);
-      if (!broadcaster) {
-        done_safe(errors::Internal(error));
-        return;
+      // With several devices per task, reducing within each task first
+      // leaves only one device per task to exchange data across tasks.
+      if (col_params.group.num_tasks > 1 &&
+          col_params.group.group_size > col_params.group.num_tasks) {
+        return "HierarchicalReduce";
       }
-      // Run in an I/O thread, so as not to starve the executor threads.
-      SchedClosure([broadcaster, done_safe]() {
-        broadcaster->Run([broadcaster, done_safe](const Status& s) {
-          done_safe(s);
-          delete broadcaster;
-        });
-      });
-    } break;
-
+      return "HalvingDoublingReduce";
+    }
+    case BROADCAST_COLLECTIVE:
+      return "HierarchicalTreeBroadcast";
+    case GATHER_COLLECTIVE:
+      return "RingGather";
     default:
-      done_safe(errors::Internal("Unimplemented CollectiveType ",
-                                 col_params.instance.type));
+      return "";
   }
 }
 
-RingReducer* BaseCollectiveExecutor::CreateReducer(
-    OpKernelContext* ctx, OpKernelContext::Params* params,
-    const CollectiveParams& col_params, const string& exec_key, int64 step_id,
-    const Tensor* input, Tensor* output, string* error) {
-  switch (col_params.instance.data_type) {
-    case DT_INT32:
-      if (col_params.group.device_type == DEVICE_GPU) {
-        *error =
-            "Collective Reduce does not support datatype DT_INT32 on "
-            "DEVICE_GPU";
-        return nullptr;
-      }
-      TF_FALLTHROUGH_INTENDED;
-    case DT_FLOAT:
-    case DT_DOUBLE:
-    case DT_INT64:
-      return new RingReducer(this, dev_mgr_, ctx, params, col_params, exec_key,
-                             step_id, input, output);
+/*static*/
+Status BaseCollectiveExecutor::CheckDataType(
+    const CollectiveParams& col_params) {
+  string op_name;
+  switch (col_params.instance.type) {
+    case REDUCTION_COLLECTIVE:
+      op_name = "Reduce";
+      break;
+    case BROADCAST_COLLECTIVE:
+      op_name = "Broadcast";
+      break;
+    case GATHER_COLLECTIVE:
+      op_name = "Gather";
       break;
     default:
-      *error = strings::StrCat("Collective Reduce does not support datatype ",
-                               col_params.instance.data_type);
-      return nullptr;
+      return errors::Internal("Unimplemented CollectiveType ",
+                              col_params.instance.type);
   }
-}
-
-Broadcaster* BaseCollectiveExecutor::CreateBroadcaster(
-    OpKernelContext* ctx, OpKernelContext::Params* params,
-    const CollectiveParams& col_params, const string& exec_key, int64 step_id,
-    Tensor* output, string* error) {
   switch (col_params.instance.data_type) {
     case DT_INT32:
       if (col_params.group.device_type == DEVICE_GPU) {
-        *error =
-            "Collective Broadcast does not support datatype DT_INT32 on "
-            "DEVICE_GPU";
-        return nullptr;
+        return errors::Internal("Collective ", op_name,
+                                " does not support datatype DT_INT32 on "
+                                "DEVICE_GPU");
       }
       TF_FALLTHROUGH_INTENDED;
     case DT_FLOAT:
     case DT_DOUBLE:
-    case DT_INT64: {
-      return new Broadcaster(this, dev_mgr_, ctx, params, col_params, exec_key,
-                             step_id, output);
-    } break;
+    case DT_INT64:
+      return Status::OK();
     default:
-      *error =
-          strings::StrCat("Collective Broadcast does not support datatype ",
-                          DataTypeString(col_params.instance.data_type));
-      return nullptr;
+      return errors::Internal(
+          "Collective ", op_name, " does not support datatype ",
+          DataTypeString(col_params.instance.data_type));
   }
 }
 
@@ -17,13 +17,12 @@ limitations under the License.
 
 #include <string>
 #include "tensorflow/core/common_runtime/buf_rendezvous.h"
+#include "tensorflow/core/common_runtime/collective_fusion.h"
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 
 namespace tensorflow {
-class Broadcaster;
 class DeviceMgr;
-class RingReducer;
 
 // Helper interface that aliases regular subfields of a Tensor as separate
 // Tensors for in-place update.
@@ -80,26 +79,44 @@ class CollectiveAdapter {
 CollectiveAdapter* MakeCollectiveAdapter(Tensor* output, int num_chunks,
                                          Allocator* allocator);
 
+// Computes `op`, a binary Op such as the merge_op or final_op of a
+// reduction, in place on `output` with `input` as its second operand, in
+// an OpKernelContext that is otherwise that of the collective Op `ctx`.
+Status ComputeBinOp(OpKernelContext* ctx, OpKernelContext::Params* params,
+                    Device* device, OpKernel* op, Tensor* output,
+                    Tensor* input);
+
 // Default implementation of CollectiveExecutor.  Delegates the actual
 // work of moving data to a class specialized for the operation type,
 // arguments and device+interconnect topology.
 class BaseCollectiveExecutor : public CollectiveExecutor {
  public:
-  BaseCollectiveExecutor(CollectiveExecutorMgrInterface* cem,
-                         PerStepCollectiveRemoteAccess* remote_access,
-                         int64 step_id, const DeviceMgr* dev_mgr)
-      : CollectiveExecutor(cem),
-        step_id_(step_id),
-        dev_mgr_(dev_mgr),
-        remote_access_(remote_access) {}
+  BaseCollectiveExecutor(
+      CollectiveExecutorMgrInterface* cem,
+      PerStepCollectiveRemoteAccess* remote_access, int64 step_id,
+      const DeviceMgr* dev_mgr,
+      const CollectiveFusionOptions& fusion_options = CollectiveFusionOptions());
 
   ~BaseCollectiveExecutor() override;
 
   void StartAbort(const Status& s) override;
 
+  // Executes `col_params` with its impl_details.collective_name, or if that
+  // is empty with DefaultImplementation().  Small reductions may first be
+  // fused with others, see CollectiveFusion.
   void ExecuteAsync(OpKernelContext* ctx, const CollectiveParams& col_params,
                     const string& exec_key, StatusCallback done) override;
 
+  // Returns the name of the registered implementation used for
+  // `col_params` when it does not name one, given that the tensor reduced,
+  // broadcast or gathered by every device is `num_bytes` long.  The choice
+  // only depends on values that all members of the group agree on.
+  static string DefaultImplementation(const CollectiveParams& col_params,
+                                      int64 num_bytes);
+
+  // Null if fusion is disabled.
+  CollectiveFusion* fusion() const { return fusion_; }
+
   PerStepCollectiveRemoteAccess* remote_access() override {
     return remote_access_.get();
   }
@@ -131,20 +148,17 @@ class BaseCollectiveExecutor : public CollectiveExecutor {
   const int64 step_id_;
   const DeviceMgr* dev_mgr_;  // Not owned.
   std::unique_ptr<PerStepCollectiveRemoteAccess> remote_access_;
+  CollectiveFusion* fusion_;  // Owned, null if fusion is disabled.
 
  private:
-  RingReducer* CreateReducer(OpKernelContext* ctx,
-                             OpKernelContext::Params* params,
-                             const CollectiveParams& col_params,
-                             const string& exec_key, int64 step_id,
-                             const Tensor* input, Tensor* output,
-                             string* error);
-
-  Broadcaster* CreateBroadcaster(OpKernelContext* ctx,
-                                 OpKernelContext::Params* params,
-                                 const CollectiveParams& col_params,
-                                 const string& exec_key, int64 step_id,
-                                 Tensor* output, string* error);
+  // Executes `col_params` on `input` into `output` with the implementation
+  // it selects.
+  void RunCollective(OpKernelContext* ctx, const CollectiveParams& col_params,
+                     const string& exec_key, const Tensor* input,
+                     Tensor* output, const StatusCallback& done);
+  // Returns an error if this executor cannot execute collectives of the
+  // data type of `col_params`.
+  static Status CheckDataType(const CollectiveParams& col_params);
 };
 
 }  // namespace tensorflow
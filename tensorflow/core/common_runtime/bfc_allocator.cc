@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include <atomic>
+#include <thread>
 
 #include "tensorflow/core/common_runtime/bfc_allocator.h"
 
@@ -30,11 +31,18 @@ limitations under the License.
 namespace tensorflow {
 
 BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
-                           bool allow_growth, const string& name)
+                           bool allow_growth, const string& name,
+                           bool enable_chunk_cache)
     : suballocator_(sub_allocator),
       name_(name),
       free_chunks_list_(kInvalidChunkHandle),
-      next_allocation_id_(1) {
+      next_allocation_id_(1),
+      chunk_cache_enabled_(enable_chunk_cache) {
+  if (chunk_cache_enabled_) {
+    cache_shards_.reset(new ChunkCacheShard[kNumCacheShards]);
+    live_chunk_stripes_.reset(new LiveChunkStripe[kNumCacheShards]);
+  }
+
   if (allow_growth) {
     // 1MiB smallest initial allocation, unless total memory available
     // is less.
@@ -247,6 +255,13 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
   // so all memory addresses are nicely byte aligned.
   size_t rounded_bytes = RoundedBytes(num_bytes);
 
+  if (chunk_cache_enabled_ && rounded_bytes <= kMaxCachedChunkSize) {
+    void* ptr = AllocateFromChunkCache(rounded_bytes, num_bytes);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+  }
+
   // The BFC allocator tries to find the best fit first.
   BinNum bin_num = BinNumForSize(rounded_bytes);
 
@@ -264,6 +279,15 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // Give the chunks held by the chunk cache back to the bins, where they
+  // can be coalesced, and try once more.
+  if (chunk_cache_enabled_ && FlushChunkCaches()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+  }
+
   // We searched all bins for an existing free chunk to use and
   // couldn't find one.  This means we must have run out of memory,
   // Dump the memory log for analysis.
@@ -319,6 +343,12 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
             std::max(stats_.max_bytes_in_use, stats_.bytes_in_use);
         stats_.max_alloc_size =
             std::max<std::size_t>(stats_.max_alloc_size, chunk->size);
+        if (chunk_cache_enabled_) {
+          RecordUserAlloc(chunk->size);
+          if (rounded_bytes <= kMaxCachedChunkSize) {
+            TrackLiveChunk(*chunk, rounded_bytes);
+          }
+        }
 
         VLOG(4) << "Returning: " << chunk->ptr;
         if (VLOG_IS_ON(4)) {
@@ -377,11 +407,17 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     LOG(ERROR) << "tried to deallocate nullptr";
     return;
   }
+  if (chunk_cache_enabled_ && DeallocateToChunkCache(ptr)) {
+    return;
+  }
   mutex_lock l(lock_);
 
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
+  if (chunk_cache_enabled_) {
+    RecordUserFree(ChunkFromHandle(h)->size);
+  }
 
   // Consider coalescing it.
   FreeAndMaybeCoalesce(h);
@@ -501,7 +537,141 @@ void BFCAllocator::AddAllocVisitor(Visitor visitor) {
 
 bool BFCAllocator::TracksAllocationSizes() { return true; }
 
+BFCAllocator::ChunkCacheShard* BFCAllocator::CacheShardForCurrentThread() {
+  const size_t h = std::hash<std::thread::id>()(std::this_thread::get_id());
+  return &cache_shards_[h % kNumCacheShards];
+}
+
+BFCAllocator::LiveChunkStripe* BFCAllocator::LiveChunkStripeFor(
+    const void* ptr) {
+  // The low bits are always zero: chunks are kMinAllocationSize aligned.
+  const uintptr_t p = reinterpret_cast<uintptr_t>(ptr) >> kMinAllocationBits;
+  return &live_chunk_stripes_[p % kNumCacheShards];
+}
+
+void* BFCAllocator::AllocateFromChunkCache(size_t rounded_bytes,
+                                           size_t num_bytes) {
+  const int size_class = CacheSizeClass(rounded_bytes);
+  CachedChunk cached;
+  {
+    ChunkCacheShard* shard = CacheShardForCurrentThread();
+    mutex_lock l(shard->mu);
+    std::vector<CachedChunk>& bucket = shard->chunks[size_class];
+    if (bucket.empty()) {
+      return nullptr;
+    }
+    cached = bucket.back();
+    bucket.pop_back();
+  }
+  LiveChunk live;
+  live.size_class = size_class;
+  live.size = cached.size;
+  live.requested_size = num_bytes;
+  live.allocation_id = next_allocation_id_++;
+  {
+    LiveChunkStripe* stripe = LiveChunkStripeFor(cached.ptr);
+    mutex_lock l(stripe->mu);
+    stripe->chunks[cached.ptr] = live;
+  }
+  ++num_cache_allocs_;
+  RecordUserAlloc(cached.size);
+  VLOG(4) << "Returning cached: " << cached.ptr;
+  return cached.ptr;
+}
+
+bool BFCAllocator::DeallocateToChunkCache(void* ptr) {
+  LiveChunk live;
+  {
+    LiveChunkStripe* stripe = LiveChunkStripeFor(ptr);
+    mutex_lock l(stripe->mu);
+    auto it = stripe->chunks.find(ptr);
+    if (it == stripe->chunks.end()) {
+      return false;
+    }
+    live = it->second;
+    stripe->chunks.erase(it);
+  }
+  RecordUserFree(live.size);
+
+  std::vector<CachedChunk> to_return;
+  {
+    ChunkCacheShard* shard = CacheShardForCurrentThread();
+    mutex_lock l(shard->mu);
+    std::vector<CachedChunk>& bucket = shard->chunks[live.size_class];
+    bucket.push_back({ptr, live.size});
+    if (bucket.size() > kMaxCachedChunksPerClass) {
+      // Keep the most recently freed chunks, which are likely still in
+      // cache, and return the others to the bins.
+      const auto split = bucket.begin() + bucket.size() / 2;
+      to_return.assign(bucket.begin(), split);
+      bucket.erase(bucket.begin(), split);
+    }
+  }
+  if (!to_return.empty()) {
+    mutex_lock l(lock_);
+    ReturnCachedChunks(to_return);
+  }
+  return true;
+}
+
+void BFCAllocator::TrackLiveChunk(const Chunk& chunk, size_t rounded_bytes) {
+  LiveChunk live;
+  live.size_class = CacheSizeClass(rounded_bytes);
+  live.size = chunk.size;
+  live.requested_size = chunk.requested_size;
+  live.allocation_id = chunk.allocation_id;
+  LiveChunkStripe* stripe = LiveChunkStripeFor(chunk.ptr);
+  mutex_lock l(stripe->mu);
+  stripe->chunks[chunk.ptr] = live;
+}
+
+bool BFCAllocator::FindLiveChunk(const void* ptr, LiveChunk* live) {
+  LiveChunkStripe* stripe = LiveChunkStripeFor(ptr);
+  mutex_lock l(stripe->mu);
+  auto it = stripe->chunks.find(ptr);
+  if (it == stripe->chunks.end()) {
+    return false;
+  }
+  *live = it->second;
+  return true;
+}
+
+void BFCAllocator::ReturnCachedChunks(const std::vector<CachedChunk>& chunks) {
+  for (const CachedChunk& cached : chunks) {
+    BFCAllocator::ChunkHandle h = region_manager_.get_handle(cached.ptr);
+    CHECK(h != kInvalidChunkHandle);
+    FreeAndMaybeCoalesce(h);
+  }
+}
+
+bool BFCAllocator::FlushChunkCaches() {
+  std::vector<CachedChunk> to_return;
+  for (int i = 0; i < kNumCacheShards; ++i) {
+    ChunkCacheShard* shard = &cache_shards_[i];
+    mutex_lock l(shard->mu);
+    for (std::vector<CachedChunk>& bucket : shard->chunks) {
+      to_return.insert(to_return.end(), bucket.begin(), bucket.end());
+      bucket.clear();
+    }
+  }
+  VLOG(1) << "Flushing " << to_return.size() << " cached chunks";
+  ReturnCachedChunks(to_return);
+  return !to_return.empty();
+}
+
+void BFCAllocator::RecordUserAlloc(int64 bytes) {
+  const int64 in_use = user_bytes_in_use_.fetch_add(bytes) + bytes;
+  int64 max_in_use = max_user_bytes_in_use_.load(std::memory_order_relaxed);
+  while (in_use > max_in_use &&
+         !max_user_bytes_in_use_.compare_exchange_weak(max_in_use, in_use)) {
+  }
+}
+
 size_t BFCAllocator::RequestedSize(const void* ptr) {
+  LiveChunk live;
+  if (chunk_cache_enabled_ && FindLiveChunk(ptr, &live)) {
+    return live.requested_size;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -511,6 +681,10 @@ size_t BFCAllocator::RequestedSize(const void* ptr) {
 }
 
 size_t BFCAllocator::AllocatedSize(const void* ptr) {
+  LiveChunk live;
+  if (chunk_cache_enabled_ && FindLiveChunk(ptr, &live)) {
+    return live.size;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -520,6 +694,10 @@ size_t BFCAllocator::AllocatedSize(const void* ptr) {
 }
 
 int64 BFCAllocator::AllocationId(const void* ptr) {
+  LiveChunk live;
+  if (chunk_cache_enabled_ && FindLiveChunk(ptr, &live)) {
+    return live.allocation_id;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -663,6 +841,11 @@ void BFCAllocator::DumpMemoryLog(size_t num_bytes) {
 void BFCAllocator::GetStats(AllocatorStats* stats) {
   mutex_lock l(lock_);
   *stats = stats_;
+  if (chunk_cache_enabled_) {
+    stats->num_allocs += num_cache_allocs_.load();
+    stats->bytes_in_use = user_bytes_in_use_.load();
+    stats->max_bytes_in_use = max_user_bytes_in_use_.load();
+  }
 }
 
 void BFCAllocator::ClearStats() {
@@ -670,6 +853,8 @@ void BFCAllocator::ClearStats() {
   stats_.num_allocs = 0;
   stats_.max_bytes_in_use = stats_.bytes_in_use;
   stats_.max_alloc_size = 0;
+  num_cache_allocs_ = 0;
+  max_user_bytes_in_use_ = user_bytes_in_use_.load();
 }
 
 std::array<BFCAllocator::BinDebugInfo, BFCAllocator::kNumBins>
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_COMMON_RUNTIME_BFC_ALLOCATOR_H_
 
 #include <array>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -24,6 +25,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/allocator_retry.h"
 #include "tensorflow/core/common_runtime/visitable_allocator.h"
+#include "tensorflow/core/lib/gtl/flatmap.h"
 #include "tensorflow/core/lib/gtl/stl_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/macros.h"
@@ -42,11 +44,17 @@ namespace tensorflow {
 // coalescing.  One assumption we make is that the process using this
 // allocator owns pretty much all of the memory, and that nearly
 // all requests to allocate memory go through this interface.
+//
+// If constructed with "enable_chunk_cache", small freed chunks are kept in
+// per-thread, per-size-class caches in front of the bins, so that most small
+// allocations and deallocations do not contend on the allocator-wide lock.
+// See the "Chunk cache" section below.
 class BFCAllocator : public VisitableAllocator {
  public:
   // Takes ownership of sub_allocator.
   BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
-               bool allow_growth, const string& name);
+               bool allow_growth, const string& name,
+               bool enable_chunk_cache = false);
   ~BFCAllocator() override;
 
   string Name() override { return name_; }
@@ -308,6 +316,88 @@ class BFCAllocator : public VisitableAllocator {
     std::vector<AllocationRegion> regions_;
   };
 
+  // Chunk cache.
+  //
+  // When enabled, chunks serving allocations of at most kMaxCachedChunkSize
+  // bytes are not returned to the bins by DeallocateRaw. Instead they are
+  // kept in one of kNumCacheShards caches, picked by the calling thread, and
+  // bucketed by the rounded size of the request they served. A later
+  // AllocateRaw of the same rounded size on a thread using that shard reuses
+  // them without taking lock_. When a bucket grows beyond
+  // kMaxCachedChunksPerClass, its older half is returned to the bins in one
+  // batch under lock_. All caches are also flushed before an allocation
+  // fails for lack of memory.
+  //
+  // Cached chunks stay marked in use in the bins. Live small allocations are
+  // tracked in live_chunk_stripes_ (sharded by pointer), which DeallocateRaw,
+  // RequestedSize, AllocatedSize and AllocationId consult before lock_.
+  //
+  // Lock order: lock_ may be held while acquiring a shard's or a stripe's
+  // mutex, never the other way around.
+  static const size_t kMaxCachedChunkSize = 16 << 10;
+  static const int kNumCacheSizeClasses =
+      kMaxCachedChunkSize / kMinAllocationSize;
+  static const int kNumCacheShards = 16;
+  static const size_t kMaxCachedChunksPerClass = 64;
+
+  struct CachedChunk {
+    void* ptr;
+    size_t size;  // Chunk::size of the underlying chunk.
+  };
+
+  struct ChunkCacheShard {
+    mutex mu;
+    // Free chunks, indexed by CacheSizeClass(rounded request size).
+    std::vector<CachedChunk> chunks[kNumCacheSizeClasses] GUARDED_BY(mu);
+  };
+
+  // A live small allocation, whose Chunk fields may be stale while the chunk
+  // cycles through the cache.
+  struct LiveChunk {
+    int size_class;
+    size_t size;
+    size_t requested_size;
+    int64 allocation_id;
+  };
+
+  struct LiveChunkStripe {
+    mutex mu;
+    gtl::FlatMap<const void*, LiveChunk> chunks GUARDED_BY(mu);
+  };
+
+  static int CacheSizeClass(size_t rounded_bytes) {
+    return static_cast<int>(rounded_bytes / kMinAllocationSize) - 1;
+  }
+  ChunkCacheShard* CacheShardForCurrentThread();
+  LiveChunkStripe* LiveChunkStripeFor(const void* ptr);
+
+  // Returns a cached chunk for an allocation of 'rounded_bytes', or nullptr
+  // if the calling thread's shard has none.
+  void* AllocateFromChunkCache(size_t rounded_bytes, size_t num_bytes);
+
+  // Moves 'ptr' into the calling thread's cache shard. Returns false if
+  // 'ptr' is not a live small allocation.
+  bool DeallocateToChunkCache(void* ptr);
+
+  // Records a small allocation just carved out of the bins.
+  void TrackLiveChunk(const Chunk& chunk, size_t rounded_bytes)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Looks up the live small allocation 'ptr'. Returns false if none.
+  bool FindLiveChunk(const void* ptr, LiveChunk* live);
+
+  // Returns the cached 'chunks' to the bins, coalescing them as usual.
+  void ReturnCachedChunks(const std::vector<CachedChunk>& chunks)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Returns all cached chunks to the bins. Returns true if there were any.
+  bool FlushChunkCaches() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Accounts for 'bytes' newly handed to or returned by the user when the
+  // chunk cache is enabled.
+  void RecordUserAlloc(int64 bytes);
+  void RecordUserFree(int64 bytes) { user_bytes_in_use_.fetch_sub(bytes); }
+
   // Returns 'bytes' rounded up to the next highest kMinAllocationSize.
   size_t RoundedBytes(size_t bytes);
 
@@ -439,12 +529,21 @@ class BFCAllocator : public VisitableAllocator {
   std::vector<Visitor> region_visitors_ GUARDED_BY(lock_);
 
   // Counter containing the next unique identifier to assign to a
-  // newly-created chunk.
-  int64 next_allocation_id_ GUARDED_BY(lock_);
+  // newly-created chunk. Atomic so that chunk cache hits can draw from it.
+  std::atomic<int64> next_allocation_id_;
 
-  // Stats.
+  // Stats. When the chunk cache is enabled, chunks sitting in the cache are
+  // counted as in use here and cache hits are not counted as allocations;
+  // GetStats() corrects for both with the counters below.
   AllocatorStats stats_ GUARDED_BY(lock_);
 
+  const bool chunk_cache_enabled_;
+  std::unique_ptr<ChunkCacheShard[]> cache_shards_;
+  std::unique_ptr<LiveChunkStripe[]> live_chunk_stripes_;
+  std::atomic<int64> num_cache_allocs_{0};
+  std::atomic<int64> user_bytes_in_use_{0};
+  std::atomic<int64> max_user_bytes_in_use_{0};
+
   friend class GPUBFCAllocatorPrivateMethodsTest;
   TF_DISALLOW_COPY_AND_ASSIGN(BFCAllocator);
 };
@@ -0,0 +1,191 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace {
+
+static void CheckStats(Allocator* a, int64 num_allocs, int64 bytes_in_use,
+                       int64 max_bytes_in_use) {
+  AllocatorStats stats;
+  a->GetStats(&stats);
+  EXPECT_EQ(stats.num_allocs, num_allocs);
+  EXPECT_EQ(stats.bytes_in_use, bytes_in_use);
+  EXPECT_EQ(stats.max_bytes_in_use, max_bytes_in_use);
+}
+
+BFCAllocator* NewCPUBFCAllocator(size_t total_memory, bool chunk_cache) {
+  return new BFCAllocator(new BasicCPUAllocator(-1), total_memory,
+                          true /*allow_growth*/, "bfc_test", chunk_cache);
+}
+
+class BFCAllocatorTest : public ::testing::TestWithParam<bool> {};
+
+TEST_P(BFCAllocatorTest, NoDups) {
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1 << 30, GetParam()));
+  CheckStats(a.get(), 0, 0, 0);
+
+  std::vector<void*> ptrs;
+  for (int s = 1; s < 1024; s++) {
+    ptrs.push_back(a->AllocateRaw(1, s));
+  }
+  CheckStats(a.get(), 1023, 654336, 654336);
+
+  std::sort(ptrs.begin(), ptrs.end());
+  for (size_t i = 1; i < ptrs.size(); i++) {
+    ASSERT_NE(ptrs[i], ptrs[i - 1]);
+    size_t req_size = a->RequestedSize(ptrs[i - 1]);
+    ASSERT_GT(req_size, 0);
+    ASSERT_GE(static_cast<char*>(ptrs[i]) - static_cast<char*>(ptrs[i - 1]),
+              req_size);
+  }
+
+  for (size_t i = 0; i < ptrs.size(); i++) {
+    a->DeallocateRaw(ptrs[i]);
+  }
+  CheckStats(a.get(), 1023, 0, 654336);
+}
+
+TEST_P(BFCAllocatorTest, ReuseKeepsStatsAndIds) {
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1 << 30, GetParam()));
+  void* p1 = a->AllocateRaw(1, 1000);
+  const int64 id1 = a->AllocationId(p1);
+  a->DeallocateRaw(p1);
+  CheckStats(a.get(), 1, 0, 1024);
+
+  // The same size class is served again, either from the chunk cache or the
+  // bins, with fresh metadata.
+  void* p2 = a->AllocateRaw(1, 900);
+  EXPECT_EQ(900, a->RequestedSize(p2));
+  EXPECT_EQ(1024, a->AllocatedSize(p2));
+  EXPECT_GT(a->AllocationId(p2), id1);
+  CheckStats(a.get(), 2, 1024, 1024);
+
+  void* p3 = a->AllocateRaw(1, 1000);
+  CheckStats(a.get(), 3, 2048, 2048);
+  a->DeallocateRaw(p2);
+  a->DeallocateRaw(p3);
+  CheckStats(a.get(), 3, 0, 2048);
+
+  a->ClearStats();
+  CheckStats(a.get(), 0, 0, 0);
+}
+
+TEST_P(BFCAllocatorTest, CachedChunksAreReturnedWhenOutOfMemory) {
+  // Room for exactly 16 chunks of 16KiB.
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(256 << 10, GetParam()));
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 16; i++) {
+    void* p = a->AllocateRaw(1, 16 << 10);
+    ASSERT_NE(p, nullptr);
+    ptrs.push_back(p);
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  // A large allocation only fits once the small chunks are coalesced.
+  AllocationAttributes attr;
+  attr.no_retry_on_failure = true;
+  void* big = a->AllocateRaw(1, 256 << 10, attr);
+  ASSERT_NE(big, nullptr);
+  a->DeallocateRaw(big);
+  CheckStats(a.get(), 17, 0, 256 << 10);
+}
+
+TEST_P(BFCAllocatorTest, ConcurrentAllocations) {
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1 << 30, GetParam()));
+  const int kNumThreads = 8;
+  thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+  BlockingCounter counter(kNumThreads);
+  for (int t = 0; t < kNumThreads; t++) {
+    pool.Schedule([&a, &counter, t]() {
+      std::vector<void*> ptrs;
+      for (int i = 0; i < 1000; i++) {
+        ptrs.push_back(a->AllocateRaw(1, 256 * (1 + (i + t) % 64)));
+        if (ptrs.size() > 16) {
+          a->DeallocateRaw(ptrs.front());
+          ptrs.erase(ptrs.begin());
+        }
+      }
+      for (void* p : ptrs) {
+        a->DeallocateRaw(p);
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  AllocatorStats stats;
+  a->GetStats(&stats);
+  EXPECT_EQ(kNumThreads * 1000, stats.num_allocs);
+  EXPECT_EQ(0, stats.bytes_in_use);
+}
+
+INSTANTIATE_TEST_CASE_P(ChunkCache, BFCAllocatorTest, ::testing::Bool());
+
+// "num_threads" threads repeatedly allocate and free small temporaries, as
+// inter-op threads do, against one allocator.
+static void BM_AllocationContention(int iters, int num_threads,
+                                    bool chunk_cache) {
+  testing::StopTiming();
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1LL << 32, chunk_cache));
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  BlockingCounter counter(num_threads);
+  const int iters_per_thread = std::max(1, iters / num_threads);
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int t = 0; t < num_threads; t++) {
+    pool.Schedule([&a, &counter, iters_per_thread]() {
+      const size_t sizes[] = {64, 256, 1024, 4096, 512, 8192, 128, 2048};
+      void* live[4] = {nullptr, nullptr, nullptr, nullptr};
+      for (int i = 0; i < iters_per_thread; i++) {
+        void*& slot = live[i % 4];
+        if (slot != nullptr) a->DeallocateRaw(slot);
+        slot = a->AllocateRaw(1, sizes[i % 8]);
+      }
+      for (void* p : live) {
+        if (p != nullptr) a->DeallocateRaw(p);
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters_per_thread) * num_threads);
+}
+
+static void BM_AllocationContentionLocked(int iters, int num_threads) {
+  BM_AllocationContention(iters, num_threads, false);
+}
+BENCHMARK(BM_AllocationContentionLocked)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_AllocationContentionChunkCache(int iters, int num_threads) {
+  BM_AllocationContention(iters, num_threads, true);
+}
+BENCHMARK(BM_AllocationContentionChunkCache)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+}  // namespace
+}  // namespace tensorflow
@@ -297,4 +297,14 @@ void Broadcaster::DispatchRecv(int subdiv, int src_rank, int dst_rank,
                           device_locality_, 0 /*stream_index*/, done);
 }
 
+REGISTER_COLLECTIVE(
+    "HierarchicalTreeBroadcast", BROADCAST_COLLECTIVE,
+    [](CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+       OpKernelContext* ctx, OpKernelContext::Params* params,
+       const CollectiveParams& col_params, const string& exec_key,
+       int64 step_id, const Tensor* input, Tensor* output) {
+      return new Broadcaster(col_exec, dev_mgr, ctx, params, col_params,
+                             exec_key, step_id, output);
+    });
+
 }  // namespace tensorflow
@@ -0,0 +1,169 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/core/framework/bfloat16.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace collective_compression {
+
+Status ValidateCompression(const CollectiveParams& params) {
+  const CollInstanceParams& instance = params.instance;
+  if (instance.compression == COMPRESSION_NONE) return Status::OK();
+  if (instance.data_type != DT_FLOAT) {
+    return errors::InvalidArgument(
+        "Compression of collective ", params.name, " requires float values, ",
+        "got ", DataTypeString(instance.data_type));
+  }
+  if (params.group.device_type != DEVICE_CPU) {
+    return errors::InvalidArgument("Compression of collective ", params.name,
+                                   " requires CPU devices, got ",
+                                   params.group.device_type.type());
+  }
+  if (instance.compression == COMPRESSION_TOPK) {
+    if (params.residuals == nullptr) {
+      return errors::Internal("Top-k compression of collective ", params.name,
+                              " has no residuals");
+    }
+    if (params.merge_op == nullptr || params.merge_op->type_string() != "Add") {
+      return errors::InvalidArgument("Top-k compression of collective ",
+                                     params.name, " requires merge_op Add");
+    }
+    if (!(instance.topk_fraction > 0 && instance.topk_fraction <= 1)) {
+      return errors::InvalidArgument(
+          "topk_fraction of collective ", params.name,
+          " must be in (0, 1], got ", instance.topk_fraction);
+    }
+  }
+  return Status::OK();
+}
+
+int64 TopKSize(float topk_fraction, int64 num_elements) {
+  const int64 k = static_cast<int64>(std::ceil(topk_fraction * num_elements));
+  return std::min(num_elements, std::max<int64>(1, k));
+}
+
+Tensor AllocateWire(Allocator* allocator,
+                    const CollInstanceParams& instance_params,
+                    int64 num_elements) {
+  switch (instance_params.compression) {
+    case COMPRESSION_BFLOAT16:
+      return Tensor(allocator, DT_BFLOAT16, TensorShape({num_elements}));
+    case COMPRESSION_FLOAT16:
+      return Tensor(allocator, DT_HALF, TensorShape({num_elements}));
+    case COMPRESSION_TOPK:
+      return Tensor(
+          allocator, DT_INT32,
+          TensorShape(
+              {2 * TopKSize(instance_params.topk_fraction, num_elements)}));
+    case COMPRESSION_NONE:
+      break;
+  }
+  LOG(FATAL) << "No wire tensor for compression "
+             << instance_params.compression;
+  return Tensor();
+}
+
+void Compress(const CollInstanceParams& instance_params, const Tensor& chunk,
+              Tensor* residual, Tensor* wire) {
+  const float* values = chunk.flat<float>().data();
+  const int64 n = chunk.NumElements();
+  switch (instance_params.compression) {
+    case COMPRESSION_BFLOAT16: {
+      bfloat16* out = wire->flat<bfloat16>().data();
+      for (int64 i = 0; i < n; ++i) {
+        out[i] = bfloat16::round_to_bfloat16(values[i]);
+      }
+      return;
+    }
+    case COMPRESSION_FLOAT16: {
+      Eigen::half* out = wire->flat<Eigen::half>().data();
+      for (int64 i = 0; i < n; ++i) {
+        out[i] = Eigen::half(values[i]);
+      }
+      return;
+    }
+    case COMPRESSION_TOPK: {
+      const int64 k = wire->NumElements() / 2;
+      // The residual first accumulates everything that is owed, then keeps
+      // what is left after the k largest values are sent.
+      float* owed = residual->flat<float>().data();
+      for (int64 i = 0; i < n; ++i) {
+        owed[i] += values[i];
+      }
+      std::vector<int32> order(n);
+      std::iota(order.begin(), order.end(), 0);
+      std::nth_element(order.begin(), order.begin() + k, order.end(),
+                       [owed](int32 a, int32 b) {
+                         return std::abs(owed[a]) > std::abs(owed[b]);
+                       });
+      // Ascending indices make the scatter on decompression sequential.
+      std::sort(order.begin(), order.begin() + k);
+      int32* indices = wire->flat<int32>().data();
+      float* sent = reinterpret_cast<float*>(indices + k);
+      for (int64 j = 0; j < k; ++j) {
+        indices[j] = order[j];
+        sent[j] = owed[order[j]];
+        owed[order[j]] = 0;
+      }
+      return;
+    }
+    case COMPRESSION_NONE:
+      break;
+  }
+  LOG(FATAL) << "Cannot compress with " << instance_params.compression;
+}
+
+void Decompress(const CollInstanceParams& instance_params, const Tensor& wire,
+                Tensor* chunk) {
+  float* values = chunk->flat<float>().data();
+  const int64 n = chunk->NumElements();
+  switch (instance_params.compression) {
+    case COMPRESSION_BFLOAT16:
+      BFloat16ToFloat(wire.flat<bfloat16>().data(), values, n);
+      return;
+    case COMPRESSION_FLOAT16: {
+      const Eigen::half* in = wire.flat<Eigen::half>().data();
+      for (int64 i = 0; i < n; ++i) {
+        values[i] = static_cast<float>(in[i]);
+      }
+      return;
+    }
+    case COMPRESSION_TOPK: {
+      const int64 k = wire.NumElements() / 2;
+      const int32* indices = wire.flat<int32>().data();
+      const float* sent = reinterpret_cast<const float*>(indices + k);
+      std::fill(values, values + n, 0.0f);
+      for (int64 j = 0; j < k; ++j) {
+        values[indices[j]] = sent[j];
+      }
+      return;
+    }
+    case COMPRESSION_NONE:
+      break;
+  }
+  LOG(FATAL) << "Cannot decompress with " << instance_params.compression;
+}
+
+}  // namespace collective_compression
+}  // namespace tensorflow
@@ -0,0 +1,61 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace collective_compression {
+
+// Encoding of DT_FLOAT chunks of a collective in the wire formats of
+// CollectiveCompression, on CPU.
+//
+// COMPRESSION_BFLOAT16 and COMPRESSION_FLOAT16 chunks are DT_BFLOAT16 and
+// DT_HALF tensors with the values rounded to nearest. COMPRESSION_TOPK chunks
+// are DT_INT32 tensors of 2k elements: the ascending indices of the k values
+// of largest magnitude, followed by the bits of those values.
+
+// Returns an error if `params` asks for a compression that cannot be applied.
+Status ValidateCompression(const CollectiveParams& params);
+
+// Returns the number of values of a chunk of `num_elements` that
+// COMPRESSION_TOPK sends: at least one, unless the chunk is empty.
+int64 TopKSize(float topk_fraction, int64 num_elements);
+
+// Returns an uninitialized wire tensor for a chunk of `num_elements`.
+Tensor AllocateWire(Allocator* allocator,
+                    const CollInstanceParams& instance_params,
+                    int64 num_elements);
+
+// Encodes `chunk` into `wire`, allocated by AllocateWire. For
+// COMPRESSION_TOPK, `residual` holds the values that earlier calls did not
+// send, which are added to `chunk` before the largest are picked, and is
+// updated with those that are not sent this time. It is ignored otherwise.
+void Compress(const CollInstanceParams& instance_params, const Tensor& chunk,
+              Tensor* residual, Tensor* wire);
+
+// Decodes `wire` into `chunk`, which has the number of elements that `wire`
+// was allocated for.
+void Decompress(const CollInstanceParams& instance_params, const Tensor& wire,
+                Tensor* chunk);
+
+}  // namespace collective_compression
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_COMPRESSION_H_
@@ -0,0 +1,155 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_compression.h"
+
+#include <cmath>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace collective_compression {
+namespace {
+
+Tensor RoundTrip(const CollInstanceParams& instance, const Tensor& chunk,
+                 Tensor* residual) {
+  Tensor wire = AllocateWire(cpu_allocator(), instance, chunk.NumElements());
+  Compress(instance, chunk, residual, &wire);
+  Tensor decoded(DT_FLOAT, chunk.shape());
+  Decompress(instance, wire, &decoded);
+  return decoded;
+}
+
+TEST(CollectiveCompressionTest, Bfloat16RoundsToNearest) {
+  CollInstanceParams instance;
+  instance.compression = COMPRESSION_BFLOAT16;
+  // 1 + 2^-7 is the bfloat16 after 1. Truncation would give 1 for all three.
+  Tensor chunk = test::AsTensor<float>({1.0f + 0.7f / 128, -1.0f - 0.7f / 128,
+                                        1.0f + 0.3f / 128});
+  Tensor wire = AllocateWire(cpu_allocator(), instance, 3);
+  EXPECT_EQ(DT_BFLOAT16, wire.dtype());
+  EXPECT_EQ(3, wire.NumElements());
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({1.0f + 1.0f / 128, -1.0f - 1.0f / 128, 1.0f}),
+      RoundTrip(instance, chunk, nullptr));
+}
+
+TEST(CollectiveCompressionTest, Float16) {
+  CollInstanceParams instance;
+  instance.compression = COMPRESSION_FLOAT16;
+  Tensor chunk = test::AsTensor<float>({0.1f, -3.25f, 1000.0f, 1e-3f});
+  Tensor decoded = RoundTrip(instance, chunk, nullptr);
+  for (int i = 0; i < 4; ++i) {
+    const float value = chunk.flat<float>()(i);
+    EXPECT_NEAR(value, decoded.flat<float>()(i), std::abs(value) / 1024);
+  }
+}
+
+TEST(CollectiveCompressionTest, TopKSize) {
+  EXPECT_EQ(0, TopKSize(0.01, 0));
+  EXPECT_EQ(1, TopKSize(0.01, 10));
+  EXPECT_EQ(3, TopKSize(0.25, 10));
+  EXPECT_EQ(10, TopKSize(1.0, 10));
+}
+
+TEST(CollectiveCompressionTest, TopKSendsLargestAndCarriesTheRest) {
+  CollInstanceParams instance;
+  instance.compression = COMPRESSION_TOPK;
+  instance.topk_fraction = 0.4;
+  Tensor residual(DT_FLOAT, TensorShape({5}));
+  residual.flat<float>().setZero();
+  Tensor chunk = test::AsTensor<float>({0.5f, -4.0f, 1.0f, 3.0f, -0.25f});
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0.0f, -4.0f, 0.0f, 3.0f, 0.0f}),
+      RoundTrip(instance, chunk, &residual));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0.5f, 0.0f, 1.0f, 0.0f, -0.25f}), residual);
+
+  // What was carried over is sent once it outweighs the new values.
+  chunk = test::AsTensor<float>({0.75f, 0.0f, 0.5f, 0.0f, 0.0f});
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({1.25f, 0.0f, 1.5f, 0.0f, 0.0f}),
+      RoundTrip(instance, chunk, &residual));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0.0f, 0.0f, 0.0f, 0.0f, -0.25f}), residual);
+}
+
+TEST(CollectiveCompressionTest, TopKErrorFeedbackLosesNothing) {
+  CollInstanceParams instance;
+  instance.compression = COMPRESSION_TOPK;
+  instance.topk_fraction = 0.05;
+  const int n = 1000;
+  Tensor residual(DT_FLOAT, TensorShape({n}));
+  residual.flat<float>().setZero();
+  std::vector<double> sent(n, 0.0);
+  std::vector<double> owed(n, 0.0);
+  for (int step = 0; step < 20; ++step) {
+    Tensor chunk(DT_FLOAT, TensorShape({n}));
+    for (int i = 0; i < n; ++i) {
+      chunk.flat<float>()(i) = std::sin(step * n + i);
+      owed[i] += chunk.flat<float>()(i);
+    }
+    Tensor decoded = RoundTrip(instance, chunk, &residual);
+    int num_sent = 0;
+    for (int i = 0; i < n; ++i) {
+      sent[i] += decoded.flat<float>()(i);
+      if (decoded.flat<float>()(i) != 0) ++num_sent;
+    }
+    EXPECT_EQ(50, num_sent);
+  }
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(owed[i], sent[i] + residual.flat<float>()(i), 1e-4);
+  }
+}
+
+TEST(CollectiveCompressionTest, Residuals) {
+  CollectiveResiduals residuals;
+  Tensor residual = residuals.Get(0, 4);
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 0, 0, 0}),
+                                 residual);
+  residual.flat<float>()(1) = 2;
+  EXPECT_EQ(2, residuals.Get(0, 4).flat<float>()(1));
+  EXPECT_EQ(0, residuals.Get(1, 4).flat<float>()(1));
+  // A new size starts over.
+  EXPECT_EQ(0, residuals.Get(0, 3).flat<float>()(1));
+  // Residuals belong to their CollectiveResiduals.
+  EXPECT_EQ(0, CollectiveResiduals().Get(1, 4).flat<float>()(1));
+}
+
+TEST(CollectiveCompressionTest, ValidateCompression) {
+  CollectiveParams params;
+  params.name = "test";
+  TF_EXPECT_OK(ValidateCompression(params));
+  params.instance.compression = COMPRESSION_BFLOAT16;
+  TF_EXPECT_OK(ValidateCompression(params));
+  params.instance.data_type = DT_DOUBLE;
+  EXPECT_TRUE(errors::IsInvalidArgument(ValidateCompression(params)));
+  params.instance.data_type = DT_FLOAT;
+  params.group.device_type = DEVICE_GPU;
+  EXPECT_TRUE(errors::IsInvalidArgument(ValidateCompression(params)));
+  params.group.device_type = DEVICE_CPU;
+  // Top-k needs residuals, owned by the op.
+  params.instance.compression = COMPRESSION_TOPK;
+  EXPECT_TRUE(errors::IsInternal(ValidateCompression(params)));
+  // Top-k needs an Add merge_op.
+  params.residuals.reset(new CollectiveResiduals);
+  EXPECT_TRUE(errors::IsInvalidArgument(ValidateCompression(params)));
+}
+
+}  // namespace
+}  // namespace collective_compression
+}  // namespace tensorflow
@@ -29,7 +29,12 @@ CollectiveExecutorMgr::CollectiveExecutorMgr(
     std::unique_ptr<ParamResolverInterface> param_resolver)
     : dev_mgr_(dev_mgr),
       dev_resolver_(std::move(dev_resolver)),
-      param_resolver_(std::move(param_resolver)) {}
+      param_resolver_(std::move(param_resolver)) {
+  fusion_options_.threshold_bytes =
+      config.experimental().collective_fusion_threshold_bytes();
+  fusion_options_.timeout_micros =
+      config.experimental().collective_fusion_timeout_micros();
+}
 
 CollectiveExecutorMgr::~CollectiveExecutorMgr() {
   for (auto iter : executor_table_) {
@@ -56,7 +61,8 @@ CollectiveExecutor* CollectiveExecutorMgr::FindOrCreate(int64 step_id) {
 CollectiveExecutor* CollectiveExecutorMgr::Create(int64 step_id) {
   CollectiveRemoteAccessLocal* rma =
       new CollectiveRemoteAccessLocal(dev_mgr_, dev_resolver_.get(), step_id);
-  return new BaseCollectiveExecutor(this, rma, step_id, dev_mgr_);
+  return new BaseCollectiveExecutor(this, rma, step_id, dev_mgr_,
+                                    fusion_options_);
 }
 
 void CollectiveExecutorMgr::Cleanup(int64 step_id) {
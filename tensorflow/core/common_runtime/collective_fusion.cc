@@ -0,0 +1,650 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_fusion.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace {
+// Largest number of ops in a fusion buffer, or in a report of ready ops.
+const int kMaxFusedOps = 255;
+
+// Ops that may share a fusion buffer have the same fusion key.
+string FusionKey(const CollectiveParams& cp) {
+  return strings::StrCat(
+      cp.group.group_key, ":", DataTypeString(cp.instance.data_type), ":",
+      cp.merge_op ? cp.merge_op->type_string() : "", ":",
+      cp.final_op ? cp.final_op->type_string() : "", ":",
+      cp.instance.impl_details.collective_name, ":",
+      str_util::Join(cp.instance.impl_details.subdiv_offsets, ","));
+}
+
+// Key to be used for BufRendezvous by the plan of fusion buffer `seq`
+// sent to the device of default rank `dst_rank`.
+string FusionPlanKey(const string& fusion_key, int64 seq, int dst_rank) {
+  return strings::StrCat("fusion_plan(", fusion_key, "):", seq, ":",
+                         dst_rank);
+}
+
+// Key to be used for BufRendezvous by report `seq` of the ops ready on the
+// device of default rank `src_rank`.
+string FusionReportKey(const string& fusion_key, int64 seq, int src_rank) {
+  return strings::StrCat("fusion_ready(", fusion_key, "):", seq, ":",
+                         src_rank);
+}
+
+AllocatorAttributes HostAttr() {
+  AllocatorAttributes attr;
+  attr.set_on_host(true);
+  return attr;
+}
+
+// Plans and reports are lists of exec key hashes, sent as a fixed size
+// tensor of the number of keys followed by the keys.
+std::shared_ptr<Tensor> MakeKeyList(Device* device,
+                                    const std::vector<uint64>& key_hashes) {
+  std::shared_ptr<Tensor> list(new Tensor(device->GetAllocator(HostAttr()),
+                                          DT_INT64,
+                                          TensorShape({kMaxFusedOps + 1})));
+  auto values = list->flat<int64>();
+  values.setZero();
+  values(0) = key_hashes.size();
+  for (int i = 0; i < static_cast<int>(key_hashes.size()); ++i) {
+    values(i + 1) = static_cast<int64>(key_hashes[i]);
+  }
+  return list;
+}
+
+Status ParseKeyList(const Tensor& list, std::vector<uint64>* key_hashes) {
+  auto values = list.flat<int64>();
+  const int64 num_keys = values(0);
+  if (num_keys < 1 || num_keys > kMaxFusedOps) {
+    return errors::Internal("Malformed collective fusion key list of ",
+                            num_keys, " keys");
+  }
+  for (int64 i = 1; i <= num_keys; ++i) {
+    key_hashes->push_back(static_cast<uint64>(values(i)));
+  }
+  return Status::OK();
+}
+
+// Returns a view of all the elements of `t` as a vector.
+Tensor Flat(const Tensor& t) {
+  Tensor flat;
+  CHECK(flat.CopyFrom(t, TensorShape({t.NumElements()})));
+  return flat;
+}
+}  // namespace
+
+const int64 CollectiveFusionOptions::kDefaultTimeoutMicros;
+
+CollectiveFusion::CollectiveFusion(CollectiveExecutor* col_exec,
+                                   const DeviceMgr* dev_mgr,
+                                   const CollectiveFusionOptions& options,
+                                   Runner runner)
+    : col_exec_(col_exec),
+      dev_mgr_(dev_mgr),
+      threshold_bytes_(options.threshold_bytes),
+      timeout_micros_(options.timeout_micros > 0
+                          ? options.timeout_micros
+                          : CollectiveFusionOptions::kDefaultTimeoutMicros),
+      runner_(std::move(runner)) {}
+
+CollectiveFusion::~CollectiveFusion() {
+  for (const auto& it : buffers_) {
+    CHECK(it.second->pending.empty())
+        << "CollectiveFusion destroyed with pending ops";
+  }
+}
+
+bool CollectiveFusion::ShouldFuse(OpKernelContext* ctx,
+                                  const CollectiveParams& col_params) const {
+  if (threshold_bytes_ <= 0 ||
+      col_params.instance.type != REDUCTION_COLLECTIVE ||
+      col_params.instance.compression != COMPRESSION_NONE ||
+      col_params.group.group_size < 2 || ctx->num_inputs() < 1) {
+    return false;
+  }
+  const int64 num_bytes = ctx->input(0).TotalBytes();
+  return num_bytes > 0 && num_bytes < threshold_bytes_;
+}
+
+void CollectiveFusion::Add(OpKernelContext* ctx,
+                           const CollectiveParams& col_params,
+                           const string& exec_key,
+                           const StatusCallback& done) {
+  std::unique_ptr<Entry> entry(new Entry);
+  entry->ctx = ctx;
+  entry->col_params = &col_params;
+  entry->exec_key = exec_key;
+  entry->key_hash = Hash64(exec_key);
+  entry->done = done;
+
+  std::vector<Flush> flushes;
+  ReportRequests report_requests;
+  std::vector<std::unique_ptr<Entry>> entries;
+  int64 seq = 0;
+  int64 request_seq = -1;
+  std::vector<uint64> report;
+  int64 report_seq = 0;
+  bool send_report = false;
+  Buffer* buf = nullptr;
+  bool is_leader = false;
+  Status status;
+  {
+    mutex_lock l(mu_);
+    status = status_;
+    if (status.ok()) status = GetBuffer(ctx, col_params, &buf);
+    if (status.ok()) {
+      const uint64 key_hash = entry->key_hash;
+      buf->pending.push_back(std::move(entry));
+      is_leader = (buf->rank == 0);
+      if (is_leader) {
+        LeaderUpdate(buf, false /*force*/, &flushes, &report_requests);
+      } else {
+        buf->unreported.push_back(key_hash);
+        send_report = TakeReport(buf, &report, &report_seq);
+        TakePlanned(buf, &entries, &seq, &request_seq);
+      }
+    }
+  }
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  if (is_leader) {
+    LeaderRun(*buf, std::move(flushes), report_requests);
+    return;
+  }
+  if (send_report) SendReport(*buf, report, report_seq);
+  if (request_seq >= 0) RequestPlan(*buf, request_seq);
+  if (!entries.empty()) RunFused(*buf, std::move(entries), seq);
+}
+
+void CollectiveFusion::StartAbort(const Status& s) {
+  std::vector<std::unique_ptr<Entry>> entries;
+  {
+    mutex_lock l(mu_);
+    status_.Update(s);
+    for (auto& it : buffers_) {
+      for (auto& entry : it.second->pending) {
+        entries.push_back(std::move(entry));
+      }
+      it.second->pending.clear();
+    }
+  }
+  for (auto& entry : entries) {
+    entry->done(s);
+  }
+}
+
+int64 CollectiveFusion::num_fused_buffers() const {
+  mutex_lock l(mu_);
+  return num_fused_buffers_;
+}
+
+int64 CollectiveFusion::num_fused_ops() const {
+  mutex_lock l(mu_);
+  return num_fused_ops_;
+}
+
+Status CollectiveFusion::GetBuffer(OpKernelContext* ctx,
+                                   const CollectiveParams& col_params,
+                                   Buffer** buf) {
+  const string& device_name =
+      col_params.instance.device_names[col_params.default_rank];
+  const string fusion_key = FusionKey(col_params);
+  const string buf_key = strings::StrCat(device_name, "|", fusion_key);
+  auto it = buffers_.find(buf_key);
+  if (it != buffers_.end()) {
+    *buf = it->second.get();
+    return Status::OK();
+  }
+  std::unique_ptr<Buffer> new_buf(new Buffer);
+  TF_RETURN_IF_ERROR(dev_mgr_->LookupDevice(device_name, &new_buf->device));
+  new_buf->fusion_key = fusion_key;
+  new_buf->device_ctx = ctx->op_device_context();
+  new_buf->rank = col_params.default_rank;
+  new_buf->device_names = col_params.instance.device_names;
+  new_buf->task_names = col_params.instance.task_names;
+  new_buf->is_local = col_params.task.is_local;
+  if (new_buf->rank == 0) {
+    const int group_size = new_buf->device_names.size();
+    new_buf->reported.resize(group_size);
+    new_buf->report_requested.resize(group_size, false);
+    new_buf->next_report_seq.resize(group_size, 0);
+  }
+  *buf = new_buf.get();
+  buffers_[buf_key] = std::move(new_buf);
+  return Status::OK();
+}
+
+bool CollectiveFusion::ReadyEverywhere(const Buffer& buf,
+                                       uint64 key_hash) const {
+  for (int r = 1; r < static_cast<int>(buf.reported.size()); ++r) {
+    if (buf.reported[r].count(key_hash) == 0) return false;
+  }
+  return true;
+}
+
+void CollectiveFusion::LeaderUpdate(Buffer* buf, bool force,
+                                    std::vector<Flush>* flushes,
+                                    ReportRequests* requests) {
+  std::vector<std::unique_ptr<Entry>>& pending = buf->pending;
+  while (true) {
+    // The ops ready everywhere, in local arrival order, up to a full buffer.
+    std::vector<int> indices;
+    int64 num_bytes = 0;
+    for (int i = 0; i < static_cast<int>(pending.size()) &&
+                    indices.size() < static_cast<size_t>(kMaxFusedOps) &&
+                    num_bytes < threshold_bytes_;
+         ++i) {
+      if (!ReadyEverywhere(*buf, pending[i]->key_hash)) continue;
+      indices.push_back(i);
+      num_bytes += pending[i]->ctx->input(0).TotalBytes();
+    }
+    if (indices.empty() ||
+        (!force && num_bytes < threshold_bytes_ &&
+         indices.size() < static_cast<size_t>(kMaxFusedOps))) {
+      break;
+    }
+    Flush flush;
+    for (int index : indices) {
+      for (auto& reported : buf->reported) {
+        reported.erase(pending[index]->key_hash);
+      }
+      flush.entries.push_back(std::move(pending[index]));
+    }
+    pending.erase(std::remove(pending.begin(), pending.end(), nullptr),
+                  pending.end());
+    flush.seq = buf->next_seq++;
+    ++buf->timer_gen;
+    buf->timer_scheduled = false;
+    flushes->push_back(std::move(flush));
+  }
+  MaybeScheduleTimer(buf);
+  // A device is asked for its next report while some local op has not been
+  // reported by it.  It reports every op once, so the report will come.
+  for (int r = 1; r < static_cast<int>(buf->reported.size()); ++r) {
+    if (buf->report_requested[r]) continue;
+    for (const auto& entry : pending) {
+      if (buf->reported[r].count(entry->key_hash) == 0) {
+        buf->report_requested[r] = true;
+        requests->emplace_back(r, buf->next_report_seq[r]++);
+        break;
+      }
+    }
+  }
+}
+
+void CollectiveFusion::LeaderRun(const Buffer& buf,
+                                 std::vector<Flush> flushes,
+                                 const ReportRequests& requests) {
+  for (const auto& request : requests) {
+    RequestReport(buf, request.first, request.second);
+  }
+  for (Flush& flush : flushes) {
+    SendPlan(buf, flush.entries, flush.seq);
+    RunFused(buf, std::move(flush.entries), flush.seq);
+  }
+}
+
+void CollectiveFusion::MaybeScheduleTimer(Buffer* buf) {
+  if (buf->timer_scheduled) return;
+  bool any_ready = false;
+  for (const auto& entry : buf->pending) {
+    if (ReadyEverywhere(*buf, entry->key_hash)) {
+      any_ready = true;
+      break;
+    }
+  }
+  if (!any_ready) return;
+  buf->timer_scheduled = true;
+  const string buf_key = strings::StrCat(
+      buf->device_names[buf->rank], "|", buf->fusion_key);
+  const int64 gen = buf->timer_gen;
+  Ref();  // Ensure this lasts until the closure executes.
+  SchedNonBlockingClosureAfter(timeout_micros_, [this, buf_key, gen] {
+    OnTimer(buf_key, gen);
+    Unref();
+  });
+}
+
+void CollectiveFusion::OnTimer(const string& buf_key, int64 gen) {
+  std::vector<Flush> flushes;
+  ReportRequests report_requests;
+  Buffer* buf = nullptr;
+  {
+    mutex_lock l(mu_);
+    auto it = buffers_.find(buf_key);
+    if (it == buffers_.end()) return;
+    buf = it->second.get();
+    if (buf->timer_gen != gen) return;
+    buf->timer_scheduled = false;
+    LeaderUpdate(buf, true /*force*/, &flushes, &report_requests);
+  }
+  LeaderRun(*buf, std::move(flushes), report_requests);
+}
+
+void CollectiveFusion::RequestReport(const Buffer& buf, int rank, int64 seq) {
+  const string buf_key =
+      strings::StrCat(buf.device_names[buf.rank], "|", buf.fusion_key);
+  Tensor* report = new Tensor(buf.device->GetAllocator(HostAttr()), DT_INT64,
+                              TensorShape({kMaxFusedOps + 1}));
+  Ref();  // Ensure this lasts until the report is received.
+  col_exec_->RecvFromPeer(
+      buf.device_names[rank], buf.task_names[rank], buf.is_local[rank],
+      FusionReportKey(buf.fusion_key, seq, rank), buf.device, buf.device_ctx,
+      HostAttr(), report, buf.device->attributes().locality(),
+      0 /*stream_index*/, [this, buf_key, rank, report](const Status& s) {
+        OnReport(buf_key, rank, report, s);
+        Unref();
+      });
+}
+
+void CollectiveFusion::OnReport(const string& buf_key, int rank,
+                                Tensor* report, const Status& s) {
+  std::unique_ptr<Tensor> report_owner(report);
+  std::vector<uint64> key_hashes;
+  const Status parse_status = s.ok() ? ParseKeyList(*report, &key_hashes) : s;
+  std::vector<Flush> flushes;
+  ReportRequests report_requests;
+  std::vector<std::unique_ptr<Entry>> failed;
+  Status status;
+  Buffer* buf = nullptr;
+  {
+    mutex_lock l(mu_);
+    buf = buffers_[buf_key].get();
+    buf->report_requested[rank] = false;
+    if (!parse_status.ok()) {
+      FailPending(buf, parse_status, &failed);
+    } else if (status_.ok()) {
+      buf->reported[rank].insert(key_hashes.begin(), key_hashes.end());
+      LeaderUpdate(buf, false /*force*/, &flushes, &report_requests);
+    }
+    status = status_;
+  }
+  for (auto& entry : failed) {
+    entry->done(status);
+  }
+  LeaderRun(*buf, std::move(flushes), report_requests);
+}
+
+bool CollectiveFusion::TakeReport(Buffer* buf, std::vector<uint64>* key_hashes,
+                                  int64* seq) {
+  if (buf->report_in_flight || buf->unreported.empty()) return false;
+  const size_t n = std::min(buf->unreported.size(),
+                            static_cast<size_t>(kMaxFusedOps));
+  key_hashes->assign(buf->unreported.begin(), buf->unreported.begin() + n);
+  buf->unreported.erase(buf->unreported.begin(), buf->unreported.begin() + n);
+  buf->report_in_flight = true;
+  *seq = buf->next_sent_report_seq++;
+  return true;
+}
+
+void CollectiveFusion::SendReport(const Buffer& buf,
+                                  const std::vector<uint64>& key_hashes,
+                                  int64 seq) {
+  const string buf_key =
+      strings::StrCat(buf.device_names[buf.rank], "|", buf.fusion_key);
+  std::shared_ptr<Tensor> report = MakeKeyList(buf.device, key_hashes);
+  Ref();  // Ensure this lasts until the leader has received the report.
+  col_exec_->PostToPeer(
+      buf.device_names[0], buf.task_names[0],
+      FusionReportKey(buf.fusion_key, seq, buf.rank), buf.device,
+      buf.device_ctx, HostAttr(), report.get(),
+      buf.device->attributes().locality(),
+      [this, buf_key, report](const Status& s) {
+        OnReportSent(buf_key, s);
+        Unref();
+      });
+}
+
+void CollectiveFusion::OnReportSent(const string& buf_key, const Status& s) {
+  std::vector<uint64> report;
+  int64 report_seq = 0;
+  bool send_report = false;
+  std::vector<std::unique_ptr<Entry>> failed;
+  Status status;
+  Buffer* buf = nullptr;
+  {
+    mutex_lock l(mu_);
+    buf = buffers_[buf_key].get();
+    buf->report_in_flight = false;
+    if (!s.ok()) {
+      FailPending(buf, s, &failed);
+    } else if (status_.ok()) {
+      send_report = TakeReport(buf, &report, &report_seq);
+    }
+    status = status_;
+  }
+  for (auto& entry : failed) {
+    entry->done(status);
+  }
+  if (send_report) SendReport(*buf, report, report_seq);
+}
+
+void CollectiveFusion::TakePlanned(Buffer* buf,
+                                   std::vector<std::unique_ptr<Entry>>* entries,
+                                   int64* seq, int64* request_seq) {
+  *request_seq = -1;
+  if (buf->has_plan) {
+    std::vector<std::unique_ptr<Entry>>& pending = buf->pending;
+    std::vector<int> indices;
+    for (uint64 key_hash : buf->plan) {
+      int index = 0;
+      while (index < static_cast<int>(pending.size()) &&
+             pending[index]->key_hash != key_hash) {
+        ++index;
+      }
+      // Not all the ops of the plan are ready yet.
+      if (index == static_cast<int>(pending.size())) return;
+      indices.push_back(index);
+    }
+    for (int index : indices) {
+      entries->push_back(std::move(pending[index]));
+    }
+    pending.erase(std::remove(pending.begin(), pending.end(), nullptr),
+                  pending.end());
+    *seq = buf->plan_seq;
+    buf->has_plan = false;
+    buf->plan.clear();
+  }
+  if (!buf->plan_requested && !buf->has_plan && !buf->pending.empty()) {
+    buf->plan_requested = true;
+    *request_seq = buf->next_seq++;
+  }
+}
+
+void CollectiveFusion::RequestPlan(const Buffer& buf, int64 seq) {
+  const string buf_key =
+      strings::StrCat(buf.device_names[buf.rank], "|", buf.fusion_key);
+  Tensor* plan = new Tensor(buf.device->GetAllocator(HostAttr()), DT_INT64,
+                            TensorShape({kMaxFusedOps + 1}));
+  Ref();  // Ensure this lasts until the plan is received.
+  col_exec_->RecvFromPeer(
+      buf.device_names[0], buf.task_names[0], buf.is_local[0],
+      FusionPlanKey(buf.fusion_key, seq, buf.rank), buf.device,
+      buf.device_ctx, HostAttr(), plan, buf.device->attributes().locality(),
+      0 /*stream_index*/, [this, buf_key, seq, plan](const Status& s) {
+        OnPlan(buf_key, seq, plan, s);
+        Unref();
+      });
+}
+
+void CollectiveFusion::OnPlan(const string& buf_key, int64 seq, Tensor* plan,
+                              const Status& s) {
+  std::unique_ptr<Tensor> plan_owner(plan);
+  std::vector<uint64> key_hashes;
+  const Status parse_status = s.ok() ? ParseKeyList(*plan, &key_hashes) : s;
+  std::vector<std::unique_ptr<Entry>> entries;
+  std::vector<std::unique_ptr<Entry>> failed;
+  int64 request_seq = -1;
+  Status status;
+  Buffer* buf = nullptr;
+  {
+    mutex_lock l(mu_);
+    buf = buffers_[buf_key].get();
+    buf->plan_requested = false;
+    if (!parse_status.ok()) {
+      // The leader will not send further plans either.
+      FailPending(buf, parse_status, &failed);
+    } else {
+      buf->has_plan = true;
+      buf->plan_seq = seq;
+      buf->plan = std::move(key_hashes);
+      TakePlanned(buf, &entries, &seq, &request_seq);
+    }
+    status = status_;
+  }
+  for (auto& entry : failed) {
+    entry->done(status);
+  }
+  if (!entries.empty()) RunFused(*buf, std::move(entries), seq);
+  if (request_seq >= 0) RequestPlan(*buf, request_seq);
+}
+
+void CollectiveFusion::FailPending(
+    Buffer* buf, const Status& s,
+    std::vector<std::unique_ptr<Entry>>* failed) {
+  status_.Update(s);
+  for (auto& entry : buf->pending) {
+    failed->push_back(std::move(entry));
+  }
+  buf->pending.clear();
+}
+
+void CollectiveFusion::SendPlan(
+    const Buffer& buf, const std::vector<std::unique_ptr<Entry>>& entries,
+    int64 seq) {
+  std::vector<uint64> key_hashes;
+  for (const auto& entry : entries) {
+    key_hashes.push_back(entry->key_hash);
+  }
+  std::shared_ptr<Tensor> plan = MakeKeyList(buf.device, key_hashes);
+  for (int r = 1; r < static_cast<int>(buf.device_names.size()); ++r) {
+    // If the post fails, so does the reduction of the fusion buffer.
+    col_exec_->PostToPeer(
+        buf.device_names[r], buf.task_names[r],
+        FusionPlanKey(buf.fusion_key, seq, r), buf.device, buf.device_ctx,
+        HostAttr(), plan.get(), buf.device->attributes().locality(),
+        [plan](const Status& s) {
+          if (!s.ok()) VLOG(1) << "Failed to send fusion plan: " << s;
+        });
+  }
+}
+
+void CollectiveFusion::RunFused(const Buffer& buf,
+                                std::vector<std::unique_ptr<Entry>> entries,
+                                int64 seq) {
+  VLOG(2) << "Fusing " << entries.size() << " ops as " << buf.fusion_key
+          << ":" << seq << " on " << buf.device->name();
+  {
+    mutex_lock l(mu_);
+    ++num_fused_buffers_;
+    num_fused_ops_ += entries.size();
+  }
+  std::shared_ptr<std::vector<std::unique_ptr<Entry>>> fused_entries(
+      new std::vector<std::unique_ptr<Entry>>(std::move(entries)));
+  const string exec_key =
+      strings::StrCat("fusion(", buf.fusion_key, "):", seq);
+  Device* device = buf.device;
+  Ref();
+  // Run in an I/O thread, since the copies block.
+  SchedClosure([this, fused_entries, exec_key, device]() {
+    std::vector<std::unique_ptr<Entry>>& entries = *fused_entries;
+    OpKernelContext* ctx = entries[0]->ctx;
+    const CollectiveParams& col_params = *entries[0]->col_params;
+    const AllocatorAttributes attr = ctx->output_alloc_attr(0);
+    int64 total_elts = 0;
+    for (const auto& entry : entries) {
+      total_elts += entry->ctx->input(0).NumElements();
+    }
+    std::shared_ptr<Tensor> fused(new Tensor(device->GetAllocator(attr),
+                                             col_params.instance.data_type,
+                                             TensorShape({total_elts})));
+
+    // Copies each op's tensor to or from its range of the fusion buffer.
+    auto copy_all = [fused_entries, fused, device, attr](bool pack) {
+      std::vector<std::unique_ptr<Entry>>& entries = *fused_entries;
+      OpKernelContext* ctx = entries[0]->ctx;
+      BlockingCounter pending(entries.size());
+      mutex mu;
+      Status status;
+      int64 offset = 0;
+      for (const auto& entry : entries) {
+        OpKernelContext* entry_ctx = entry->ctx;
+        Tensor flat = Flat(pack ? entry_ctx->input(0)
+                                : *entry_ctx->mutable_output(0));
+        Tensor range = fused->Slice(offset, offset + flat.NumElements());
+        offset += flat.NumElements();
+        auto done = [&pending, &mu, &status](const Status& s) {
+          {
+            mutex_lock l(mu);
+            status.Update(s);
+          }
+          pending.DecrementCount();
+        };
+        if (pack) {
+          CollectiveRemoteAccessLocal::MemCpyAsync(
+              entry_ctx->input_device_context(0), ctx->op_device_context(),
+              device, device, entry_ctx->input_alloc_attr(0), attr, &flat,
+              &range, 0 /*dev_to_dev_stream_index*/, done);
+        } else {
+          CollectiveRemoteAccessLocal::MemCpyAsync(
+              ctx->op_device_context(), entry_ctx->op_device_context(), device,
+              device, attr, entry_ctx->output_alloc_attr(0), &range, &flat,
+              0 /*dev_to_dev_stream_index*/, done);
+        }
+      }
+      pending.Wait();
+      mutex_lock l(mu);
+      return status;
+    };
+    auto finish = [this, fused_entries](const Status& s) {
+      for (auto& entry : *fused_entries) {
+        entry->done(s);
+      }
+      Unref();
+    };
+
+    Status status = copy_all(true);
+    if (!status.ok()) {
+      finish(status);
+      return;
+    }
+    runner_(ctx, col_params, exec_key, fused.get(),
+            [fused, copy_all, finish](const Status& s) {
+              if (!s.ok()) {
+                finish(s);
+                return;
+              }
+              // The reduction may complete in a thread that must not block.
+              SchedClosure([copy_all, finish]() { finish(copy_all(false)); });
+            });
+  });
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,220 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+class Device;
+class DeviceMgr;
+
+struct CollectiveFusionOptions {
+  // Reductions of tensors smaller than this many bytes are fused, and a
+  // fusion buffer is flushed as soon as it holds this many bytes.  Zero
+  // disables fusion.
+  int64 threshold_bytes = 0;
+  // How long the first tensor of a fusion buffer, once ready on all the
+  // devices, waits for others before the buffer is flushed anyway.  Zero selects kDefaultTimeoutMicros.
+  int64 timeout_micros = 0;
+
+  static const int64 kDefaultTimeoutMicros = 1000;
+};
+
+// Packs the small tensors of the CollectiveReduce ops of one step that
+// become ready within a short window into a single fusion buffer, reduces
+// the buffer as one collective, and unpacks the result into the outputs of
+// the ops.  This trades a little latency for far fewer, larger messages
+// when many ops reduce only a few KB each.
+//
+// Only the device of default rank 0 of a group, the leader, flushes its
+// buffers.  The other devices report to the leader the exec keys of their
+// ops as these become ready, and the leader only fuses ops that all the
+// devices have reported, since an op that is not ready on some device may
+// depend there on the result of another op of the buffer.  The leader sends
+// the list of the exec keys of the ops of each buffer to the other devices,
+// which fuse exactly those ops, in that order.  So the devices agree on the
+// contents of every buffer whatever the order in which their ops become
+// ready.
+//
+// Tensors are fused with those of the same group, data type, merge and
+// final ops, and implementation; a step has one CollectiveFusion which
+// serves all the local devices.
+class CollectiveFusion : public core::RefCounted {
+ public:
+  // Runs the reduction of the fusion buffer `input`, in place, as the
+  // collective `exec_key`.
+  typedef std::function<void(OpKernelContext* ctx,
+                             const CollectiveParams& col_params,
+                             const string& exec_key, Tensor* input,
+                             const StatusCallback& done)>
+      Runner;
+
+  CollectiveFusion(CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+                   const CollectiveFusionOptions& options, Runner runner);
+  ~CollectiveFusion() override;
+
+  // Returns true if the op of `ctx` and `col_params` should go through
+  // Add() rather than run by itself.  All the devices of the group agree.
+  bool ShouldFuse(OpKernelContext* ctx,
+                  const CollectiveParams& col_params) const;
+
+  // Queues the reduction of the input of `ctx` into its output, and calls
+  // `done` once it has been reduced as part of a fusion buffer.
+  void Add(OpKernelContext* ctx, const CollectiveParams& col_params,
+           const string& exec_key, const StatusCallback& done);
+
+  // Fails the pending and future ops with `s`.
+  void StartAbort(const Status& s);
+
+  // The number of fusion buffers reduced by the local devices, and of the
+  // ops reduced in them.  For tests.
+  int64 num_fused_buffers() const LOCKS_EXCLUDED(mu_);
+  int64 num_fused_ops() const LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Entry {
+    OpKernelContext* ctx;
+    const CollectiveParams* col_params;
+    string exec_key;
+    uint64 key_hash;
+    StatusCallback done;
+  };
+  // The fusion state of the ops of one device with one fusion key.
+  struct Buffer {
+    string fusion_key;
+    Device* device = nullptr;
+    DeviceContext* device_ctx = nullptr;
+    // From the col_params of the first op, which all the others share.
+    int rank = 0;
+    std::vector<string> device_names;
+    std::vector<string> task_names;
+    std::vector<bool> is_local;
+    // Ops ready locally, in arrival order.
+    std::vector<std::unique_ptr<Entry>> pending;
+    // Sequence number of the next fusion buffer.
+    int64 next_seq = 0;
+    // Leader: incremented by every flush, so stale timers do nothing.
+    int64 timer_gen = 0;
+    bool timer_scheduled = false;
+    // Leader, indexed by default rank: the hashes of the exec keys of the
+    // ops that each device has reported ready and that are not fused yet,
+    // whether the device's next report is being received, and its sequence
+    // number.
+    std::vector<std::unordered_set<uint64>> reported;
+    std::vector<bool> report_requested;
+    std::vector<int64> next_report_seq;
+    // Others: the hashes of the exec keys of the ops ready locally that were
+    // not reported to the leader yet, whether a report is being sent, and the
+    // sequence number of the next report.
+    std::vector<uint64> unreported;
+    bool report_in_flight = false;
+    int64 next_sent_report_seq = 0;
+    // Others: whether the next plan is being received, and the received
+    // plan, if any, waiting for its ops.
+    bool plan_requested = false;
+    bool has_plan = false;
+    int64 plan_seq = 0;
+    std::vector<uint64> plan;
+  };
+  // The ops of one fusion buffer.
+  struct Flush {
+    std::vector<std::unique_ptr<Entry>> entries;
+    int64 seq = 0;
+  };
+  // Leader: the reports to receive, as pairs of default rank and sequence
+  // number.
+  typedef std::vector<std::pair<int, int64>> ReportRequests;
+
+  Status GetBuffer(OpKernelContext* ctx, const CollectiveParams& col_params,
+                   Buffer** buf) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Leader: takes the ops of the fusion buffers that are full, or, if
+  // `force`, of all those that hold ops ready on every device, out of `buf`,
+  // then schedules the timer of the remaining ops and picks the devices
+  // whose next report is needed.
+  void LeaderUpdate(Buffer* buf, bool force, std::vector<Flush>* flushes,
+                    ReportRequests* requests) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Leader: requests the reports and runs the fusion buffers picked by
+  // LeaderUpdate().
+  void LeaderRun(const Buffer& buf, std::vector<Flush> flushes,
+                 const ReportRequests& requests);
+  bool ReadyEverywhere(const Buffer& buf, uint64 key_hash) const
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Leader: schedules a flush of `buf` after the timeout, if none is and
+  // some ops are ready on every device.
+  void MaybeScheduleTimer(Buffer* buf) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void OnTimer(const string& buf_key, int64 gen);
+  void RequestReport(const Buffer& buf, int rank, int64 seq);
+  void OnReport(const string& buf_key, int rank, Tensor* report,
+                const Status& s);
+
+  // Others: takes the next report out of `buf` if there is one and none is
+  // being sent.  Returns false if there is none to send.
+  bool TakeReport(Buffer* buf, std::vector<uint64>* key_hashes, int64* seq)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void SendReport(const Buffer& buf, const std::vector<uint64>& key_hashes,
+                  int64 seq);
+  void OnReportSent(const string& buf_key, const Status& s);
+  // Others: takes the ops of the received plan out of `buf` if they are all
+  // ready.  Sets `request_seq` to the sequence number of the plan to
+  // request with RequestPlan() if there are ops waiting for one, else -1.
+  void TakePlanned(Buffer* buf, std::vector<std::unique_ptr<Entry>>* entries,
+                   int64* seq, int64* request_seq)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void RequestPlan(const Buffer& buf, int64 seq);
+  void OnPlan(const string& buf_key, int64 seq, Tensor* plan,
+              const Status& s);
+
+  // Fails the ops of `buf` with `s`, after which no further reports or plans
+  // are exchanged.
+  void FailPending(Buffer* buf, const Status& s,
+                   std::vector<std::unique_ptr<Entry>>* failed)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Leader: sends the exec keys of `entries` to the other devices.
+  void SendPlan(const Buffer& buf,
+                const std::vector<std::unique_ptr<Entry>>& entries, int64 seq);
+  // Packs the inputs of `entries`, reduces them as one collective and
+  // unpacks the result.
+  void RunFused(const Buffer& buf,
+                std::vector<std::unique_ptr<Entry>> entries, int64 seq);
+
+  CollectiveExecutor* col_exec_;  // Not owned
+  const DeviceMgr* dev_mgr_;      // Not owned
+  const int64 threshold_bytes_;
+  const int64 timeout_micros_;
+  const Runner runner_;
+  mutable mutex mu_;
+  Status status_ GUARDED_BY(mu_);
+  int64 num_fused_buffers_ GUARDED_BY(mu_) = 0;
+  int64 num_fused_ops_ GUARDED_BY(mu_) = 0;
+  // Keyed by device name and fusion key.
+  std::unordered_map<string, std::unique_ptr<Buffer>> buffers_
+      GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_COLLECTIVE_FUSION_H_
@@ -0,0 +1,339 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/collective_fusion.h"
+
+#include <algorithm>
+#include <set>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+static int64 kStepId = 123;
+
+std::unique_ptr<OpKernel> GetKernel(const NodeDef& node, DeviceBase* device) {
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()), node,
+      TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, DeviceBase* device) {
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder(strings::StrCat(op, "_node"), op)
+                  .Attr("T", DT_FLOAT)
+                  .Input(FakeInput(DT_FLOAT))
+                  .Input(FakeInput(DT_FLOAT))
+                  .Finalize(&node_def));
+  return GetKernel(node_def, device);
+}
+
+// Runs a number of float CollectiveReduce ops of various lengths on every
+// device through BaseCollectiveExecutor::ExecuteAsync, with fusion enabled.
+class CollectiveFusionTest : public ::testing::Test {
+ protected:
+  ~CollectiveFusionTest() override {
+    for (auto i : instances_) {
+      delete i;
+    }
+    if (col_exec_) col_exec_->Unref();
+  }
+
+  void Init(int num_workers, int num_devices,
+            const CollectiveFusionOptions& options) {
+    std::vector<Device*> local_devices;
+    SessionOptions sess_opts;
+    sess_opts.env = Env::Default();
+    Bytes mem_limit(4 << 20);
+    DeviceLocality dev_locality;
+    for (int wi = 0; wi < num_workers; ++wi) {
+      for (int di = 0; di < num_devices; ++di) {
+        string dev_name =
+            strings::StrCat("/job:worker/replica:0/task:", wi, "/cpu:", di);
+        local_devices.push_back(new ThreadPoolDevice(
+            sess_opts, dev_name, mem_limit, dev_locality, cpu_allocator()));
+      }
+    }
+    dev_mgr_.reset(new DeviceMgr(local_devices));
+    dev_resolver_.reset(new DeviceResolverLocal(dev_mgr_.get()));
+    rma_ = new CollectiveRemoteAccessLocal(dev_mgr_.get(), dev_resolver_.get(),
+                                           kStepId);
+    col_exec_ = new BaseCollectiveExecutor(&col_exec_mgr_, rma_, kStepId,
+                                           dev_mgr_.get(), options);
+    fusion_ = col_exec_->fusion();
+    group_size_ = num_workers * num_devices;
+    for (int wi = 0; wi < num_workers; ++wi) {
+      string task_name = strings::StrCat("/job:worker/replica:0/task:", wi);
+      for (int di = 0; di < num_devices; ++di) {
+        device_names_.push_back(strings::StrCat(task_name, "/cpu:", di));
+        task_names_.push_back(task_name);
+      }
+    }
+    for (int rank = 0; rank < group_size_; ++rank) {
+      instances_.push_back(new DeviceInstance(rank, this));
+    }
+  }
+
+  // Reduces tensors of `lengths` on every device, the devices of odd rank
+  // starting their ops in the reverse order, or if `chain_odd_ranks_` one
+  // after the other, and checks the results.
+  void RunTest(int num_workers, int num_devices,
+               const CollectiveFusionOptions& options,
+               const std::vector<int>& lengths) {
+    Init(num_workers, num_devices, options);
+    BlockingCounter counter(group_size_);
+    for (auto di : instances_) {
+      SchedClosure([di, &lengths, &counter] {
+        di->DoReduce(lengths);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    for (int rank = 0; rank < group_size_; ++rank) {
+      DeviceInstance* instance = instances_[rank];
+      for (int op = 0; op < static_cast<int>(lengths.size()); ++op) {
+        TF_EXPECT_OK(instance->ops_[op]->status);
+        const Tensor& actual = instance->ops_[op]->tensor;
+        for (int i = 0; i < lengths[op]; ++i) {
+          // The mean over the ranks of Value(rank, op, i).
+          const float expected = op * 1000 + i + (group_size_ - 1) / 2.0f;
+          EXPECT_FLOAT_EQ(expected, actual.flat<float>()(i))
+              << "Mismatch at device " << rank << " op " << op << " index "
+              << i;
+        }
+      }
+    }
+  }
+
+  static float Value(int rank, int op, int i) { return op * 1000 + i + rank; }
+
+  class DeviceInstance {
+   public:
+    // One CollectiveReduce op and the state it keeps while it runs.
+    struct Op {
+      CollectiveParams col_params;
+      std::unique_ptr<OpKernel> kernel;
+      Tensor tensor;
+      gtl::InlinedVector<TensorValue, 4> inputs;
+      gtl::InlinedVector<AllocatorAttributes, 4> input_aa;
+      gtl::InlinedVector<DeviceContext*, 4> input_dc;
+      AllocatorAttributes output_attr;
+      int forward_from = 0;
+      OpKernelContext::Params op_params;
+      std::unique_ptr<OpKernelContext> ctx;
+      Status status;
+    };
+
+    DeviceInstance(int rank, CollectiveFusionTest* parent)
+        : parent_(parent), rank_(rank) {
+      TF_CHECK_OK(parent_->dev_mgr_->LookupDevice(
+          parent_->device_names_[rank], &device_));
+    }
+
+    ~DeviceInstance() {
+      if (dev_ctx_) dev_ctx_->Unref();
+    }
+
+    void DoReduce(const std::vector<int>& lengths) {
+      dev_ctx_ = new DeviceContext;
+      const int num_ops = static_cast<int>(lengths.size());
+      for (int op = 0; op < num_ops; ++op) {
+        ops_.emplace_back(new Op);
+        InitOp(op, lengths[op], ops_.back().get());
+      }
+      std::vector<int> order(num_ops);
+      for (int op = 0; op < num_ops; ++op) order[op] = op;
+      if (rank_ % 2 == 1) std::reverse(order.begin(), order.end());
+      // On chained devices, each op only becomes ready once the previous one
+      // is done, as if it consumed its output.
+      const bool chained = parent_->chain_odd_ranks_ && rank_ % 2 == 1;
+      BlockingCounter counter(num_ops);
+      std::function<void(int)> start = [this, &order, &counter, &start,
+                                        chained, num_ops](int i) {
+        Op* o = ops_[order[i]].get();
+        parent_->col_exec_->ExecuteAsync(
+            o->ctx.get(), o->col_params,
+            strings::StrCat(o->col_params.instance.instance_key, ":0:0"),
+            [o, &counter, &start, chained, num_ops, i](const Status& s) {
+              o->status = s;
+              if (chained && i + 1 < num_ops) {
+                SchedClosure([&start, i]() { start(i + 1); });
+              }
+              counter.DecrementCount();
+            });
+      };
+      if (chained) {
+        start(0);
+      } else {
+        for (int i = 0; i < num_ops; ++i) start(i);
+      }
+      counter.Wait();
+      for (auto& o : ops_) {
+        CHECK(o->tensor.CopyFrom(*o->ctx->mutable_output(0),
+                                 o->tensor.shape()));
+      }
+    }
+
+    void InitOp(int op, int length, Op* o) {
+      CollectiveParams& cp = o->col_params;
+      cp.name = strings::StrCat("op_", op);
+      cp.group.group_key = 5;
+      cp.group.device_type = DEVICE_CPU;
+      cp.group.group_size = parent_->group_size_;
+      cp.group.num_tasks = static_cast<int>(std::set<string>(
+          parent_->task_names_.begin(), parent_->task_names_.end()).size());
+      cp.instance.instance_key = 100 + op;
+      cp.instance.type = REDUCTION_COLLECTIVE;
+      cp.instance.data_type = DT_FLOAT;
+      cp.instance.device_names = parent_->device_names_;
+      cp.instance.task_names = parent_->task_names_;
+      cp.instance.impl_details.subdiv_offsets = {0};
+      cp.instance.impl_details.subdiv_permutations.resize(1);
+      for (int r = 0; r < parent_->group_size_; ++r) {
+        cp.instance.impl_details.subdiv_permutations[0].push_back(r);
+        cp.task.is_local.push_back(true);
+      }
+      cp.default_rank = rank_;
+      cp.subdiv_rank = {rank_};
+      cp.merge_op = GetBinOp("Add", device_);
+      cp.final_op = GetBinOp("Div", device_);
+
+      NodeDef node_def;
+      TF_CHECK_OK(NodeDefBuilder(strings::StrCat("reduce_", rank_, "_", op),
+                                 "CollectiveReduce")
+                      .Attr("T", DT_FLOAT)
+                      .Attr("merge_op", "Add")
+                      .Attr("final_op", "Div")
+                      .Attr("group_size", cp.group.group_size)
+                      .Attr("group_key", cp.group.group_key)
+                      .Attr("instance_key", cp.instance.instance_key)
+                      .Attr("subdiv_offsets",
+                            cp.instance.impl_details.subdiv_offsets)
+                      .Input(FakeInput(DT_FLOAT))
+                      .Finalize(&node_def));
+      o->kernel = GetKernel(node_def, device_);
+
+      o->tensor = Tensor(device_->GetAllocator(AllocatorAttributes()),
+                         DT_FLOAT, TensorShape({length}));
+      for (int i = 0; i < length; ++i) {
+        o->tensor.flat<float>()(i) = Value(rank_, op, i);
+      }
+      o->inputs.push_back(TensorValue(&o->tensor));
+      o->input_aa.push_back(AllocatorAttributes());
+      o->input_dc.push_back(dev_ctx_);
+      o->op_params.step_id = kStepId;
+      o->op_params.device = device_;
+      o->op_params.inputs = &o->inputs;
+      o->op_params.input_alloc_attrs = &o->input_aa;
+      o->op_params.input_device_contexts = &o->input_dc;
+      o->op_params.op_device_context = dev_ctx_;
+      o->op_params.forward_from_array = &o->forward_from;
+      o->op_params.output_attr_array = &o->output_attr;
+      o->op_params.op_kernel = o->kernel.get();
+      o->ctx.reset(new OpKernelContext(&o->op_params, 1));
+      // We never actually execute the kernel, so we need to do the output
+      // allocation that it would do, ourselves.
+      Tensor* output = nullptr;
+      TF_CHECK_OK(o->ctx->forward_input_or_allocate_output(
+          {0}, 0, o->tensor.shape(), &output));
+    }
+
+    CollectiveFusionTest* parent_;
+    const int rank_;
+    Device* device_;
+    DeviceContext* dev_ctx_ = nullptr;
+    std::vector<std::unique_ptr<Op>> ops_;
+  };
+
+  TestCollectiveExecutorMgr col_exec_mgr_;
+  BaseCollectiveExecutor* col_exec_ = nullptr;
+  CollectiveFusion* fusion_ = nullptr;  // Owned by col_exec_.
+  bool chain_odd_ranks_ = false;
+  CollectiveRemoteAccessLocal* rma_;
+  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
+  std::unique_ptr<tensorflow::DeviceMgr> dev_mgr_;
+  std::vector<string> device_names_;
+  std::vector<string> task_names_;
+  int group_size_ = 0;
+  std::vector<DeviceInstance*> instances_;
+};
+
+CollectiveFusionOptions Options(int64 threshold_bytes, int64 timeout_micros) {
+  CollectiveFusionOptions options;
+  options.threshold_bytes = threshold_bytes;
+  options.timeout_micros = timeout_micros;
+  return options;
+}
+
+TEST_F(CollectiveFusionTest, Disabled) {
+  RunTest(1, 2, Options(0, 0), {1, 16, 1001});
+}
+
+TEST_F(CollectiveFusionTest, FlushedByTimeout) {
+  RunTest(1, 4, Options(1 << 20, 1000), {1, 2, 3, 16, 100, 1001, 7, 64});
+  EXPECT_EQ(8 * 4, fusion_->num_fused_ops());
+}
+
+TEST_F(CollectiveFusionTest, FlushedByThreshold) {
+  // Every pair of ops fills a fusion buffer, so it should be flushed long
+  // before the timeout expires.
+  RunTest(2, 2, Options(100, 10 * 1000 * 1000),
+          {16, 16, 16, 16, 16, 16, 16, 16});
+  EXPECT_EQ(8 * 4, fusion_->num_fused_ops());
+  EXPECT_EQ(4 * 4, fusion_->num_fused_buffers());
+}
+
+TEST_F(CollectiveFusionTest, DependenciesDifferAcrossDevices) {
+  // All the ops are ready at once on the leader, but on the devices of odd
+  // rank each op waits for the previous one, so fusing any two of them would
+  // deadlock.
+  chain_odd_ranks_ = true;
+  RunTest(2, 2, Options(1 << 20, 1000), {4, 4, 4, 4, 4});
+  EXPECT_EQ(5 * 4, fusion_->num_fused_ops());
+  EXPECT_EQ(5 * 4, fusion_->num_fused_buffers());
+}
+
+TEST_F(CollectiveFusionTest, LargeTensorsAreNotFused) {
+  RunTest(2, 3, Options(4096, 1000), {1, 4096, 5, 100000, 1000, 2});
+}
+
+TEST_F(CollectiveFusionTest, ManyOps) {
+  // More ops than fit in one fusion buffer.
+  RunTest(1, 3, Options(1 << 20, 1000), std::vector<int>(600, 3));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -443,8 +443,10 @@ void CollectiveParamResolverLocal::GenerateSubdivPerms(const string& device,
   CHECK_EQ(cp->group.num_tasks, dev_per_task.size());
 
   CHECK(cp->instance.type == REDUCTION_COLLECTIVE ||
-        cp->instance.type == BROADCAST_COLLECTIVE);
-  if (cp->instance.type == REDUCTION_COLLECTIVE) {
+        cp->instance.type == BROADCAST_COLLECTIVE ||
+        cp->instance.type == GATHER_COLLECTIVE);
+  if (cp->instance.type == REDUCTION_COLLECTIVE ||
+      cp->instance.type == GATHER_COLLECTIVE) {
     // Generate a ring permutation for each requested offset.
     CHECK_GT(cp->instance.impl_details.subdiv_offsets.size(), 0);
     VLOG(2) << "Setting up perms for cp " << cp << " subdiv_permutations "
@@ -41,6 +41,7 @@ limitations under the License.
 #include "tensorflow/core/framework/log_memory.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/graph.h"
@@ -75,6 +76,43 @@ auto* direct_session_runs = monitoring::Counter<0>::New(
     "/tensorflow/core/direct_session_runs",
     "The number of times DirectSession::Run() has been called.");
 
+// Forwards to another call frame, but copies the fetched tensors that were
+// allocated from a step arena, so that fetches never pin an arena after
+// their step.
+class StepArenaCallFrame : public CallFrameInterface {
+ public:
+  StepArenaCallFrame(
+      CallFrameInterface* base,
+      const std::vector<std::pair<StepArenaPool*, StepArenaAllocator*>>&
+          arenas)
+      : base_(base) {
+    for (const auto& pool_and_arena : arenas) {
+      arenas_.push_back(pool_and_arena.second);
+    }
+  }
+
+  size_t num_args() const override { return base_->num_args(); }
+  size_t num_retvals() const override { return base_->num_retvals(); }
+
+  Status GetArg(int index, Tensor* val) const override {
+    return base_->GetArg(index, val);
+  }
+
+  Status SetRetval(int index, const Tensor& val) override {
+    const char* data = val.tensor_data().data();
+    for (StepArenaAllocator* arena : arenas_) {
+      if (arena->Owns(data)) {
+        return base_->SetRetval(index, tensor::DeepCopy(val));
+      }
+    }
+    return base_->SetRetval(index, val);
+  }
+
+ private:
+  CallFrameInterface* const base_;  // Not owned.
+  std::vector<StepArenaAllocator*> arenas_;
+};
+
 Status NewThreadPoolFromThreadPoolOptions(
     const SessionOptions& options,
     const ThreadPoolOptionProto& thread_pool_options, int pool_number,
@@ -301,6 +339,13 @@ DirectSession::DirectSession(const SessionOptions& options,
       device_set_.set_client_device(d);
     }
     ++devices_added;
+
+    const int64 step_arena_bytes =
+        options_.config.experimental().host_step_arena_bytes();
+    if (step_arena_bytes > 0 && d->device_type() == DEVICE_CPU) {
+      step_arena_pools_[d].reset(new StepArenaPool(
+          d->GetAllocator(AllocatorAttributes()), step_arena_bytes));
+    }
   }
 }
 
@@ -572,7 +617,29 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
                                            pool](Executor::Args::Closure c) {
     SchedClosure(pool, std::move(c));
   };
+  // Acquire the step arenas before any executor starts, so that the call
+  // frame knows all of them by the time the first fetch is set.
+  std::vector<std::pair<StepArenaPool*, StepArenaAllocator*>> step_arenas;
+  std::vector<Allocator*> step_allocators;
   for (const auto& item : executors_and_keys->items) {
+    StepArenaAllocator* arena = nullptr;
+    auto pool_it = step_arena_pools_.find(item.device);
+    if (pool_it != step_arena_pools_.end()) {
+      arena = pool_it->second->Acquire();
+      if (arena != nullptr) {
+        step_arenas.emplace_back(pool_it->second.get(), arena);
+      }
+    }
+    step_allocators.push_back(arena);
+  }
+  std::unique_ptr<StepArenaCallFrame> step_arena_call_frame;
+  if (!step_arenas.empty()) {
+    step_arena_call_frame.reset(
+        new StepArenaCallFrame(call_frame, step_arenas));
+    args.call_frame = step_arena_call_frame.get();
+  }
+  for (size_t i = 0; i < executors_and_keys->items.size(); ++i) {
+    const auto& item = executors_and_keys->items[i];
     // TODO(zhengxq): support partial run.
     // TODO(zhengxq): if the device picks its own threadpool, we need to assign
     //     less threads to the main compute pool by default.
@@ -585,6 +652,7 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
         SchedClosure(device_thread_pool, std::move(c));
       };
     }
+    args.step_allocator = step_allocators[i];
     item.executor->RunAsync(args, barrier->Get());
   }
 
@@ -592,6 +660,11 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
                       run_options.timeout_in_ms() > 0
                           ? run_options.timeout_in_ms()
                           : operation_timeout_in_ms_);
+  // The executors are done; tensors that outlive the step, e.g. in variables,
+  // keep their arena alive until they are freed.
+  for (const auto& pool_and_arena : step_arenas) {
+    pool_and_arena.first->Release(pool_and_arena.second);
+  }
 
   if (!cancellation_manager_->DeregisterCallback(cancellation_token)) {
     // The step has been cancelled: make sure we don't attempt to receive the
@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/process_function_library_runtime.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/session_factory.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -306,6 +307,11 @@ class DirectSession : public Session {
   std::vector<Device*> devices_;  // not owned
   DeviceSet device_set_;
 
+  // Per-step arenas for small host allocations on each CPU device, if
+  // ConfigProto.Experimental.host_step_arena_bytes is set.
+  std::unordered_map<const Device*, std::unique_ptr<StepArenaPool>>
+      step_arena_pools_;
+
   string session_handle_;
   bool graph_created_ GUARDED_BY(graph_def_lock_) = false;
 
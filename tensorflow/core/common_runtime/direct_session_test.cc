@@ -41,6 +41,8 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -625,6 +627,34 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetworkWithOpts_Callable) {
   EXPECT_EQ(run_metadata.step_stats().dev_stats_size(), 2);
 }
 
+TEST_F(DirectSessionMinusAXTest, RunSimpleNetworkWithHostStepArena) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.mutable_experimental()->set_host_step_arena_bytes(64 << 10);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // Fetched tensors outlive their step, and must stay intact while later
+  // steps run and after the session is gone.
+  std::vector<std::vector<Tensor>> all_outputs;
+  for (int i = 0; i < 20; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {y_ + ":0", z_ + ":0"}, {}, &outputs));
+    all_outputs.push_back(outputs);
+  }
+  TF_ASSERT_OK(session->Close());
+  session.reset();
+  for (const auto& outputs : all_outputs) {
+    ASSERT_EQ(2, outputs.size());
+    test::ExpectTensorEqual<float>(
+        outputs[0], test::AsTensor<float>({5, -1}, TensorShape({2, 1})));
+    test::ExpectTensorEqual<float>(
+        outputs[1], test::AsTensor<float>({-5, 1}, TensorShape({2, 1})));
+  }
+}
+
 TEST(DirectSessionTest, KeepsStateAcrossRunsOfSession) {
   GraphDef def;
   Graph g(OpRegistry::Global());
@@ -2217,5 +2247,113 @@ void BM_FeedFetchCallable(int iters, int num_feeds) {
 BENCHMARK(BM_FeedFetch)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
 BENCHMARK(BM_FeedFetchCallable)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
 
+// Runs four independent matmul (or embedding lookup) towers, spread
+// round-robin over one CPU device per NUMA node. With "use_numa" each device
+// has node-local threads and memory; otherwise the same devices share one
+// unpinned thread pool and allocator.
+void BM_NUMATowers(int iters, int use_numa, int embedding) {
+  testing::StopTiming();
+  const int kNumTowers = 4;
+  const int num_devices = port::NUMANumNodes();
+  Graph g(OpRegistry::Global());
+  std::vector<string> outputs;
+  int64 items_per_step = 0;
+  for (int t = 0; t < kNumTowers; ++t) {
+    const string device = strings::StrCat(
+        "/job:localhost/replica:0/task:0/cpu:", t % num_devices);
+    Node* out;
+    if (embedding) {
+      Tensor params(DT_FLOAT, TensorShape({20000, 64}));
+      params.flat<float>().setRandom();
+      Tensor ids(DT_INT32, TensorShape({16384}));
+      for (int i = 0; i < ids.NumElements(); ++i) {
+        ids.flat<int32>()(i) = (i * 7919) % 20000;
+      }
+      Node* p = test::graph::Constant(&g, params);
+      Node* i = test::graph::Constant(&g, ids);
+      Node* axis = test::graph::Constant(&g, test::AsScalar<int32>(0));
+      out = test::graph::Gather(&g, p, i, axis);
+      for (Node* n : {p, i, axis, out}) n->set_assigned_device_name(device);
+      items_per_step += ids.NumElements();
+    } else {
+      Tensor x(DT_FLOAT, TensorShape({512, 512}));
+      x.flat<float>().setRandom();
+      out = test::graph::Constant(&g, x);
+      out->set_assigned_device_name(device);
+      for (int i = 0; i < 4; ++i) {
+        out = test::graph::Matmul(&g, out, out, false, false);
+        out->set_assigned_device_name(device);
+      }
+      items_per_step += 4 * 512 * 512 * 512;
+    }
+    Node* axes = test::graph::Constant(&g, test::AsTensor<int32>({0, 1}));
+    Node* sum = test::graph::Reduce(&g, "Sum", out, axes);
+    axes->set_assigned_device_name(device);
+    sum->set_assigned_device_name(device);
+    outputs.push_back(sum->name());
+  }
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  SessionOptions opts;
+  (*opts.config.mutable_device_count())["CPU"] = num_devices;
+  opts.config.mutable_experimental()->set_use_numa_affinity(use_numa);
+  std::unique_ptr<Session> session(NewSession(opts));
+  TF_CHECK_OK(session->Create(gd));
+  std::vector<Tensor> output_values;
+  TF_CHECK_OK(session->Run({}, outputs, {}, &output_values));
+
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(session->Run({}, outputs, {}, &output_values));
+  }
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters) * items_per_step);
+}
+
+// A small serving-style graph: "num_ops" chained element-wise ops on a
+// tiny vector, each also computing its input's shape, so every step makes
+// many small host allocations.
+void BM_HostStepArena(int iters, int use_arena, int num_ops) {
+  testing::StopTiming();
+  Graph g(OpRegistry::Global());
+  Node* x = test::graph::Constant(&g, test::AsTensor<float>({1, 2, 3, 4}));
+  std::vector<string> outputs;
+  for (int i = 0; i < num_ops; ++i) {
+    Node* shape = test::graph::Unary(&g, "Shape", x);
+    outputs.push_back(shape->name());
+    x = test::graph::Unary(&g, i % 2 ? "Neg" : "Square", x);
+  }
+  outputs.push_back(x->name());
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  SessionOptions opts;
+  if (use_arena) {
+    opts.config.mutable_experimental()->set_host_step_arena_bytes(64 << 10);
+  }
+  std::unique_ptr<Session> session(NewSession(opts));
+  TF_CHECK_OK(session->Create(gd));
+  std::vector<Tensor> output_values;
+  TF_CHECK_OK(session->Run({}, outputs, {}, &output_values));
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(session->Run({}, outputs, {}, &output_values));
+  }
+  testing::StopTiming();
+}
+
+BENCHMARK(BM_HostStepArena)
+    ->ArgPair(0, 10)
+    ->ArgPair(1, 10)
+    ->ArgPair(0, 100)
+    ->ArgPair(1, 100);
+
+BENCHMARK(BM_NUMATowers)
+    ->ArgPair(0, 0)
+    ->ArgPair(1, 0)
+    ->ArgPair(0, 1)
+    ->ArgPair(1, 1);
+
 }  // namespace
 }  // namespace tensorflow
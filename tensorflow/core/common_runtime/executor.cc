@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/executor.h"
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <memory>
@@ -54,6 +55,7 @@ limitations under the License.
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -364,8 +366,16 @@ class GraphView {
 
 class ExecutorImpl : public Executor {
  public:
-  ExecutorImpl(const LocalExecutorParams& p, std::unique_ptr<const Graph> g)
-      : params_(p), graph_(std::move(g)), gview_() {
+  // If "num_work_stealing_workers" is positive, each step schedules its
+  // ready nodes on that many per-worker deques with work stealing (see
+  // ExecutorState::RunWorker) instead of handing every non-inline node to
+  // the runner.
+  ExecutorImpl(const LocalExecutorParams& p, std::unique_ptr<const Graph> g,
+               int num_work_stealing_workers = 0)
+      : params_(p),
+        graph_(std::move(g)),
+        gview_(),
+        num_work_stealing_workers_(num_work_stealing_workers) {
     CHECK(p.create_kernel != nullptr);
     CHECK(p.delete_kernel != nullptr);
   }
@@ -449,6 +459,10 @@ class ExecutorImpl : public Executor {
   // A cached value of params_
   bool device_record_tensor_accesses_ = false;
 
+  // Number of work-stealing workers per step, or 0 to use the default
+  // scheduler.
+  const int num_work_stealing_workers_;
+
   // Root nodes (with no in edges) that should form the initial ready queue
   std::vector<const Node*> root_nodes_;
 
@@ -1304,6 +1318,21 @@ class ExecutorState {
     int front_index_;
   };
 
+  // A ready node waiting in a work-stealing worker's deque.
+  struct QueuedNode {
+    TaggedNode tagged_node;
+    int64 scheduled_nsec;
+  };
+
+  // The deque owned by one work-stealing worker. The owner pushes and pops
+  // at the back, so the successors of a node tend to run on the thread
+  // (and core) that produced their inputs. Idle workers steal the oldest
+  // entries from the front.
+  struct WorkerQueue {
+    mutex mu;
+    std::deque<QueuedNode> nodes GUARDED_BY(mu);
+  };
+
   struct AsyncState;
 
   const bool vlog_;  // true if VLOG_IS_ON(1). Used to check vlog cheaply.
@@ -1319,6 +1348,8 @@ class ExecutorState {
   TensorStore* tensor_store_;
   // Step-local container.
   ScopedStepContainer* step_container_;
+  // Step-local host allocator, or nullptr.
+  Allocator* step_allocator_;
   StepStatsCollector* stats_collector_;
   // QUESTION: Make it a checkpoint::TensorSliceReaderCacheWrapper
   // instead of a pointer?  (avoids having to delete).
@@ -1343,6 +1374,23 @@ class ExecutorState {
 
   std::atomic_int_fast32_t num_outstanding_ops_;
 
+  // State of the work-stealing scheduler. Empty/unused unless
+  // impl_->num_work_stealing_workers_ > 0.
+  std::vector<std::unique_ptr<WorkerQueue>> worker_queues_;
+  // Total number of nodes in worker_queues_.
+  std::atomic<int64> num_queued_nodes_{0};
+  // Number of workers that are running or have been handed to runner_.
+  // Only modified with worker_mu_ held, but read without it to decide
+  // whether more workers may be started.
+  std::atomic<int> num_active_workers_{0};
+  // Round-robin cursor for nodes scheduled from outside a worker.
+  std::atomic<uint32> next_external_queue_{0};
+  mutex worker_mu_;
+  std::vector<int> free_worker_ids_ GUARDED_BY(worker_mu_);
+  // Set when the step has completed while workers were still active; the
+  // last worker to go idle calls Finish().
+  bool finish_pending_ GUARDED_BY(worker_mu_) = false;
+
   mutex mu_;
   Status status_ GUARDED_BY(mu_);
 
@@ -1403,6 +1451,31 @@ class ExecutorState {
   void ScheduleReady(const TaggedNodeSeq& ready,
                      TaggedNodeReadyQueue* inline_ready);
 
+  // Work-stealing variant of ScheduleReady. When called from one of this
+  // step's workers, keeps the first ready node inline and pushes the rest
+  // onto the worker's own deque; otherwise spreads 'ready' over all deques.
+  void ScheduleReadyWorkStealing(const TaggedNodeSeq& ready,
+                                 TaggedNodeReadyQueue* inline_ready,
+                                 int64 scheduled_nsec);
+
+  // Starts workers on free worker ids while there are queued nodes. Returns
+  // the ids of the workers to hand to runner_ once worker_mu_ is released.
+  gtl::InlinedVector<int, 4> ClaimIdleWorkersLocked()
+      EXCLUSIVE_LOCKS_REQUIRED(worker_mu_);
+  void StartWorkers(const gtl::InlinedVector<int, 4>& worker_ids);
+
+  // Pops a node from the back of worker 'worker_id's deque, or steals one
+  // from the front of another worker's deque. Returns false if all deques
+  // are empty.
+  bool PopReadyNode(int worker_id, QueuedNode* queued);
+
+  // The main loop of a work-stealing worker.
+  void RunWorker(int worker_id);
+
+  // Calls Finish() now, or defers it to the last active work-stealing
+  // worker so that no worker touches this state after it is deleted.
+  void MaybeFinish();
+
   // For debugging/logging only.
   inline void MaybeMarkCompleted(FrameState* frame, int64 iter, int64 id);
 
@@ -1441,6 +1514,7 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       session_state_(args.session_state),
       tensor_store_(args.tensor_store),
       step_container_(args.step_container),
+      step_allocator_(args.step_allocator),
       stats_collector_(args.stats_collector),
       slice_reader_cache_(new checkpoint::TensorSliceReaderCacheWrapper),
       call_frame_(args.call_frame),
@@ -1462,6 +1536,17 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       root_frame_->pending_counts, root_frame_->total_input_tensors);
 
   outstanding_frames_.insert({root_frame_->frame_name, root_frame_});
+
+  const int num_workers = impl_->num_work_stealing_workers_;
+  if (num_workers > 0) {
+    worker_queues_.reserve(num_workers);
+    free_worker_ids_.reserve(num_workers);
+    for (int i = 0; i < num_workers; ++i) {
+      worker_queues_.emplace_back(new WorkerQueue);
+      // Hand out low ids first.
+      free_worker_ids_.push_back(num_workers - 1 - i);
+    }
+  }
 }
 
 ExecutorState::~ExecutorState() {
@@ -1656,6 +1741,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
   params.function_library = impl_->params_.function_library;
   params.resource_manager = device->resource_manager();
   params.step_container = step_container_;
+  params.step_allocator = step_allocator_;
   params.slice_reader_cache = slice_reader_cache_;
   params.inputs = &inputs;
   params.input_device_contexts = &input_device_contexts;
@@ -1794,7 +1880,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
           const bool completed =
               NodeDone(s, state->item->node, ready, stats, nullptr);
           delete state;
-          if (completed) Finish();
+          if (completed) MaybeFinish();
         };
         nodestats::SetOpStart(stats);
         device->ComputeAsync(async, &state->ctx, done);
@@ -1847,7 +1933,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
   }  // while !inline_ready.empty()
 
   // This thread of computation is done if completed = true.
-  if (completed) Finish();
+  if (completed) MaybeFinish();
 }
 
 Status ExecutorState::PrepareInputs(const NodeItem& item, Entry* first_input,
@@ -2218,6 +2304,10 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
   if (stats_collector_) {
     scheduled_nsec = nodestats::NowInNsec();
   }
+  if (!worker_queues_.empty()) {
+    ScheduleReadyWorkStealing(ready, inline_ready, scheduled_nsec);
+    return;
+  }
   if (inline_ready == nullptr) {
     // Schedule to run all the ready ops in thread pool.
     for (auto& tagged_node : ready) {
@@ -2255,6 +2345,155 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
   }
 }
 
+// The work-stealing worker, if any, that is running on the current thread.
+// 'state' identifies the ExecutorState the worker belongs to, so that nested
+// executors (e.g. for function calls) run inline on the same thread do not
+// mistake it for one of their own workers.
+struct CurrentWorker {
+  const void* state = nullptr;
+  int id = -1;
+};
+thread_local CurrentWorker current_worker;
+
+void ExecutorState::ScheduleReadyWorkStealing(
+    const TaggedNodeSeq& ready, TaggedNodeReadyQueue* inline_ready,
+    int64 scheduled_nsec) {
+  if (current_worker.state == this) {
+    // Called by one of our workers, which keeps this state alive until it
+    // goes idle.
+    auto begin = ready.begin();
+    if (inline_ready != nullptr && inline_ready->empty()) {
+      // Run the first successor next on this thread, where its inputs are
+      // still hot in cache.
+      inline_ready->push_back(*begin);
+      ++begin;
+    }
+    if (begin == ready.end()) return;
+    WorkerQueue* queue = worker_queues_[current_worker.id].get();
+    {
+      mutex_lock l(queue->mu);
+      for (auto it = begin; it != ready.end(); ++it) {
+        queue->nodes.push_back(QueuedNode{*it, scheduled_nsec});
+      }
+    }
+    num_queued_nodes_.fetch_add(ready.end() - begin);
+    const int num_workers = worker_queues_.size();
+    if (num_active_workers_.load() < num_workers) {
+      gtl::InlinedVector<int, 4> worker_ids;
+      {
+        mutex_lock l(worker_mu_);
+        worker_ids = ClaimIdleWorkersLocked();
+      }
+      StartWorkers(worker_ids);
+    }
+    return;
+  }
+
+  // Called from outside the workers (the initial ready nodes, or an async
+  // kernel's completion callback). Hold worker_mu_ while enqueueing so that
+  // the step cannot finish, and this state be deleted, until we are done.
+  gtl::InlinedVector<int, 4> worker_ids;
+  {
+    mutex_lock l(worker_mu_);
+    const uint32 num_queues = worker_queues_.size();
+    for (const TaggedNode& tagged_node : ready) {
+      WorkerQueue* queue =
+          worker_queues_[next_external_queue_.fetch_add(1) % num_queues].get();
+      mutex_lock queue_lock(queue->mu);
+      queue->nodes.push_back(QueuedNode{tagged_node, scheduled_nsec});
+    }
+    num_queued_nodes_.fetch_add(ready.size());
+    worker_ids = ClaimIdleWorkersLocked();
+  }
+  // Every claimed worker counts as active, which keeps this state alive.
+  StartWorkers(worker_ids);
+}
+
+gtl::InlinedVector<int, 4> ExecutorState::ClaimIdleWorkersLocked() {
+  gtl::InlinedVector<int, 4> worker_ids;
+  int64 num_queued = num_queued_nodes_.load();
+  while (num_queued > 0 && !free_worker_ids_.empty()) {
+    worker_ids.push_back(free_worker_ids_.back());
+    free_worker_ids_.pop_back();
+    num_active_workers_.fetch_add(1);
+    --num_queued;
+  }
+  return worker_ids;
+}
+
+void ExecutorState::StartWorkers(
+    const gtl::InlinedVector<int, 4>& worker_ids) {
+  for (int worker_id : worker_ids) {
+    runner_([this, worker_id]() { RunWorker(worker_id); });
+  }
+}
+
+bool ExecutorState::PopReadyNode(int worker_id, QueuedNode* queued) {
+  if (num_queued_nodes_.load(std::memory_order_relaxed) == 0) return false;
+  const int num_queues = worker_queues_.size();
+  {
+    WorkerQueue* queue = worker_queues_[worker_id].get();
+    mutex_lock l(queue->mu);
+    if (!queue->nodes.empty()) {
+      *queued = queue->nodes.back();
+      queue->nodes.pop_back();
+      num_queued_nodes_.fetch_sub(1);
+      return true;
+    }
+  }
+  for (int i = 1; i < num_queues; ++i) {
+    WorkerQueue* victim = worker_queues_[(worker_id + i) % num_queues].get();
+    mutex_lock l(victim->mu);
+    if (!victim->nodes.empty()) {
+      *queued = victim->nodes.front();
+      victim->nodes.pop_front();
+      num_queued_nodes_.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ExecutorState::RunWorker(int worker_id) {
+  const CurrentWorker saved_worker = current_worker;
+  current_worker.state = this;
+  current_worker.id = worker_id;
+  bool finish = false;
+  QueuedNode queued{TaggedNode(nullptr, nullptr, -1, false), 0};
+  while (true) {
+    while (PopReadyNode(worker_id, &queued)) {
+      Process(queued.tagged_node, queued.scheduled_nsec);
+    }
+    // Go idle. Nodes pushed concurrently are either seen below, or their
+    // pusher sees this worker as inactive and starts a new one.
+    mutex_lock l(worker_mu_);
+    num_active_workers_.fetch_sub(1);
+    free_worker_ids_.push_back(worker_id);
+    if (num_queued_nodes_.load() > 0) {
+      worker_id = free_worker_ids_.back();
+      free_worker_ids_.pop_back();
+      num_active_workers_.fetch_add(1);
+      current_worker.id = worker_id;
+      continue;
+    }
+    finish = finish_pending_ && num_active_workers_.load() == 0;
+    break;
+  }
+  current_worker = saved_worker;
+  if (finish) Finish();
+}
+
+void ExecutorState::MaybeFinish() {
+  if (!worker_queues_.empty()) {
+    mutex_lock l(worker_mu_);
+    if (num_active_workers_.load() > 0) {
+      finish_pending_ = true;
+      return;
+    }
+  }
+  Finish();
+}
+
 inline void ExecutorState::MaybeMarkCompleted(FrameState* frame, int64 iter,
                                               int64 node_id) {
   // TODO(misard) Replace with a finer-grain enabling flag once we
@@ -2784,6 +3023,34 @@ class DefaultExecutorRegistrar {
 };
 static DefaultExecutorRegistrar registrar;
 
+// Registers the "WORK_STEALING" executor type. It runs the same ExecutorImpl
+// as the default executor, but each step keeps its ready nodes in
+// per-worker deques (one worker per schedulable CPU) and lets idle workers
+// steal from busy ones. This keeps producer/consumer chains on one thread and
+// avoids a runner handoff for every non-inline node, which helps graphs with
+// many small ops.
+class WorkStealingExecutorRegistrar {
+ public:
+  WorkStealingExecutorRegistrar() {
+    ExecutorFactory::Register("WORK_STEALING", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params,
+                       std::unique_ptr<const Graph> graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      const int num_workers = std::max(port::NumSchedulableCPUs(), 1);
+      std::unique_ptr<ExecutorImpl> impl(
+          new ExecutorImpl(params, std::move(graph), num_workers));
+      TF_RETURN_IF_ERROR(impl->Initialize());
+      *out_executor = std::move(impl);
+      return Status::OK();
+    }
+  };
+};
+static WorkStealingExecutorRegistrar work_stealing_registrar;
+
 }  // namespace
 
 }  // namespace tensorflow
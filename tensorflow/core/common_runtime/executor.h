@@ -91,6 +91,10 @@ class Executor {
     ScopedStepContainer* step_container = nullptr;
     CollectiveExecutor* collective_executor = nullptr;
 
+    // If not null, serves the step's plain host allocations (see
+    // OpKernelContext::Params::step_allocator).
+    Allocator* step_allocator = nullptr;
+
     // If true, calls Sync() on the device.
     bool sync_on_finish = false;
 
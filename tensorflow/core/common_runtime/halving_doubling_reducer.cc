@@ -0,0 +1,372 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/halving_doubling_reducer.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+
+// Set true for greater intelligibility of debug mode log messages.
+#define READABLE_KEYS false
+
+namespace tensorflow {
+namespace {
+// Stages of the algorithm, in order of execution.  Within a stage, the
+// exchanges between a pair of devices are told apart by their step.
+enum Stage {
+  kIntraTaskReduce = 0,  // members of a task to its first device
+  kFold,                 // devices in excess of a power of two to a neighbor
+  kHalving,              // reduce-scatter
+  kDoubling,             // all-gather
+  kUnfold,               // back to the devices in excess
+  kIntraTaskBroadcast,   // first device of a task to the others
+};
+
+// Key to be used for BufRendezvous by HalvingDoublingReducer.
+string HalvingDoublingBufKey(const string& exec_key, int stage, int step,
+                             int src_rank, int dst_rank) {
+  if (READABLE_KEYS) {
+    return strings::StrCat("hdred(", exec_key, "):stage(", stage, "):step(",
+                           step, "):src(", src_rank, "):dst(", dst_rank, ")");
+  } else {
+    return strings::StrCat(exec_key, ":", stage, ":", step, ":", src_rank, ":",
+                           dst_rank);
+  }
+}
+}  // namespace
+
+HalvingDoublingReducer::HalvingDoublingReducer(
+    CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+    OpKernelContext* ctx, OpKernelContext::Params* op_params,
+    const CollectiveParams& col_params, const string& exec_key, int64 step_id,
+    const Tensor* input, Tensor* output, bool hierarchical)
+    : col_exec_(col_exec),
+      dev_mgr_(dev_mgr),
+      ctx_(ctx),
+      op_params_(op_params),
+      col_params_(col_params),
+      exec_key_(exec_key),
+      input_(input),
+      output_(output),
+      hierarchical_(hierarchical),
+      rank_(col_params.default_rank),
+      device_(nullptr) {
+  CHECK_GT(col_params_.group.group_size, 0);
+}
+
+/*static*/
+std::vector<int> HalvingDoublingReducer::Participants(
+    const CollectiveParams& cp, bool hierarchical) {
+  std::vector<int> participants;
+  std::unordered_set<string> tasks;
+  for (int r = 0; r < cp.group.group_size; ++r) {
+    if (!hierarchical || tasks.insert(cp.instance.task_names[r]).second) {
+      participants.push_back(r);
+    }
+  }
+  return participants;
+}
+
+void HalvingDoublingReducer::Run(StatusCallback done) {
+  Status status = dev_mgr_->LookupDevice(
+      col_params_.instance.device_names[rank_], &device_);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  CHECK(device_);
+  device_locality_ = device_->attributes().locality();
+  if (col_params_.group.device_type != DEVICE_CPU) {
+    done(errors::InvalidArgument(
+        "HalvingDoublingReducer only runs on CPU devices, not on ",
+        device_->name()));
+    return;
+  }
+
+  // Start by copying input to output if they're not already the same, i.e. if
+  // we're not computing in-place on the input tensor.
+  if ((input_ != output_) &&
+      (DMAHelper::base(input_) != DMAHelper::base(output_))) {
+    // We are running in a blockable thread and the callback can't block so
+    // just wait here on the copy.
+    Notification note;
+    CollectiveRemoteAccessLocal::MemCpyAsync(
+        ctx_->input_device_context(0), ctx_->op_device_context(), device_,
+        device_, ctx_->input_alloc_attr(0), ctx_->output_alloc_attr(0), input_,
+        output_, 0 /*dev_to_dev_stream_index*/,
+        [&note, &status](const Status& s) {
+          status.Update(s);
+          note.Notify();
+        });
+    note.WaitForNotification();
+    if (!status.ok()) {
+      done(status);
+      return;
+    }
+  }
+
+  // The adapter is only used to flatten the output, the ranges exchanged
+  // are computed below.
+  ca_.reset(MakeCollectiveAdapter(
+      output_, 1, device_->GetAllocator(ctx_->output_alloc_attr(0))));
+  if (col_params_.final_op) {
+    group_size_tensor_ = ca_->Scalar(col_params_.group.group_size);
+  }
+
+  status = hierarchical_ ? RunHierarchical()
+                         : RunHalvingDoubling(Participants(col_params_, false));
+  if (status.ok()) {
+    ca_->ConsumeFinalValue(output_);
+  } else {
+    // Peers may be waiting for exchanges with this device that will never
+    // happen.
+    col_exec_->StartAbort(status);
+  }
+  done(status);
+}
+
+Status HalvingDoublingReducer::RunHierarchical() {
+  const std::vector<string>& task_names = col_params_.instance.task_names;
+  int leader = -1;
+  std::vector<int> members;
+  for (int r = 0; r < col_params_.group.group_size; ++r) {
+    if (task_names[r] != task_names[rank_]) continue;
+    if (leader < 0) {
+      leader = r;
+    } else {
+      members.push_back(r);
+    }
+  }
+  Tensor value = Range(0, ca_->Value().NumElements());
+  if (rank_ != leader) {
+    TF_RETURN_IF_ERROR(
+        Exchange({leader}, &value, -1, nullptr, kIntraTaskReduce, 0));
+    return Exchange({}, nullptr, leader, &value, kIntraTaskBroadcast, 0);
+  }
+  if (!members.empty()) {
+    Tensor tmp = TempTensor(value.NumElements());
+    for (int member : members) {
+      TF_RETURN_IF_ERROR(
+          Exchange({}, nullptr, member, &tmp, kIntraTaskReduce, 0));
+      TF_RETURN_IF_ERROR(Merge(&value, &tmp));
+    }
+  }
+  TF_RETURN_IF_ERROR(RunHalvingDoubling(Participants(col_params_, true)));
+  return Exchange(members, &value, -1, nullptr, kIntraTaskBroadcast, 0);
+}
+
+Status HalvingDoublingReducer::RunHalvingDoubling(
+    const std::vector<int>& participants) {
+  const int num_participants = static_cast<int>(participants.size());
+  const int index = static_cast<int>(
+      std::find(participants.begin(), participants.end(), rank_) -
+      participants.begin());
+  CHECK_LT(index, num_participants);
+  int pow2 = 1;
+  while (pow2 * 2 <= num_participants) pow2 *= 2;
+  const int num_extra = num_participants - pow2;
+  const int64 total_elts = ca_->Value().NumElements();
+  Tensor value = Range(0, total_elts);
+
+  // The first 2 * num_extra participants pair up, the even one of each pair
+  // handing its value to the odd one, which takes part in the rest under a
+  // new rank among pow2.
+  int new_rank;
+  if (index < 2 * num_extra) {
+    if (index % 2 == 0) {
+      TF_RETURN_IF_ERROR(
+          Exchange({participants[index + 1]}, &value, -1, nullptr, kFold, 0));
+      return Exchange({}, nullptr, participants[index + 1], &value, kUnfold,
+                      0);
+    }
+    Tensor tmp = TempTensor(total_elts);
+    TF_RETURN_IF_ERROR(
+        Exchange({}, nullptr, participants[index - 1], &tmp, kFold, 0));
+    TF_RETURN_IF_ERROR(Merge(&value, &tmp));
+    new_rank = index / 2;
+  } else {
+    new_rank = index - num_extra;
+  }
+  auto participant = [&participants, num_extra](int r) {
+    return participants[r < num_extra ? 2 * r + 1 : r + num_extra];
+  };
+
+  // The tensor is split into pow2 chunks of aligned size, and each step
+  // exchanges a contiguous range [lo, hi) of them.
+  const int64 chunk_elts = CollectiveAdapter::AlignedChunkElts(
+      DataTypeSize(col_params_.instance.data_type), total_elts, pow2);
+  auto offset = [chunk_elts, total_elts](int chunk) {
+    return std::min(total_elts, chunk * chunk_elts);
+  };
+  // Each step halves the range that this device reduces, sending the other
+  // half to the peer that reduces it, until it is left with chunk new_rank.
+  int lo = 0;
+  int hi = pow2;
+  int step = 0;
+  for (int mask = pow2 / 2; mask > 0; mask /= 2, ++step) {
+    const int peer = participant(new_rank ^ mask);
+    const int mid = lo + (hi - lo) / 2;
+    Tensor send;
+    if (new_rank & mask) {
+      send = Range(offset(lo), offset(mid));
+      lo = mid;
+    } else {
+      send = Range(offset(mid), offset(hi));
+      hi = mid;
+    }
+    Tensor keep = Range(offset(lo), offset(hi));
+    Tensor tmp = TempTensor(keep.NumElements());
+    // Empty ranges are neither sent nor received, by either peer.
+    TF_RETURN_IF_ERROR(
+        Exchange(send.NumElements() > 0 ? std::vector<int>({peer})
+                                        : std::vector<int>(),
+                 &send, keep.NumElements() > 0 ? peer : -1, &tmp, kHalving,
+                 step));
+    if (keep.NumElements() > 0) TF_RETURN_IF_ERROR(Merge(&keep, &tmp));
+  }
+  Tensor own = Range(offset(lo), offset(hi));
+  TF_RETURN_IF_ERROR(Finalize(&own));
+
+  // Then each step doubles the range of final values, by exchanging it for
+  // that of the peer.
+  step = 0;
+  for (int mask = 1; mask < pow2; mask *= 2, ++step) {
+    const int peer = participant(new_rank ^ mask);
+    const int size = hi - lo;
+    const int peer_lo = (new_rank & mask) ? lo - size : hi;
+    Tensor send = Range(offset(lo), offset(hi));
+    Tensor recv = Range(offset(peer_lo), offset(peer_lo + size));
+    TF_RETURN_IF_ERROR(
+        Exchange(send.NumElements() > 0 ? std::vector<int>({peer})
+                                        : std::vector<int>(),
+                 &send, recv.NumElements() > 0 ? peer : -1, &recv, kDoubling,
+                 step));
+    lo = std::min(lo, peer_lo);
+    hi = lo + 2 * size;
+  }
+
+  if (index < 2 * num_extra) {
+    return Exchange({participants[index - 1]}, &value, -1, nullptr, kUnfold,
+                    0);
+  }
+  return Status::OK();
+}
+
+Status HalvingDoublingReducer::Exchange(const std::vector<int>& send_to,
+                                        const Tensor* send, int recv_from,
+                                        Tensor* recv, int stage, int step) {
+  BlockingCounter pending(send_to.size() + (recv_from >= 0 ? 1 : 0));
+  mutex mu;
+  Status status;
+  auto done = [&pending, &mu, &status](const Status& s) {
+    {
+      mutex_lock l(mu);
+      status.Update(s);
+    }
+    pending.DecrementCount();
+  };
+  for (int peer : send_to) {
+    DispatchSend(peer, stage, step, send, done);
+  }
+  if (recv_from >= 0) {
+    DispatchRecv(recv_from, stage, step, recv, done);
+  }
+  pending.Wait();
+  mutex_lock l(mu);
+  return status;
+}
+
+void HalvingDoublingReducer::DispatchSend(int dst_rank, int stage, int step,
+                                          const Tensor* src_tensor,
+                                          const StatusCallback& done) {
+  string send_buf_key =
+      HalvingDoublingBufKey(exec_key_, stage, step, rank_, dst_rank);
+  VLOG(3) << "DispatchSend " << send_buf_key << " from_device "
+          << device_->name() << " to_device "
+          << col_params_.instance.device_names[dst_rank];
+  col_exec_->PostToPeer(col_params_.instance.device_names[dst_rank],
+                        col_params_.instance.task_names[dst_rank],
+                        send_buf_key, device_, ctx_->op_device_context(),
+                        ctx_->output_alloc_attr(0), src_tensor,
+                        device_locality_, done);
+}
+
+void HalvingDoublingReducer::DispatchRecv(int src_rank, int stage, int step,
+                                          Tensor* dst_tensor,
+                                          const StatusCallback& done) {
+  string recv_buf_key =
+      HalvingDoublingBufKey(exec_key_, stage, step, src_rank, rank_);
+  VLOG(3) << "DispatchRecv " << recv_buf_key << " from_device "
+          << col_params_.instance.device_names[src_rank] << " to_device "
+          << device_->name();
+  col_exec_->RecvFromPeer(col_params_.instance.device_names[src_rank],
+                          col_params_.instance.task_names[src_rank],
+                          col_params_.task.is_local[src_rank], recv_buf_key,
+                          device_, ctx_->op_device_context(),
+                          ctx_->output_alloc_attr(0), dst_tensor,
+                          device_locality_, 0 /*stream_index*/, done);
+}
+
+Status HalvingDoublingReducer::Merge(Tensor* output, Tensor* input) {
+  return ComputeBinOp(ctx_, op_params_, device_, col_params_.merge_op.get(),
+                      output, input);
+}
+
+Status HalvingDoublingReducer::Finalize(Tensor* value) {
+  if (!col_params_.final_op || value->NumElements() == 0) {
+    return Status::OK();
+  }
+  return ComputeBinOp(ctx_, op_params_, device_, col_params_.final_op.get(),
+                      value, &group_size_tensor_);
+}
+
+Tensor HalvingDoublingReducer::Range(int64 begin, int64 end) {
+  return ca_->Value().Slice(begin, end);
+}
+
+Tensor HalvingDoublingReducer::TempTensor(int64 num_elements) {
+  return Tensor(device_->GetAllocator(ctx_->output_alloc_attr(0)),
+                col_params_.instance.data_type, TensorShape({num_elements}));
+}
+
+REGISTER_COLLECTIVE(
+    "HalvingDoublingReduce", REDUCTION_COLLECTIVE,
+    [](CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+       OpKernelContext* ctx, OpKernelContext::Params* params,
+       const CollectiveParams& col_params, const string& exec_key,
+       int64 step_id, const Tensor* input, Tensor* output) {
+      return new HalvingDoublingReducer(col_exec, dev_mgr, ctx, params,
+                                        col_params, exec_key, step_id, input,
+                                        output, false /*hierarchical*/);
+    });
+
+REGISTER_COLLECTIVE(
+    "HierarchicalReduce", REDUCTION_COLLECTIVE,
+    [](CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+       OpKernelContext* ctx, OpKernelContext::Params* params,
+       const CollectiveParams& col_params, const string& exec_key,
+       int64 step_id, const Tensor* input, Tensor* output) {
+      return new HalvingDoublingReducer(col_exec, dev_mgr, ctx, params,
+                                        col_params, exec_key, step_id, input,
+                                        output, true /*hierarchical*/);
+    });
+
+}  // namespace tensorflow
@@ -0,0 +1,103 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_HALVING_DOUBLING_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_HALVING_DOUBLING_REDUCER_H_
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+
+namespace tensorflow {
+class DeviceMgr;
+
+// Recursive halving/doubling implementation of collective all-reduce,
+// registered as "HalvingDoublingReduce", and its two-level variant,
+// registered as "HierarchicalReduce".
+//
+// Among n devices, a reduce-scatter by recursive halving leaves each device
+// with the reduction of 1/n of the tensor, which an all-gather by recursive
+// doubling then distributes.  Both take log2(n) steps, against the n-1 each
+// of the ring.  When n is not a power of two, the devices in excess first
+// hand their values to a neighbor and get the result back at the end.
+//
+// The two-level variant first reduces the values of the devices of each
+// task into the first device of the task, runs the halving/doubling among
+// those devices only, and then broadcasts the result back within each task.
+//
+// Only runs on CPU devices.
+class HalvingDoublingReducer : public CollectiveImplementationInterface {
+ public:
+  HalvingDoublingReducer(CollectiveExecutor* col_exec,
+                         const DeviceMgr* dev_mgr, OpKernelContext* ctx,
+                         OpKernelContext::Params* op_params,
+                         const CollectiveParams& col_params,
+                         const string& exec_key, int64 step_id,
+                         const Tensor* input, Tensor* output,
+                         bool hierarchical);
+
+  void Run(StatusCallback done) override;
+
+  // Returns the default ranks of the devices that run the halving/doubling:
+  // all of them, or in the two-level variant the first device of each task.
+  static std::vector<int> Participants(const CollectiveParams& cp,
+                                       bool hierarchical);
+
+ private:
+  // Reduces within the task of this device, runs the halving/doubling if
+  // this device participates, then broadcasts within the task.
+  Status RunHierarchical();
+  // Runs the halving/doubling among `participants`, to which this device
+  // belongs.
+  Status RunHalvingDoubling(const std::vector<int>& participants);
+
+  // Sends `send` to each device of default rank in `send_to`, receives
+  // `recv` from the device of default rank `recv_from` unless it is -1, and
+  // waits for all of them.  `stage` and `step` tell apart the exchanges
+  // between the same pair of devices.
+  Status Exchange(const std::vector<int>& send_to, const Tensor* send,
+                  int recv_from, Tensor* recv, int stage, int step);
+  void DispatchSend(int dst_rank, int stage, int step,
+                    const Tensor* src_tensor, const StatusCallback& done);
+  void DispatchRecv(int src_rank, int stage, int step, Tensor* dst_tensor,
+                    const StatusCallback& done);
+  // Merges `input` into `output` with the merge_op.
+  Status Merge(Tensor* output, Tensor* input);
+  // Applies the final_op, if any, to `value`.
+  Status Finalize(Tensor* value);
+  // Returns an alias of elements [begin, end) of the flattened output.
+  Tensor Range(int64 begin, int64 end);
+  // Returns a temporary tensor of `num_elements`.
+  Tensor TempTensor(int64 num_elements);
+
+  CollectiveExecutor* col_exec_;        // Not owned
+  const DeviceMgr* dev_mgr_;            // Not owned
+  OpKernelContext* ctx_;                // Not owned
+  OpKernelContext::Params* op_params_;  // Not owned
+  const CollectiveParams& col_params_;
+  const string exec_key_;
+  const Tensor* input_;  // Not owned
+  Tensor* output_;       // Not owned
+  const bool hierarchical_;
+  const int rank_;
+  std::unique_ptr<CollectiveAdapter> ca_;
+  Tensor group_size_tensor_;
+  Device* device_;  // The device for which this instance labors
+  DeviceLocality device_locality_;
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_HALVING_DOUBLING_REDUCER_H_
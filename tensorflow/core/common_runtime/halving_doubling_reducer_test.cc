@@ -0,0 +1,512 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/halving_doubling_reducer.h"
+
+#include <cmath>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+// Wraps CollectiveRemoteAccessLocal with the ability to return an
+// error status to the N'th action.
+class FailTestRMA : public CollectiveRemoteAccessLocal {
+ public:
+  FailTestRMA(const DeviceMgr* dev_mgr, DeviceResolverInterface* dev_resolver,
+              int64 step_id, int fail_after)
+      : CollectiveRemoteAccessLocal(dev_mgr, dev_resolver, step_id),
+        fail_after_(fail_after) {}
+
+  bool MaybeFail(const StatusCallback& done) {
+    bool fail_now = false;
+    {
+      mutex_lock l(mu_);
+      if (fail_after_ > 0) {
+        fail_now = (--fail_after_ == 0);
+      }
+    }
+    if (fail_now) {
+      done(errors::Internal("Deliberate failure"));
+      return true;
+    }
+    return false;
+  }
+
+  void RecvFromPeer(const string& peer_device, const string& peer_task,
+                    bool peer_is_local, const string& key, Device* to_device,
+                    DeviceContext* to_device_ctx,
+                    const AllocatorAttributes& to_alloc_attr, Tensor* to_tensor,
+                    const DeviceLocality& client_locality,
+                    int dev_to_dev_stream_index,
+                    const StatusCallback& done) override {
+    if (MaybeFail(done)) return;
+    CollectiveRemoteAccessLocal::RecvFromPeer(
+        peer_device, peer_task, peer_is_local, key, to_device, to_device_ctx,
+        to_alloc_attr, to_tensor, client_locality, dev_to_dev_stream_index,
+        done);
+  }
+
+  void PostToPeer(const string& peer_device, const string& peer_task,
+                  const string& key, Device* from_device,
+                  DeviceContext* from_device_ctx,
+                  const AllocatorAttributes& from_alloc_attr,
+                  const Tensor* from_tensor,
+                  const DeviceLocality& client_locality,
+                  const StatusCallback& done) override {
+    if (MaybeFail(done)) return;
+    CollectiveRemoteAccessLocal::PostToPeer(
+        peer_device, peer_task, key, from_device, from_device_ctx,
+        from_alloc_attr, from_tensor, client_locality, done);
+  }
+
+  mutex mu_;
+  int fail_after_ GUARDED_BY(mu_);
+};
+
+std::unique_ptr<OpKernel> GetKernel(const NodeDef& node,
+                                    const DeviceType& device_type,
+                                    DeviceBase* device) {
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      device_type, device, device->GetAllocator(AllocatorAttributes()), node,
+      TF_GRAPH_DEF_VERSION, &status);
+  if (!status.ok()) {
+    LOG(FATAL) << status;
+  }
+  return k;
+}
+
+std::unique_ptr<OpKernel> GetBinOp(const string& op, DataType dtype,
+                                   DeviceBase* device) {
+  NodeDef node_def;
+  NodeDefBuilder builder(strings::StrCat(op, "_node"), op);
+  TF_CHECK_OK(builder.Attr("T", dtype)
+                  .Input(FakeInput(dtype))
+                  .Input(FakeInput(dtype))
+                  .Finalize(&node_def));
+  return GetKernel(node_def, DEVICE_CPU, device);
+}
+
+static int64 kStepId = 123;
+
+// Runs the all-reduce implementation registered under a given name on
+// num_workers * num_devices local CPU devices, where the devices of each
+// worker are in a task of their own.
+class HalvingDoublingReducerTest : public ::testing::Test {
+ protected:
+  ~HalvingDoublingReducerTest() override {
+    stop_ = true;
+    for (auto i : instances_) {
+      delete i;
+    }
+    if (col_exec_) col_exec_->Unref();
+  }
+
+  void Init(const string& impl_name, int num_workers, int num_devices,
+            DataType dtype, int fail_after) {
+    impl_name_ = impl_name;
+    std::vector<Device*> local_devices;
+    SessionOptions sess_opts;
+    sess_opts.env = Env::Default();
+    Bytes mem_limit(4 << 20);
+    DeviceLocality dev_locality;
+    for (int wi = 0; wi < num_workers; ++wi) {
+      for (int di = 0; di < num_devices; ++di) {
+        string dev_name =
+            strings::StrCat("/job:worker/replica:0/task:", wi, "/cpu:", di);
+        local_devices.push_back(new ThreadPoolDevice(
+            sess_opts, dev_name, mem_limit, dev_locality, cpu_allocator()));
+      }
+    }
+    dev_mgr_.reset(new DeviceMgr(local_devices));
+    dev_resolver_.reset(new DeviceResolverLocal(dev_mgr_.get()));
+    rma_ = new FailTestRMA(dev_mgr_.get(), dev_resolver_.get(), kStepId,
+                           fail_after);
+    col_exec_ = new BaseCollectiveExecutor(&col_exec_mgr_, rma_, kStepId,
+                                           dev_mgr_.get());
+    col_params_.name = "test_collective";
+    col_params_.group.group_key = 5;
+    col_params_.group.device_type = DEVICE_CPU;
+    col_params_.group.group_size = num_workers * num_devices;
+    col_params_.group.num_tasks = num_workers;
+    col_params_.instance.instance_key = 17;
+    col_params_.instance.type = REDUCTION_COLLECTIVE;
+    col_params_.instance.data_type = dtype;
+    col_params_.instance.impl_details.collective_name = impl_name;
+    // A single subdivision in default rank order, for the ring.
+    col_params_.instance.impl_details.subdiv_offsets = {0};
+    col_params_.instance.impl_details.subdiv_permutations.resize(1);
+    col_params_.subdiv_rank.resize(1);
+    for (int wi = 0; wi < num_workers; ++wi) {
+      string task_name = strings::StrCat("/job:worker/replica:0/task:", wi);
+      for (int di = 0; di < num_devices; ++di) {
+        int rank = wi * num_devices + di;
+        col_params_.instance.device_names.push_back(
+            strings::StrCat(task_name, "/cpu:", di));
+        col_params_.instance.task_names.push_back(task_name);
+        col_params_.task.is_local.push_back(true);
+        col_params_.instance.impl_details.subdiv_permutations[0].push_back(
+            rank);
+      }
+    }
+    for (int rank = 0; rank < col_params_.group.group_size; ++rank) {
+      instances_.push_back(new DeviceInstance(rank, this));
+    }
+  }
+
+  void Reduce() {
+    std::atomic<int> done(0);
+    for (auto di : instances_) {
+      SchedClosure([di, &done] {
+        di->DoReduce();
+        ++done;
+      });
+    }
+    while (done < static_cast<int>(instances_.size())) {
+      if (stop_) break;
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+  }
+
+  template <typename T>
+  void RunTest(const string& impl_name, DataType dtype, int num_workers,
+               int num_devices, int tensor_len, int fail_after) {
+    Init(impl_name, num_workers, num_devices, dtype, fail_after);
+    std::vector<T> expected(tensor_len, 0);
+    for (int di = 0; di < static_cast<int>(instances_.size()); ++di) {
+      instances_[di]->InitTensor(
+          dtype, TensorShape({tensor_len}), [&expected, di](Tensor* t) {
+            for (int i = 0; i < t->NumElements(); ++i) {
+              T value = static_cast<T>(di * 10 + i);
+              t->flat<T>()(i) = value;
+              expected[i] += value;
+            }
+          });
+    }
+    Reduce();
+    if (fail_after > 0) {
+      // Confirm that every device terminated with the expected error status.
+      for (int di = 0; di < static_cast<int>(instances_.size()); ++di) {
+        EXPECT_EQ("Deliberate failure",
+                  instances_[di]->status_.error_message());
+      }
+      return;
+    }
+    // Confirm that every device computed the same correct reduction value.
+    for (int i = 0; i < tensor_len; ++i) {
+      expected[i] /= static_cast<T>(instances_.size());
+    }
+    for (int di = 0; di < static_cast<int>(instances_.size()); ++di) {
+      TF_EXPECT_OK(instances_[di]->status_);
+      for (int i = 0; i < tensor_len; ++i) {
+        const double value = expected[i];
+        EXPECT_NEAR(value, instances_[di]->tensor_.flat<T>()(i),
+                    1e-5 * (1 + std::abs(value)))
+            << "Mismatch at device " << di << " index " << i;
+      }
+    }
+  }
+
+  std::unique_ptr<OpKernel> GetCollectiveReduce(const CollectiveParams& params,
+                                                DeviceBase* device) {
+    mutex_lock l(mu_);
+    NodeDef node_def;
+    NodeDefBuilder builder(
+        strings::StrCat("collective_reduce_", reduce_counter_++),
+        "CollectiveReduce");
+    TF_CHECK_OK(
+        builder.Attr("T", params.instance.data_type)
+            .Attr("merge_op", "Add")
+            .Attr("final_op", "Div")
+            .Attr("group_size", params.group.group_size)
+            .Attr("group_key", params.group.group_key)
+            .Attr("instance_key", params.instance.instance_key)
+            .Attr("subdiv_offsets", params.instance.impl_details.subdiv_offsets)
+            .Input(FakeInput(params.instance.data_type))
+            .Finalize(&node_def));
+    return GetKernel(node_def, DEVICE_CPU, device);
+  }
+
+  class DeviceInstance {
+   public:
+    DeviceInstance(int rank, HalvingDoublingReducerTest* parent)
+        : parent_(parent) {
+      col_params_.name = parent_->col_params_.name;
+      col_params_.group = parent_->col_params_.group;
+      col_params_.instance = parent_->col_params_.instance;
+      col_params_.task.is_local = parent_->col_params_.task.is_local;
+      col_params_.default_rank = rank;
+      col_params_.subdiv_rank = {rank};
+      const string& dev_name = col_params_.instance.device_names[rank];
+      TF_CHECK_OK(parent_->dev_mgr_->LookupDevice(dev_name, &device_))
+          << "Couldn't find device " << dev_name
+          << " existing devices: " << parent_->dev_mgr_->DebugString();
+    }
+
+    void InitTensor(DataType dtype, const TensorShape& shape,
+                    const std::function<void(Tensor*)>& init_f) {
+      tensor_ =
+          Tensor(device_->GetAllocator(AllocatorAttributes()), dtype, shape);
+      init_f(&tensor_);
+    }
+
+    void DoReduce() {
+      col_params_.merge_op =
+          GetBinOp("Add", col_params_.instance.data_type, device_);
+      col_params_.final_op =
+          GetBinOp("Div", col_params_.instance.data_type, device_);
+
+      // Prepare an OpKernelContext.
+      OpKernelContext::Params op_params;
+      op_params.step_id = kStepId;
+      op_params.device = device_;
+      gtl::InlinedVector<TensorValue, 4> inputs;
+      inputs.push_back(TensorValue(&tensor_));
+      op_params.inputs = &inputs;
+      gtl::InlinedVector<AllocatorAttributes, 4> input_aa(
+          {AllocatorAttributes()});
+      op_params.input_alloc_attrs = &input_aa;
+      DeviceContext* dev_ctx = new DeviceContext;
+      gtl::InlinedVector<DeviceContext*, 4> input_dc({dev_ctx});
+      op_params.input_device_contexts = &input_dc;
+      op_params.op_device_context = dev_ctx;
+      int forward_from = 0;
+      op_params.forward_from_array = &forward_from;
+      AllocatorAttributes generic_alloc_attr;
+      op_params.output_attr_array = &generic_alloc_attr;
+      std::unique_ptr<OpKernel> op =
+          parent_->GetCollectiveReduce(col_params_, device_);
+      op_params.op_kernel = op.get();
+      OpKernelContext ctx(&op_params, 1);
+
+      // We never actually execute the kernel, so we need to do the
+      // output allocation that it would do, ourselves.
+      Tensor* output_tensor_ptr = nullptr;
+      TF_CHECK_OK(ctx.forward_input_or_allocate_output({0}, 0, tensor_.shape(),
+                                                       &output_tensor_ptr));
+      CHECK_EQ(output_tensor_ptr, ctx.mutable_output(0));
+
+      // Instantiate the implementation through the registry.
+      CollectiveRegistry::Factory factory;
+      TF_CHECK_OK(CollectiveRegistry::Lookup(
+          parent_->impl_name_, REDUCTION_COLLECTIVE, &factory));
+      string exec_key =
+          strings::StrCat(col_params_.instance.instance_key, ":0:0");
+      std::unique_ptr<CollectiveImplementationInterface> impl(factory(
+          parent_->col_exec_, parent_->dev_mgr_.get(), &ctx, &op_params,
+          col_params_, exec_key, kStepId, &tensor_, &tensor_));
+
+      // Start execution in a threadpool then wait for completion.
+      Notification notification;
+      SchedClosure([this, &notification, &impl]() {
+        impl->Run([this, &notification](Status s) {
+          status_ = s;
+          notification.Notify();
+        });
+      });
+      notification.WaitForNotification();
+      CHECK(tensor_.CopyFrom(*ctx.mutable_output(0), tensor_.shape()));
+
+      dev_ctx->Unref();
+    }
+
+    HalvingDoublingReducerTest* parent_;
+    Tensor tensor_;
+    Device* device_;
+    CollectiveParams col_params_;
+    Status status_;
+  };
+
+  bool stop_ = false;
+  string impl_name_;
+  TestCollectiveExecutorMgr col_exec_mgr_;
+  CollectiveExecutor* col_exec_ = nullptr;
+  CollectiveRemoteAccessLocal* rma_;
+  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
+  std::vector<DeviceInstance*> instances_;
+  CollectiveParams col_params_;
+  std::unique_ptr<tensorflow::DeviceMgr> dev_mgr_;
+  mutex mu_;
+  int32 reduce_counter_ GUARDED_BY(mu_) = 0;
+};
+
+#define DEF_TEST(I, B, W, D, L, A)                                     \
+  TEST_F(HalvingDoublingReducerTest,                                   \
+         I##_DaTy##B##_Wkr##W##_Dev##D##_Len##L##_Abrt##A) {           \
+    DataType dtype = DT_##B;                                           \
+    switch (dtype) {                                                   \
+      case DT_FLOAT: {                                                 \
+        RunTest<float>(#I "Reduce", dtype, W, D, L, A);                \
+      } break;                                                         \
+      case DT_DOUBLE: {                                                \
+        RunTest<double>(#I "Reduce", dtype, W, D, L, A);               \
+      } break;                                                         \
+      case DT_INT64: {                                                 \
+        RunTest<int64>(#I "Reduce", dtype, W, D, L, A);                \
+      } break;                                                         \
+      default:                                                         \
+        LOG(FATAL) << "Unimplemented";                                 \
+    }                                                                  \
+  }
+
+// Success tests, with power of two and other group sizes, and tensors
+// smaller than the group.
+DEF_TEST(HalvingDoubling, FLOAT, 1, 2, 1, 0)
+DEF_TEST(HalvingDoubling, FLOAT, 1, 3, 1, 0)
+DEF_TEST(HalvingDoubling, FLOAT, 1, 4, 1001, 0)
+DEF_TEST(HalvingDoubling, FLOAT, 1, 5, 4, 0)
+DEF_TEST(HalvingDoubling, FLOAT, 1, 7, 4096, 0)
+DEF_TEST(HalvingDoubling, FLOAT, 2, 8, 9408, 0)
+DEF_TEST(HalvingDoubling, DOUBLE, 3, 4, 1001, 0)
+DEF_TEST(HalvingDoubling, INT64, 2, 3, 4095, 0)
+DEF_TEST(Hierarchical, FLOAT, 1, 4, 1001, 0)
+DEF_TEST(Hierarchical, FLOAT, 2, 1, 16, 0)
+DEF_TEST(Hierarchical, FLOAT, 2, 8, 9408, 0)
+DEF_TEST(Hierarchical, FLOAT, 3, 4, 3, 0)
+DEF_TEST(Hierarchical, DOUBLE, 5, 2, 4096, 0)
+DEF_TEST(Hierarchical, INT64, 3, 3, 4095, 0)
+
+// Failure tests
+DEF_TEST(HalvingDoubling, FLOAT, 2, 8, 9408, 7)
+DEF_TEST(Hierarchical, FLOAT, 2, 8, 9408, 11)
+
+TEST(DefaultImplementationTest, Reduction) {
+  CollectiveParams cp;
+  cp.instance.type = REDUCTION_COLLECTIVE;
+  cp.instance.impl_details.subdiv_offsets = {0};
+  cp.group.device_type = DEVICE_CPU;
+  cp.group.group_size = 16;
+  cp.group.num_tasks = 1;
+  EXPECT_EQ("HalvingDoublingReduce",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 1024));
+  // Large tensors are bandwidth bound.
+  EXPECT_EQ("RingReduce",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 64 << 20));
+  cp.group.num_tasks = 2;
+  EXPECT_EQ("HierarchicalReduce",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 1024));
+  cp.group.num_tasks = 16;
+  EXPECT_EQ("HalvingDoublingReduce",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 1024));
+  // Features that only the ring implements.
+  cp.instance.compression = COMPRESSION_BFLOAT16;
+  EXPECT_EQ("RingReduce",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 1024));
+  cp.instance.compression = COMPRESSION_NONE;
+  cp.instance.impl_details.subdiv_offsets = {0, 4};
+  EXPECT_EQ("RingReduce",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 1024));
+  cp.instance.impl_details.subdiv_offsets = {0};
+  cp.group.device_type = DEVICE_GPU;
+  EXPECT_EQ("RingReduce",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 1024));
+}
+
+TEST(DefaultImplementationTest, OtherTypes) {
+  CollectiveParams cp;
+  cp.instance.type = BROADCAST_COLLECTIVE;
+  EXPECT_EQ("HierarchicalTreeBroadcast",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 1024));
+  cp.instance.type = GATHER_COLLECTIVE;
+  EXPECT_EQ("RingGather",
+            BaseCollectiveExecutor::DefaultImplementation(cp, 1024));
+}
+
+TEST(CollectiveRegistryTest, Lookup) {
+  CollectiveRegistry::Factory factory;
+  TF_EXPECT_OK(CollectiveRegistry::Lookup("HalvingDoublingReduce",
+                                          REDUCTION_COLLECTIVE, &factory));
+  TF_EXPECT_OK(CollectiveRegistry::Lookup("HierarchicalReduce",
+                                          REDUCTION_COLLECTIVE, &factory));
+  EXPECT_TRUE(errors::IsInvalidArgument(CollectiveRegistry::Lookup(
+      "HalvingDoublingReduce", BROADCAST_COLLECTIVE, &factory)));
+  EXPECT_TRUE(errors::IsNotFound(
+      CollectiveRegistry::Lookup("NoSuchReduce", REDUCTION_COLLECTIVE,
+                                 &factory)));
+}
+
+// Benchmarks the latency of the all-reduce of small tensors on 2 tasks of 8
+// devices, which exchange their values through CollectiveRemoteAccessLocal.
+class HalvingDoublingReducerBenchmark : public HalvingDoublingReducerTest {
+ public:
+  void TestBody() override {}
+
+  void Run(int iters, const string& impl_name, int tensor_len) {
+    testing::StopTiming();
+    Init(impl_name, 2, 8, DT_FLOAT, 0);
+    for (DeviceInstance* instance : instances_) {
+      instance->InitTensor(DT_FLOAT, TensorShape({tensor_len}), [](Tensor* t) {
+        for (int i = 0; i < t->NumElements(); ++i) {
+          t->flat<float>()(i) = i;
+        }
+      });
+    }
+    testing::StartTiming();
+    for (int i = 0; i < iters; ++i) {
+      Reduce();
+    }
+    testing::StopTiming();
+    testing::ItemsProcessed(static_cast<int64>(iters));
+  }
+};
+
+static void BM_RingReduceLatency(int iters, int tensor_len) {
+  HalvingDoublingReducerBenchmark benchmark;
+  benchmark.Run(iters, "RingReduce", tensor_len);
+}
+BENCHMARK(BM_RingReduceLatency)->Arg(1)->Arg(256)->Arg(4096)->Arg(65536);
+
+static void BM_HalvingDoublingReduceLatency(int iters, int tensor_len) {
+  HalvingDoublingReducerBenchmark benchmark;
+  benchmark.Run(iters, "HalvingDoublingReduce", tensor_len);
+}
+BENCHMARK(BM_HalvingDoublingReduceLatency)
+    ->Arg(1)
+    ->Arg(256)
+    ->Arg(4096)
+    ->Arg(65536);
+
+static void BM_HierarchicalReduceLatency(int iters, int tensor_len) {
+  HalvingDoublingReducerBenchmark benchmark;
+  benchmark.Run(iters, "HierarchicalReduce", tensor_len);
+}
+BENCHMARK(BM_HierarchicalReduceLatency)
+    ->Arg(1)
+    ->Arg(256)
+    ->Arg(4096)
+    ->Arg(65536);
+
+}  // namespace
+}  // namespace tensorflow
@@ -54,6 +54,9 @@ ProcessState::~ProcessState() {
   for (Allocator* a : cpu_allocators_) {
     delete a;
   }
+  for (Allocator* a : numa_allocators_) {
+    delete a;
+  }
 }
 
 string ProcessState::MemDesc::DebugString() {
@@ -95,9 +98,16 @@ VisitableAllocator* ProcessState::GetCPUAllocator(int numa_node) {
         LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
       }
       int64 cpu_mem_limit = cpu_mem_limit_in_mb * (1LL << 20);
+      bool use_chunk_cache = false;
+      status = ReadBoolFromEnvVar("TF_CPU_BFC_USE_CHUNK_CACHE", false,
+                                  &use_chunk_cache);
+      if (!status.ok()) {
+        LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+      }
       allocator = new BFCAllocator(
           new BasicCPUAllocator(numa_enabled_ ? numa_node : -1), cpu_mem_limit,
-          true /*allow_growth*/, "bfc_cpu_allocator_for_gpu" /*name*/);
+          true /*allow_growth*/, "bfc_cpu_allocator_for_gpu" /*name*/,
+          use_chunk_cache);
       VLOG(2) << "Using BFCAllocator with memory limit of "
               << cpu_mem_limit_in_mb << " MB for ProcessState CPU allocator";
     } else {
@@ -119,10 +129,41 @@ VisitableAllocator* ProcessState::GetCPUAllocator(int numa_node) {
   return cpu_allocators_[numa_node];
 }
 
+VisitableAllocator* ProcessState::GetNUMAAllocator(int numa_node) {
+  CHECK_GE(numa_node, 0);
+  mutex_lock lock(mu_);
+  while (numa_allocators_.size() <= static_cast<size_t>(numa_node)) {
+    const int node = numa_allocators_.size();
+    int64 cpu_mem_limit_in_mb = -1;
+    Status status = ReadInt64FromEnvVar("TF_CPU_BFC_MEM_LIMIT_IN_MB",
+                                        1LL << 16 /*64GB max by default*/,
+                                        &cpu_mem_limit_in_mb);
+    if (!status.ok()) {
+      LOG(ERROR) << "GetNUMAAllocator: " << status.error_message();
+    }
+    // The BFCAllocator grows its regions geometrically, so only a few
+    // allocations pay for the mmap and mbind of port::NUMAMalloc.
+    VisitableAllocator* allocator = new BFCAllocator(
+        new BasicCPUAllocator(node), cpu_mem_limit_in_mb * (1LL << 20),
+        true /*allow_growth*/,
+        strings::StrCat("numa_", node, "_bfc_cpu_allocator") /*name*/);
+    VLOG(2) << "Using BFCAllocator with memory limit of "
+            << cpu_mem_limit_in_mb << " MB for NUMA node " << node;
+    if (LogMemory::IsEnabled()) {
+      // Wrap the allocator to track allocation ids for better logging
+      // at the cost of performance.
+      allocator = new TrackingVisitableAllocator(allocator, true);
+    }
+    numa_allocators_.push_back(allocator);
+  }
+  return numa_allocators_[numa_node];
+}
+
 void ProcessState::TestOnlyReset() {
   mutex_lock lock(mu_);
   mem_desc_map_.clear();
   gtl::STLDeleteElements(&cpu_allocators_);
+  gtl::STLDeleteElements(&numa_allocators_);
   gtl::STLDeleteElements(&cpu_al_);
 }
 
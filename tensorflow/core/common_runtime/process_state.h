@@ -63,10 +63,16 @@ class ProcessState {
   // If we know nothing, it's called CPU 0 with no other attributes.
   MemDesc PtrType(const void* ptr);
 
-  // Returns the one CPUAllocator used for the given numa_node.
-  // TEMPORARY: ignores numa_node.
+  // Returns the one CPUAllocator used for the given numa_node. Unless
+  // EnableNUMA() has been called, all nodes share the allocator for node 0.
   VisitableAllocator* GetCPUAllocator(int numa_node);
 
+  // Returns the one allocator whose memory is bound to the given numa_node,
+  // whether or not EnableNUMA() has been called. It carves allocations out of
+  // large regions obtained from the node, rather than mapping and binding
+  // memory for each allocation.
+  VisitableAllocator* GetNUMAAllocator(int numa_node);
+
   typedef std::unordered_map<const void*, MemDesc> MDMap;
 
  protected:
@@ -88,6 +94,7 @@ class ProcessState {
   mutex mu_;
 
   std::vector<VisitableAllocator*> cpu_allocators_ GUARDED_BY(mu_);
+  std::vector<VisitableAllocator*> numa_allocators_ GUARDED_BY(mu_);
 
   virtual ~ProcessState();
 
@@ -0,0 +1,152 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/ring_gatherer.h"
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+
+// Set true for greater intelligibility of debug mode log messages.
+#define READABLE_KEYS false
+
+namespace tensorflow {
+namespace {
+// Key to be used for BufRendezvous by RingGatherer.
+string RingGatherBufKey(const string& exec_key, int block_rank,
+                        int src_rank) {
+  if (READABLE_KEYS) {
+    return strings::StrCat("rgather(", exec_key, "):block(", block_rank,
+                           "):src(", src_rank, ")");
+  } else {
+    return strings::StrCat(exec_key, ":", block_rank, ":", src_rank);
+  }
+}
+}  // namespace
+
+RingGatherer::RingGatherer(CollectiveExecutor* col_exec,
+                           const DeviceMgr* dev_mgr, OpKernelContext* ctx,
+                           OpKernelContext::Params* op_params,
+                           const CollectiveParams& col_params,
+                           const string& exec_key, int64 step_id,
+                           const Tensor* input, Tensor* output)
+    : col_exec_(col_exec),
+      dev_mgr_(dev_mgr),
+      ctx_(ctx),
+      col_params_(col_params),
+      exec_key_(exec_key),
+      input_(input),
+      output_(output),
+      rank_(col_params.default_rank),
+      group_size_(col_params.group.group_size),
+      device_(nullptr) {
+  CHECK_GT(group_size_, 0);
+}
+
+void RingGatherer::Run(StatusCallback done) {
+  Status status = dev_mgr_->LookupDevice(
+      col_params_.instance.device_names[rank_], &device_);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  CHECK(device_);
+  device_locality_ = device_->attributes().locality();
+  if (input_->dims() < 1 ||
+      output_->dim_size(0) != input_->dim_size(0) * group_size_) {
+    done(errors::Internal("Output shape ", output_->shape().DebugString(),
+                          " of ", col_params_.name,
+                          " does not concatenate ", group_size_,
+                          " inputs of shape ", input_->shape().DebugString()));
+    return;
+  }
+
+  // Start by copying the input to its own block of the output.  We are
+  // running in a blockable thread and the callback can't block so just wait
+  // here on the copy.
+  Tensor own_block = Block(rank_);
+  Notification note;
+  CollectiveRemoteAccessLocal::MemCpyAsync(
+      ctx_->input_device_context(0), ctx_->op_device_context(), device_,
+      device_, ctx_->input_alloc_attr(0), ctx_->output_alloc_attr(0), input_,
+      &own_block, 0 /*dev_to_dev_stream_index*/,
+      [&note, &status](const Status& s) {
+        status.Update(s);
+        note.Notify();
+      });
+  note.WaitForNotification();
+
+  // In step s, the block of rank_ - s moves from rank_ to rank_ + 1.
+  for (int step = 0; status.ok() && step < group_size_ - 1; ++step) {
+    status = RunStep((rank_ - step + group_size_) % group_size_,
+                     (rank_ - step - 1 + group_size_) % group_size_);
+  }
+  if (!status.ok()) {
+    // Peers may be waiting for blocks from this device that will never
+    // arrive.
+    col_exec_->StartAbort(status);
+  }
+  done(status);
+}
+
+Status RingGatherer::RunStep(int send_rank, int recv_rank) {
+  const int next = (rank_ + 1) % group_size_;
+  const int prev = (rank_ + group_size_ - 1) % group_size_;
+  Tensor send_block = Block(send_rank);
+  Tensor recv_block = Block(recv_rank);
+  BlockingCounter pending(2);
+  mutex mu;
+  Status status;
+  auto done = [&pending, &mu, &status](const Status& s) {
+    {
+      mutex_lock l(mu);
+      status.Update(s);
+    }
+    pending.DecrementCount();
+  };
+  col_exec_->PostToPeer(col_params_.instance.device_names[next],
+                        col_params_.instance.task_names[next],
+                        RingGatherBufKey(exec_key_, send_rank, rank_), device_,
+                        ctx_->op_device_context(), ctx_->output_alloc_attr(0),
+                        &send_block, device_locality_, done);
+  col_exec_->RecvFromPeer(col_params_.instance.device_names[prev],
+                          col_params_.instance.task_names[prev],
+                          col_params_.task.is_local[prev],
+                          RingGatherBufKey(exec_key_, recv_rank, prev),
+                          device_, ctx_->op_device_context(),
+                          ctx_->output_alloc_attr(0), &recv_block,
+                          device_locality_, 0 /*stream_index*/, done);
+  pending.Wait();
+  mutex_lock l(mu);
+  return status;
+}
+
+Tensor RingGatherer::Block(int rank) {
+  const int64 block_rows = input_->dim_size(0);
+  return output_->Slice(rank * block_rows, (rank + 1) * block_rows);
+}
+
+REGISTER_COLLECTIVE(
+    "RingGather", GATHER_COLLECTIVE,
+    [](CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+       OpKernelContext* ctx, OpKernelContext::Params* params,
+       const CollectiveParams& col_params, const string& exec_key,
+       int64 step_id, const Tensor* input, Tensor* output) {
+      return new RingGatherer(col_exec, dev_mgr, ctx, params, col_params,
+                              exec_key, step_id, input, output);
+    });
+
+}  // namespace tensorflow
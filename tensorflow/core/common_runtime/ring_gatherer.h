@@ -0,0 +1,63 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_RING_GATHERER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_RING_GATHERER_H_
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+
+namespace tensorflow {
+class DeviceMgr;
+
+// Ring-algorithm implementation of collective all-gather, registered as
+// "RingGather".
+//
+// The output is the concatenation along the first dimension of the inputs
+// of all devices, in default rank order.  In each of group_size - 1 steps,
+// every device passes the last block it got on to the next device in the
+// ring.
+class RingGatherer : public CollectiveImplementationInterface {
+ public:
+  RingGatherer(CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+               OpKernelContext* ctx, OpKernelContext::Params* op_params,
+               const CollectiveParams& col_params, const string& exec_key,
+               int64 step_id, const Tensor* input, Tensor* output);
+
+  void Run(StatusCallback done) override;
+
+ private:
+  // Sends the block of `send_rank` to the next device and receives the
+  // block of `recv_rank` from the previous one, then waits for both.
+  Status RunStep(int send_rank, int recv_rank);
+  // Returns an alias of the block of the output of the device of default
+  // rank `rank`.
+  Tensor Block(int rank);
+
+  CollectiveExecutor* col_exec_;  // Not owned
+  const DeviceMgr* dev_mgr_;      // Not owned
+  OpKernelContext* ctx_;          // Not owned
+  const CollectiveParams& col_params_;
+  const string exec_key_;
+  const Tensor* input_;  // Not owned
+  Tensor* output_;       // Not owned
+  const int rank_;
+  const int group_size_;
+  Device* device_;  // The device for which this instance labors
+  DeviceLocality device_locality_;
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_RING_GATHERER_H_
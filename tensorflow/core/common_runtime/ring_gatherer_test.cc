@@ -0,0 +1,271 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/ring_gatherer.h"
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/device_resolver_local.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
+#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+static int64 kStepId = 123;
+
+class RingGathererTest : public ::testing::Test {
+ protected:
+  ~RingGathererTest() override {
+    stop_ = true;
+    for (auto i : instances_) {
+      delete i;
+    }
+    if (col_exec_) col_exec_->Unref();
+  }
+
+  void Init(int num_workers, int num_devices, DataType dtype) {
+    std::vector<Device*> local_devices;
+    SessionOptions sess_opts;
+    sess_opts.env = Env::Default();
+    Bytes mem_limit(4 << 20);
+    DeviceLocality dev_locality;
+    for (int wi = 0; wi < num_workers; ++wi) {
+      for (int di = 0; di < num_devices; ++di) {
+        string dev_name =
+            strings::StrCat("/job:worker/replica:0/task:", wi, "/cpu:", di);
+        local_devices.push_back(new ThreadPoolDevice(
+            sess_opts, dev_name, mem_limit, dev_locality, cpu_allocator()));
+      }
+    }
+    dev_mgr_.reset(new DeviceMgr(local_devices));
+    dev_resolver_.reset(new DeviceResolverLocal(dev_mgr_.get()));
+    rma_ = new CollectiveRemoteAccessLocal(dev_mgr_.get(), dev_resolver_.get(),
+                                           kStepId);
+    col_exec_ = new BaseCollectiveExecutor(&col_exec_mgr_, rma_, kStepId,
+                                           dev_mgr_.get());
+    col_params_.name = "test_collective";
+    col_params_.group.group_key = 5;
+    col_params_.group.device_type = DEVICE_CPU;
+    col_params_.group.group_size = num_workers * num_devices;
+    col_params_.group.num_tasks = num_workers;
+    col_params_.instance.instance_key = 17;
+    col_params_.instance.type = GATHER_COLLECTIVE;
+    col_params_.instance.data_type = dtype;
+    for (int wi = 0; wi < num_workers; ++wi) {
+      string task_name = strings::StrCat("/job:worker/replica:0/task:", wi);
+      for (int di = 0; di < num_devices; ++di) {
+        col_params_.instance.device_names.push_back(
+            strings::StrCat(task_name, "/cpu:", di));
+        col_params_.instance.task_names.push_back(task_name);
+        col_params_.task.is_local.push_back(true);
+      }
+    }
+    for (int rank = 0; rank < col_params_.group.group_size; ++rank) {
+      instances_.push_back(new DeviceInstance(rank, this));
+    }
+  }
+
+  void Gather() {
+    std::atomic<int> done(0);
+    for (auto di : instances_) {
+      SchedClosure([di, &done] {
+        di->DoGather();
+        ++done;
+      });
+    }
+    while (done < static_cast<int>(instances_.size())) {
+      if (stop_) break;
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+  }
+
+  // Gathers inputs of `shape` whose values are distinct across devices, and
+  // checks that every device gets all of them in rank order.
+  template <typename T>
+  void RunTest(DataType dtype, int num_workers, int num_devices,
+               const TensorShape& shape) {
+    Init(num_workers, num_devices, dtype);
+    const int64 num_elements = shape.num_elements();
+    const int group_size = static_cast<int>(instances_.size());
+    TensorShape expected_shape(shape);
+    expected_shape.set_dim(0, shape.dim_size(0) * group_size);
+    Tensor expected(dtype, expected_shape);
+    for (int di = 0; di < group_size; ++di) {
+      instances_[di]->InitTensor(
+          dtype, shape, [&expected, num_elements, di](Tensor* t) {
+            for (int64 i = 0; i < num_elements; ++i) {
+              T value = static_cast<T>(di * 1000 + i);
+              t->flat<T>()(i) = value;
+              expected.flat<T>()(di * num_elements + i) = value;
+            }
+          });
+    }
+    Gather();
+    for (int di = 0; di < group_size; ++di) {
+      TF_EXPECT_OK(instances_[di]->status_);
+      test::ExpectTensorEqual<T>(expected, instances_[di]->output_);
+    }
+  }
+
+  std::unique_ptr<OpKernel> GetCollectiveGather(const CollectiveParams& params,
+                                                DeviceBase* device) {
+    mutex_lock l(mu_);
+    NodeDef node_def;
+    NodeDefBuilder builder(
+        strings::StrCat("collective_gather_", gather_counter_++),
+        "CollectiveGather");
+    TF_CHECK_OK(builder.Attr("T", params.instance.data_type)
+                    .Attr("group_size", params.group.group_size)
+                    .Attr("group_key", params.group.group_key)
+                    .Attr("instance_key", params.instance.instance_key)
+                    .Input(FakeInput(params.instance.data_type))
+                    .Finalize(&node_def));
+    Status status;
+    std::unique_ptr<OpKernel> k = CreateOpKernel(
+        DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()),
+        node_def, TF_GRAPH_DEF_VERSION, &status);
+    TF_CHECK_OK(status);
+    return k;
+  }
+
+  class DeviceInstance {
+   public:
+    DeviceInstance(int rank, RingGathererTest* parent) : parent_(parent) {
+      col_params_.name = parent_->col_params_.name;
+      col_params_.group = parent_->col_params_.group;
+      col_params_.instance = parent_->col_params_.instance;
+      col_params_.task.is_local = parent_->col_params_.task.is_local;
+      col_params_.default_rank = rank;
+      const string& dev_name = col_params_.instance.device_names[rank];
+      TF_CHECK_OK(parent_->dev_mgr_->LookupDevice(dev_name, &device_))
+          << "Couldn't find device " << dev_name
+          << " existing devices: " << parent_->dev_mgr_->DebugString();
+    }
+
+    void InitTensor(DataType dtype, const TensorShape& shape,
+                    const std::function<void(Tensor*)>& init_f) {
+      input_ =
+          Tensor(device_->GetAllocator(AllocatorAttributes()), dtype, shape);
+      init_f(&input_);
+    }
+
+    void DoGather() {
+      // Prepare an OpKernelContext.
+      OpKernelContext::Params op_params;
+      op_params.step_id = kStepId;
+      op_params.device = device_;
+      gtl::InlinedVector<TensorValue, 4> inputs;
+      inputs.push_back(TensorValue(&input_));
+      op_params.inputs = &inputs;
+      gtl::InlinedVector<AllocatorAttributes, 4> input_aa(
+          {AllocatorAttributes()});
+      op_params.input_alloc_attrs = &input_aa;
+      DeviceContext* dev_ctx = new DeviceContext;
+      gtl::InlinedVector<DeviceContext*, 4> input_dc({dev_ctx});
+      op_params.input_device_contexts = &input_dc;
+      op_params.op_device_context = dev_ctx;
+      AllocatorAttributes generic_alloc_attr;
+      op_params.output_attr_array = &generic_alloc_attr;
+      std::unique_ptr<OpKernel> op =
+          parent_->GetCollectiveGather(col_params_, device_);
+      op_params.op_kernel = op.get();
+      OpKernelContext ctx(&op_params, 1);
+
+      // We never actually execute the kernel, so we need to do the
+      // output allocation that it would do, ourselves.
+      TensorShape output_shape(input_.shape());
+      output_shape.set_dim(
+          0, input_.dim_size(0) * col_params_.group.group_size);
+      Tensor* output_tensor_ptr = nullptr;
+      TF_CHECK_OK(ctx.allocate_output(0, output_shape, &output_tensor_ptr));
+
+      // Prepare a RingGatherer instance.
+      string exec_key =
+          strings::StrCat(col_params_.instance.instance_key, ":0:0");
+      RingGatherer gatherer(parent_->col_exec_, parent_->dev_mgr_.get(), &ctx,
+                            &op_params, col_params_, exec_key, kStepId,
+                            &input_, output_tensor_ptr);
+
+      // Start execution in a threadpool then wait for completion.
+      Notification notification;
+      SchedClosure([this, &notification, &gatherer]() {
+        gatherer.Run([this, &notification](Status s) {
+          status_ = s;
+          notification.Notify();
+        });
+      });
+      notification.WaitForNotification();
+      output_ = *output_tensor_ptr;
+
+      dev_ctx->Unref();
+    }
+
+    RingGathererTest* parent_;
+    Tensor input_;
+    Tensor output_;
+    Device* device_;
+    CollectiveParams col_params_;
+    Status status_;
+  };
+
+  bool stop_ = false;
+  TestCollectiveExecutorMgr col_exec_mgr_;
+  CollectiveExecutor* col_exec_ = nullptr;
+  CollectiveRemoteAccessLocal* rma_;
+  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
+  std::vector<DeviceInstance*> instances_;
+  CollectiveParams col_params_;
+  std::unique_ptr<tensorflow::DeviceMgr> dev_mgr_;
+  mutex mu_;
+  int32 gather_counter_ GUARDED_BY(mu_) = 0;
+};
+
+TEST_F(RingGathererTest, Float_Dev2_Len1) {
+  RunTest<float>(DT_FLOAT, 1, 2, TensorShape({1}));
+}
+
+TEST_F(RingGathererTest, Float_Dev3_Len1001) {
+  RunTest<float>(DT_FLOAT, 1, 3, TensorShape({1001}));
+}
+
+TEST_F(RingGathererTest, Float_Wkr2_Dev8_Matrix) {
+  RunTest<float>(DT_FLOAT, 2, 8, TensorShape({3, 5}));
+}
+
+TEST_F(RingGathererTest, Double_Wkr2_Dev4_Len4096) {
+  RunTest<double>(DT_DOUBLE, 2, 4, TensorShape({4096}));
+}
+
+TEST_F(RingGathererTest, Int64_Wkr3_Dev2_Rank3) {
+  RunTest<int64>(DT_INT64, 3, 2, TensorShape({2, 3, 4}));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/ring_reducer.h"
 
+#include "tensorflow/core/common_runtime/collective_compression.h"
 #include "tensorflow/core/common_runtime/collective_rma_local.h"
 #include "tensorflow/core/common_runtime/copy_tensor.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
@@ -84,6 +85,7 @@ RingReducer::RingReducer(CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
       group_size_(col_params.group.group_size),
       num_subdivs_(static_cast<int>(
           col_params.instance.impl_details.subdiv_permutations.size())),
+      compress_(col_params.instance.compression != COMPRESSION_NONE),
       done_(nullptr),
       device_(nullptr),
       device_name_(
@@ -149,6 +151,13 @@ void RingReducer::Run(StatusCallback done) {
   }
   CHECK(device_);
   device_locality_ = device_->attributes().locality();
+  if (compress_) {
+    status = collective_compression::ValidateCompression(col_params_);
+    if (!status.ok()) {
+      done_(status);
+      return;
+    }
+  }
 
   VLOG(1) << this << " default_rank " << col_params_.default_rank << " cp "
           << &col_params_ << ": " << col_params_.ToString();
@@ -249,37 +258,6 @@ void RingReducer::Finish(bool ok) {
   done_(s);
 }
 
-RingReducer::SubContext::SubContext(OpKernelContext* ctx,
-                                    OpKernelContext::Params* params,
-                                    OpKernel* op, Tensor* output, Tensor* input)
-    : sub_params_(*params),
-      sub_inputs_({output, input}),
-      sub_input_attr_({ctx->input_alloc_attr(0), ctx->input_alloc_attr(0)}),
-      sub_input_dc_(
-          {ctx->input_device_context(0), ctx->input_device_context(0)}) {
-  sub_params_.op_kernel = op;
-  sub_params_.inputs = &sub_inputs_;
-  sub_params_.input_alloc_attrs = &sub_input_attr_;
-  sub_params_.input_device_contexts = &sub_input_dc_;
-  sub_params_.eigen_gpu_device = nullptr;
-  sub_params_.ensure_eigen_gpu_device();
-  sub_params_.forward_from_array = &forward_from_;
-  sub_ctx_ = new OpKernelContext(&sub_params_, 1);
-}
-
-Status RingReducer::ComputeBinOp(Device* device, OpKernel* op, Tensor* output,
-                                 Tensor* input) {
-  // Prepare an OpKernelContext that is identical to that of the original Op
-  // (i.e. the collective), except for the input output sizes and identities and
-  // the Op itself.
-  // TODO(tucker): Is it possible to cache and reuse these objects?  They're
-  // mostly identical inside one device execution.
-  std::unique_ptr<SubContext> sub_ctx(
-      new SubContext(ctx_, op_params_, op, output, input));
-  device->Compute(op, sub_ctx->sub_ctx_);
-  return sub_ctx->sub_ctx_->status();
-}
-
 // At the beginning of the algorithm initialize a RingField struct for
 // every independent field of the tensor.
 void RingReducer::InitRingField(RingField* rf, int chunk_idx, int subdiv_idx,
@@ -319,6 +297,15 @@ void RingReducer::InitRingField(RingField* rf, int chunk_idx, int subdiv_idx,
   if (rf->do_send || rf->do_recv) {
     rf->chunk = ca_->ChunkAlias(rf->sc_idx);
     CHECK(rf->chunk.IsAligned()) << rf->DebugString();
+    if (compress_) {
+      // Both passes exchange wires of the same size.
+      Allocator* allocator =
+          device_->GetAllocator(ctx_->output_alloc_attr(0));
+      rf->send_wire = collective_compression::AllocateWire(
+          allocator, col_params_.instance, rf->chunk.NumElements());
+      rf->recv_wire = collective_compression::AllocateWire(
+          allocator, col_params_.instance, rf->chunk.NumElements());
+    }
   }
   if (rf->do_recv) {
     rf->tmp_chunk = ca_->TempChunk(rf->sc_idx);
@@ -368,10 +355,15 @@ void RingReducer::DispatchSend(RingField* rf, const StatusCallback& done) {
   int send_to_rank = (rf->rank + 1) % group_size_;
   int send_to_dev_idx = col_params_.instance.impl_details
                             .subdiv_permutations[rf->subdiv_idx][send_to_rank];
+  const Tensor* src_tensor = &rf->chunk;
+  if (compress_) {
+    src_tensor =
+        (rf->second_pass && rf->do_recv) ? &rf->recv_wire : &rf->send_wire;
+  }
   col_exec_->PostToPeer(col_params_.instance.device_names[send_to_dev_idx],
                         col_params_.instance.task_names[send_to_dev_idx],
                         send_buf_key, device_, ctx_->op_device_context(),
-                        ctx_->output_alloc_attr(0), &rf->chunk,
+                        ctx_->output_alloc_attr(0), src_tensor,
                         device_locality_, done);
 }
 
@@ -386,6 +378,7 @@ void RingReducer::DispatchRecv(RingField* rf, const StatusCallback& done) {
   Tensor* dst_tensor = (!rf->second_pass && (col_params_.merge_op != nullptr))
                            ? &rf->tmp_chunk
                            : &rf->chunk;
+  if (compress_) dst_tensor = &rf->recv_wire;
   col_exec_->RecvFromPeer(col_params_.instance.device_names[rf->recv_dev_idx],
                           col_params_.instance.task_names[rf->recv_dev_idx],
                           col_params_.task.is_local[rf->recv_dev_idx],
@@ -394,6 +387,27 @@ void RingReducer::DispatchRecv(RingField* rf, const StatusCallback& done) {
                           device_locality_, rf->subdiv_idx, done);
 }
 
+void RingReducer::CompressForSend(RingField* rf) {
+  // In the second pass a received chunk is already final, and its wire is
+  // sent on as is.
+  if (rf->second_pass && rf->do_recv) return;
+  Tensor residual;
+  if (col_params_.instance.compression == COMPRESSION_TOPK) {
+    // The residual outlives this execution, and belongs to the op's
+    // CollectiveParams and the chunk this field sends in its pass.
+    residual = col_params_.residuals->Get(2 * rf->sc_idx + rf->second_pass,
+                                          rf->chunk.NumElements());
+  }
+  collective_compression::Compress(col_params_.instance, rf->chunk, &residual,
+                                   &rf->send_wire);
+  if (rf->second_pass) {
+    // This device finished the reduction of the chunk: it keeps the value
+    // that the other devices will decode, so that all of them agree.
+    collective_compression::Decompress(col_params_.instance, rf->send_wire,
+                                       &rf->chunk);
+  }
+}
+
 string RingReducer::FieldState() {
   string s = strings::StrCat("RingReducer ",
                              strings::Hex(reinterpret_cast<uint64>(this)),
@@ -466,10 +480,18 @@ bool RingReducer::RunAsyncParts() {
         case RF_RECV:
           CHECK_GT(recv_pending_count, 0);
           --recv_pending_count;
+          if (compress_) {
+            collective_compression::Decompress(
+                col_params_.instance, rf->recv_wire,
+                (!rf->second_pass && (col_params_.merge_op != nullptr))
+                    ? &rf->tmp_chunk
+                    : &rf->chunk);
+          }
           if (!rf->second_pass) {
             rf->action = RF_REDUCE;
-            Status s = ComputeBinOp(device_, col_params_.merge_op.get(),
-                                    &rf->chunk, &rf->tmp_chunk);
+            Status s = ComputeBinOp(ctx_, op_params_, device_,
+                                    col_params_.merge_op.get(), &rf->chunk,
+                                    &rf->tmp_chunk);
             if (!s.ok()) {
               aborted = true;
               StartAbort(s);
@@ -482,8 +504,9 @@ bool RingReducer::RunAsyncParts() {
           if (!rf->second_pass && col_params_.final_op.get() && rf->is_final) {
             rf->action = RF_FINALIZE;
             group_size_tensor_ready_.WaitForNotification();
-            Status s = ComputeBinOp(device_, col_params_.final_op.get(),
-                                    &rf->chunk, &group_size_tensor_);
+            Status s = ComputeBinOp(ctx_, op_params_, device_,
+                                    col_params_.final_op.get(), &rf->chunk,
+                                    &group_size_tensor_);
             if (!s.ok()) {
               aborted = true;
               StartAbort(s);
@@ -497,6 +520,7 @@ bool RingReducer::RunAsyncParts() {
           break;
         case RF_SEND_READY:
           if (rf->do_send) {
+            if (compress_) CompressForSend(rf);
             rf->action = RF_SEND;
             auto send_complete = [this, rf, &ready_queue, &aborted](Status s) {
               if (!s.ok()) {
@@ -557,4 +581,14 @@ bool RingReducer::RunAsyncParts() {
   return !aborted;
 }
 
+REGISTER_COLLECTIVE(
+    "RingReduce", REDUCTION_COLLECTIVE,
+    [](CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+       OpKernelContext* ctx, OpKernelContext::Params* params,
+       const CollectiveParams& col_params, const string& exec_key,
+       int64 step_id, const Tensor* input, Tensor* output) {
+      return new RingReducer(col_exec, dev_mgr, ctx, params, col_params,
+                             exec_key, step_id, input, output);
+    });
+
 }  // namespace tensorflow
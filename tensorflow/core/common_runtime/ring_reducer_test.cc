@@ -30,9 +30,11 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/public/version.h"
 
@@ -351,6 +353,53 @@ class RingReducerTest : public ::testing::Test {
     }
   }
 
+  // Reduces the float values of `value_f(device, index)` `num_steps` times
+  // with `compression`, and checks that every device computes the same
+  // results. Returns, for each step, the largest difference from the exact
+  // mean reduction of the mean of the results up to that step.
+  std::vector<float> RunCompressionTest(
+      CollectiveCompression compression, float topk_fraction, int instance_key,
+      int num_workers, int num_devices, int num_subdivs, int tensor_len,
+      int num_steps, const std::function<float(int, int)>& value_f) {
+    Init(num_workers, num_devices, DT_FLOAT, DEVICE_CPU, num_subdivs, 0);
+    std::vector<double> expected(tensor_len, 0.0);
+    std::vector<double> sum(tensor_len, 0.0);
+    std::vector<float> errors;
+    for (int step = 0; step < num_steps; ++step) {
+      for (int di = 0; di < static_cast<int>(instances_.size()); ++di) {
+        DeviceInstance* instance = instances_[di];
+        instance->col_params_.instance.instance_key = instance_key;
+        instance->col_params_.instance.compression = compression;
+        instance->col_params_.instance.topk_fraction = topk_fraction;
+        if (step == 0) {
+          instance->col_params_.residuals.reset(new CollectiveResiduals);
+        }
+        instance->InitTensor(DT_FLOAT, TensorShape({tensor_len}),
+                             [&expected, &value_f, step, di](Tensor* t) {
+                               for (int i = 0; i < t->NumElements(); ++i) {
+                                 t->flat<float>()(i) = value_f(di, i);
+                                 if (step == 0) expected[i] += value_f(di, i);
+                               }
+                             });
+      }
+      Reduce();
+      for (int di = 0; di < static_cast<int>(instances_.size()); ++di) {
+        TF_EXPECT_OK(instances_[di]->status_);
+        test::ExpectTensorEqual<float>(instances_[0]->tensor_,
+                                       instances_[di]->tensor_);
+      }
+      float max_error = 0;
+      for (int i = 0; i < tensor_len; ++i) {
+        sum[i] += instances_[0]->tensor_.flat<float>()(i);
+        const double mean = expected[i] / (num_workers * num_devices);
+        const double error = std::abs(sum[i] / (step + 1) - mean);
+        max_error = std::max(max_error, static_cast<float>(error));
+      }
+      errors.push_back(max_error);
+    }
+    return errors;
+  }
+
   std::unique_ptr<OpKernel> GetCollectiveReduce(const CollectiveParams& params,
                                                 Tensor* input,
                                                 const DeviceType& device_type,
@@ -577,8 +626,105 @@ DEF_TEST(INT64, CPU, 2, 8, 3, 4095, 0)
 // Failure tests
 DEF_TEST(FLOAT, CPU, 2, 8, 1, 9408, 7)
 DEF_TEST(FLOAT, CPU, 2, 8, 2, 9408, 11)
+
+// Compression tests
+float SmoothValue(int di, int i) { return 1 + di + std::sin(i); }
+
+TEST_F(RingReducerTest, CompressBfloat16) {
+  // Each of the 15 partial sums of the first pass and the final mean is
+  // rounded to 8 significant bits.
+  EXPECT_LT(RunCompressionTest(COMPRESSION_BFLOAT16, 0, 101, 2, 8, 2, 4095, 1,
+                               SmoothValue)[0],
+            17 * 18.0 / 256);
+}
+
+TEST_F(RingReducerTest, CompressFloat16) {
+  EXPECT_LT(RunCompressionTest(COMPRESSION_FLOAT16, 0, 102, 2, 8, 2, 4095, 1,
+                               SmoothValue)[0],
+            17 * 18.0 / 2048);
+}
+
+TEST_F(RingReducerTest, CompressTopKOfEverythingIsExact) {
+  EXPECT_LT(RunCompressionTest(COMPRESSION_TOPK, 1.0, 103, 2, 4, 1, 1001, 1,
+                               SmoothValue)[0],
+            1e-5);
+}
+
+TEST_F(RingReducerTest, CompressTopKOfSparseValuesIsExact) {
+  // Fewer than a tenth of the values of each chunk are nonzero.
+  EXPECT_LT(RunCompressionTest(COMPRESSION_TOPK, 0.1, 104, 2, 4, 3, 4095, 1,
+                               [](int di, int i) {
+                                 return i % 16 == 0 ? SmoothValue(di, i) : 0;
+                               })[0],
+            1e-5);
+}
+
+TEST_F(RingReducerTest, CompressTopKFeedsBackErrors) {
+  // Values that are not sent in one step are sent in later ones, so the mean
+  // of the results approaches the exact mean.
+  std::vector<float> errors = RunCompressionTest(
+      COMPRESSION_TOPK, 0.1, 105, 1, 4, 1, 1001, 100, SmoothValue);
+  EXPECT_GT(errors.front(), 1);
+  EXPECT_LT(errors.back(), errors.front() / 10);
+}
+
+TEST_F(RingReducerTest, CompressTopKOfNothingFails) {
+  Init(1, 2, DT_FLOAT, DEVICE_CPU, 1, 0);
+  for (DeviceInstance* instance : instances_) {
+    instance->col_params_.instance.compression = COMPRESSION_TOPK;
+    instance->col_params_.instance.topk_fraction = 0;
+    instance->col_params_.residuals.reset(new CollectiveResiduals);
+    instance->InitTensor(DT_FLOAT, TensorShape({16}), [](Tensor* t) {
+      t->flat<float>().setZero();
+    });
+  }
+  Reduce();
+  for (DeviceInstance* instance : instances_) {
+    EXPECT_TRUE(errors::IsInvalidArgument(instance->status_));
+  }
+}
 #endif
 
+// Benchmarks an 8 device ring that exchanges its chunks through
+// CollectiveRemoteAccessLocal, with each compression.
+class RingReducerBenchmark : public RingReducerTest {
+ public:
+  void TestBody() override {}
+
+  void Run(int iters, CollectiveCompression compression, int tensor_len) {
+    testing::StopTiming();
+    Init(1, 8, DT_FLOAT, DEVICE_CPU, 1, 0);
+    for (DeviceInstance* instance : instances_) {
+      instance->col_params_.instance.instance_key = 200 + compression;
+      instance->col_params_.instance.compression = compression;
+      instance->col_params_.residuals.reset(new CollectiveResiduals);
+      instance->InitTensor(DT_FLOAT, TensorShape({tensor_len}), [](Tensor* t) {
+        for (int i = 0; i < t->NumElements(); ++i) {
+          t->flat<float>()(i) = std::sin(i);
+        }
+      });
+    }
+    testing::StartTiming();
+    for (int i = 0; i < iters; ++i) {
+      Reduce();
+    }
+    testing::StopTiming();
+    testing::BytesProcessed(static_cast<int64>(iters) * instances_.size() *
+                            tensor_len * sizeof(float));
+  }
+};
+
+static void BM_RingReduce(int iters, int compression) {
+  RingReducerBenchmark benchmark;
+  benchmark.Run(iters, static_cast<CollectiveCompression>(compression),
+                1 << 20);
+}
+BENCHMARK(BM_RingReduce)
+    ->Arg(COMPRESSION_NONE)
+    ->Arg(COMPRESSION_BFLOAT16)
+    ->Arg(COMPRESSION_FLOAT16)
+    ->Arg(COMPRESSION_TOPK);
+
 #ifdef GOOGLE_CUDA
 // GPU tests.  So long as the device names are all in a single tasks we
 // bypass inter-worker routing code and can fake multiple GPUs with a single
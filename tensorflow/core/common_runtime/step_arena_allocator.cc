@@ -0,0 +1,160 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+StepArenaAllocator::StepArenaAllocator(Allocator* base, size_t arena_bytes,
+                                       size_t max_arena_allocation)
+    : base_(base),
+      max_arena_allocation_(max_arena_allocation),
+      arena_(arena_bytes) {
+  // Larger requests would make core::Arena allocate a dedicated block.
+  CHECK_LE(max_arena_allocation, arena_bytes / 4);
+}
+
+StepArenaAllocator::~StepArenaAllocator() {}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  if (num_bytes > 0 && num_bytes <= max_arena_allocation_) {
+    mutex_lock l(mu_);
+    if (in_step_) {
+      char* ptr = arena_.TryAllocAligned(num_bytes, alignment);
+      if (ptr != nullptr) {
+        if (arena_begin_ == nullptr || ptr < arena_begin_) arena_begin_ = ptr;
+        arena_end_ = std::max<const char*>(arena_end_, ptr + num_bytes);
+        ++num_arena_live_;
+        ++num_live_;
+        return ptr;
+      }
+    }
+  }
+  void* ptr = base_->AllocateRaw(alignment, num_bytes);
+  if (ptr != nullptr) {
+    mutex_lock l(mu_);
+    ++num_live_;
+  }
+  return ptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  bool in_arena;
+  bool delete_this;
+  {
+    mutex_lock l(mu_);
+    const char* p = static_cast<const char*>(ptr);
+    in_arena = p >= arena_begin_ && p < arena_end_;
+    if (in_arena) {
+      CHECK_GT(num_arena_live_, 0);
+      --num_arena_live_;
+    }
+    CHECK_GT(num_live_, 0);
+    --num_live_;
+    delete_this = orphaned_ && num_live_ == 0;
+  }
+  if (!in_arena) {
+    base_->DeallocateRaw(ptr);
+  }
+  if (delete_this) delete this;
+}
+
+bool StepArenaAllocator::BeginStep() {
+  mutex_lock l(mu_);
+  DCHECK(!in_step_);
+  if (num_arena_live_ > 0) return false;
+  arena_.Reset();
+  arena_begin_ = nullptr;
+  arena_end_ = nullptr;
+  in_step_ = true;
+  return true;
+}
+
+bool StepArenaAllocator::EndStep() {
+  mutex_lock l(mu_);
+  in_step_ = false;
+  return num_arena_live_ == 0;
+}
+
+bool StepArenaAllocator::Owns(const void* ptr) {
+  mutex_lock l(mu_);
+  const char* p = static_cast<const char*>(ptr);
+  return p != nullptr && p >= arena_begin_ && p < arena_end_;
+}
+
+void StepArenaAllocator::Orphan() {
+  bool delete_this;
+  {
+    mutex_lock l(mu_);
+    in_step_ = false;
+    orphaned_ = true;
+    delete_this = num_live_ == 0;
+  }
+  if (delete_this) delete this;
+}
+
+StepArenaPool::StepArenaPool(Allocator* base, size_t arena_bytes,
+                             int max_arenas)
+    : base_(base), arena_bytes_(arena_bytes), max_arenas_(max_arenas) {}
+
+StepArenaPool::~StepArenaPool() {
+  mutex_lock l(mu_);
+  for (StepArenaAllocator* a : idle_) {
+    a->Orphan();
+  }
+}
+
+StepArenaAllocator* StepArenaPool::Acquire() {
+  mutex_lock l(mu_);
+  // Most recently released arenas first, as their memory is likely cached.
+  for (auto it = idle_.rbegin(); it != idle_.rend(); ++it) {
+    StepArenaAllocator* a = *it;
+    if (a->BeginStep()) {
+      idle_.erase(std::next(it).base());
+      return a;
+    }
+  }
+  if (num_arenas_ >= max_arenas_) return nullptr;
+  ++num_arenas_;
+  // Allocations above 1/16th of the arena go to the base allocator, so that
+  // a few large temporaries cannot crowd out the small ones.
+  StepArenaAllocator* a =
+      new StepArenaAllocator(base_, arena_bytes_, arena_bytes_ / 16);
+  CHECK(a->BeginStep());
+  return a;
+}
+
+void StepArenaPool::Release(StepArenaAllocator* allocator) {
+  const bool reusable = allocator->EndStep();
+  mutex_lock l(mu_);
+  if (reusable) {
+    idle_.push_back(allocator);
+  } else {
+    // The escaped tensors keep the arena alive; a later step gets a new one.
+    --num_arenas_;
+    allocator->Orphan();
+  }
+}
+
+int StepArenaPool::num_arenas() {
+  mutex_lock l(mu_);
+  return num_arenas_;
+}
+
+}  // namespace tensorflow
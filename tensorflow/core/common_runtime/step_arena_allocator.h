@@ -0,0 +1,135 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/arena.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// An Allocator that serves small host allocations made during one step from
+// a bump arena, and forwards everything else to a base allocator.
+//
+// Individual arena allocations are never freed; the whole arena is reset
+// when the next step begins. Tensors may outlive their step (e.g. values
+// assigned to variables), so the arena only resets once every allocation it
+// served has been deallocated. Until then BeginStep() fails. Instances are
+// managed by a StepArenaPool, which gives up on arenas that still have live
+// allocations when their step ends.
+class StepArenaAllocator : public Allocator {
+ public:
+  // Allocations of at most "max_arena_allocation" bytes are served from an
+  // arena of "arena_bytes", until it is full. "base" must outlive this.
+  StepArenaAllocator(Allocator* base, size_t arena_bytes,
+                     size_t max_arena_allocation);
+
+  string Name() override { return "step_arena"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  // Resets the arena and starts serving a step. Returns false, without
+  // effect, if arena allocations from earlier steps are still live.
+  bool BeginStep();
+
+  // Stops serving the current step. Later allocations are forwarded to the
+  // base allocator. Returns false if some of the step's arena allocations
+  // are still live, i.e. escaped the step.
+  bool EndStep();
+
+  // Returns true if "ptr" was allocated from the arena.
+  bool Owns(const void* ptr);
+
+  // Relinquishes ownership: deletes this now if there are no live
+  // allocations, or else when the last one is deallocated.
+  void Orphan();
+
+ private:
+  ~StepArenaAllocator() override;
+
+  // Exposes how much of the current arena block is left, so that the arena
+  // never grows beyond its first block.
+  class Arena : public core::Arena {
+   public:
+    explicit Arena(size_t block_size) : core::Arena(block_size) {}
+    char* TryAllocAligned(size_t size, size_t alignment) {
+      if (size + alignment > remaining_) return nullptr;
+      return AllocAligned(size, alignment);
+    }
+  };
+
+  Allocator* const base_;
+  const size_t max_arena_allocation_;
+
+  mutex mu_;
+  Arena arena_ GUARDED_BY(mu_);
+  // Bounds of all pointers handed out from arena_. As arena_ has a single
+  // block, any pointer in [arena_begin_, arena_end_) was allocated there.
+  const char* arena_begin_ GUARDED_BY(mu_) = nullptr;
+  const char* arena_end_ GUARDED_BY(mu_) = nullptr;
+  // Live allocations served from arena_, and in all, so that an orphaned
+  // instance lasts until forwarded allocations are freed too.
+  int64 num_arena_live_ GUARDED_BY(mu_) = 0;
+  int64 num_live_ GUARDED_BY(mu_) = 0;
+  bool in_step_ GUARDED_BY(mu_) = false;
+  bool orphaned_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaAllocator);
+};
+
+// A thread-safe pool of StepArenaAllocators over one base allocator, with
+// at most "max_arenas" instances. Each concurrent step acquires its own.
+// An arena whose allocations escape its step is dropped from the pool, and
+// deleted once they are freed, so that it never keeps later steps from
+// getting an arena.
+class StepArenaPool {
+ public:
+  StepArenaPool(Allocator* base, size_t arena_bytes, int max_arenas = 8);
+  ~StepArenaPool();
+
+  // Returns an allocator that has begun a step, or nullptr if every arena
+  // in the pool is busy, in which case the step should use "base" directly.
+  StepArenaAllocator* Acquire();
+
+  // Ends the step of an allocator returned by Acquire().
+  void Release(StepArenaAllocator* allocator);
+
+  // The number of arenas owned by the pool. For tests.
+  int num_arenas();
+
+ private:
+  Allocator* const base_;
+  const size_t arena_bytes_;
+  const int max_arenas_;
+
+  mutex mu_;
+  // Arenas not in use by a step; they have no live arena allocations.
+  std::vector<StepArenaAllocator*> idle_ GUARDED_BY(mu_);
+  int num_arenas_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
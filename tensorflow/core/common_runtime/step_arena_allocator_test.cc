@@ -0,0 +1,177 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the allocations that reach the base allocator.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocs;
+    ++num_live;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    --num_live;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocs = 0;
+  int num_live = 0;
+};
+
+TEST(StepArenaAllocatorTest, SmallAllocationsUseArena) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 64 << 10);
+  StepArenaAllocator* a = pool.Acquire();
+  ASSERT_NE(nullptr, a);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 100; ++i) {
+    void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 1 + i);
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) %
+                     Allocator::kAllocatorAlignment);
+    ptrs.push_back(p);
+  }
+  // Too large for the arena.
+  ptrs.push_back(a->AllocateRaw(Allocator::kAllocatorAlignment, 32 << 10));
+  EXPECT_EQ(1, base.num_allocs);
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  EXPECT_EQ(0, base.num_live);
+  pool.Release(a);
+
+  // The released arena is reused by the next step.
+  EXPECT_EQ(a, pool.Acquire());
+  pool.Release(a);
+}
+
+TEST(StepArenaAllocatorTest, FullArenaFallsBackToBase) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 16 << 10);
+  StepArenaAllocator* a = pool.Acquire();
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 64; ++i) {
+    ptrs.push_back(a->AllocateRaw(Allocator::kAllocatorAlignment, 1000));
+  }
+  EXPECT_GT(base.num_allocs, 0);
+  EXPECT_LT(base.num_allocs, 64);
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  EXPECT_EQ(0, base.num_live);
+  pool.Release(a);
+}
+
+TEST(StepArenaAllocatorTest, EscapingTensorsPinTheirArena) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 64 << 10);
+  StepArenaAllocator* a = pool.Acquire();
+  Tensor fetched(a, DT_FLOAT, TensorShape({16}));
+  fetched.flat<float>().setConstant(42.0f);
+  EXPECT_TRUE(a->Owns(fetched.tensor_data().data()));
+  {
+    Tensor temp(a, DT_INT32, TensorShape({4}));
+  }
+  pool.Release(a);
+  // "fetched" outlives its step, so the pool gives up on its arena.
+  EXPECT_EQ(0, pool.num_arenas());
+
+  // More steps than the pool has arenas all get one, and reuse it.
+  StepArenaAllocator* b = nullptr;
+  for (int step = 0; step < 20; ++step) {
+    StepArenaAllocator* arena = pool.Acquire();
+    ASSERT_NE(nullptr, arena);
+    if (b == nullptr) b = arena;
+    EXPECT_EQ(b, arena);
+    Tensor other(arena, DT_FLOAT, TensorShape({16}));
+    other.flat<float>().setZero();
+    other = Tensor();
+    pool.Release(arena);
+  }
+  EXPECT_EQ(1, pool.num_arenas());
+
+  // The escaped tensor is intact.
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(42.0f, fetched.flat<float>()(i));
+  }
+}
+
+TEST(StepArenaAllocatorTest, EscapingForwardedTensorsDoNotPinTheirArena) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 64 << 10);
+  StepArenaAllocator* a = pool.Acquire();
+  // Too large for the arena, so it comes from the base allocator.
+  Tensor fetched(a, DT_FLOAT, TensorShape({1 << 16}));
+  EXPECT_FALSE(a->Owns(fetched.tensor_data().data()));
+  pool.Release(a);
+  for (int step = 0; step < 20; ++step) {
+    StepArenaAllocator* arena = pool.Acquire();
+    EXPECT_EQ(a, arena);
+    pool.Release(arena);
+  }
+  fetched = Tensor();
+  EXPECT_EQ(0, base.num_live);
+}
+
+TEST(StepArenaAllocatorTest, ConcurrentStepsExhaustThePool) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 64 << 10, 2 /*max_arenas*/);
+  StepArenaAllocator* a = pool.Acquire();
+  StepArenaAllocator* b = pool.Acquire();
+  ASSERT_NE(nullptr, a);
+  ASSERT_NE(nullptr, b);
+  EXPECT_NE(a, b);
+  // Once the pool is exhausted, steps use the base allocator.
+  EXPECT_EQ(nullptr, pool.Acquire());
+  pool.Release(a);
+  EXPECT_EQ(a, pool.Acquire());
+  pool.Release(a);
+  pool.Release(b);
+}
+
+TEST(StepArenaAllocatorTest, TensorsMayOutliveThePool) {
+  CountingAllocator base;
+  Tensor escaped;
+  Tensor escaped_large;
+  {
+    StepArenaPool pool(&base, 64 << 10);
+    StepArenaAllocator* a = pool.Acquire();
+    escaped = Tensor(a, DT_FLOAT, TensorShape({4}));
+    escaped_large = Tensor(a, DT_FLOAT, TensorShape({1 << 16}));
+    escaped.flat<float>().setConstant(1.0f);
+    pool.Release(a);
+  }
+  EXPECT_EQ(1.0f, escaped.flat<float>()(3));
+  escaped = Tensor();
+  EXPECT_EQ(1, base.num_live);
+  // Deletes the orphaned arena.
+  escaped_large = Tensor();
+  EXPECT_EQ(0, base.num_live);
+}
+
+}  // namespace
+}  // namespace tensorflow
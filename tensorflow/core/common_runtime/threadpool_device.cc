@@ -29,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 #ifdef INTEL_MKL
 #ifdef _OPENMP
@@ -77,6 +78,8 @@ void ThreadPoolDevice::Compute(OpKernel* op_kernel, OpKernelContext* context) {
                                    op_kernel->IsExpensive());
   tracing::ScopedRegion region(tracing::EventCategory::kCompute,
                                op_kernel->name());
+  // Keys adaptive sharding's cost measurements, if enabled.
+  ScopedShardingKernel sharding_kernel(op_kernel->type_string());
 
   op_kernel->Compute(context);
 }
@@ -101,7 +104,7 @@ Status ThreadPoolDevice::MakeTensorFromProto(
     Tensor* tensor) {
   if (tensor_proto.dtype() > 0 && tensor_proto.dtype() <= DataType_MAX) {
     Tensor parsed(tensor_proto.dtype());
-    if (parsed.FromProto(cpu_allocator(), tensor_proto)) {
+    if (parsed.FromProto(allocator_, tensor_proto)) {
       *tensor = std::move(parsed);
       return Status::OK();
     }
@@ -18,7 +18,10 @@ limitations under the License.
 
 #include <vector>
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/process_state.h"
+#include "tensorflow/core/common_runtime/visitable_allocator.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -28,13 +31,20 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
  public:
   Status CreateDevices(const SessionOptions& options, const string& name_prefix,
                        std::vector<Device*>* devices) override {
-    // TODO(zhifengc/tucker): Figure out the number of available CPUs
-    // and/or NUMA configuration.
+    // TODO(zhifengc/tucker): Figure out the number of available CPUs.
     int n = 1;
     auto iter = options.config.device_count().find("CPU");
     if (iter != options.config.device_count().end()) {
       n = iter->second;
     }
+    if (options.config.experimental().use_numa_affinity() &&
+        port::NUMAEnabled()) {
+      // Unless the number of devices is given, there is one per node.
+      if (iter == options.config.device_count().end()) {
+        n = port::NUMANumNodes();
+      }
+      return CreateNUMADevices(options, name_prefix, n, devices);
+    }
     for (int i = 0; i < n; i++) {
       string name = strings::StrCat(name_prefix, "/device:CPU:", i);
       devices->push_back(new ThreadPoolDevice(
@@ -43,6 +53,26 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
 
     return Status::OK();
   }
+
+ private:
+  // Creates n devices, assigned to the NUMA nodes round-robin. Each device
+  // gets its node's thread pool (see LocalDevice) and allocator, so the placer
+  // can split a graph across nodes by device.
+  Status CreateNUMADevices(const SessionOptions& options,
+                           const string& name_prefix, int n,
+                           std::vector<Device*>* devices) {
+    const int num_nodes = port::NUMANumNodes();
+    for (int i = 0; i < n; i++) {
+      const int numa_node = i % num_nodes;
+      string name = strings::StrCat(name_prefix, "/device:CPU:", i);
+      DeviceLocality locality;
+      locality.set_numa_node(numa_node);
+      devices->push_back(new ThreadPoolDevice(
+          options, name, Bytes(256 << 20), locality,
+          ProcessState::singleton()->GetNUMAAllocator(numa_node)));
+    }
+    return Status::OK();
+  }
 };
 
 REGISTER_LOCAL_DEVICE_FACTORY("CPU", ThreadPoolDeviceFactory, 60);
@@ -1259,11 +1259,15 @@ Status MasterSession::CreateWorkerSessions(
       // is in use.
       workers[i].request.set_isolate_session_state(true);
     } else {
-      // NOTE(mrry): Do not set any component of the ServerDef,
+      // NOTE(mrry): Do not set the cluster or task of the ServerDef,
       // because the worker will use its local configuration.
       workers[i].request.set_isolate_session_state(
           session_opts_.config.isolate_session_state());
     }
+    // Either way, the workers follow the RPC options of this session.
+    ServerDef* server_def = workers[i].request.mutable_server_def();
+    *server_def->mutable_default_session_config()->mutable_rpc_options() =
+        session_opts_.config.rpc_options();
   }
 
   for (size_t i = 0; i < worker_names.size(); ++i) {
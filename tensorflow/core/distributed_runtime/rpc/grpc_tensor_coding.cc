@@ -17,6 +17,7 @@ limitations under the License.
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_reference.h"
@@ -242,5 +243,35 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
   }
 }
 
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
+                              StringPiece compression_algorithm,
+                              int compression_level, int64 threshold_bytes,
+                              ::grpc::ByteBuffer* result) {
+  if (compression_algorithm.empty() || is_dead ||
+      !DataTypeCanUseMemcpy(val.dtype()) || val.TotalBytes() == 0 ||
+      static_cast<int64>(val.TotalBytes()) < threshold_bytes) {
+    EncodeTensorToByteBuffer(is_dead, val, result);
+    return;
+  }
+  RecvTensorResponse response;
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  string* compressed = response.mutable_compressed_tensor_content();
+  Status s = CompressTensorContent(compression_algorithm, compression_level,
+                                   val.tensor_data(), compressed);
+  if (!s.ok() || compressed->size() >= val.TotalBytes()) {
+    VLOG(1) << "Sending " << val.TotalBytes()
+            << " bytes of tensor content uncompressed: "
+            << (s.ok() ? "they do not shrink" : s.ToString());
+    EncodeTensorToByteBuffer(is_dead, val, result);
+    return;
+  }
+  response.set_compression_algorithm(compression_algorithm.data(),
+                                     compression_algorithm.size());
+  TensorProto* tensor = response.mutable_tensor();
+  tensor->set_dtype(val.dtype());
+  val.shape().AsProto(tensor->mutable_tensor_shape());
+  EncodeRecvTensorResponseToByteBuffer(response, result);
+}
+
 }  // namespace grpc
 }  // namespace tensorflow
@@ -17,9 +17,13 @@ limitations under the License.
 
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
@@ -100,4 +104,54 @@ TEST_F(GrpcTensorCodingTest, Simple) {
 
 TEST_F(GrpcTensorCodingTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+// Encodes `t` with compression and parses the result.
+static RecvTensorResponse EncodeCompressed(const Tensor& t,
+                                           int64 threshold_bytes) {
+  ::grpc::ByteBuffer buf;
+  grpc::EncodeTensorToByteBuffer(false, t, tensor_compression::kZlib, 0,
+                                 threshold_bytes, &buf);
+  std::vector<::grpc::Slice> slices;
+  (void)buf.Dump(&slices);
+  string tmp;
+  for (const auto& s : slices) {
+    tmp.append(reinterpret_cast<const char*>(s.begin()), s.size());
+  }
+  RecvTensorResponse response;
+  EXPECT_TRUE(response.ParseFromString(tmp));
+  return response;
+}
+
+TEST_F(GrpcTensorCodingTest, Compressed) {
+  Tensor t(DT_FLOAT, TensorShape({64, 64}));
+  test::FillFn<float>(&t, [](int i) { return i % 13 == 0 ? i : 0; });
+
+  RecvTensorResponse response = EncodeCompressed(t, 1024);
+  EXPECT_EQ(tensor_compression::kZlib, response.compression_algorithm());
+  EXPECT_LT(response.compressed_tensor_content().size(), t.TotalBytes() / 4);
+  EXPECT_TRUE(response.tensor().tensor_content().empty());
+  Tensor result(DT_FLOAT, TensorShape(response.tensor().tensor_shape()));
+  EXPECT_EQ(DT_FLOAT, response.tensor().dtype());
+  StringPiece buf = result.tensor_data();
+  TF_EXPECT_OK(UncompressTensorContent(
+      response.compression_algorithm(), response.compressed_tensor_content(),
+      const_cast<char*>(buf.data()), buf.size()));
+  test::ExpectTensorEqual<float>(t, result);
+
+  // Below the threshold the content is sent as is.
+  response = EncodeCompressed(t, t.TotalBytes() + 1);
+  EXPECT_TRUE(response.compression_algorithm().empty());
+  EXPECT_EQ(t.tensor_data(), response.tensor().tensor_content());
+}
+
+TEST_F(GrpcTensorCodingTest, IncompressibleContentIsSentAsIs) {
+  Tensor t(DT_UINT8, TensorShape({4096}));
+  random::PhiloxRandom philox(7);
+  random::SimplePhilox rnd(&philox);
+  test::FillFn<uint8>(&t, [&rnd](int i) { return rnd.Rand32() & 0xff; });
+
+  RecvTensorResponse response = EncodeCompressed(t, 0);
+  EXPECT_TRUE(response.compression_algorithm().empty());
+  EXPECT_EQ(t.tensor_data(), response.tensor().tensor_content());
+}
+
 }  // namespace tensorflow
@@ -15,10 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service.h"
 
+#include <algorithm>
 #include <deque>
 
 #include "grpcpp/alarm.h"
 #include "grpcpp/server_builder.h"
+#include "grpcpp/support/byte_buffer.h"
 
 #include "tensorflow/core/common_runtime/buf_rendezvous.h"
 #include "tensorflow/core/common_runtime/device.h"
@@ -41,6 +43,8 @@ limitations under the License.
 #include "tensorflow/core/framework/collective.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/protobuf/transport_options.pb.h"
@@ -50,6 +54,10 @@ namespace tensorflow {
 
 namespace {
 
+auto* recv_tensor_response_bytes = monitoring::Counter<0>::New(
+    "/tensorflow/core/grpc_worker/recv_tensor_response_bytes",
+    "The bytes of the RecvTensor responses that GrpcWorker has encoded.");
+
 class GrpcWorkerService : public AsyncServiceInterface {
   // TODO(ncteisen): consider adding a config var or flag for this
   static constexpr const size_t kGrpcWorkerServiceThreadCount = 8;
@@ -456,7 +464,7 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
   opts->SetCancelCallback([this, step_id]() { AbortStep(step_id); });
   env_->rendezvous_mgr->RecvLocalAsync(
       step_id, parsed,
-      [opts, response, done, src_dev, request](
+      [this, opts, response, done, src_dev, request](
           const Status& status, const Rendezvous::Args& send_args,
           const Rendezvous::Args& recv_args, const Tensor& val,
           const bool is_dead) {
@@ -483,19 +491,22 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
                   << " gpu_info: " << src_dev->tensorflow_gpu_device_info();
               // "val" is on an accelerator device. Uses the device_context to
               // fill the copy on host.
-              StatusCallback copy_ready = [response, done, copy,
-                                           is_dead](const Status& s) {
-                // The value is now ready to be returned on the wire.
-                grpc::EncodeTensorToByteBuffer(is_dead, *copy, response);
-                done(s);
+              StatusCallback copy_ready = [this, request, response, done,
+                                           copy, is_dead](const Status& s) {
+                if (s.ok()) {
+                  // The value is now ready to be returned on the wire.
+                  EncodeRecvTensorResponse(request, is_dead, *copy, response,
+                                           done);
+                } else {
+                  done(s);
+                }
                 delete copy;
               };
 
               send_dev_context->CopyDeviceTensorToCPU(
                   &val, request->rendezvous_key(), src_dev, copy, copy_ready);
             } else {
-              grpc::EncodeTensorToByteBuffer(is_dead, val, response);
-              done(Status::OK());
+              EncodeRecvTensorResponse(request, is_dead, val, response, done);
             }
           }
         } else {
@@ -505,6 +516,43 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
       });
 }
 
+void GrpcWorker::EncodeRecvTensorResponse(const RecvTensorRequest* request,
+                                          bool is_dead, const Tensor& val,
+                                          ::grpc::ByteBuffer* response,
+                                          StatusCallback done) {
+  if (request->compression_algorithm().empty() || is_dead ||
+      !DataTypeCanUseMemcpy(val.dtype()) || val.TotalBytes() == 0 ||
+      static_cast<int64>(val.TotalBytes()) <
+          request->compression_threshold_bytes()) {
+    grpc::EncodeTensorToByteBuffer(is_dead, val, response);
+    recv_tensor_response_bytes->GetCell()->IncrementBy(response->Length());
+    done(Status::OK());
+    return;
+  }
+  // Compressing a large tensor takes a while, so it must not hold up the
+  // thread that produced the tensor or serves the RPCs.  "val" shares its
+  // buffer with the copy that the closure captures.
+  compression_pool()->Schedule([request, is_dead, val, response, done]() {
+    grpc::EncodeTensorToByteBuffer(is_dead, val,
+                                   request->compression_algorithm(),
+                                   request->compression_level(),
+                                   request->compression_threshold_bytes(),
+                                   response);
+    recv_tensor_response_bytes->GetCell()->IncrementBy(response->Length());
+    done(Status::OK());
+  });
+}
+
+thread::ThreadPool* GrpcWorker::compression_pool() {
+  mutex_lock l(compression_mu_);
+  if (compression_pool_ == nullptr) {
+    compression_pool_.reset(
+        new thread::ThreadPool(env_->env, "recv_tensor_compression",
+                               std::max(1, port::NumSchedulableCPUs() / 4)));
+  }
+  return compression_pool_.get();
+}
+
 void GrpcWorker::RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
                               RecvBufResponse* response, StatusCallback done) {
   // This is a generic, low performance implementation appropriate for grpc.
@@ -16,8 +16,12 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_WORKER_SERVICE_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_GRPC_WORKER_SERVICE_H_
 
+#include <memory>
+
 #include "tensorflow/core/distributed_runtime/recent_request_ids.h"
 #include "tensorflow/core/distributed_runtime/worker.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/mutex.h"
 
 namespace grpc {
 class ByteBuffer;
@@ -49,7 +53,20 @@ class GrpcWorker : public Worker {
   WorkerEnv* env();
 
  private:
+  // Encodes `val` into `response`, compressed as `request` asks for, and
+  // calls `done`.  Compression runs on compression_pool().
+  void EncodeRecvTensorResponse(const RecvTensorRequest* request,
+                                bool is_dead, const Tensor& val,
+                                ::grpc::ByteBuffer* response,
+                                StatusCallback done);
+  // Returns the pool that compresses RecvTensor responses, created on
+  // first use.
+  thread::ThreadPool* compression_pool();
+
   RecentRequestIds recent_request_ids_;
+  mutex compression_mu_;
+  std::unique_ptr<thread::ThreadPool> compression_pool_
+      GUARDED_BY(compression_mu_);
 };
 
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* worker_env);
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <unordered_set>
 
+#include "tensorflow/core/common_runtime/copy_tensor.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
@@ -37,6 +38,8 @@ namespace tensorflow {
 
 namespace {
 
+class RpcRecvTensorCall;
+
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
   RpcRemoteRendezvous(const WorkerEnv* env, int64 step_id)
@@ -50,6 +53,14 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  private:
   ~RpcRemoteRendezvous() override {}
 
+  // Copies the tensor of "call", which was received into host memory, to the
+  // device of "call", and then calls the callback of "call".
+  void CopyToDeviceThenDone(RpcRecvTensorCall* call, const string& edge_name);
+
+  // Calls the callback of "call" with "tensor" and releases "call".
+  void RecvDone(RpcRecvTensorCall* call, const Status& s,
+                const Tensor& tensor);
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
 
@@ -60,15 +71,30 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
   void Init(WorkerInterface* wi, int64 step_id, StringPiece key,
             AllocatorAttributes alloc_attrs, Device* dst_device,
-            const Rendezvous::Args& recv_args, Rendezvous::DoneCallback done) {
+            const Rendezvous::Args& recv_args, const RPCOptions& rpc_options,
+            Rendezvous::DoneCallback done) {
     wi_ = wi;
     alloc_attrs_ = alloc_attrs;
     dst_device_ = dst_device;
     recv_args_ = recv_args;
+    // A tensor for a non-CPU device is parsed straight out of the response
+    // into device-compatible host memory, and then copied to the device.
+    // Letting the device parse the response would first copy the content
+    // into a TensorProto.
+    copy_to_device_ = !alloc_attrs.on_host() &&
+                      dst_device->device_type() != DEVICE_CPU &&
+                      recv_args.device_context != nullptr;
     done_ = std::move(done);
     req_.set_step_id(step_id);
     req_.set_rendezvous_key(key.data(), key.size());
     req_.set_request_id(GetUniqueRequestId());
+    if (!rpc_options.tensor_compression_algorithm().empty()) {
+      req_.set_compression_algorithm(
+          rpc_options.tensor_compression_algorithm());
+      req_.set_compression_level(rpc_options.tensor_compression_level());
+      req_.set_compression_threshold_bytes(
+          rpc_options.tensor_compression_threshold_bytes());
+    }
   }
 
   void Reset(WorkerCacheInterface* wc) {
@@ -76,6 +102,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     wi_ = nullptr;
     alloc_attrs_ = AllocatorAttributes();
     dst_device_ = nullptr;
+    copy_to_device_ = false;
     // We don't clear opts_ and assume that Init will set up the state for
     // opts_ appropriately.
     req_.Clear();
@@ -118,6 +145,9 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
   bool is_dead() const { return resp_.metadata().is_dead(); }
 
   Device* dst_device() const { return dst_device_; }
+  // Whether tensor() is in host memory and still needs to be copied to
+  // dst_device().
+  bool copy_to_device() const { return copy_to_device_; }
   const Rendezvous::Args& recv_args() const { return recv_args_; }
   const Rendezvous::DoneCallback& done() const { return done_; }
 
@@ -126,7 +156,12 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
   // Start the main RecvTensor call, checking for an async abort.
   void StartRTCall(std::function<void()> recv_done) {
-    resp_.InitAlloc(dst_device_, alloc_attrs_);
+    AllocatorAttributes alloc_attrs = alloc_attrs_;
+    if (copy_to_device_) {
+      alloc_attrs.set_on_host(true);
+      alloc_attrs.set_gpu_compatible(true);
+    }
+    resp_.InitAlloc(dst_device_, alloc_attrs);
     using namespace std::placeholders;
     StatusCallback cb = std::bind(
         [this](std::function<void()> recv_done,
@@ -147,6 +182,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
   WorkerInterface* wi_;
   AllocatorAttributes alloc_attrs_;
   Device* dst_device_;
+  bool copy_to_device_ = false;
   CallOptions opts_;
   RecvTensorRequest req_;
   TensorResponse resp_;
@@ -239,27 +275,71 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
   }
 
   call->Init(rwi, step_id_, parsed.FullKey(), recv_args.alloc_attrs, dst_device,
-             recv_args, std::move(done));
+             recv_args, sess->rpc_options, std::move(done));
 
   // Record "call" in active_ so that it can be aborted cleanly.
   RegisterCall(call);
 
   // Start "call".
   Ref();
-  call->Start([this, call]() {
+  string edge_name = std::string(parsed.edge_name);
+  call->Start([this, call, edge_name]() {
     // Removes "call" from active_. Prevent StartAbort().
     DeregisterCall(call);
     // If StartAbort was called prior to DeregisterCall, then the
     // current status should be bad.
     Status s = call->status();
-    call->done()(s, Args(), call->recv_args(), call->tensor(), call->is_dead());
-    session()->worker_cache->ReleaseWorker(call->src_worker_, call->wi_);
-    call->wi_ = nullptr;
-    get_call_freelist()->Release(call, session()->worker_cache.get());
-    Unref();
+    if (s.ok() && call->copy_to_device() && !call->is_dead()) {
+      CopyToDeviceThenDone(call, edge_name);
+    } else {
+      RecvDone(call, s, call->tensor());
+    }
   });
 }
 
+void RpcRemoteRendezvous::CopyToDeviceThenDone(RpcRecvTensorCall* call,
+                                               const string& edge_name) {
+  const Tensor& in = call->tensor();
+  if (!DMAHelper::CanUseDMA(&in) && in.dtype() != DT_VARIANT) {
+    RecvDone(call,
+             errors::InvalidArgument(
+                 "Non-DMA-safe ", DataTypeString(in.dtype()),
+                 " tensor may not be copied from/to a GPU."),
+             Tensor());
+    return;
+  }
+  Device* dst_device = call->dst_device();
+  const Rendezvous::Args& recv_args = call->recv_args();
+  Tensor* out = new Tensor;
+  if (in.dtype() != DT_VARIANT) {
+    // Variants are handled by CopyTensor::ViaDMA.
+    *out = Tensor(dst_device->GetAllocator(recv_args.alloc_attrs), in.dtype(),
+                  in.shape());
+  }
+  AllocatorAttributes host_alloc_attrs;
+  host_alloc_attrs.set_on_host(true);
+  host_alloc_attrs.set_gpu_compatible(true);
+  // The source tensor is in host memory that dst_device allocated, so
+  // dst_device also stands in for the source device.
+  CopyTensor::ViaDMA(edge_name, nullptr /*send_dev_context*/,
+                     recv_args.device_context, dst_device, dst_device,
+                     host_alloc_attrs, recv_args.alloc_attrs, &in, out,
+                     0 /*dev_to_dev_stream_index*/,
+                     [this, call, out](const Status& s) {
+                       RecvDone(call, s, *out);
+                       delete out;
+                     });
+}
+
+void RpcRemoteRendezvous::RecvDone(RpcRecvTensorCall* call, const Status& s,
+                                   const Tensor& tensor) {
+  call->done()(s, Args(), call->recv_args(), tensor, call->is_dead());
+  session()->worker_cache->ReleaseWorker(call->src_worker_, call->wi_);
+  call->wi_ = nullptr;
+  get_call_freelist()->Release(call, session()->worker_cache.get());
+  Unref();
+}
+
 }  // namespace
 
 RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
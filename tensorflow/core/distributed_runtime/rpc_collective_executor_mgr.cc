@@ -49,7 +49,8 @@ CollectiveExecutor* RpcCollectiveExecutorMgr::Create(int64 step_id) {
   CollectiveRemoteAccessDistributed* rma =
       new CollectiveRemoteAccessDistributed(dev_mgr_, dev_resolver_.get(),
                                             worker_cache_, step_id);
-  return new BaseCollectiveExecutor(this, rma, step_id, dev_mgr_);
+  return new BaseCollectiveExecutor(this, rma, step_id, dev_mgr_,
+                                    fusion_options_);
 }
 
 namespace {
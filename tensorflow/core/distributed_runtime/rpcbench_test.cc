@@ -21,11 +21,14 @@ limitations under the License.
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_session.h"
 #include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/graph/default_device.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/monitoring/collection_registry.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
@@ -165,14 +168,33 @@ string DebugString(const Tensor& x, const Tensor& y, int tensor_size) {
                          x_flat(1), y_flat(0), y_flat(1));
 }
 
+// Returns the bytes of the RecvTensor responses that the workers of this
+// process have encoded so far.
+static int64 RecvTensorResponseBytes() {
+  monitoring::CollectionRegistry::CollectMetricsOptions options;
+  options.collect_metric_descriptors = false;
+  const std::unique_ptr<monitoring::CollectedMetrics> metrics =
+      monitoring::CollectionRegistry::Default()->CollectMetrics(options);
+  auto it = metrics->point_set_map.find(
+      "/tensorflow/core/grpc_worker/recv_tensor_response_bytes");
+  if (it == metrics->point_set_map.end() || it->second->points.empty()) {
+    return 0;
+  }
+  return it->second->points[0]->int64_value;
+}
+
 // TODO: Support sharding and depth.
 static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
-                      bool use_multiple_devices) {
+                      bool use_multiple_devices,
+                      const RPCOptions& rpc_options = RPCOptions(),
+                      bool sparse_input = false) {
   testing::StopTiming();
   const Cluster* cluster = GetCluster();
 
   // Creates a session.
-  std::unique_ptr<Session> session(NewSession(cluster->options));
+  SessionOptions options = cluster->options;
+  *options.config.mutable_rpc_options() = rpc_options;
+  std::unique_ptr<Session> session(NewSession(options));
   GraphDef def = CreateGraphDef(num_stages, width, tensor_size,
                                 use_multiple_devices, cluster);
   graph::SetDefaultDevice(cluster->devices[0].name(), &def);
@@ -181,11 +203,16 @@ static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
 
   // Randomly initialize the input.
   Tensor x(DT_FLOAT, TensorShape({tensor_size, 1}));
+  if (sparse_input) {
+    // Mostly zeros, like a sparse gradient.
+    test::FillFn<float>(&x, [](int i) { return i % 10 == 0 ? i : 0; });
+  }
 
-  testing::SetLabel(
+  const string label =
       strings::StrCat(def.node_size(), " nodes; ",
                       use_multiple_devices ? "Multi device" : "Single device",
-                      "; tensor bytes/send: ", tensor_size * sizeof(float)));
+                      "; tensor bytes/send: ", tensor_size * sizeof(float));
+  testing::SetLabel(label);
 
   std::vector<Tensor> outputs;
 
@@ -203,6 +230,7 @@ static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
   }
 
   // Iterations.
+  const int64 start_bytes = RecvTensorResponseBytes();
   testing::StartTiming();
   for (int i = 0; i < iters; i++) {
     outputs.clear();
@@ -210,6 +238,11 @@ static void BM_Helper(int iters, int width, int num_stages, int tensor_size,
     CHECK_EQ(size_t{1}, outputs.size());
   }
   testing::StopTiming();
+  if (iters > 0) {
+    testing::SetLabel(strings::StrCat(
+        label, "; RecvTensor response bytes/step: ",
+        (RecvTensorResponseBytes() - start_bytes) / iters));
+  }
   TF_CHECK_OK(session->Close());
 }
 static void BM_ShardedProgram(int iters, int width, int num_stages) {
@@ -235,7 +268,37 @@ BENCHMARK(BM_ShardedProgram)
 static void BM_RPC(int iters, int width, int tensor_size) {
   BM_Helper(iters, width, 2 /*num_stages*/, tensor_size, true /*multi-device*/);
 }
-BENCHMARK(BM_RPC)->ArgPair(30, 2)->ArgPair(30, 1000)->ArgPair(30, 100000);
+BENCHMARK(BM_RPC)
+    ->ArgPair(30, 2)
+    ->ArgPair(30, 1000)
+    ->ArgPair(30, 100000)
+    ->ArgPair(4, 1000000)
+    ->ArgPair(1, 10000000);
+
+// Sends the tensors between workers with their content compressed by
+// `codec`: 0 for none, 1 for snappy and 2 for zlib.  The input is mostly
+// zeros, and the label reports the bytes of the RecvTensor responses that the
+// workers sent per step.
+static void BM_CompressedRPC(int iters, int codec, int tensor_size) {
+  const char* const kCodecs[] = {tensor_compression::kNone,
+                                 tensor_compression::kSnappy,
+                                 tensor_compression::kZlib};
+  if (!ValidateTensorCompression(kCodecs[codec], 0).ok()) {
+    testing::SetLabel("codec not available");
+    return;
+  }
+  RPCOptions rpc_options;
+  rpc_options.set_tensor_compression_algorithm(kCodecs[codec]);
+  BM_Helper(iters, 2 /*width*/, 2 /*num_stages*/, tensor_size,
+            true /*multi-device*/, rpc_options, true /*sparse_input*/);
+}
+BENCHMARK(BM_CompressedRPC)
+    ->ArgPair(0, 100000)
+    ->ArgPair(1, 100000)
+    ->ArgPair(2, 100000)
+    ->ArgPair(0, 1000000)
+    ->ArgPair(1, 1000000)
+    ->ArgPair(2, 1000000);
 
 static void BM_SingleDevice(int iters, int width, int num_stages) {
   BM_Helper(iters, width, num_stages, 2 /*tensor_size*/,
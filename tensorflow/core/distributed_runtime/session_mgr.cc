@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/distributed_runtime/graph_mgr.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/distributed_runtime/worker_cache_wrapper.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/protobuf/cluster.pb.h"
@@ -56,6 +57,11 @@ Status SessionMgr::CreateSession(const string& session,
   if (session.empty()) {
     return errors::InvalidArgument("Session must be non-empty.");
   }
+  const RPCOptions& rpc_options =
+      server_def.default_session_config().rpc_options();
+  TF_RETURN_IF_ERROR(
+      ValidateTensorCompression(rpc_options.tensor_compression_algorithm(),
+                                rpc_options.tensor_compression_level()));
 
   WorkerCacheInterface* worker_cache = nullptr;
   string worker_name;
@@ -101,6 +107,7 @@ Status SessionMgr::CreateSession(const string& session,
         worker_env_->device_mgr, std::move(graph_mgr));
   }
 
+  worker_session->rpc_options = rpc_options;
   sessions_.insert(std::make_pair(session, std::move(worker_session)));
   return Status::OK();
 }
@@ -106,6 +106,30 @@ TEST_F(SessionMgrTest, CreateSessionDefaultWorkerName) {
   TF_EXPECT_OK(mgr_.DeleteSession(session_handle));
 }
 
+TEST_F(SessionMgrTest, CreateSessionRPCOptions) {
+  ServerDef server_def;
+  RPCOptions* rpc_options =
+      server_def.mutable_default_session_config()->mutable_rpc_options();
+  rpc_options->set_tensor_compression_algorithm("zlib");
+  rpc_options->set_tensor_compression_threshold_bytes(1024);
+  string session_handle = "test_session_handle";
+  TF_EXPECT_OK(mgr_.CreateSession(session_handle, server_def, true));
+  std::shared_ptr<WorkerSession> session;
+  TF_EXPECT_OK(mgr_.WorkerSessionForSession(session_handle, &session));
+  EXPECT_EQ("zlib", session->rpc_options.tensor_compression_algorithm());
+  EXPECT_EQ(1024, session->rpc_options.tensor_compression_threshold_bytes());
+  TF_EXPECT_OK(mgr_.DeleteSession(session_handle));
+
+  rpc_options->set_tensor_compression_algorithm("lzma");
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      mgr_.CreateSession(session_handle, server_def, true)));
+
+  rpc_options->set_tensor_compression_algorithm("zlib");
+  rpc_options->set_tensor_compression_level(10);
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      mgr_.CreateSession(session_handle, server_def, true)));
+}
+
 TEST_F(SessionMgrTest, CreateSessionIsolateSessionState) {
   ServerDef server_def;
   server_def.set_job_name("worker");
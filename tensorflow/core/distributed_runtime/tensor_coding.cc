@@ -18,6 +18,7 @@ limitations under the License.
 #include "google/protobuf/any.pb.h"
 
 #include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 
@@ -51,14 +52,17 @@ void TensorResponse::InitAlloc(DeviceBase* d, const AllocatorAttributes& aa) {
 }
 
 Status TensorResponse::InitFrom(RecvTensorResponse* response) {
-  Status s;
   meta_.Swap(response);
-  if (on_host_) {
-    if (!tensor_.FromProto(allocator_, meta_.tensor())) {
-      s = errors::InvalidArgument("Cannot parse tensor from response");
+  Status s = UncompressContent();
+  if (s.ok()) {
+    if (on_host_) {
+      if (!tensor_.FromProto(allocator_, meta_.tensor())) {
+        s = errors::InvalidArgument("Cannot parse tensor from response");
+      }
+    } else {
+      s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_,
+                                       &tensor_);
     }
-  } else {
-    s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
   }
   {
     TensorProto empty;
@@ -87,8 +91,10 @@ Status TensorResponse::ParseFrom(Source* source) {
     if (!meta_.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
       return errors::InvalidArgument("Cannot parse tensor from response");
     }
-    Status s =
-        device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    Status s = UncompressContent();
+    if (s.ok()) {
+      s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    }
     // Reduce memory usage for big tensors.
     {
       TensorProto empty;
@@ -218,12 +224,15 @@ bool TensorResponse::ParseTensorSubmessage(
 bool TensorResponse::ParseFast(Source* source) {
   protobuf::io::CodedInputStream input(source->contents());
   input.SetTotalBytesLimit(INT_MAX, INT_MAX);  // Unlimited
+  string compression_algorithm;
+  bool seen_compressed_content = false;
   while (true) {
     auto p = input.ReadTagWithCutoff(127);
     int tag = GetTagFieldNumber(p.first);
     WireType wt = GetTagWireType(p.first);
     if (!p.second) {
-      return (tag == 0);
+      return (tag == 0) &&
+             (compression_algorithm.empty() || seen_compressed_content);
     }
     switch (tag) {
       case RecvTensorResponse::kTensorFieldNumber: {
@@ -260,6 +269,37 @@ bool TensorResponse::ParseFast(Source* source) {
           return false;
         break;
       }
+      case RecvTensorResponse::kCompressionAlgorithmFieldNumber: {
+        int length;
+        if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
+            !ReadVarintSizeAsInt(&input, &length) ||
+            !input.ReadString(&compression_algorithm, length))
+          return false;
+        break;
+      }
+      case RecvTensorResponse::kCompressedTensorContentFieldNumber: {
+        // The tensor, which ParseTensorSubmessage allocated without its
+        // content, and the codec must come first.  The content is
+        // uncompressed straight into the buffer of the tensor.
+        if (wt != WIRETYPE_LENGTH_DELIMITED || !meta_.has_tensor() ||
+            compression_algorithm.empty() || seen_compressed_content) {
+          return false;
+        }
+        int length;
+        string compressed;
+        if (!ReadVarintSizeAsInt(&input, &length) ||
+            !input.ReadString(&compressed, length))
+          return false;
+        seen_compressed_content = true;
+        StringPiece buf = tensor_.tensor_data();
+        if (!UncompressTensorContent(compression_algorithm, compressed,
+                                     const_cast<char*>(buf.data()),
+                                     buf.size())
+                 .ok()) {
+          return false;
+        }
+        break;
+      }
       default: {
         // Unknown tag, so don't handle we can't handle on the fast path
         return false;
@@ -271,7 +311,8 @@ bool TensorResponse::ParseFast(Source* source) {
 }
 
 bool TensorResponse::ParseSlow(Source* source) {
-  if (!meta_.ParseFromZeroCopyStream(source->contents())) {
+  if (!meta_.ParseFromZeroCopyStream(source->contents()) ||
+      !UncompressContent().ok()) {
     return false;
   }
 
@@ -291,4 +332,25 @@ bool TensorResponse::ParseSlow(Source* source) {
   return true;
 }
 
+Status TensorResponse::UncompressContent() {
+  if (meta_.compression_algorithm().empty()) return Status::OK();
+  TensorProto* tensor = meta_.mutable_tensor();
+  if (!TensorShape::IsValid(tensor->tensor_shape()) ||
+      !DataTypeCanUseMemcpy(tensor->dtype())) {
+    return errors::InvalidArgument(
+        "Cannot parse compressed tensor from response");
+  }
+  const int64 num_bytes =
+      TensorShape(tensor->tensor_shape()).num_elements() *
+      DataTypeSize(tensor->dtype());
+  string* content = tensor->mutable_tensor_content();
+  content->resize(num_bytes);
+  TF_RETURN_IF_ERROR(UncompressTensorContent(
+      meta_.compression_algorithm(), meta_.compressed_tensor_content(),
+      &(*content)[0], num_bytes));
+  meta_.clear_compression_algorithm();
+  meta_.clear_compressed_tensor_content();
+  return Status::OK();
+}
+
 }  // namespace tensorflow
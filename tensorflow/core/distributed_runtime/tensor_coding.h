@@ -92,6 +92,9 @@ class TensorResponse {
                              TensorProto* tensor_meta);
   bool ParseFast(Source* source);
   bool ParseSlow(Source* source);
+  // If the sender compressed the content of the tensor of meta_, restores
+  // it into meta_.tensor().tensor_content().
+  Status UncompressContent();
 
   bool on_host_ = false;
   DeviceBase* device_ = nullptr;
@@ -15,10 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -46,6 +48,35 @@ class DummyDevice : public DeviceBase {
   DeviceAttributes attr_;
 };
 
+// A device that, like a GPU, parses a tensor into host memory and then
+// "copies" it to itself.
+class DummyAcceleratorDevice : public DeviceBase {
+ public:
+  explicit DummyAcceleratorDevice(Env* env) : DeviceBase(env) {
+    attr_.set_device_type("ACCELERATOR");
+  }
+
+  const DeviceAttributes& attributes() const override { return attr_; }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override {
+    return cpu_allocator();
+  }
+
+  Status MakeTensorFromProto(const TensorProto& tensor_proto,
+                             const AllocatorAttributes alloc_attrs,
+                             Tensor* tensor) override {
+    Tensor parsed(tensor_proto.dtype());
+    if (!parsed.FromProto(cpu_allocator(), tensor_proto)) {
+      return errors::InvalidArgument("Cannot parse tensor from proto");
+    }
+    *tensor = parsed;
+    return Status::OK();
+  }
+
+ private:
+  DeviceAttributes attr_;
+};
+
 class StringSource : public TensorResponse::Source {
  public:
   explicit StringSource(const string* s, int block_size)
@@ -156,6 +187,63 @@ TEST_F(TensorResponseTest, Simple) {
 
 TEST_F(TensorResponseTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+// Returns a RecvTensorResponse holding `src` with its content compressed
+// with `algorithm`.
+static RecvTensorResponse MakeCompressedResponse(const Tensor& src,
+                                                 const char* algorithm) {
+  RecvTensorResponse proto;
+  proto.set_send_start_micros(123456);
+  proto.mutable_tensor()->set_dtype(src.dtype());
+  src.shape().AsProto(proto.mutable_tensor()->mutable_tensor_shape());
+  proto.set_compression_algorithm(algorithm);
+  TF_CHECK_OK(CompressTensorContent(algorithm, 0, src.tensor_data(),
+                                    proto.mutable_compressed_tensor_content()));
+  return proto;
+}
+
+TEST_F(TensorResponseTest, CompressedContent) {
+  Tensor src(DT_INT64, TensorShape({100, 100}));
+  test::FillFn<int64>(&src, [](int i) { return i % 17 == 0 ? i : 0; });
+  string encoded;
+  MakeCompressedResponse(src, tensor_compression::kZlib)
+      .AppendToString(&encoded);
+
+  DummyDevice cpu_device(Env::Default());
+  // The small block size splits the compressed content across blocks.
+  for (int block_size : {-1, 7}) {
+    StringSource source(&encoded, block_size);
+    TensorResponse response;
+    response.InitAlloc(&cpu_device, AllocatorAttributes());
+    TF_ASSERT_OK(response.ParseFrom(&source));
+    EXPECT_EQ(123456, response.metadata().send_start_micros());
+    test::ExpectTensorEqual<int64>(src, response.tensor());
+  }
+
+  RecvTensorResponse proto =
+      MakeCompressedResponse(src, tensor_compression::kZlib);
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  TF_ASSERT_OK(response.InitFrom(&proto));
+  test::ExpectTensorEqual<int64>(src, response.tensor());
+}
+
+TEST_F(TensorResponseTest, CorruptCompressedContent) {
+  Tensor src(DT_FLOAT, TensorShape({1000}));
+  test::FillFn<float>(&src, [](int i) { return i % 10; });
+  RecvTensorResponse proto =
+      MakeCompressedResponse(src, tensor_compression::kZlib);
+  proto.mutable_compressed_tensor_content()->resize(
+      proto.compressed_tensor_content().size() / 2);
+  string encoded;
+  proto.AppendToString(&encoded);
+
+  StringSource source(&encoded, 1024);
+  DummyDevice cpu_device(Env::Default());
+  TensorResponse response;
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  EXPECT_FALSE(response.ParseFrom(&source).ok());
+}
+
 string MakeFloatTensorTestCase(int num_elems) {
   std::vector<int8> v(num_elems);
   for (int i = 0; i < num_elems; i++) {
@@ -207,4 +295,43 @@ static void BM_TensorViaTensorProto(int iters, int arg) {
 }
 BENCHMARK(BM_TensorViaTensorProto)->Arg(0)->Arg(1000)->Arg(100000);
 
+// Parses a response for a tensor on an accelerator. With `via_host`, the
+// response is parsed into host memory, as the rendezvous does before copying
+// the tensor to the device; otherwise the device parses the response.
+static void BM_TensorResponseForAccelerator(int iters, int arg,
+                                            bool via_host) {
+  testing::StopTiming();
+  string encoded = MakeFloatTensorTestCase(arg);
+  DummyAcceleratorDevice device(Env::Default());
+  AllocatorAttributes alloc_attrs;
+  if (via_host) {
+    alloc_attrs.set_on_host(true);
+    alloc_attrs.set_gpu_compatible(true);
+  }
+  testing::BytesProcessed(static_cast<int64>(iters) * arg);
+  testing::StartTiming();
+  while (--iters > 0) {
+    TensorResponse response;
+    response.InitAlloc(&device, alloc_attrs);
+    StringSource source(&encoded, -1);
+    TF_CHECK_OK(response.ParseFrom(&source));
+  }
+}
+
+static void BM_TensorResponseForAcceleratorViaProto(int iters, int arg) {
+  BM_TensorResponseForAccelerator(iters, arg, false);
+}
+BENCHMARK(BM_TensorResponseForAcceleratorViaProto)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Arg(10000000);
+
+static void BM_TensorResponseForAcceleratorViaHost(int iters, int arg) {
+  BM_TensorResponseForAccelerator(iters, arg, true);
+}
+BENCHMARK(BM_TensorResponseForAcceleratorViaHost)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Arg(10000000);
+
 }  // namespace tensorflow
@@ -0,0 +1,121 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
+
+#include <zlib.h>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/snappy.h"
+
+namespace tensorflow {
+
+namespace tensor_compression {
+
+const char kNone[] = "";
+const char kSnappy[] = "snappy";
+const char kZlib[] = "zlib";
+
+}  // namespace tensor_compression
+
+Status ValidateTensorCompression(StringPiece algorithm, int level) {
+  if (algorithm == tensor_compression::kZlib && (level < 0 || level > 9)) {
+    return errors::InvalidArgument("Invalid zlib compression level ", level);
+  }
+  if (algorithm == tensor_compression::kSnappy) {
+    string unused;
+    if (!port::Snappy_Compress("", 0, &unused)) {
+      return errors::Unimplemented("Snappy compression is not available");
+    }
+    return Status::OK();
+  }
+  if (algorithm == tensor_compression::kNone ||
+      algorithm == tensor_compression::kZlib) {
+    return Status::OK();
+  }
+  return errors::InvalidArgument("Unknown tensor compression algorithm: \"",
+                                 algorithm, "\"");
+}
+
+Status CompressTensorContent(StringPiece algorithm, int level,
+                             StringPiece input, string* output) {
+  if (algorithm == tensor_compression::kSnappy) {
+    if (!port::Snappy_Compress(input.data(), input.size(), output)) {
+      return errors::Unimplemented("Snappy compression is not available");
+    }
+    return Status::OK();
+  }
+  if (algorithm == tensor_compression::kZlib) {
+    TF_RETURN_IF_ERROR(ValidateTensorCompression(algorithm, level));
+    uLongf output_size = compressBound(input.size());
+    output->resize(output_size);
+    const int ret = compress2(
+        reinterpret_cast<Bytef*>(&(*output)[0]), &output_size,
+        reinterpret_cast<const Bytef*>(input.data()), input.size(),
+        level == 0 ? Z_DEFAULT_COMPRESSION : level);
+    if (ret != Z_OK) {
+      return errors::Internal("zlib compression failed with code ", ret);
+    }
+    output->resize(output_size);
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(ValidateTensorCompression(algorithm, level));
+  output->assign(input.data(), input.size());
+  return Status::OK();
+}
+
+Status UncompressTensorContent(StringPiece algorithm, StringPiece input,
+                               char* output, size_t output_size) {
+  if (algorithm == tensor_compression::kSnappy) {
+    size_t uncompressed_size;
+    if (!port::Snappy_GetUncompressedLength(input.data(), input.size(),
+                                            &uncompressed_size)) {
+      return errors::DataLoss("Corrupt snappy compressed tensor content");
+    }
+    if (uncompressed_size != output_size) {
+      return errors::DataLoss("Compressed tensor content holds ",
+                              uncompressed_size, " bytes, expected ",
+                              output_size);
+    }
+    if (!port::Snappy_Uncompress(input.data(), input.size(), output)) {
+      return errors::DataLoss("Corrupt snappy compressed tensor content");
+    }
+    return Status::OK();
+  }
+  if (algorithm == tensor_compression::kZlib) {
+    uLongf uncompressed_size = output_size;
+    const int ret =
+        uncompress(reinterpret_cast<Bytef*>(output), &uncompressed_size,
+                   reinterpret_cast<const Bytef*>(input.data()), input.size());
+    if (ret != Z_OK) {
+      return errors::DataLoss("zlib uncompression failed with code ", ret);
+    }
+    if (uncompressed_size != output_size) {
+      return errors::DataLoss("Compressed tensor content holds ",
+                              uncompressed_size, " bytes, expected ",
+                              output_size);
+    }
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(ValidateTensorCompression(algorithm, 0));
+  if (input.size() != output_size) {
+    return errors::DataLoss("Tensor content holds ", input.size(),
+                            " bytes, expected ", output_size);
+  }
+  memcpy(output, input.data(), output_size);
+  return Status::OK();
+}
+
+}  // namespace tensorflow
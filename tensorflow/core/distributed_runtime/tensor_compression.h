@@ -0,0 +1,54 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Codecs for the content of the tensors that workers send one another,
+// as named by RPCOptions.tensor_compression_algorithm and
+// RecvTensorResponse.compression_algorithm.
+namespace tensor_compression {
+
+extern const char kNone[];
+extern const char kSnappy[];
+extern const char kZlib[];
+
+}  // namespace tensor_compression
+
+// Returns OK if `algorithm` names a codec above that this build supports,
+// and `level` is a valid compression level for it.
+Status ValidateTensorCompression(StringPiece algorithm, int level);
+
+// Compresses `input` with `algorithm` into *output.  `level` is the zlib
+// compression level from 1 to 9, 0 selecting the zlib default; snappy
+// ignores it.
+Status CompressTensorContent(StringPiece algorithm, int level,
+                             StringPiece input, string* output);
+
+// Uncompresses `input`, compressed with `algorithm`, into the
+// `output_size` bytes at `output`.  Fails if `input` does not uncompress
+// to exactly `output_size` bytes.
+Status UncompressTensorContent(StringPiece algorithm, StringPiece input,
+                               char* output, size_t output_size);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_COMPRESSION_H_
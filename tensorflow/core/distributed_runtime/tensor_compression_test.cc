@@ -0,0 +1,106 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/tensor_compression.h"
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Content that compresses well: mostly zeros, like a sparse gradient.
+string MakeContent(size_t size) {
+  string content(size, 0);
+  for (size_t i = 0; i < size; i += 37) {
+    content[i] = static_cast<char>(i);
+  }
+  return content;
+}
+
+bool SnappyAvailable() {
+  string out;
+  return port::Snappy_Compress("x", 1, &out);
+}
+
+void RoundTrip(const char* algorithm, int level) {
+  const string content = MakeContent(1 << 16);
+  string compressed;
+  TF_ASSERT_OK(CompressTensorContent(algorithm, level, content, &compressed));
+  if (StringPiece(algorithm) != tensor_compression::kNone) {
+    EXPECT_LT(compressed.size(), content.size() / 4);
+  }
+  string uncompressed(content.size(), 1);
+  TF_ASSERT_OK(UncompressTensorContent(algorithm, compressed, &uncompressed[0],
+                                       uncompressed.size()));
+  EXPECT_EQ(content, uncompressed);
+
+  // The sizes must match exactly.
+  string too_small(content.size() - 1, 0);
+  EXPECT_FALSE(UncompressTensorContent(algorithm, compressed, &too_small[0],
+                                       too_small.size())
+                   .ok());
+}
+
+TEST(TensorCompressionTest, None) { RoundTrip(tensor_compression::kNone, 0); }
+
+TEST(TensorCompressionTest, Zlib) {
+  RoundTrip(tensor_compression::kZlib, 0);
+  RoundTrip(tensor_compression::kZlib, 1);
+  RoundTrip(tensor_compression::kZlib, 9);
+}
+
+TEST(TensorCompressionTest, Snappy) {
+  if (!SnappyAvailable()) {
+    string compressed;
+    EXPECT_TRUE(errors::IsUnimplemented(CompressTensorContent(
+        tensor_compression::kSnappy, 0, "x", &compressed)));
+    return;
+  }
+  RoundTrip(tensor_compression::kSnappy, 0);
+}
+
+TEST(TensorCompressionTest, CorruptInput) {
+  const string content = MakeContent(1 << 12);
+  string compressed;
+  TF_ASSERT_OK(CompressTensorContent(tensor_compression::kZlib, 0, content,
+                                     &compressed));
+  compressed.resize(compressed.size() / 2);
+  string uncompressed(content.size(), 0);
+  EXPECT_TRUE(errors::IsDataLoss(
+      UncompressTensorContent(tensor_compression::kZlib, compressed,
+                              &uncompressed[0], uncompressed.size())));
+}
+
+TEST(TensorCompressionTest, InvalidArguments) {
+  TF_EXPECT_OK(ValidateTensorCompression("", 0));
+  EXPECT_EQ(SnappyAvailable(), ValidateTensorCompression("snappy", 0).ok());
+  TF_EXPECT_OK(ValidateTensorCompression("zlib", 0));
+  TF_EXPECT_OK(ValidateTensorCompression("zlib", 9));
+  EXPECT_TRUE(errors::IsInvalidArgument(ValidateTensorCompression("zlib", 10)));
+  EXPECT_TRUE(errors::IsInvalidArgument(ValidateTensorCompression("zlib", -1)));
+  EXPECT_TRUE(errors::IsInvalidArgument(ValidateTensorCompression("gzip", 0)));
+
+  string compressed;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      CompressTensorContent("gzip", 0, "abc", &compressed)));
+  EXPECT_TRUE(errors::IsInvalidArgument(CompressTensorContent(
+      tensor_compression::kZlib, 10, "abc", &compressed)));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -14,10 +14,13 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/framework/collective.h"
 
+#include <unordered_map>
+
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/mutex.h"
 
 namespace tensorflow {
 
@@ -39,6 +42,9 @@ CollInstanceParams& CollInstanceParams::operator=(
     device_names.assign(other.device_names.begin(), other.device_names.end());
     task_names.assign(other.task_names.begin(), other.task_names.end());
     same_num_devices_per_task = other.same_num_devices_per_task;
+    compression = other.compression;
+    topk_fraction = other.topk_fraction;
+    impl_details.collective_name = other.impl_details.collective_name;
     impl_details.subdiv_offsets.assign(
         other.impl_details.subdiv_offsets.begin(),
         other.impl_details.subdiv_offsets.end());
@@ -57,7 +63,14 @@ CollInstanceParams& CollInstanceParams::operator=(
 string CollInstanceParams::ToString() const {
   string v = strings::StrCat("CollInstanceParams { instance_key=", instance_key,
                              " type=", type, " data_type=", data_type,
-                             " shape=", shape.DebugString(), " devices {");
+                             " shape=", shape.DebugString());
+  if (compression != COMPRESSION_NONE) {
+    strings::StrAppend(&v, " compression=", compression);
+    if (compression == COMPRESSION_TOPK) {
+      strings::StrAppend(&v, " topk_fraction=", topk_fraction);
+    }
+  }
+  strings::StrAppend(&v, " devices {");
   for (const auto& d : device_names) {
     strings::StrAppend(&v, d, ",");
   }
@@ -65,7 +78,8 @@ string CollInstanceParams::ToString() const {
   for (const auto& n : task_names) {
     strings::StrAppend(&v, n, ", ");
   }
-  strings::StrAppend(&v, "}, subdiv_offsets={");
+  strings::StrAppend(&v, "}, collective_name=", impl_details.collective_name,
+                     ", subdiv_offsets={");
   for (const auto& d : impl_details.subdiv_offsets) {
     strings::StrAppend(&v, d, ",");
   }
@@ -97,6 +111,16 @@ string CollTaskParams::ToString() const {
   return v;
 }
 
+Tensor CollectiveResiduals::Get(int64 chunk_key, int64 num_elements) {
+  mutex_lock l(mu_);
+  Tensor& residual = residuals_[chunk_key];
+  if (!residual.IsInitialized() || residual.NumElements() != num_elements) {
+    residual = Tensor(cpu_allocator(), DT_FLOAT, TensorShape({num_elements}));
+    residual.flat<float>().setZero();
+  }
+  return residual;
+}
+
 string CollectiveParams::ToString() const {
   string v = strings::StrCat("CollectiveParams ", name, " {", group.ToString());
   strings::StrAppend(&v, " ", instance.ToString());
@@ -118,4 +142,47 @@ string CollectiveParams::ToString() const {
 /*static*/
 int64 CollectiveExecutor::kInvalidId = -1;
 
+namespace {
+struct RegisteredCollective {
+  CollectiveType type;
+  CollectiveRegistry::Factory factory;
+};
+
+mutex* RegistryMutex() {
+  static mutex* mu = new mutex;
+  return mu;
+}
+
+std::unordered_map<string, RegisteredCollective>* Registry() {
+  static auto* registry =
+      new std::unordered_map<string, RegisteredCollective>;
+  return registry;
+}
+}  // namespace
+
+/*static*/
+void CollectiveRegistry::Register(const string& name, CollectiveType type,
+                                  Factory factory) {
+  mutex_lock l(*RegistryMutex());
+  CHECK(Registry()->insert({name, {type, std::move(factory)}}).second)
+      << "Collective implementation " << name << " registered twice";
+}
+
+/*static*/
+Status CollectiveRegistry::Lookup(const string& name, CollectiveType type,
+                                  Factory* factory) {
+  mutex_lock l(*RegistryMutex());
+  auto it = Registry()->find(name);
+  if (it == Registry()->end()) {
+    return errors::NotFound("No collective implementation named ", name);
+  }
+  if (it->second.type != type) {
+    return errors::InvalidArgument("Collective implementation ", name,
+                                   " does not execute collectives of type ",
+                                   type);
+  }
+  *factory = it->second.factory;
+  return Status::OK();
+}
+
 }  // namespace tensorflow
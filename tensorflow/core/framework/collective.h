@@ -15,7 +15,9 @@ limitations under the License.
 #ifndef TENSORFLOW_FRAMEWORK_COLLECTIVE_EXECUTOR_H_
 #define TENSORFLOW_FRAMEWORK_COLLECTIVE_EXECUTOR_H_
 
+#include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "tensorflow/core/framework/device_base.h"
@@ -31,6 +33,7 @@ class CompleteGroupResponse;
 class CompleteInstanceRequest;
 class CompleteInstanceResponse;
 class DeviceLocality;
+class DeviceMgr;
 class GetStepSequenceRequest;
 class GetStepSequenceResponse;
 class Op;
@@ -40,9 +43,23 @@ class Tensor;
 enum CollectiveType {
   REDUCTION_COLLECTIVE = 0,
   BROADCAST_COLLECTIVE,
+  GATHER_COLLECTIVE,
   UNDEFINED_COLLECTIVE,
 };
 
+// Wire formats of the values that a reduction collective exchanges between
+// devices. All but COMPRESSION_NONE are lossy and apply to DT_FLOAT values
+// on CPU devices only.
+enum CollectiveCompression {
+  COMPRESSION_NONE = 0,
+  // Values are rounded to bfloat16, or to IEEE float16.
+  COMPRESSION_BFLOAT16,
+  COMPRESSION_FLOAT16,
+  // Only the largest values by magnitude are sent, and the others are carried
+  // over to the next execution of the collective (error feedback).
+  COMPRESSION_TOPK,
+};
+
 // Data common to all members of a device group.
 // All members share the same device set but its order is
 // particular to an instance so it is stored there.
@@ -64,6 +81,10 @@ struct CollGroupParams {
 // interpretation.  On first execution the runtime will update this
 // structure with decisions that will guide all subsequent executions.
 struct CollImplDetails {
+  // Name of the CollectiveRegistry implementation that executes the
+  // collective.  If empty, the executor picks one for each execution from
+  // the tensor size and group topology.
+  string collective_name;
   std::vector<std::vector<int>> subdiv_permutations;
   std::vector<int> subdiv_offsets;
   // broadcast only: rank of source in each subdiv
@@ -83,6 +104,10 @@ struct CollInstanceParams {
   std::vector<string> task_names;
   // True if every task has the same number of devices.
   bool same_num_devices_per_task = false;
+  // Reduction only: the wire format of the values exchanged, and for
+  // COMPRESSION_TOPK the fraction of the values of each chunk that are sent.
+  CollectiveCompression compression = COMPRESSION_NONE;
+  float topk_fraction = 0.01;
   CollImplDetails impl_details;
   string ToString() const;
   CollInstanceParams& operator=(const struct CollInstanceParams& other);
@@ -95,6 +120,20 @@ struct CollTaskParams {
   string ToString() const;
 };
 
+// Error-feedback state of a reduction with COMPRESSION_TOPK: for each chunk
+// that a device sends, the values that earlier executions did not send.
+class CollectiveResiduals {
+ public:
+  // Returns the residual of chunk `chunk_key`, a DT_FLOAT tensor of
+  // `num_elements` zeros on first use. A residual must not be used by two
+  // executions at once.
+  Tensor Get(int64 chunk_key, int64 num_elements);
+
+ private:
+  mutex mu_;
+  std::unordered_map<int64, Tensor> residuals_ GUARDED_BY(mu_);
+};
+
 // Unique to a single CollectiveOp node.
 struct CollectiveParams {
   CollGroupParams group;
@@ -108,6 +147,9 @@ struct CollectiveParams {
   std::vector<int> subdiv_rank;
   std::unique_ptr<OpKernel> merge_op;  // reduction only
   std::unique_ptr<OpKernel> final_op;  // reduction only
+  // COMPRESSION_TOPK only. Owned by the op, so that the residuals last as
+  // long as its kernel.
+  std::unique_ptr<CollectiveResiduals> residuals;
   string ToString() const;
 };
 
@@ -239,6 +281,63 @@ class PeerAccessInterface {
 
 class PerStepCollectiveRemoteAccess;
 
+// An algorithm that executes one collective op on one device.  An instance
+// is created by a CollectiveRegistry factory for every execution.
+class CollectiveImplementationInterface {
+ public:
+  virtual ~CollectiveImplementationInterface() {}
+
+  // Executes the collective and then calls `done`.  May block, so must be
+  // called in a thread that can be blocked.
+  virtual void Run(StatusCallback done) = 0;
+};
+
+// Process-wide table of the algorithms that can execute collectives,
+// keyed by name.
+class CollectiveRegistry {
+ public:
+  // Creates the implementation that executes `col_params` on behalf of the
+  // op of `ctx`.  `input` is null for ops without inputs.
+  typedef std::function<CollectiveImplementationInterface*(
+      CollectiveExecutor* col_exec, const DeviceMgr* dev_mgr,
+      OpKernelContext* ctx, OpKernelContext::Params* params,
+      const CollectiveParams& col_params, const string& exec_key,
+      int64 step_id, const Tensor* input, Tensor* output)>
+      Factory;
+
+  // Registers `factory` as the implementation `name` of collectives of
+  // `type`.  Dies if `name` is already registered.
+  static void Register(const string& name, CollectiveType type,
+                       Factory factory);
+
+  // Sets *factory to the implementation `name`, or returns an error if
+  // there is none for collectives of `type`.
+  static Status Lookup(const string& name, CollectiveType type,
+                       Factory* factory);
+};
+
+namespace collective_registration {
+
+class CollectiveRegistration {
+ public:
+  CollectiveRegistration(const string& name, CollectiveType type,
+                         CollectiveRegistry::Factory factory) {
+    CollectiveRegistry::Register(name, type, std::move(factory));
+  }
+};
+
+}  // namespace collective_registration
+
+#define REGISTER_COLLECTIVE(name, type, factory) \
+  REGISTER_COLLECTIVE_UNIQ_HELPER(__COUNTER__, name, type, factory)
+
+#define REGISTER_COLLECTIVE_UNIQ_HELPER(ctr, name, type, factory) \
+  REGISTER_COLLECTIVE_UNIQ(ctr, name, type, factory)
+
+#define REGISTER_COLLECTIVE_UNIQ(ctr, name, type, factory)         \
+  static ::tensorflow::collective_registration::CollectiveRegistration \
+      register_collective_##ctr(name, type, factory)
+
 // A step-specific object that can execute a collective operation completely
 // described by a CollectiveParams object.
 class CollectiveExecutor : public PeerAccessInterface, public core::RefCounted {
@@ -315,6 +315,24 @@ void BackgroundWorker::WorkerLoop() {
   }
 }
 
+model::Node* DatasetBaseIterator::LookupModelNode(IteratorContext* ctx) {
+  mutex_lock l(model_mu_);
+  if (model_node_ == nullptr) {
+    model_ = ctx->model();
+    model_node_ = model_->LookupNode(params_.prefix);
+  }
+  return model_node_;
+}
+
+dataset_metrics::StageMetrics* DatasetBaseIterator::LookupStageMetrics(
+    IteratorContext* ctx) {
+  dataset_metrics::StageMetrics* metrics =
+      dataset_metrics::GetStageMetrics(ctx->pipeline_name(), params_.prefix);
+  // Racing lookups get the same metrics.
+  stage_metrics_.store(metrics, std::memory_order_release);
+  return metrics;
+}
+
 namespace dataset {
 
 IteratorContext MakeIteratorContext(OpKernelContext* ctx) {
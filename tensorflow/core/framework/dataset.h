@@ -15,14 +15,18 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_DATASET_H_
 #define TENSORFLOW_CORE_FRAMEWORK_DATASET_H_
 
+#include <atomic>
 #include <deque>
 #include <memory>
 
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/dataset_metrics.h"
 #include "tensorflow/core/framework/dataset_stateful_op_whitelist.h"
+#include "tensorflow/core/framework/dataset_thread_pool.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -272,6 +276,20 @@ class IteratorContext {
 
     // The Allocator to be used to allocate the output of an iterator.
     std::function<Allocator*(AllocatorAttributes)> allocator_getter = nullptr;
+
+    // The performance model of the input pipeline, if any, through which
+    // iterators report metrics and get their auto-tuned parameters.
+    std::shared_ptr<model::Model> model = nullptr;
+
+    // The pool on which iterators that support it run their background work,
+    // in place of threads of their own, and the id under which the pool
+    // schedules the work of this input pipeline. Not owned.
+    DatasetThreadPool* thread_pool = nullptr;
+    int64 pipeline_id = 0;
+
+    // The name under which iterators export their metrics (see
+    // dataset_metrics.h), or empty if they do not.
+    string pipeline_name;
   };
 
   explicit IteratorContext(Params params) : params_(std::move(params)) {}
@@ -310,6 +328,27 @@ class IteratorContext {
     return params_.stats_aggregator_getter;
   }
 
+  const std::shared_ptr<model::Model>& model() { return params_.model; }
+
+  void set_model(std::shared_ptr<model::Model> model) {
+    params_.model = std::move(model);
+  }
+
+  DatasetThreadPool* thread_pool() { return params_.thread_pool; }
+
+  int64 pipeline_id() { return params_.pipeline_id; }
+
+  void set_thread_pool(DatasetThreadPool* thread_pool, int64 pipeline_id) {
+    params_.thread_pool = thread_pool;
+    params_.pipeline_id = pipeline_id;
+  }
+
+  const string& pipeline_name() { return params_.pipeline_name; }
+
+  void set_pipeline_name(const string& pipeline_name) {
+    params_.pipeline_name = pipeline_name;
+  }
+
  private:
   Params params_;
 };
@@ -544,7 +583,17 @@ class DatasetBaseIterator : public IteratorBase {
   Status GetNext(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
                  bool* end_of_sequence) final {
     tracing::ScopedActivity activity(params_.prefix);
-    Status s = GetNextInternal(ctx, out_tensors, end_of_sequence);
+    dataset_metrics::ScopedGetNext call(ctx->env(), stage_metrics(ctx));
+    Status s;
+    model::Node* node = model_node(ctx);
+    if (node != nullptr) {
+      model::ScopedProcessing processing(ctx->env(), node);
+      s = GetNextInternal(ctx, out_tensors, end_of_sequence);
+      if (s.ok() && !*end_of_sequence) node->record_element();
+    } else {
+      s = GetNextInternal(ctx, out_tensors, end_of_sequence);
+    }
+    if (s.ok() && !*end_of_sequence) call.RecordElement();
     if (TF_PREDICT_FALSE(errors::IsOutOfRange(s) && !*end_of_sequence)) {
       s = errors::Internal(
           "Iterator \"", params_.prefix,
@@ -571,8 +620,44 @@ class DatasetBaseIterator : public IteratorBase {
     return strings::StrCat(params_.prefix, ":", name);
   }
 
+  // Returns the node of this iterator in the performance model of `ctx`, or
+  // nullptr if there is no model or it is not collecting metrics.
+  model::Node* model_node(IteratorContext* ctx) {
+    model::Node* node = model_node_.load(std::memory_order_acquire);
+    if (TF_PREDICT_TRUE(node != nullptr || !ctx->model() ||
+                        !ctx->model()->collecting())) {
+      return node;
+    }
+    return LookupModelNode(ctx);
+  }
+
+  // Returns the metrics that this iterator exports, or nullptr if `ctx` has
+  // no pipeline name.
+  dataset_metrics::StageMetrics* stage_metrics(IteratorContext* ctx) {
+    dataset_metrics::StageMetrics* metrics =
+        stage_metrics_.load(std::memory_order_acquire);
+    if (TF_PREDICT_TRUE(metrics != nullptr || ctx->pipeline_name().empty())) {
+      return metrics;
+    }
+    return LookupStageMetrics(ctx);
+  }
+
+  // Exports the number of elements in the buffer of this iterator.
+  void RecordBufferSize(IteratorContext* ctx, int64 size) {
+    dataset_metrics::StageMetrics* metrics = stage_metrics(ctx);
+    if (metrics != nullptr) metrics->buffer_size->Set(size);
+  }
+
  private:
+  model::Node* LookupModelNode(IteratorContext* ctx);
+  dataset_metrics::StageMetrics* LookupStageMetrics(IteratorContext* ctx);
+
   BaseParams params_;
+  mutex model_mu_;
+  // Keeps the nodes of `model_` alive.
+  std::shared_ptr<model::Model> model_ GUARDED_BY(model_mu_);
+  std::atomic<model::Node*> model_node_{nullptr};
+  std::atomic<dataset_metrics::StageMetrics*> stage_metrics_{nullptr};
 };
 
 // Represents an iterator that is associated with a particular dataset
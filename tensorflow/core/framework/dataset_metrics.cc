@@ -0,0 +1,133 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/dataset_metrics.h"
+
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace dataset_metrics {
+namespace {
+
+// The `ScopedGetNext` that is innermost on this thread.
+thread_local ScopedGetNext* current_call = nullptr;
+
+// Latency buckets from 1us to about 16s.
+std::unique_ptr<monitoring::Buckets> LatencyBuckets() {
+  return monitoring::Buckets::Exponential(1, 2, 25);
+}
+
+StageMetrics* NewStageMetrics(const string& pipeline, const string& stage) {
+  static auto* elements = monitoring::Counter<2>::New(
+      "/tensorflow/data/iterator/elements",
+      "The number of elements produced by an input pipeline stage.",
+      "pipeline", "stage");
+  static auto* get_next_usecs = monitoring::Sampler<2>::New(
+      {"/tensorflow/data/iterator/get_next_usecs",
+       "The time spent producing an element by an input pipeline stage, in "
+       "microseconds. Sampled.",
+       "pipeline", "stage"},
+      LatencyBuckets());
+  static auto* input_usecs = monitoring::Sampler<2>::New(
+      {"/tensorflow/data/iterator/input_usecs",
+       "The part of get_next_usecs that an input pipeline stage spent "
+       "getting or waiting for elements from its inputs, in microseconds. "
+       "Sampled.",
+       "pipeline", "stage"},
+      LatencyBuckets());
+  static auto* buffer_size = monitoring::Gauge<int64, 2>::New(
+      "/tensorflow/data/iterator/buffer_size",
+      "The number of elements buffered by an input pipeline stage.",
+      "pipeline", "stage");
+
+  StageMetrics* metrics = new StageMetrics;
+  metrics->elements = elements->GetCell(pipeline, stage);
+  metrics->get_next_usecs = get_next_usecs->GetCell(pipeline, stage);
+  metrics->input_usecs = input_usecs->GetCell(pipeline, stage);
+  metrics->buffer_size = buffer_size->GetCell(pipeline, stage);
+  return metrics;
+}
+
+}  // namespace
+
+/* static */
+StageMetricsRegistry* StageMetricsRegistry::Global() {
+  static StageMetricsRegistry* registry = new StageMetricsRegistry(kMaxStages);
+  return registry;
+}
+
+StageMetrics* StageMetricsRegistry::Get(const string& pipeline,
+                                        const string& prefix) {
+  const string stage = model::NodeName(prefix);
+  mutex_lock l(mu_);
+  auto it = stages_.find({pipeline, stage});
+  if (it != stages_.end()) return it->second.get();
+  if (static_cast<int>(stages_.size()) < max_stages_) {
+    StageMetrics* metrics = NewStageMetrics(pipeline, stage);
+    stages_[{pipeline, stage}].reset(metrics);
+    return metrics;
+  }
+  if (!overflow_) {
+    LOG(WARNING) << "More than " << max_stages_
+                 << " tf.data pipeline stages export metrics; the stages of "
+                    "new pipelines share the label "
+                 << kOverflowLabel << ".";
+    overflow_.reset(NewStageMetrics(kOverflowLabel, kOverflowLabel));
+  }
+  return overflow_.get();
+}
+
+StageMetrics* GetStageMetrics(const string& pipeline, const string& prefix) {
+  return StageMetricsRegistry::Global()->Get(pipeline, prefix);
+}
+
+ScopedGetNext::ScopedGetNext(Env* env, StageMetrics* metrics)
+    : env_(env), metrics_(metrics), parent_(current_call) {
+  if (metrics_ == nullptr) return;
+  // The calls nested in a timed call are timed too, so that the caller's time
+  // on input is known.
+  const uint64 num_calls =
+      metrics_->num_calls.load(std::memory_order_relaxed);
+  metrics_->num_calls.store(num_calls + 1, std::memory_order_relaxed);
+  if ((parent_ != nullptr && parent_->start_ != 0) ||
+      num_calls % kSamplingPeriod == 0) {
+    start_ = env_->NowNanos();
+  }
+  current_call = this;
+}
+
+ScopedGetNext::~ScopedGetNext() {
+  if (metrics_ == nullptr) return;
+  current_call = parent_;
+  if (start_ == 0) return;
+  const uint64 elapsed = env_->NowNanos() - start_;
+  metrics_->get_next_usecs->Add(elapsed / 1000.0);
+  metrics_->input_usecs->Add(input_nanos_ / 1000.0);
+  if (parent_ != nullptr) parent_->input_nanos_ += elapsed;
+}
+
+ScopedInputWait::ScopedInputWait(Env* env)
+    : env_(env),
+      call_(current_call != nullptr && current_call->start_ != 0
+                ? current_call
+                : nullptr),
+      start_(call_ != nullptr ? env->NowNanos() : 0) {}
+
+ScopedInputWait::~ScopedInputWait() {
+  if (call_ != nullptr) call_->input_nanos_ += env_->NowNanos() - start_;
+}
+
+}  // namespace dataset_metrics
+}  // namespace tensorflow
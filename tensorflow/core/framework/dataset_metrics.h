@@ -0,0 +1,145 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_FRAMEWORK_DATASET_METRICS_H_
+#define TENSORFLOW_CORE_FRAMEWORK_DATASET_METRICS_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace dataset_metrics {
+
+// Metrics of the iterators of input pipelines, exported to the monitoring
+// collection registry with the labels "pipeline" (the shared name of the
+// iterator, or else the name of the iterator op's node, which stay the same
+// when the pipeline is re-created) and "stage" (the iterator's prefix without
+// per-element indices, e.g. "Iterator::Prefetch::Map"):
+//
+//   /tensorflow/data/iterator/elements: the number of elements produced.
+//   /tensorflow/data/iterator/get_next_usecs: the time spent in `GetNext`.
+//   /tensorflow/data/iterator/input_usecs: the part of that time spent in the
+//     `GetNext` of the iterator's inputs, or waiting for a background thread
+//     to produce an element from them.
+//   /tensorflow/data/iterator/buffer_size: the number of elements buffered by
+//     the iterators that have a buffer (e.g. prefetch), when last measured.
+//
+// Elements are counted on every call, but reading the clock costs about as
+// much as the `GetNext` of a cheap iterator, so only one call in
+// `kSamplingPeriod` is timed, along with the calls nested in it.
+//
+// The monitoring library cannot delete cells, so the number of stages is
+// bounded: past `kMaxStages`, the stages of new pipelines share the cells
+// labelled `kOverflowLabel`.
+
+constexpr int64 kSamplingPeriod = 64;
+constexpr int kMaxStages = 4096;
+constexpr char kOverflowLabel[] = "<overflow>";
+
+// The cells of one stage of one pipeline. Never deleted.
+struct StageMetrics {
+  monitoring::CounterCell* elements;
+  monitoring::SamplerCell* get_next_usecs;
+  monitoring::SamplerCell* input_usecs;
+  monitoring::GaugeCell<int64>* buffer_size;
+  // The number of calls to `GetNext`, which decides the calls that are timed.
+  // Incremented without synchronization, since a lost increment only shifts
+  // the calls that are timed.
+  std::atomic<uint64> num_calls{0};
+};
+
+// The metrics of the stages of input pipelines, by pipeline and stage, with
+// at most `max_stages` stages. Thread-safe.
+class StageMetricsRegistry {
+ public:
+  explicit StageMetricsRegistry(int max_stages) : max_stages_(max_stages) {}
+
+  // The registry used by `GetStageMetrics()`.
+  static StageMetricsRegistry* Global();
+
+  // Returns the metrics of the iterators with prefix `prefix` in the pipeline
+  // `pipeline`, or the overflow metrics if the registry is full.
+  StageMetrics* Get(const string& pipeline, const string& prefix)
+      LOCKS_EXCLUDED(mu_);
+
+ private:
+  const int max_stages_;
+  mutex mu_;
+  std::map<std::pair<string, string>, std::unique_ptr<StageMetrics>> stages_
+      GUARDED_BY(mu_);
+  std::unique_ptr<StageMetrics> overflow_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StageMetricsRegistry);
+};
+
+// Returns the metrics of the iterators with prefix `prefix` in the pipeline
+// `pipeline`. Thread-safe.
+StageMetrics* GetStageMetrics(const string& pipeline, const string& prefix);
+
+// Records a call to `GetNext` of an iterator with `metrics` that lasts as
+// long as this scope. Does nothing if `metrics` is null.
+class ScopedGetNext {
+ public:
+  ScopedGetNext(Env* env, StageMetrics* metrics);
+  ~ScopedGetNext();
+
+  // Counts an element produced by the call.
+  void RecordElement() {
+    if (metrics_ != nullptr) metrics_->elements->IncrementBy(1);
+  }
+
+ private:
+  friend class ScopedInputWait;
+
+  Env* const env_;
+  StageMetrics* const metrics_;
+  ScopedGetNext* const parent_;
+  // When the call started, if it is timed, or 0.
+  uint64 start_ = 0;
+  uint64 input_nanos_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedGetNext);
+};
+
+// Within a timed `ScopedGetNext`, records the time spent in this scope (e.g.
+// waiting for a background thread to produce an element) as time spent on
+// input.
+class ScopedInputWait {
+ public:
+  explicit ScopedInputWait(Env* env);
+  ~ScopedInputWait();
+
+ private:
+  Env* const env_;
+  ScopedGetNext* const call_;
+  const uint64 start_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedInputWait);
+};
+
+}  // namespace dataset_metrics
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_DATASET_METRICS_H_
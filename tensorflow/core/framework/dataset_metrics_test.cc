@@ -0,0 +1,164 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/dataset_metrics.h"
+
+#include <functional>
+#include <vector>
+
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace dataset_metrics {
+namespace {
+
+class FakeClockEnv : public EnvWrapper {
+ public:
+  FakeClockEnv() : EnvWrapper(Env::Default()) {}
+
+  uint64 NowNanos() override { return now_; }
+
+  void Advance(uint64 nanos) { now_ += nanos; }
+
+ private:
+  uint64 now_ = 1000000000;
+};
+
+TEST(DatasetMetricsTest, GetStageMetricsIgnoresIndices) {
+  StageMetrics* a = GetStageMetrics("indices", "Iterator::Interleave[0]::Map");
+  StageMetrics* b = GetStageMetrics("indices", "Iterator::Interleave[1]::Map");
+  StageMetrics* c = GetStageMetrics("other", "Iterator::Interleave[0]::Map");
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_NE(a->elements, c->elements);
+}
+
+TEST(DatasetMetricsTest, RegistryIsBounded) {
+  StageMetricsRegistry registry(2);
+  StageMetrics* range = registry.Get("bounded", "Iterator::Range");
+  StageMetrics* map = registry.Get("bounded", "Iterator::Map");
+  StageMetrics* batch = registry.Get("bounded", "Iterator::Batch");
+  StageMetrics* other = registry.Get("bounded_too", "Iterator::Range");
+  EXPECT_NE(range, map);
+  EXPECT_NE(map, batch);
+  // The registry is full, so new stages share the overflow metrics.
+  EXPECT_EQ(batch, other);
+  // Known stages keep their own.
+  EXPECT_EQ(range, registry.Get("bounded", "Iterator::Range"));
+}
+
+TEST(DatasetMetricsTest, CountsEveryElement) {
+  FakeClockEnv env;
+  StageMetrics* metrics = GetStageMetrics("count", "Iterator::Range");
+  for (int i = 0; i < 2 * kSamplingPeriod; ++i) {
+    ScopedGetNext call(&env, metrics);
+    call.RecordElement();
+  }
+  EXPECT_EQ(2 * kSamplingPeriod, metrics->elements->value());
+  EXPECT_EQ(2, metrics->get_next_usecs->value().num());
+}
+
+TEST(DatasetMetricsTest, AttributesNestedCallsToInput) {
+  FakeClockEnv env;
+  StageMetrics* map = GetStageMetrics("nested", "Iterator::Map");
+  StageMetrics* range = GetStageMetrics("nested", "Iterator::Map::Range");
+  // Takes the range iterator off its first, timed, call.
+  { ScopedGetNext call(&env, range); }
+  {
+    ScopedGetNext call(&env, map);
+    env.Advance(1000);
+    {
+      // Timed since its caller is.
+      ScopedGetNext input_call(&env, range);
+      env.Advance(3000);
+    }
+    env.Advance(2000);
+  }
+  EXPECT_EQ(1, map->get_next_usecs->value().num());
+  EXPECT_EQ(6, map->get_next_usecs->value().sum());
+  EXPECT_EQ(3, map->input_usecs->value().sum());
+  EXPECT_EQ(2, range->get_next_usecs->value().num());
+  EXPECT_EQ(3, range->get_next_usecs->value().sum());
+  EXPECT_EQ(0, range->input_usecs->value().sum());
+}
+
+TEST(DatasetMetricsTest, AttributesWaitsToInput) {
+  FakeClockEnv env;
+  StageMetrics* prefetch = GetStageMetrics("wait", "Iterator::Prefetch");
+  {
+    ScopedGetNext call(&env, prefetch);
+    {
+      ScopedInputWait wait(&env);
+      env.Advance(4000);
+    }
+    env.Advance(1000);
+  }
+  EXPECT_EQ(5, prefetch->get_next_usecs->value().sum());
+  EXPECT_EQ(4, prefetch->input_usecs->value().sum());
+}
+
+TEST(DatasetMetricsTest, IgnoresWaitsOutsideTimedCalls) {
+  FakeClockEnv env;
+  StageMetrics* prefetch = GetStageMetrics("untimed", "Iterator::Prefetch");
+  { ScopedGetNext call(&env, prefetch); }
+  {
+    ScopedGetNext call(&env, prefetch);
+    ScopedInputWait wait(&env);
+    env.Advance(4000);
+  }
+  EXPECT_EQ(1, prefetch->input_usecs->value().num());
+  EXPECT_EQ(0, prefetch->input_usecs->value().sum());
+}
+
+TEST(DatasetMetricsTest, NullMetricsAreIgnored) {
+  FakeClockEnv env;
+  StageMetrics* map = GetStageMetrics("null", "Iterator::Map");
+  {
+    ScopedGetNext call(&env, map);
+    {
+      // Its time counts as the caller's own.
+      ScopedGetNext input_call(&env, nullptr);
+      input_call.RecordElement();
+      env.Advance(3000);
+    }
+  }
+  EXPECT_EQ(3, map->get_next_usecs->value().sum());
+  EXPECT_EQ(0, map->input_usecs->value().sum());
+}
+
+// The overhead of the metrics on a call to `GetNext`, with `arg` nested
+// calls, compared to no metrics when `arg` is 0.
+static void BM_ScopedGetNext(int iters, int arg) {
+  Env* env = Env::Default();
+  std::vector<StageMetrics*> stages;
+  string prefix = "Iterator";
+  for (int i = 0; i < arg; ++i) {
+    prefix += "::Map";
+    stages.push_back(GetStageMetrics("benchmark", prefix));
+  }
+  std::function<void(int)> get_next = [&](int depth) {
+    ScopedGetNext call(env, depth < arg ? stages[depth] : nullptr);
+    if (depth + 1 < arg) get_next(depth + 1);
+    call.RecordElement();
+  };
+  for (int i = 0; i < iters; ++i) {
+    get_next(0);
+  }
+}
+BENCHMARK(BM_ScopedGetNext)->Arg(0)->Arg(1)->Arg(4);
+
+}  // namespace
+}  // namespace dataset_metrics
+}  // namespace tensorflow
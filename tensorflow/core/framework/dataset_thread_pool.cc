@@ -0,0 +1,202 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/dataset_thread_pool.h"
+
+#include <atomic>
+#include <map>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace {
+
+// The pool whose closure this thread is running, if it is not blocked.
+thread_local DatasetThreadPool* current_pool = nullptr;
+
+}  // namespace
+
+DatasetThreadPool::DatasetThreadPool(Env* env, const string& name,
+                                     int num_threads)
+    : env_(env), name_(name), num_threads_(num_threads) {
+  CHECK_GE(num_threads, 1);
+}
+
+DatasetThreadPool::~DatasetThreadPool() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cond_var_.notify_all();
+  }
+  // The remaining closures may start more threads, so join until none is
+  // left.
+  while (true) {
+    std::vector<std::unique_ptr<Thread>> threads;
+    {
+      mutex_lock l(mu_);
+      if (threads_.empty() && retired_.empty()) break;
+      for (auto& entry : threads_) {
+        threads.push_back(std::move(entry.second));
+      }
+      threads_.clear();
+      for (auto& thread : retired_) {
+        threads.push_back(std::move(thread));
+      }
+      retired_.clear();
+    }
+    threads.clear();
+  }
+}
+
+/* static */
+DatasetThreadPool* DatasetThreadPool::Global() {
+  static DatasetThreadPool* pool = []() -> DatasetThreadPool* {
+    int64 num_threads;
+    Status s = ReadInt64FromEnvVar("TF_DATA_SHARED_THREADPOOL_SIZE", 0,
+                                   &num_threads);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return nullptr;
+    }
+    if (num_threads <= 0) return nullptr;
+    return Shared(num_threads);
+  }();
+  return pool;
+}
+
+/* static */
+DatasetThreadPool* DatasetThreadPool::Shared(int num_threads) {
+  static mutex* mu = new mutex;
+  static std::map<int, DatasetThreadPool*>* pools =
+      new std::map<int, DatasetThreadPool*>;
+  mutex_lock l(*mu);
+  DatasetThreadPool*& pool = (*pools)[num_threads];
+  if (pool == nullptr) {
+    pool = new DatasetThreadPool(Env::Default(), "tf_data_shared",
+                                 num_threads);
+  }
+  return pool;
+}
+
+/* static */
+int64 DatasetThreadPool::NewPipelineId() {
+  static std::atomic<int64> next_id(1);
+  return next_id.fetch_add(1);
+}
+
+void DatasetThreadPool::Schedule(int64 pipeline_id, std::function<void()> fn) {
+  // Joined outside the lock, when this goes out of scope.
+  std::vector<std::unique_ptr<Thread>> retired;
+  mutex_lock l(mu_);
+  retired.swap(retired_);
+  std::deque<std::function<void()>>& queue = queues_[pipeline_id];
+  if (queue.empty()) turns_.push_back(pipeline_id);
+  queue.push_back(std::move(fn));
+  ++num_queued_;
+  MaybeWakeWorkerLocked();
+}
+
+int DatasetThreadPool::NumLiveThreads() {
+  mutex_lock l(mu_);
+  return threads_.size();
+}
+
+void DatasetThreadPool::MaybeWakeWorkerLocked() {
+  if (num_queued_ == 0 || num_running_ >= num_threads_) return;
+  // Threads that are neither running nor blocked are idle, or about to look
+  // for closures.
+  const int num_free = threads_.size() - num_running_ - num_blocked_;
+  if (num_free > 0) cond_var_.notify_one();
+  if (num_free < num_queued_ && num_running_ + num_free < num_threads_) {
+    const int64 worker_id = next_worker_id_++;
+    threads_.emplace(worker_id,
+                     std::unique_ptr<Thread>(env_->StartThread(
+                         {}, name_, [this, worker_id]() {
+                           WorkerLoop(worker_id);
+                         })));
+  }
+}
+
+bool DatasetThreadPool::HasSurplusThreadsLocked() {
+  // Only `num_threads_` threads may run closures, plus one for each blocked
+  // closure.
+  return static_cast<int>(threads_.size()) > num_threads_ + num_blocked_;
+}
+
+void DatasetThreadPool::WorkerLoop(int64 worker_id) {
+  current_pool = this;
+  while (true) {
+    std::function<void()> fn;
+    {
+      mutex_lock l(mu_);
+      while (turns_.empty() || num_running_ >= num_threads_) {
+        if (cancelled_ && turns_.empty()) return;
+        if (HasSurplusThreadsLocked()) {
+          // Retire this thread, which was started while closures were
+          // blocked. The destructor may already own it.
+          auto it = threads_.find(worker_id);
+          if (it != threads_.end()) {
+            retired_.push_back(std::move(it->second));
+            threads_.erase(it);
+          }
+          return;
+        }
+        cond_var_.wait(l);
+      }
+      // Take the oldest closure of the pipeline whose turn it is, and move
+      // the pipeline to the back of the line if it has more.
+      const int64 pipeline_id = turns_.front();
+      turns_.pop_front();
+      auto it = queues_.find(pipeline_id);
+      fn = std::move(it->second.front());
+      it->second.pop_front();
+      if (it->second.empty()) {
+        queues_.erase(it);
+      } else {
+        turns_.push_back(pipeline_id);
+      }
+      --num_queued_;
+      ++num_running_;
+    }
+    fn();
+    {
+      mutex_lock l(mu_);
+      --num_running_;
+      if (cancelled_ && turns_.empty()) cond_var_.notify_all();
+    }
+  }
+}
+
+DatasetThreadPool::ScopedBlocking::ScopedBlocking() : pool_(current_pool) {
+  if (pool_ == nullptr) return;
+  // Nested scopes do nothing.
+  current_pool = nullptr;
+  mutex_lock l(pool_->mu_);
+  --pool_->num_running_;
+  ++pool_->num_blocked_;
+  pool_->MaybeWakeWorkerLocked();
+}
+
+DatasetThreadPool::ScopedBlocking::~ScopedBlocking() {
+  if (pool_ == nullptr) return;
+  current_pool = pool_;
+  mutex_lock l(pool_->mu_);
+  ++pool_->num_running_;
+  --pool_->num_blocked_;
+  // Let an idle thread that is no longer needed exit.
+  if (pool_->HasSurplusThreadsLocked()) pool_->cond_var_.notify_all();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,125 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_FRAMEWORK_DATASET_THREAD_POOL_H_
+#define TENSORFLOW_CORE_FRAMEWORK_DATASET_THREAD_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A pool of threads that runs the background work of many input pipelines,
+// in place of threads owned by each iterator.
+//
+// At most `num_threads` closures run at a time, except while closures are
+// blocked in a `ScopedBlocking` region (e.g. waiting for an element from an
+// upstream iterator), when the pool may start more threads so that the work
+// they wait for can make progress. Pipelines take turns: each closure is
+// queued with the id of its pipeline, and the pool runs the oldest closure of
+// each pipeline with queued work in round-robin order, so that a pipeline
+// that schedules a lot of work does not starve the others.
+//
+// Closures should do a bounded amount of work and schedule a new closure to
+// continue, rather than loop, so that pipelines get their turns.
+class DatasetThreadPool {
+ public:
+  DatasetThreadPool(Env* env, const string& name, int num_threads);
+
+  // Runs the closures that are still queued, then joins the threads.
+  ~DatasetThreadPool();
+
+  // Returns the process-wide pool, or nullptr if it is disabled. The pool
+  // is enabled by setting the environment variable
+  // TF_DATA_SHARED_THREADPOOL_SIZE to its number of threads.
+  static DatasetThreadPool* Global();
+
+  // Returns the process-wide pool with `num_threads` threads, which is shared
+  // by all callers that ask for that size. `Global()` is one of these pools.
+  static DatasetThreadPool* Shared(int num_threads);
+
+  // Returns a new pipeline id.
+  static int64 NewPipelineId();
+
+  // Schedules `fn` to run on behalf of the pipeline `pipeline_id`.
+  void Schedule(int64 pipeline_id, std::function<void()> fn)
+      LOCKS_EXCLUDED(mu_);
+
+  int num_threads() const { return num_threads_; }
+
+  // Returns the number of threads the pool has started and not retired.
+  int NumLiveThreads() LOCKS_EXCLUDED(mu_);
+
+  // Marks the current thread as blocked for the lifetime of this object, if
+  // it is running a closure of a pool; does nothing otherwise.
+  class ScopedBlocking {
+   public:
+    ScopedBlocking();
+    ~ScopedBlocking();
+
+   private:
+    DatasetThreadPool* const pool_;
+
+    TF_DISALLOW_COPY_AND_ASSIGN(ScopedBlocking);
+  };
+
+ private:
+  void WorkerLoop(int64 worker_id);
+  // Wakes up or starts a thread to run queued closures, if the pool has
+  // capacity for them.
+  void MaybeWakeWorkerLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns true if an idle thread should exit, because the pool has more
+  // threads than it may run closures on.
+  bool HasSurplusThreadsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;
+  const string name_;
+  const int num_threads_;
+
+  mutex mu_;
+  condition_variable cond_var_;
+  // The queued closures of each pipeline.
+  std::unordered_map<int64, std::deque<std::function<void()>>> queues_
+      GUARDED_BY(mu_);
+  // The pipelines with queued closures, in the order of their turns.
+  std::deque<int64> turns_ GUARDED_BY(mu_);
+  int num_queued_ GUARDED_BY(mu_) = 0;
+  // The number of closures that are running and not blocked.
+  int num_running_ GUARDED_BY(mu_) = 0;
+  // The number of closures in a `ScopedBlocking` region.
+  int num_blocked_ GUARDED_BY(mu_) = 0;
+  bool cancelled_ GUARDED_BY(mu_) = false;
+  // The live threads, by worker id.
+  std::unordered_map<int64, std::unique_ptr<Thread>> threads_ GUARDED_BY(mu_);
+  int64 next_worker_id_ GUARDED_BY(mu_) = 0;
+  // Threads that have exited their loop and are yet to be joined. A thread
+  // cannot join itself, so they are joined by the next call to `Schedule()`
+  // or by the destructor.
+  std::vector<std::unique_ptr<Thread>> retired_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(DatasetThreadPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_DATASET_THREAD_POOL_H_
@@ -0,0 +1,145 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/dataset_thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(DatasetThreadPoolTest, RunsAllClosures) {
+  std::atomic<int> count(0);
+  {
+    DatasetThreadPool pool(Env::Default(), "test", 4);
+    for (int i = 0; i < 1000; ++i) {
+      pool.Schedule(i % 7, [&count]() { count.fetch_add(1); });
+    }
+  }
+  EXPECT_EQ(1000, count.load());
+}
+
+TEST(DatasetThreadPoolTest, BoundsConcurrency) {
+  DatasetThreadPool pool(Env::Default(), "test", 2);
+  mutex mu;
+  int running = 0;
+  int max_running = 0;
+  BlockingCounter done(20);
+  for (int i = 0; i < 20; ++i) {
+    pool.Schedule(i, [&]() {
+      {
+        mutex_lock l(mu);
+        max_running = std::max(max_running, ++running);
+      }
+      Env::Default()->SleepForMicroseconds(1000);
+      {
+        mutex_lock l(mu);
+        --running;
+      }
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  EXPECT_LE(max_running, 2);
+}
+
+TEST(DatasetThreadPoolTest, PipelinesTakeTurns) {
+  DatasetThreadPool pool(Env::Default(), "test", 1);
+  Notification start;
+  pool.Schedule(0, [&start]() { start.WaitForNotification(); });
+  mutex mu;
+  std::vector<int> order;
+  BlockingCounter done(101);
+  // Pipeline 1 floods the pool before pipeline 2 schedules its closure.
+  for (int i = 0; i < 100; ++i) {
+    pool.Schedule(1, [&]() {
+      mutex_lock l(mu);
+      order.push_back(1);
+      done.DecrementCount();
+    });
+  }
+  pool.Schedule(2, [&]() {
+    mutex_lock l(mu);
+    order.push_back(2);
+    done.DecrementCount();
+  });
+  start.Notify();
+  done.Wait();
+  ASSERT_EQ(101, order.size());
+  EXPECT_EQ(1, order[0]);
+  EXPECT_EQ(2, order[1]);
+}
+
+TEST(DatasetThreadPoolTest, BlockedClosuresDoNotStallThePool) {
+  DatasetThreadPool pool(Env::Default(), "test", 1);
+  Notification produced;
+  Notification consumed;
+  // The consumer occupies the pool's only thread while it waits for the
+  // producer, which can only run on another thread.
+  pool.Schedule(0, [&]() {
+    {
+      DatasetThreadPool::ScopedBlocking blocking;
+      // Nested scopes do nothing.
+      DatasetThreadPool::ScopedBlocking nested;
+      produced.WaitForNotification();
+    }
+    consumed.Notify();
+  });
+  pool.Schedule(1, [&produced]() { produced.Notify(); });
+  consumed.WaitForNotification();
+}
+
+TEST(DatasetThreadPoolTest, RetiresThreadsStartedForBlockedClosures) {
+  DatasetThreadPool pool(Env::Default(), "test", 1);
+  Notification produced;
+  BlockingCounter done(2);
+  pool.Schedule(0, [&]() {
+    {
+      DatasetThreadPool::ScopedBlocking blocking;
+      produced.WaitForNotification();
+    }
+    done.DecrementCount();
+  });
+  pool.Schedule(1, [&]() {
+    produced.Notify();
+    done.DecrementCount();
+  });
+  done.Wait();
+  // The thread started for the producer exits once it is idle.
+  for (int i = 0; i < 10000 && pool.NumLiveThreads() > 1; ++i) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  EXPECT_EQ(1, pool.NumLiveThreads());
+  // The pool keeps running closures after retiring threads.
+  Notification ran;
+  pool.Schedule(2, [&ran]() { ran.Notify(); });
+  ran.WaitForNotification();
+  EXPECT_EQ(1, pool.NumLiveThreads());
+}
+
+TEST(DatasetThreadPoolTest, SharedPoolsAreKeyedByNumThreads) {
+  DatasetThreadPool* pool = DatasetThreadPool::Shared(3);
+  EXPECT_EQ(3, pool->num_threads());
+  EXPECT_EQ(pool, DatasetThreadPool::Shared(3));
+  EXPECT_NE(pool, DatasetThreadPool::Shared(5));
+}
+
+}  // namespace
+}  // namespace tensorflow
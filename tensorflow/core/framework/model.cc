@@ -0,0 +1,317 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/model.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace model {
+namespace {
+
+// The node whose `ScopedProcessing` is innermost on this thread, and when its
+// processing time last started accruing.
+struct ThreadState {
+  Node* node = nullptr;
+  uint64 start = 0;
+};
+thread_local ThreadState thread_state;
+
+// A consumer that waits for a node for more than this fraction of the time
+// makes its buffer grow.
+constexpr double kWaitThreshold = 0.01;
+
+int NodeDepth(const string& name) {
+  return str_util::Split(name, "::").size();
+}
+
+}  // namespace
+
+string NodeName(const string& prefix) {
+  string name;
+  name.reserve(prefix.size());
+  bool in_index = false;
+  for (char c : prefix) {
+    if (c == '[') {
+      in_index = true;
+    } else if (c == ']') {
+      in_index = false;
+    } else if (!in_index) {
+      name.push_back(c);
+    }
+  }
+  return name;
+}
+
+void Node::add_tunable(const std::shared_ptr<Tunable>& tunable) {
+  mutex_lock l(mu_);
+  tunables_.push_back(tunable);
+}
+
+void Node::remove_tunable(const Tunable* tunable) {
+  mutex_lock l(mu_);
+  for (auto it = tunables_.begin(); it != tunables_.end(); ++it) {
+    if (it->get() == tunable) {
+      tunables_.erase(it);
+      return;
+    }
+  }
+}
+
+ScopedProcessing::ScopedProcessing(Env* env, Node* node)
+    : env_(env), parent_(thread_state.node) {
+  const uint64 now = env_->NowNanos();
+  if (parent_ != nullptr) {
+    parent_->add_processing_time(now - thread_state.start);
+  }
+  thread_state.node = node;
+  thread_state.start = now;
+}
+
+ScopedProcessing::~ScopedProcessing() {
+  const uint64 now = env_->NowNanos();
+  thread_state.node->add_processing_time(now - thread_state.start);
+  thread_state.node = parent_;
+  thread_state.start = now;
+}
+
+ScopedWait::ScopedWait(Env* env, Node* node)
+    : env_(env), node_(node), start_(node ? env->NowNanos() : 0) {
+  if (node_ != nullptr && thread_state.node != nullptr) {
+    thread_state.node->add_processing_time(start_ - thread_state.start);
+  }
+}
+
+ScopedWait::~ScopedWait() {
+  if (node_ == nullptr) return;
+  const uint64 now = env_->NowNanos();
+  node_->add_wait_time(now - start_);
+  thread_state.start = now;
+}
+
+Model::Model(Env* env, int64 cpu_budget)
+    : env_(env), cpu_budget_(cpu_budget) {}
+
+Model::~Model() {
+  std::unique_ptr<Thread> thread;
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cond_var_.notify_all();
+    thread = std::move(thread_);
+  }
+  // Joins the optimization thread.
+  thread.reset();
+}
+
+Node* Model::LookupNode(const string& name) {
+  const string node_name = NodeName(name);
+  mutex_lock l(mu_);
+  std::unique_ptr<Node>& node = nodes_[node_name];
+  if (!node) node.reset(new Node(node_name));
+  return node.get();
+}
+
+void Model::StartOptimization() {
+  collecting_ = true;
+  mutex_lock l(mu_);
+  if (!thread_ && !cancelled_) {
+    thread_.reset(env_->StartThread({}, "tf_data_model",
+                                    [this]() { OptimizationThread(); }));
+  }
+}
+
+void Model::OptimizationThread() {
+  while (true) {
+    {
+      mutex_lock l(mu_);
+      if (!cancelled_) {
+        WaitForMilliseconds(&l, &cond_var_, kOptimizationPeriodMs);
+      }
+      if (cancelled_) return;
+    }
+    Optimize();
+  }
+}
+
+void Model::Optimize() {
+  struct Entry {
+    Node* node;
+    NodeState* state;
+    // The first tunable of the node, which stands for all of them.
+    std::shared_ptr<Tunable> tunable;
+    // The number of tunables of the node, each of which gets `value`.
+    int64 num_tunables;
+    int64 value;
+  };
+  std::vector<Entry> entries;
+  {
+    mutex_lock l(mu_);
+    const uint64 now = env_->NowNanos();
+    const uint64 period = now - last_optimization_;
+    const bool first = last_optimization_ == 0;
+    last_optimization_ = now;
+
+    // Snapshot the metrics and find the output node, which has the shortest
+    // name.
+    struct Delta {
+      int64 num_elements;
+      int64 processing_time;
+      int64 wait_time;
+      int64 buffer_size_sum;
+      int64 num_buffer_samples;
+      int64 num_buffer_full;
+    };
+    std::vector<Delta> deltas;
+    int64 output_elements = 0;
+    int output_depth = 0;
+    int output_index = 0;
+    for (const auto& it : nodes_) {
+      Node* node = it.second.get();
+      NodeState* state = &states_[node];
+      Delta delta;
+      int64 value = node->num_elements_.load();
+      delta.num_elements = value - state->num_elements;
+      state->num_elements = value;
+      value = node->processing_time_.load();
+      delta.processing_time = value - state->processing_time;
+      state->processing_time = value;
+      value = node->wait_time_.load();
+      delta.wait_time = value - state->wait_time;
+      state->wait_time = value;
+      value = node->buffer_size_sum_.load();
+      delta.buffer_size_sum = value - state->buffer_size_sum;
+      state->buffer_size_sum = value;
+      value = node->num_buffer_samples_.load();
+      delta.num_buffer_samples = value - state->num_buffer_samples;
+      state->num_buffer_samples = value;
+      value = node->num_buffer_full_.load();
+      delta.num_buffer_full = value - state->num_buffer_full;
+      state->num_buffer_full = value;
+      deltas.push_back(delta);
+
+      const int depth = NodeDepth(node->name());
+      if (output_depth == 0 || depth < output_depth) {
+        output_depth = depth;
+        output_elements = delta.num_elements;
+        output_index = deltas.size() - 1;
+      }
+      std::shared_ptr<Tunable> tunable;
+      int64 num_tunables;
+      {
+        mutex_lock node_l(node->mu_);
+        num_tunables = node->tunables_.size();
+        if (num_tunables > 0) tunable = node->tunables_.front();
+      }
+      entries.push_back({node, state, std::move(tunable), num_tunables, 0});
+    }
+    // Nothing to learn from a period in which the pipeline made no progress.
+    if (first || output_elements == 0) return;
+
+    // Update the work per output element of every node, and size the buffers.
+    double total_work = 0;
+    int64 parallelism = 0;
+    for (int i = 0; i < entries.size(); ++i) {
+      Entry& entry = entries[i];
+      const Delta& delta = deltas[i];
+      const double work =
+          static_cast<double>(delta.processing_time) / output_elements;
+      entry.state->work = entry.state->work < 0
+                              ? work
+                              : (entry.state->work + work) / 2;
+      total_work += entry.state->work;
+      if (!entry.tunable) continue;
+      const Tunable& tunable = *entry.tunable;
+      if (tunable.type == Tunable::Type::kParallelism) {
+        entry.value = tunable.min;
+        parallelism += tunable.min * entry.num_tunables;
+        continue;
+      }
+      // A consumer that waits although the buffer has been full at times is
+      // served by a bursty producer, which a larger buffer smooths out. A
+      // consumer that never waits for a mostly full buffer has more buffer
+      // than it needs.
+      entry.value = tunable.value.load();
+      const bool waited = delta.wait_time > kWaitThreshold * period;
+      if (waited && delta.num_buffer_full > 0) {
+        entry.value = std::min(tunable.max, entry.value * 2);
+      } else if (!waited && delta.num_buffer_samples > 0 &&
+                 2 * delta.buffer_size_sum >
+                     entry.value * delta.num_buffer_samples) {
+        entry.value = std::max(tunable.min, entry.value - 1);
+      }
+    }
+
+    // Hand out the CPU budget one call at a time to the stage that takes the
+    // longest per output element, until that stage cannot be parallelized
+    // further, or is fast enough: the pipeline as a whole is bound by the
+    // budget, or, if the pipeline's consumer did not have to wait for it, the
+    // stage runs at least twice as fast as the consumer. A node with several
+    // iterators runs that many calls for each step of its parallelism.
+    double target_time = total_work / cpu_budget_;
+    const Delta& output = deltas[output_index];
+    if (output.num_buffer_samples > 0 &&
+        output.wait_time <= kWaitThreshold * period) {
+      target_time = std::max(
+          target_time, static_cast<double>(period) / output_elements / 2);
+    }
+    auto stage_time = [](const Entry& entry) {
+      if (entry.tunable &&
+          entry.tunable->type == Tunable::Type::kParallelism) {
+        return entry.state->work / (entry.value * entry.num_tunables);
+      }
+      return entry.state->work;
+    };
+    while (true) {
+      auto slowest = std::max_element(
+          entries.begin(), entries.end(),
+          [&stage_time](const Entry& a, const Entry& b) {
+            return stage_time(a) < stage_time(b);
+          });
+      if (slowest == entries.end() ||
+          stage_time(*slowest) <= target_time ||
+          !slowest->tunable ||
+          slowest->tunable->type != Tunable::Type::kParallelism ||
+          slowest->value >= slowest->tunable->max ||
+          parallelism + slowest->num_tunables > cpu_budget_) {
+        break;
+      }
+      ++slowest->value;
+      parallelism += slowest->num_tunables;
+    }
+  }
+
+  // Apply the new values outside of `mu_`, as `on_change` takes iterator
+  // locks under which iterators may look up nodes.
+  for (const Entry& entry : entries) {
+    if (!entry.tunable) continue;
+    mutex_lock l(entry.node->mu_);
+    for (const std::shared_ptr<Tunable>& tunable : entry.node->tunables_) {
+      if (tunable->type != entry.tunable->type) continue;
+      const int64 value =
+          std::max(tunable->min, std::min(tunable->max, entry.value));
+      if (tunable->value.load() == value) continue;
+      VLOG(2) << "Setting " << entry.node->name() << " to " << value;
+      tunable->value = value;
+      if (tunable->on_change) tunable->on_change();
+    }
+  }
+}
+
+}  // namespace model
+}  // namespace tensorflow
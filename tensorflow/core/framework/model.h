@@ -0,0 +1,221 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
+#define TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace model {
+
+// A performance model of an input pipeline, used to tune the pipeline while it
+// runs.
+//
+// Each iterator of the pipeline reports to its `Node` how many elements it
+// produced, how much time it spent producing them, how long its consumers
+// waited for its buffer, and how full that buffer was. Iterators with a
+// performance parameter that the user left for the runtime to pick (passing
+// `kAutoTune`) register it as a `Tunable`. A background thread periodically
+// estimates how much work each iterator does per element of the pipeline's
+// output, then splits a CPU budget among the parallelism parameters so as to
+// relieve the slowest stage, and sizes buffers by whether their consumers
+// had to wait. Each optimization starts over from the minimum parallelism,
+// so parameters shrink again when the pipeline's bottleneck moves.
+
+// Passed for a performance parameter to have it tuned by the model.
+constexpr int64 kAutoTune = -1;
+
+// A performance parameter of an iterator. The optimizer may change `value`
+// at any time, then calls `on_change` so that the iterator can wake up its
+// threads. `on_change` runs under the lock of the parameter's node, so it must
+// not call back into the node.
+struct Tunable {
+  enum class Type {
+    // The number of concurrent calls; each one is assumed to use a CPU.
+    kParallelism,
+    // The number of elements buffered ahead of the consumer.
+    kBufferSize,
+  };
+
+  Tunable(Type type, int64 min, int64 max, std::function<void()> on_change)
+      : type(type), value(min), min(min), max(max), on_change(on_change) {}
+
+  const Type type;
+  std::atomic<int64> value;
+  const int64 min;
+  const int64 max;
+  const std::function<void()> on_change;
+};
+
+// Returns the name shared by the iterators with prefix `prefix`, which drops
+// the per-element indices, e.g. "Iterator::Interleave[2]::Map" becomes
+// "Iterator::Interleave::Map".
+string NodeName(const string& prefix);
+
+// The metrics of the iterators that share a name in the pipeline (e.g. the
+// per-element iterators of an interleave). Thread-safe.
+class Node {
+ public:
+  explicit Node(const string& name) : name_(name) {}
+
+  const string& name() const { return name_; }
+  int64 num_elements() const { return num_elements_.load(); }
+  int64 processing_time() const { return processing_time_.load(); }
+  int64 wait_time() const { return wait_time_.load(); }
+
+  void record_element() { num_elements_.fetch_add(1); }
+  void add_processing_time(int64 nanos) { processing_time_.fetch_add(nanos); }
+  void add_wait_time(int64 nanos) { wait_time_.fetch_add(nanos); }
+  // Records the size of the node's buffer, out of `capacity`, as seen by a
+  // consumer.
+  void record_buffer_size(int64 size, int64 capacity) {
+    buffer_size_sum_.fetch_add(size);
+    num_buffer_samples_.fetch_add(1);
+    if (size >= capacity) num_buffer_full_.fetch_add(1);
+  }
+
+  // Makes `tunable` adjustable by the optimizer. The iterators of a node (e.g.
+  // the per-element iterators of an interleave) each register their own
+  // tunable; the optimizer gives all of them the same value, using the first
+  // one registered for the type and range.
+  void add_tunable(const std::shared_ptr<Tunable>& tunable)
+      LOCKS_EXCLUDED(mu_);
+
+  // Unregisters `tunable`. Once this returns, the optimizer no longer calls
+  // `tunable->on_change`.
+  void remove_tunable(const Tunable* tunable) LOCKS_EXCLUDED(mu_);
+
+ private:
+  friend class Model;
+
+  const string name_;
+  std::atomic<int64> num_elements_{0};
+  std::atomic<int64> processing_time_{0};
+  std::atomic<int64> wait_time_{0};
+  std::atomic<int64> buffer_size_sum_{0};
+  std::atomic<int64> num_buffer_samples_{0};
+  std::atomic<int64> num_buffer_full_{0};
+
+  mutex mu_;
+  std::vector<std::shared_ptr<Tunable>> tunables_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Node);
+};
+
+// Attributes the time that the current thread spends in this scope to
+// `node`'s processing time, excluding the time spent in nested scopes (i.e.
+// in the iterator's inputs) and in `ScopedWait`s.
+class ScopedProcessing {
+ public:
+  ScopedProcessing(Env* env, Node* node);
+  ~ScopedProcessing();
+
+ private:
+  Env* const env_;
+  Node* const parent_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedProcessing);
+};
+
+// Within a `ScopedProcessing` of `node`, records the time spent in this scope
+// as time that the consumer of `node` waited for it, rather than as
+// processing time. Does nothing if `node` is null.
+class ScopedWait {
+ public:
+  ScopedWait(Env* env, Node* node);
+  ~ScopedWait();
+
+ private:
+  Env* const env_;
+  Node* const node_;
+  const uint64 start_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedWait);
+};
+
+// The model of one input pipeline. Thread-safe.
+class Model {
+ public:
+  // `cpu_budget` bounds the sum of the parallelism parameters.
+  Model(Env* env, int64 cpu_budget);
+  ~Model();
+
+  Env* env() const { return env_; }
+
+  // Returns the node of the iterators named `name` (an iterator prefix;
+  // per-element indices such as "[3]" are ignored), creating it if needed.
+  // Nodes live as long as the model.
+  Node* LookupNode(const string& name) LOCKS_EXCLUDED(mu_);
+
+  // Whether the iterators should report metrics. Collection starts with
+  // the first `StartOptimization()`, so that pipelines with nothing to tune
+  // pay nothing.
+  bool collecting() const { return collecting_.load(); }
+
+  // Starts collecting metrics and, unless already running, the thread that
+  // calls `Optimize()` every `kOptimizationPeriodMs`.
+  void StartOptimization() LOCKS_EXCLUDED(mu_);
+
+  // Updates the tunables from the metrics reported since the last call.
+  // Called by the background thread, and directly by tests.
+  void Optimize() LOCKS_EXCLUDED(mu_);
+
+  static constexpr int64 kOptimizationPeriodMs = 100;
+
+ private:
+  // What the optimizer remembers about a node between optimizations.
+  struct NodeState {
+    int64 num_elements = 0;
+    int64 processing_time = 0;
+    int64 wait_time = 0;
+    int64 buffer_size_sum = 0;
+    int64 num_buffer_samples = 0;
+    int64 num_buffer_full = 0;
+    // Smoothed processing time of the node per output element of the
+    // pipeline, in nanoseconds; negative until measured.
+    double work = -1;
+  };
+
+  void OptimizationThread();
+
+  Env* const env_;
+  const int64 cpu_budget_;
+  std::atomic<bool> collecting_{false};
+
+  mutex mu_;
+  condition_variable cond_var_;
+  std::map<string, std::unique_ptr<Node>> nodes_ GUARDED_BY(mu_);
+  std::map<const Node*, NodeState> states_ GUARDED_BY(mu_);
+  uint64 last_optimization_ GUARDED_BY(mu_) = 0;
+  std::unique_ptr<Thread> thread_ GUARDED_BY(mu_);
+  bool cancelled_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Model);
+};
+
+}  // namespace model
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
@@ -0,0 +1,267 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/model.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace model {
+namespace {
+
+class FakeClockEnv : public EnvWrapper {
+ public:
+  FakeClockEnv() : EnvWrapper(Env::Default()) {}
+
+  uint64 NowNanos() override { return now_; }
+
+  void Advance(uint64 nanos) { now_ += nanos; }
+
+ private:
+  uint64 now_ = 1000000000;
+};
+
+TEST(ModelTest, LookupNodeIgnoresIndices) {
+  Model model(Env::Default(), 4);
+  Node* a = model.LookupNode("Iterator::Interleave[0]::Map");
+  Node* b = model.LookupNode("Iterator::Interleave[12]::Map");
+  Node* c = model.LookupNode("Iterator::Interleave");
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ("Iterator::Interleave::Map", a->name());
+}
+
+TEST(ModelTest, StartOptimization) {
+  Model model(Env::Default(), 4);
+  EXPECT_FALSE(model.collecting());
+  model.StartOptimization();
+  model.StartOptimization();
+  EXPECT_TRUE(model.collecting());
+}
+
+TEST(ModelTest, ScopedProcessingExcludesInputsAndWaits) {
+  FakeClockEnv env;
+  Model model(&env, 4);
+  Node* outer = model.LookupNode("Iterator::Outer");
+  Node* inner = model.LookupNode("Iterator::Outer::Inner");
+  {
+    ScopedProcessing outer_scope(&env, outer);
+    env.Advance(10);
+    {
+      ScopedProcessing inner_scope(&env, inner);
+      env.Advance(5);
+    }
+    env.Advance(3);
+    {
+      ScopedWait wait(&env, outer);
+      env.Advance(100);
+    }
+    {
+      ScopedWait no_op(&env, nullptr);
+    }
+    env.Advance(2);
+  }
+  EXPECT_EQ(15, outer->processing_time());
+  EXPECT_EQ(100, outer->wait_time());
+  EXPECT_EQ(5, inner->processing_time());
+  EXPECT_EQ(0, inner->wait_time());
+}
+
+// Simulates a pipeline of a sequential source, a parallel map and a prefetch,
+// feeding the model the metrics that a real pipeline would report.
+class SimulatedPipeline {
+ public:
+  explicit SimulatedPipeline(int64 cpu_budget)
+      : cpu_budget_(cpu_budget), model_(&env_, cpu_budget) {
+    prefetch_ = model_.LookupNode("Iterator::Prefetch");
+    map_ = model_.LookupNode("Iterator::Prefetch::ParallelMap");
+    source_ = model_.LookupNode("Iterator::Prefetch::ParallelMap::Range");
+    parallelism_ = std::make_shared<Tunable>(Tunable::Type::kParallelism, 1,
+                                             2 * cpu_budget, nullptr);
+    map_->add_tunable(parallelism_);
+    buffer_size_ = std::make_shared<Tunable>(Tunable::Type::kBufferSize, 1,
+                                             1024, nullptr);
+    prefetch_->add_tunable(buffer_size_);
+  }
+
+  // The time per output element with the current parameters.
+  double ElementTime() const {
+    const int64 parallelism =
+        std::min(parallelism_->value.load(), cpu_budget_);
+    return std::max({static_cast<double>(source_work_),
+                     static_cast<double>(map_work_) / parallelism,
+                     static_cast<double>(consumer_time_)});
+  }
+
+  // The time per output element with the best parameters.
+  double OptimalElementTime() const {
+    return std::max({static_cast<double>(source_work_),
+                     static_cast<double>(source_work_ + map_work_) /
+                         cpu_budget_,
+                     static_cast<double>(consumer_time_)});
+  }
+
+  // Runs the pipeline for an optimization period, then optimizes.
+  void Step() {
+    const int64 period = Model::kOptimizationPeriodMs * 1000000;
+    const double element_time = ElementTime();
+    const int64 n = period / element_time;
+    for (int64 i = 0; i < n; ++i) {
+      prefetch_->record_element();
+      map_->record_element();
+      source_->record_element();
+      // The consumer finds the buffer empty whenever the pipeline is slower.
+      const bool pipeline_bound = element_time > consumer_time_;
+      prefetch_->record_buffer_size(
+          pipeline_bound ? 0 : buffer_size_->value.load(),
+          buffer_size_->value.load());
+    }
+    map_->add_processing_time(map_work_ * n);
+    source_->add_processing_time(source_work_ * n);
+    if (element_time > consumer_time_) {
+      prefetch_->add_wait_time((element_time - consumer_time_) * n);
+    }
+    env_.Advance(period);
+    model_.Optimize();
+  }
+
+  int64 parallelism() const { return parallelism_->value.load(); }
+  int64 buffer_size() const { return buffer_size_->value.load(); }
+
+  int64 source_work_ = 500;
+  int64 map_work_ = 8000;
+  int64 consumer_time_ = 0;
+
+ private:
+  const int64 cpu_budget_;
+  FakeClockEnv env_;
+  Model model_;
+  Node* prefetch_;
+  Node* map_;
+  Node* source_;
+  std::shared_ptr<Tunable> parallelism_;
+  std::shared_ptr<Tunable> buffer_size_;
+};
+
+TEST(ModelTest, ConvergesToNearOptimalThroughput) {
+  SimulatedPipeline pipeline(8);
+  for (int i = 0; i < 10; ++i) pipeline.Step();
+  EXPECT_EQ(8, pipeline.parallelism());
+  EXPECT_LT(pipeline.ElementTime(), 1.1 * pipeline.OptimalElementTime());
+  // The producer is too slow for a larger buffer to help.
+  EXPECT_EQ(1, pipeline.buffer_size());
+
+  // The map gets cheaper, so that the source becomes the bottleneck.
+  pipeline.map_work_ = 2000;
+  for (int i = 0; i < 10; ++i) pipeline.Step();
+  EXPECT_LE(pipeline.parallelism(), 5);
+  EXPECT_LT(pipeline.ElementTime(), 1.1 * pipeline.OptimalElementTime());
+
+  // The consumer gets slower than the pipeline, so that the map needs fewer
+  // calls.
+  pipeline.map_work_ = 8000;
+  pipeline.consumer_time_ = 5000;
+  for (int i = 0; i < 10; ++i) pipeline.Step();
+  EXPECT_EQ(4, pipeline.parallelism());
+  EXPECT_LT(pipeline.ElementTime(), 1.1 * pipeline.OptimalElementTime());
+}
+
+TEST(ModelTest, BufferGrowsForBurstyProducerAndShrinksWhenIdle) {
+  FakeClockEnv env;
+  Model model(&env, 4);
+  Node* node = model.LookupNode("Iterator::Prefetch");
+  int num_changes = 0;
+  auto buffer_size = std::make_shared<Tunable>(
+      Tunable::Type::kBufferSize, 1, 16, [&num_changes]() { ++num_changes; });
+  node->add_tunable(buffer_size);
+  const int64 period = Model::kOptimizationPeriodMs * 1000000;
+  model.Optimize();
+
+  // The consumer waits, although the buffer was full at times.
+  for (int i = 0; i < 10; ++i) {
+    node->record_element();
+    node->record_buffer_size(i % 2 ? 0 : buffer_size->value.load(),
+                             buffer_size->value.load());
+    node->add_wait_time(period / 10);
+    env.Advance(period);
+    model.Optimize();
+  }
+  EXPECT_EQ(16, buffer_size->value.load());
+  EXPECT_EQ(4, num_changes);
+
+  // The consumer never waits for the full buffer.
+  for (int i = 0; i < 10; ++i) {
+    node->record_element();
+    node->record_buffer_size(buffer_size->value.load(),
+                             buffer_size->value.load());
+    env.Advance(period);
+    model.Optimize();
+  }
+  EXPECT_EQ(6, buffer_size->value.load());
+
+  // Unregistered tunables are left alone.
+  node->remove_tunable(buffer_size.get());
+  node->record_element();
+  node->record_buffer_size(6, 6);
+  env.Advance(period);
+  model.Optimize();
+  EXPECT_EQ(6, buffer_size->value.load());
+}
+
+TEST(ModelTest, IteratorsOfANodeShareTheirParallelism) {
+  FakeClockEnv env;
+  Model model(&env, 8);
+  // The per-element iterators of an interleave share a node.
+  Node* node = model.LookupNode("Iterator::Interleave[0]::ParallelMap");
+  EXPECT_EQ(node, model.LookupNode("Iterator::Interleave[1]::ParallelMap"));
+  Node* output = model.LookupNode("Iterator::Interleave");
+  int num_changes = 0;
+  auto first = std::make_shared<Tunable>(Tunable::Type::kParallelism, 1, 8,
+                                         [&num_changes]() { ++num_changes; });
+  auto second = std::make_shared<Tunable>(Tunable::Type::kParallelism, 1, 8,
+                                          [&num_changes]() { ++num_changes; });
+  node->add_tunable(first);
+  node->add_tunable(second);
+  const int64 period = Model::kOptimizationPeriodMs * 1000000;
+  model.Optimize();
+
+  // The map does all of the work, so it gets the whole budget, split between
+  // its two iterators.
+  output->record_element();
+  node->record_element();
+  node->add_processing_time(period);
+  env.Advance(period);
+  model.Optimize();
+  EXPECT_EQ(4, first->value.load());
+  EXPECT_EQ(4, second->value.load());
+  EXPECT_EQ(2, num_changes);
+
+  // Once the first iterator is gone, the second one gets the whole budget.
+  node->remove_tunable(first.get());
+  output->record_element();
+  node->record_element();
+  node->add_processing_time(period);
+  env.Advance(period);
+  model.Optimize();
+  EXPECT_EQ(4, first->value.load());
+  EXPECT_EQ(8, second->value.load());
+  EXPECT_EQ(3, num_changes);
+}
+
+}  // namespace
+}  // namespace model
+}  // namespace tensorflow
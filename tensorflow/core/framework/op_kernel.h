@@ -532,6 +532,11 @@ class OpKernelContext {
     // stored in this container..
     ScopedStepContainer* step_container = nullptr;
 
+    // If not null, serves allocate_temp() and allocate_output() requests
+    // for plain host memory instead of the device's allocator. Its
+    // allocations may be cheaper, but are tied to the step.
+    Allocator* step_allocator = nullptr;
+
     // Mechanism used by this op kernel invocation to communicate with
     // computations running on other devices.
     Rendezvous* rendezvous = nullptr;
@@ -1116,9 +1121,11 @@ class OpKernelContext {
                            AllocationAttributes());
   }
 
+  // If "step_local", the tensor may come from Params::step_allocator.
   Status allocate_tensor(DataType type, const TensorShape& shape,
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
-                         const AllocationAttributes& allocation_attr);
+                         const AllocationAttributes& allocation_attr,
+                         bool step_local = false);
 
   // This is called by PersistentTensor::AccessTensor whenever the
   // wrapped tensor is retrieved, to ensure the runtime knows that the
@@ -15,11 +15,15 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -282,6 +286,33 @@ class DummyDeviceContext : public DeviceContext {
   const int stream_id_;
 };
 
+TEST_F(LocalRendezvousTest, AbortManyKeys) {
+  // Pending receives spread over many keys (and hence table shards) are all
+  // failed by a single abort.
+  const int kNumKeys = 100;
+  std::vector<Rendezvous::ParsedKey> keys;
+  for (int i = 0; i < kNumKeys; ++i) {
+    keys.push_back(MakeKey(strings::StrCat("key", i)));
+  }
+  BlockingCounter counter(kNumKeys);
+  Rendezvous::Args args;
+  for (int i = 0; i < kNumKeys; ++i) {
+    rendez_->RecvAsync(keys[i], args,
+                       [&counter](const Status& s, const Rendezvous::Args&,
+                                  const Rendezvous::Args&, const Tensor&,
+                                  bool) {
+                         EXPECT_TRUE(errors::IsAborted(s));
+                         counter.DecrementCount();
+                       });
+  }
+  rendez_->StartAbort(errors::Aborted(""));
+  counter.Wait();
+  for (int i = 0; i < kNumKeys; ++i) {
+    EXPECT_TRUE(
+        errors::IsAborted(rendez_->Send(keys[i], args, V("x"), false)));
+  }
+}
+
 TEST_F(LocalRendezvousTest, TransferDummyDeviceContext) {
   Rendezvous::Args args;
   args.device_context = new DummyDeviceContext(123);
@@ -358,5 +389,48 @@ void BM_PingPong(int iters) {
 }
 BENCHMARK(BM_PingPong);
 
+// "num_pairs" producer/consumer pairs each transfer tensors over their own
+// key, so the pairs only interact through the shared rendezvous table.
+void BM_SendRecvPairs(int iters, int num_pairs) {
+  testing::StopTiming();
+  thread::ThreadPool* pool =
+      new thread::ThreadPool(Env::Default(), "test", 2 * num_pairs);
+  Rendezvous* rendez = NewLocalRendezvous();
+  std::vector<Rendezvous::ParsedKey> keys;
+  for (int i = 0; i < num_pairs; ++i) {
+    keys.push_back(MakeKey(strings::StrCat("pair", i)));
+  }
+  const int iters_per_pair = std::max(1, iters / num_pairs);
+  BlockingCounter counter(2 * num_pairs);
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < num_pairs; ++i) {
+    const Rendezvous::ParsedKey& key = keys[i];
+    pool->Schedule([rendez, &key, &counter, iters_per_pair]() {
+      Tensor val = V("val");
+      Rendezvous::Args args;
+      for (int j = 0; j < iters_per_pair; ++j) {
+        TF_CHECK_OK(rendez->Send(key, args, val, false));
+      }
+      counter.DecrementCount();
+    });
+    pool->Schedule([rendez, &key, &counter, iters_per_pair]() {
+      Tensor val;
+      bool is_dead = false;
+      Rendezvous::Args args;
+      for (int j = 0; j < iters_per_pair; ++j) {
+        TF_CHECK_OK(rendez->Recv(key, args, &val, &is_dead));
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters_per_pair) * num_pairs);
+  rendez->Unref();
+  delete pool;
+}
+BENCHMARK(BM_SendRecvPairs)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
 }  // namespace
 }  // namespace tensorflow
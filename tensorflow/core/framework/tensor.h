@@ -45,6 +45,7 @@ class VariantTensorData;
 namespace batch_util {
 Status CopyElementToSlice(Tensor element, Tensor* parent, int64 index);
 Status MaybeMoveSliceToElement(Tensor* parent, Tensor* element, int64 index);
+Status MaybeMoveLeadingSlices(Tensor* src, Tensor* dst, int64 num_slices);
 }  // namespace batch_util
 
 /// @ingroup core
@@ -499,9 +500,14 @@ class Tensor {
   friend Status batch_util::MaybeMoveSliceToElement(
       Tensor* parent, Tensor* element,
       int64 index);  // For access to RefCountIsOne().
+  friend Status batch_util::MaybeMoveLeadingSlices(
+      Tensor* src, Tensor* dst,
+      int64 num_slices);  // For access to RefCountIsOne().
 
   friend class NumpyTensorBuffer;  // For access to the private constructor
                                    // taking the buffer.
+  friend class BundleReader;       // For access to the private constructor
+                                   // taking the buffer.
 
   // Creates a tensor with the input datatype, shape and buf.
   //
@@ -83,6 +83,10 @@ NodeDef make_map_and_batch_node(const NodeDef& map_node,
   for (auto key : {"f", "Targuments"}) {
     (*new_node.mutable_attr())[key] = map_node.attr().at(key);
   }
+  // Set the `sloppy` attribute of a parallel map, if any.
+  if (map_node.attr().count("sloppy")) {
+    (*new_node.mutable_attr())["sloppy"] = map_node.attr().at("sloppy");
+  }
   // Set `output_types` and `output_shapes` attributes.
   for (auto key : {"output_shapes", "output_types"}) {
     (*new_node.mutable_attr())[key] = batch_node.attr().at(key);
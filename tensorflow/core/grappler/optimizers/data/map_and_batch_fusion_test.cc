@@ -216,13 +216,16 @@ TEST(MapAndBatchFusionTest, FuseParallelMapAndBatchNodesIntoOne) {
     map_inputs[0] = range_node->name();
     map_inputs[1] = captured_input_node->name();
     map_inputs[2] = num_parallel_calls_node->name();
-    std::vector<std::pair<string, AttrValue>> map_attrs(2);
+    std::vector<std::pair<string, AttrValue>> map_attrs(3);
     AttrValue f_attr;
     SetAttrValue("f", &f_attr);
     map_attrs[0] = std::make_pair("f", f_attr);
     AttrValue args_attr;
     SetAttrValue("Targuments", &args_attr);
     map_attrs[1] = std::make_pair("Targuments", args_attr);
+    AttrValue sloppy_attr;
+    SetAttrValue(true, &sloppy_attr);
+    map_attrs[2] = std::make_pair("sloppy", sloppy_attr);
     map_node = graph_utils::AddNode("", "ParallelMapDataset", map_inputs,
                                     map_attrs, &graph);
   }
@@ -270,6 +273,7 @@ TEST(MapAndBatchFusionTest, FuseParallelMapAndBatchNodesIntoOne) {
                                  map_node->attr().at("f")));
   EXPECT_TRUE(AreAttrValuesEqual(map_and_batch_node.attr().at("Targuments"),
                                  map_node->attr().at("Targuments")));
+  EXPECT_TRUE(map_and_batch_node.attr().at("sloppy").b());
   EXPECT_TRUE(AreAttrValuesEqual(map_and_batch_node.attr().at("output_shapes"),
                                  batch_node->attr().at("output_shapes")));
   EXPECT_TRUE(AreAttrValuesEqual(map_and_batch_node.attr().at("output_types"),
@@ -0,0 +1,198 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/vectorization_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/protobuf.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+bool IsMapNode(const NodeDef& node) {
+  return node.op() == "MapDataset" || node.op() == "ParallelMapDataset";
+}
+
+// Returns the ranks of the arguments of the function of `map_node`, or an
+// empty vector if the elements of `input_node`, the input of `map_node`, do
+// not all have the same known shape and type. Batching elements of different
+// shapes fails, even if the map function would have turned them into elements
+// that can be batched.
+std::vector<int> GetArgRanks(const NodeDef& map_node,
+                             const NodeDef& input_node,
+                             const FunctionDef& function) {
+  const auto it = input_node.attr().find("output_shapes");
+  if (it == input_node.attr().end()) return {};
+  const auto& shapes = it->second.list().shape();
+  const int num_captured_args =
+      map_node.attr().at("Targuments").list().type_size();
+  if (shapes.size() + num_captured_args !=
+      function.signature().input_arg_size()) {
+    return {};
+  }
+  std::vector<int> arg_ranks;
+  for (int i = 0; i < shapes.size(); ++i) {
+    if (function.signature().input_arg(i).type() == DT_INVALID ||
+        !PartialTensorShape(shapes.Get(i)).IsFullyDefined()) {
+      return {};
+    }
+    arg_ranks.push_back(shapes.Get(i).dim_size());
+  }
+  arg_ranks.resize(arg_ranks.size() + num_captured_args, -1);
+  return arg_ranks;
+}
+
+// Batches the elements of `input_node` like `batch_node` batches the
+// elements of the map node that reads `input_node`.
+NodeDef MakeBatchNode(const NodeDef& input_node, const NodeDef& map_node,
+                      const NodeDef& batch_node, const FunctionDef& function,
+                      int num_stacked_args, MutableGraphView* graph) {
+  NodeDef new_node = batch_node;
+  graph_utils::SetUniqueGraphNodeName(batch_node.op(), graph->GetGraph(),
+                                      &new_node);
+  new_node.set_input(0, map_node.input(0));
+
+  // Source datasets such as `TensorSliceDataset` name their types
+  // `Toutput_types`, so they are read from the arguments of the function.
+  AttrValue types;
+  for (int i = 0; i < num_stacked_args; ++i) {
+    types.mutable_list()->add_type(function.signature().input_arg(i).type());
+  }
+  (*new_node.mutable_attr())["output_types"] = std::move(types);
+  AttrValue shapes;
+  for (const TensorShapeProto& shape :
+       input_node.attr().at("output_shapes").list().shape()) {
+    TensorShapeProto* batched_shape = shapes.mutable_list()->add_shape();
+    batched_shape->add_dim()->set_size(-1);
+    for (const auto& dim : shape.dim()) {
+      *batched_shape->add_dim() = dim;
+    }
+  }
+  (*new_node.mutable_attr())["output_shapes"] = std::move(shapes);
+  return new_node;
+}
+
+// Applies `vectorized_function` to the batches of `new_batch_node`, which
+// produces the elements of `batch_node`.
+NodeDef MakeMapNode(const NodeDef& map_node, const NodeDef& batch_node,
+                    const NodeDef& new_batch_node,
+                    const FunctionDef& vectorized_function,
+                    MutableGraphView* graph) {
+  NodeDef new_node = map_node;
+  graph_utils::SetUniqueGraphNodeName(
+      strings::StrCat("vectorized_", map_node.op()), graph->GetGraph(),
+      &new_node);
+  new_node.set_input(0, new_batch_node.name());
+
+  auto* f = (*new_node.mutable_attr())["f"].mutable_func();
+  f->set_name(vectorized_function.signature().name());
+  for (auto key : {"output_shapes", "output_types"}) {
+    (*new_node.mutable_attr())[key] = batch_node.attr().at(key);
+  }
+  return new_node;
+}
+
+}  // namespace
+
+Status MapVectorization::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                  GraphDef* output) {
+  *output = item.graph;
+  MutableGraphView graph(output);
+  std::set<string> nodes_to_delete;
+  FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                             item.graph.library());
+  for (const NodeDef& node : item.graph.node()) {
+    if (node.op() != "BatchDataset" && node.op() != "BatchDatasetV2") {
+      continue;
+    }
+
+    // Use a more descriptive variable name now that we know the node type.
+    const NodeDef& batch_node = node;
+    GraphView::InputPort input_port = graph.GetInputPort(batch_node.name(), 0);
+    NodeDef* map_node = graph.GetRegularFanin(input_port).node;
+    if (!IsMapNode(*map_node) ||
+        graph.GetFanouts(*map_node, true).size() != 1) {
+      continue;
+    }
+    const NodeDef* input_node =
+        graph.GetRegularFanin(graph.GetInputPort(map_node->name(), 0)).node;
+    const FunctionDef* function =
+        function_library.Find(map_node->attr().at("f").func().name());
+    if (function == nullptr) continue;
+
+    const std::vector<int> arg_ranks =
+        GetArgRanks(*map_node, *input_node, *function);
+    if (arg_ranks.empty()) {
+      VLOG(1) << "Cannot vectorize " << map_node->name()
+              << " whose input elements do not have a known shape";
+      continue;
+    }
+    const int num_stacked_args = arg_ranks.size() -
+        map_node->attr().at("Targuments").list().type_size();
+    FunctionDef vectorized_function;
+    Status s = vectorization_utils::VectorizeFunction(
+        *function, num_stacked_args, arg_ranks, &vectorized_function);
+    if (!s.ok()) {
+      // Leave the map as it is, which is always correct.
+      VLOG(1) << "Cannot vectorize the function of " << map_node->name()
+              << ": " << s;
+      continue;
+    }
+    graph_utils::SetUniqueGraphFunctionName(
+        strings::StrCat("vectorized_", function->signature().name()),
+        output->mutable_library(), &vectorized_function);
+    *output->mutable_library()->add_function() = vectorized_function;
+
+    auto* new_batch_node = graph.AddNode(
+        MakeBatchNode(*input_node, *map_node, batch_node, *function,
+                      num_stacked_args, &graph));
+    auto* new_map_node =
+        graph.AddNode(MakeMapNode(*map_node, batch_node, *new_batch_node,
+                                  vectorized_function, &graph));
+    graph.ReplaceInput(batch_node, *new_map_node);
+
+    // Mark the `Map` and `Batch` nodes for removal.
+    nodes_to_delete.insert(map_node->name());
+    nodes_to_delete.insert(batch_node.name());
+  }
+
+  graph.DeleteNodes(nodes_to_delete);
+  return Status::OK();
+}
+
+void MapVectorization::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                const GraphDef& optimize_output,
+                                double result) {
+  // no-op
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(MapVectorization, "map_vectorization");
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,160 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using test::function::NDef;
+
+// Returns a graph that maps the function `function_name` over the int32
+// elements of shape `element_shape` of a dataset, and batches the results.
+GraphDef MakeMapAndBatchGraph(const string& map_op, const string& batch_op,
+                              const string& function_name,
+                              const PartialTensorShape& element_shape,
+                              const FunctionDef& function) {
+  const std::vector<PartialTensorShape> shape_list = {element_shape};
+  const gtl::ArraySlice<PartialTensorShape> shapes(shape_list);
+  const std::vector<PartialTensorShape> batched_shape_list = {
+      PartialTensorShape({-1}).Concatenate(element_shape)};
+  const gtl::ArraySlice<PartialTensorShape> batched_shapes(batched_shape_list);
+  std::vector<string> map_inputs = {"input"};
+  if (map_op == "ParallelMapDataset") {
+    map_inputs.push_back("num_parallel_calls");
+  }
+  std::vector<string> batch_inputs = {"map", "batch_size"};
+  if (batch_op == "BatchDatasetV2") {
+    batch_inputs.push_back("drop_remainder");
+  }
+  return test::function::GDef(
+      {NDef("components", "Const", {},
+            {{"value", test::AsTensor<int32>({1, 2, 3, 4})},
+             {"dtype", DT_INT32}}),
+       NDef("input", "TensorSliceDataset", {"components"},
+            {{"Toutput_types", gtl::ArraySlice<DataType>({DT_INT32})},
+             {"output_shapes", shapes}}),
+       NDef("num_parallel_calls", "Const", {},
+            {{"value", 2}, {"dtype", DT_INT32}}),
+       NDef("map", map_op, map_inputs,
+            {{"f", FunctionDefHelper::FunctionRef(function_name)},
+             {"Targuments", gtl::ArraySlice<DataType>({})},
+             {"output_types", gtl::ArraySlice<DataType>({DT_INT32})},
+             {"output_shapes", shapes}}),
+       NDef("batch_size", "Const", {},
+            {{"value", int64{2}}, {"dtype", DT_INT64}}),
+       NDef("drop_remainder", "Const", {},
+            {{"value", false}, {"dtype", DT_BOOL}}),
+       NDef("batch", batch_op, batch_inputs,
+            {{"output_types", gtl::ArraySlice<DataType>({DT_INT32})},
+             {"output_shapes", batched_shapes}})},
+      // FunctionLib
+      {function});
+}
+
+class VectorizeMapAndBatchTest
+    : public ::testing::TestWithParam<std::pair<string, string>> {};
+
+TEST_P(VectorizeMapAndBatchTest, VectorizesMapAndBatch) {
+  const string map_op = GetParam().first;
+  const string batch_op = GetParam().second;
+  GrapplerItem item;
+  item.graph =
+      MakeMapAndBatchGraph(map_op, batch_op, "XTimesTwoInt32",
+                           PartialTensorShape({}),
+                           test::function::XTimesTwoInt32());
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("batch", output));
+  // The input is batched first, and the batches are mapped.
+  const NodeDef& new_batch_node =
+      output.node(graph_utils::FindNodeWithOp(batch_op, output));
+  const NodeDef& new_map_node =
+      output.node(graph_utils::FindNodeWithOp(map_op, output));
+  EXPECT_EQ("input", new_batch_node.input(0));
+  EXPECT_EQ("batch_size", new_batch_node.input(1));
+  EXPECT_EQ(new_batch_node.name(), new_map_node.input(0));
+  if (map_op == "ParallelMapDataset") {
+    EXPECT_EQ("num_parallel_calls", new_map_node.input(1));
+  }
+  if (batch_op == "BatchDatasetV2") {
+    EXPECT_EQ("drop_remainder", new_batch_node.input(2));
+  }
+  EXPECT_EQ("vectorized_XTimesTwoInt32",
+            new_map_node.attr().at("f").func().name());
+  EXPECT_NE(-1, graph_utils::FindGraphFunctionWithName(
+                    "vectorized_XTimesTwoInt32", output.library()));
+
+  const auto& batch_shapes = new_batch_node.attr().at("output_shapes");
+  ASSERT_EQ(1, batch_shapes.list().shape_size());
+  EXPECT_EQ("[?]", PartialTensorShape(batch_shapes.list().shape(0))
+                       .DebugString());
+  const NodeDef& batch_node =
+      item.graph.node(graph_utils::FindGraphNodeWithName("batch", item.graph));
+  for (auto key : {"output_shapes", "output_types"}) {
+    EXPECT_TRUE(AreAttrValuesEqual(new_map_node.attr().at(key),
+                                   batch_node.attr().at(key)));
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    Test, VectorizeMapAndBatchTest,
+    ::testing::Values(std::make_pair("MapDataset", "BatchDataset"),
+                      std::make_pair("ParallelMapDataset", "BatchDataset"),
+                      std::make_pair("MapDataset", "BatchDatasetV2"),
+                      std::make_pair("ParallelMapDataset", "BatchDatasetV2")));
+
+TEST(MapVectorizationTest, KeepsMapOfElementsWithUnknownShapes) {
+  GrapplerItem item;
+  item.graph = MakeMapAndBatchGraph(
+      "MapDataset", "BatchDataset", "XTimesTwoInt32", PartialTensorShape({-1}),
+      test::function::XTimesTwoInt32());
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::Compare(item.graph, output));
+}
+
+TEST(MapVectorizationTest, KeepsMapOfUnsupportedFunction) {
+  GrapplerItem item;
+  item.graph = MakeMapAndBatchGraph("MapDataset", "BatchDataset",
+                                    "XTimesFour", PartialTensorShape({}),
+                                    test::function::XTimesFour());
+  *item.graph.mutable_library()->add_function() =
+      test::function::XTimesTwo();
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::Compare(item.graph, output));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
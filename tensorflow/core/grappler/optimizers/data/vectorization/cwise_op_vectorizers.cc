@@ -0,0 +1,216 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer.h"
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer_registry.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+namespace {
+
+// Returns the type of the inputs of the cwise op `node`.
+DataType InputType(const NodeDef& node) {
+  const auto it = node.attr().find("T");
+  return it == node.attr().end() ? DT_BOOL : it->second.type();
+}
+
+// Sets `*expanded` to the name of a tensor that holds the stacked operand `x`
+// of `node` with size-1 dimensions inserted after the leading dimension, so
+// that its values have at least the rank of the other operand `other`. The
+// operands then broadcast against each other like they do in the original
+// function, where shapes are aligned on their trailing dimensions.
+Status ExpandForBroadcast(const NodeDef& node, const VectorizedTensor& x,
+                          const VectorizedTensor& other, FunctionDef* outer,
+                          string* expanded) {
+  const AttrValue type_attr = MakeAttr(InputType(node));
+  const AttrValue int32_attr = MakeAttr(DT_INT32);
+  const string prefix = strings::StrCat(node.name(), "/expand");
+  if (x.rank >= 0 && other.rank >= 0) {
+    *expanded = x.name;
+    if (x.rank >= other.rank) return Status::OK();
+    const string axis = AddInt32ScalarConst(prefix, 1, outer);
+    for (int i = x.rank; i < other.rank; ++i) {
+      NodeDef* expand_dims = AddFunctionNode(
+          prefix, "ExpandDims", {*expanded, axis},
+          {{"T", type_attr}, {"Tdim", int32_attr}}, outer);
+      TF_RETURN_IF_ERROR(GetOutputTensorName(*expand_dims, expanded));
+    }
+    return Status::OK();
+  }
+
+  // The ranks are only known when the function runs, so the new shape is
+  // computed in the function:
+  //   pad = max(rank(other) - rank(x), 0)
+  //   shape = concat([shape(x)[:1], fill([pad], 1), shape(x)[1:]])
+  string x_rank;
+  NodeDef* node_def = AddFunctionNode(prefix, "Rank", {x.name},
+                                      {{"T", type_attr}}, outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &x_rank));
+  string other_rank;
+  node_def = AddFunctionNode(prefix, "Rank", {other.name}, {{"T", type_attr}},
+                             outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &other_rank));
+  string pad;
+  node_def = AddFunctionNode(prefix, "Sub", {other_rank, x_rank},
+                             {{"T", int32_attr}}, outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &pad));
+  const string one = AddInt32ScalarConst(prefix, 1, outer);
+  if (!other.stacked) {
+    // `x_rank` includes the leading dimension, but `other_rank` does not.
+    node_def = AddFunctionNode(prefix, "Add", {pad, one}, {{"T", int32_attr}},
+                               outer);
+    TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &pad));
+  }
+  node_def = AddFunctionNode(prefix, "Maximum",
+                             {pad, AddInt32ScalarConst(prefix, 0, outer)},
+                             {{"T", int32_attr}}, outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &pad));
+  node_def = AddFunctionNode(prefix, "Reshape",
+                             {pad, AddInt32VectorConst(prefix, {1}, outer)},
+                             {{"T", int32_attr}, {"Tshape", int32_attr}},
+                             outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &pad));
+  string ones;
+  node_def = AddFunctionNode(prefix, "Fill", {pad, one},
+                             {{"T", int32_attr}, {"index_type", int32_attr}},
+                             outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &ones));
+
+  string x_shape;
+  node_def = AddFunctionNode(prefix, "Shape", {x.name},
+                             {{"T", type_attr}, {"out_type", int32_attr}},
+                             outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &x_shape));
+  string batch_dim;
+  node_def = AddFunctionNode(prefix, "Slice",
+                             {x_shape, AddInt32VectorConst(prefix, {0}, outer),
+                              AddInt32VectorConst(prefix, {1}, outer)},
+                             {{"T", int32_attr}, {"Index", int32_attr}},
+                             outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &batch_dim));
+  string element_dims;
+  node_def = AddFunctionNode(prefix, "Slice",
+                             {x_shape, AddInt32VectorConst(prefix, {1}, outer),
+                              AddInt32VectorConst(prefix, {-1}, outer)},
+                             {{"T", int32_attr}, {"Index", int32_attr}},
+                             outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &element_dims));
+  string shape;
+  node_def = AddFunctionNode(
+      prefix, "ConcatV2",
+      {batch_dim, ones, element_dims, AddInt32ScalarConst(prefix, 0, outer)},
+      {{"N", MakeAttr(3)}, {"T", int32_attr}, {"Tidx", int32_attr}}, outer);
+  TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &shape));
+  node_def = AddFunctionNode(prefix, "Reshape", {x.name, shape},
+                             {{"T", type_attr}, {"Tshape", int32_attr}},
+                             outer);
+  return GetOutputTensorName(*node_def, expanded);
+}
+
+// Vectorizes an op that is applied to each value of its input independently.
+class UnaryCwiseVectorizer : public Vectorizer {
+ public:
+  Status Vectorize(const NodeDef& node,
+                   gtl::ArraySlice<VectorizedTensor> inputs, FunctionDef* outer,
+                   std::vector<VectorizedTensor>* outputs) override {
+    NodeDef* new_node = AddNodeCopy(node, {inputs[0].name}, outer);
+    VectorizedTensor output;
+    TF_RETURN_IF_ERROR(GetOutputTensorName(*new_node, &output.name));
+    output.stacked = true;
+    outputs->push_back(output);
+    return Status::OK();
+  }
+};
+
+// Vectorizes an op that is applied to each pair of values of its inputs
+// after broadcasting them against each other. The stacked inputs get size-1
+// dimensions after the leading one where needed, so that broadcasting the
+// stacked values matches broadcasting the values of each element.
+class BinaryCwiseVectorizer : public Vectorizer {
+ public:
+  Status Vectorize(const NodeDef& node,
+                   gtl::ArraySlice<VectorizedTensor> inputs, FunctionDef* outer,
+                   std::vector<VectorizedTensor>* outputs) override {
+    if (inputs.size() != 2) {
+      return errors::InvalidArgument("Expected ", node.op(), " node ",
+                                     node.name(), " to have 2 inputs");
+    }
+    std::vector<string> new_inputs(2);
+    for (int i = 0; i < 2; ++i) {
+      if (inputs[i].stacked) {
+        TF_RETURN_IF_ERROR(ExpandForBroadcast(node, inputs[i], inputs[1 - i],
+                                              outer, &new_inputs[i]));
+      } else {
+        new_inputs[i] = inputs[i].name;
+      }
+    }
+    NodeDef* new_node = AddNodeCopy(node, new_inputs, outer);
+    VectorizedTensor output;
+    TF_RETURN_IF_ERROR(GetOutputTensorName(*new_node, &output.name));
+    output.stacked = true;
+    outputs->push_back(output);
+    return Status::OK();
+  }
+};
+
+REGISTER_VECTORIZER("Abs", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Ceil", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Cos", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Exp", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Floor", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Identity", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("IsNan", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Log", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Log1p", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("LogicalNot", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Neg", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Reciprocal", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Round", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Rsqrt", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Sigmoid", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Sign", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Sin", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Sqrt", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Square", UnaryCwiseVectorizer);
+REGISTER_VECTORIZER("Tanh", UnaryCwiseVectorizer);
+
+REGISTER_VECTORIZER("Add", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("AddV2", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Div", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Equal", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("FloorDiv", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("FloorMod", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Greater", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("GreaterEqual", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Less", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("LessEqual", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("LogicalAnd", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("LogicalOr", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Maximum", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Minimum", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Mul", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("NotEqual", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Pow", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("RealDiv", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("SquaredDifference", BinaryCwiseVectorizer);
+REGISTER_VECTORIZER("Sub", BinaryCwiseVectorizer);
+
+}  // namespace
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
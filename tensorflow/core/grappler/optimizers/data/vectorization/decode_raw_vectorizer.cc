@@ -0,0 +1,47 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer.h"
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer_registry.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+namespace {
+
+// DecodeRaw decodes each string of its input into a vector of the same
+// length, so decoding the stacked strings stacks the decoded vectors. As for
+// batching, the strings of all the elements must have the same length.
+class DecodeRawVectorizer : public Vectorizer {
+ public:
+  Status Vectorize(const NodeDef& node,
+                   gtl::ArraySlice<VectorizedTensor> inputs, FunctionDef* outer,
+                   std::vector<VectorizedTensor>* outputs) override {
+    NodeDef* decode_raw = AddNodeCopy(node, {inputs[0].name}, outer);
+    VectorizedTensor output;
+    TF_RETURN_IF_ERROR(GetOutputTensorName(*decode_raw, &output.name));
+    output.stacked = true;
+    outputs->push_back(output);
+    return Status::OK();
+  }
+};
+
+REGISTER_VECTORIZER("DecodeRaw", DecodeRawVectorizer);
+
+}  // namespace
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
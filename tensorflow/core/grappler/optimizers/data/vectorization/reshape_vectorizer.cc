@@ -0,0 +1,78 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer.h"
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer_registry.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+namespace {
+
+// Reshapes the stacked tensor to the requested shape with the leading
+// dimension prepended:
+//   shape' = concat([shape(tensor)[:1], shape])
+// Each element may be reshaped to a different shape if the requested shape
+// is stacked, which cannot be done with a single Reshape.
+class ReshapeVectorizer : public Vectorizer {
+ public:
+  Status Vectorize(const NodeDef& node,
+                   gtl::ArraySlice<VectorizedTensor> inputs, FunctionDef* outer,
+                   std::vector<VectorizedTensor>* outputs) override {
+    if (inputs[1].stacked) {
+      return errors::Unimplemented("Cannot vectorize Reshape node ",
+                                   node.name(),
+                                   " whose shape depends on the element");
+    }
+    const AttrValue& shape_type = node.attr().at("Tshape");
+    const AttrValue int32_attr = MakeAttr(DT_INT32);
+    const string prefix = strings::StrCat(node.name(), "/shape");
+
+    string tensor_shape;
+    NodeDef* node_def = AddFunctionNode(
+        prefix, "Shape", {inputs[0].name},
+        {{"T", node.attr().at("T")}, {"out_type", shape_type}}, outer);
+    TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &tensor_shape));
+    string batch_dim;
+    node_def = AddFunctionNode(
+        prefix, "Slice",
+        {tensor_shape, AddInt32VectorConst(prefix, {0}, outer),
+         AddInt32VectorConst(prefix, {1}, outer)},
+        {{"T", shape_type}, {"Index", int32_attr}}, outer);
+    TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &batch_dim));
+    string shape;
+    node_def = AddFunctionNode(
+        prefix, "ConcatV2",
+        {batch_dim, inputs[1].name, AddInt32ScalarConst(prefix, 0, outer)},
+        {{"N", MakeAttr(2)}, {"T", shape_type}, {"Tidx", int32_attr}}, outer);
+    TF_RETURN_IF_ERROR(GetOutputTensorName(*node_def, &shape));
+
+    NodeDef* reshape = AddNodeCopy(node, {inputs[0].name, shape}, outer);
+    VectorizedTensor output;
+    TF_RETURN_IF_ERROR(GetOutputTensorName(*reshape, &output.name));
+    output.stacked = true;
+    outputs->push_back(output);
+    return Status::OK();
+  }
+};
+
+REGISTER_VECTORIZER("Reshape", ReshapeVectorizer);
+
+}  // namespace
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,117 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer.h"
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+
+NodeDef* AddFunctionNode(
+    StringPiece name, StringPiece op, const std::vector<string>& inputs,
+    const std::vector<std::pair<string, AttrValue>>& attributes,
+    FunctionDef* function) {
+  NodeDef* node = function->add_node_def();
+  graph_utils::SetUniqueFunctionNodeName(name, function, node);
+  node->set_op(op.ToString());
+  for (const string& input : inputs) {
+    node->add_input(input);
+  }
+  for (const auto& attr : attributes) {
+    (*node->mutable_attr())[attr.first] = attr.second;
+  }
+  return node;
+}
+
+NodeDef* AddNodeCopy(const NodeDef& node, const std::vector<string>& inputs,
+                     FunctionDef* function) {
+  NodeDef* copy = function->add_node_def();
+  *copy = node;
+  copy->clear_name();
+  copy->clear_input();
+  graph_utils::SetUniqueFunctionNodeName(node.name(), function, copy);
+  for (const string& input : inputs) {
+    copy->add_input(input);
+  }
+  return copy;
+}
+
+string AddConstNode(StringPiece name, const Tensor& value,
+                    FunctionDef* function) {
+  AttrValue dtype;
+  dtype.set_type(value.dtype());
+  AttrValue tensor;
+  value.AsProtoTensorContent(tensor.mutable_tensor());
+  NodeDef* node = AddFunctionNode(name, "Const", {},
+                                  {{"dtype", dtype}, {"value", tensor}},
+                                  function);
+  return strings::StrCat(node->name(), ":output:0");
+}
+
+string AddInt32ScalarConst(StringPiece name, int32 value,
+                           FunctionDef* function) {
+  Tensor tensor(DT_INT32, TensorShape({}));
+  tensor.scalar<int32>()() = value;
+  return AddConstNode(name, tensor, function);
+}
+
+string AddInt32VectorConst(StringPiece name, const std::vector<int32>& values,
+                           FunctionDef* function) {
+  Tensor tensor(DT_INT32, TensorShape({static_cast<int64>(values.size())}));
+  for (size_t i = 0; i < values.size(); ++i) {
+    tensor.vec<int32>()(i) = values[i];
+  }
+  return AddConstNode(name, tensor, function);
+}
+
+Status GetOutputTensorNames(const NodeDef& node, std::vector<string>* names) {
+  const OpDef* op_def;
+  TF_RETURN_IF_ERROR(OpRegistry::Global()->LookUpOpDef(node.op(), &op_def));
+  NameRangeMap output_ranges;
+  TF_RETURN_IF_ERROR(
+      NameRangesForNode(node, *op_def, nullptr, &output_ranges));
+  names->clear();
+  for (const auto& output_arg : op_def->output_arg()) {
+    const auto& range = output_ranges.at(output_arg.name());
+    for (int i = 0; i < range.second - range.first; ++i) {
+      names->push_back(
+          strings::StrCat(node.name(), ":", output_arg.name(), ":", i));
+    }
+  }
+  return Status::OK();
+}
+
+Status GetOutputTensorName(const NodeDef& node, string* name) {
+  std::vector<string> names;
+  TF_RETURN_IF_ERROR(GetOutputTensorNames(node, &names));
+  if (names.size() != 1) {
+    return errors::Internal("Expected node ", node.name(),
+                            " to have a single output, but it has ",
+                            names.size());
+  }
+  *name = names[0];
+  return Status::OK();
+}
+
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
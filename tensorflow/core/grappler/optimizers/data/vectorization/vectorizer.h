@@ -0,0 +1,110 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_VECTORIZER_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_VECTORIZER_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+
+// A tensor of a vectorized function. A "stacked" tensor holds the values
+// that the original function computes for each element of a batch, stacked
+// along a new leading dimension; an "unstacked" tensor holds a value that is
+// the same for all the elements.
+struct VectorizedTensor {
+  // The name of the tensor in the vectorized function, e.g. "node:output:0".
+  string name;
+  bool stacked = false;
+  // The rank of the value for a single element, i.e. excluding the leading
+  // dimension of stacked tensors, or -1 if unknown. Vectorizers need not set
+  // the rank of their outputs, which is inferred from the original function.
+  int rank = -1;
+};
+
+// Interface for the conversion of a node of the original function into
+// nodes of the vectorized function that compute its outputs for a whole batch
+// at once.
+class Vectorizer {
+ public:
+  virtual ~Vectorizer() {}
+
+  // Adds to `outer` the nodes that compute the outputs of `node` for a
+  // batch, given its data `inputs` in the vectorized function, at least one
+  // of which is stacked. Fills in `outputs` with one tensor per output of
+  // `node`. Returns an error if `node` cannot be vectorized; `outer` is
+  // then discarded by the caller.
+  virtual Status Vectorize(const NodeDef& node,
+                           gtl::ArraySlice<VectorizedTensor> inputs,
+                           FunctionDef* outer,
+                           std::vector<VectorizedTensor>* outputs) = 0;
+};
+
+// Returns an AttrValue holding `value`.
+template <typename T>
+AttrValue MakeAttr(const T& value) {
+  AttrValue attr;
+  SetAttrValue(value, &attr);
+  return attr;
+}
+
+// Adds a node to `function`, whose name is unique in `function` and derived
+// from `name`.
+NodeDef* AddFunctionNode(
+    StringPiece name, StringPiece op, const std::vector<string>& inputs,
+    const std::vector<std::pair<string, AttrValue>>& attributes,
+    FunctionDef* function);
+
+// Adds to `function` a copy of `node` that reads `inputs`, named uniquely
+// after `node`.
+NodeDef* AddNodeCopy(const NodeDef& node, const std::vector<string>& inputs,
+                     FunctionDef* function);
+
+// Adds a Const node holding `value` to `function` and returns the name of
+// its output tensor.
+string AddConstNode(StringPiece name, const Tensor& value,
+                    FunctionDef* function);
+
+// Add a Const node holding an int32 scalar or vector to `function` and
+// return the name of its output tensor.
+string AddInt32ScalarConst(StringPiece name, int32 value,
+                           FunctionDef* function);
+string AddInt32VectorConst(StringPiece name, const std::vector<int32>& values,
+                           FunctionDef* function);
+
+// Fills in `names` with the names of the output tensors of `node`, a node
+// of a function, e.g. {"node:output:0"}.
+Status GetOutputTensorNames(const NodeDef& node, std::vector<string>* names);
+
+// Returns the name of the single output tensor of `node`, a node of a
+// function.
+Status GetOutputTensorName(const NodeDef& node, string* name);
+
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_VECTORIZER_H_
@@ -0,0 +1,52 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer_registry.h"
+
+#include <unordered_map>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+
+namespace {
+typedef std::unordered_map<string, std::unique_ptr<Vectorizer>>
+    RegistrationMap;
+RegistrationMap* GetRegistrationMap() {
+  static RegistrationMap* registered_vectorizers = new RegistrationMap;
+  return registered_vectorizers;
+}
+}  // namespace
+
+Vectorizer* VectorizerRegistry::Get(const string& op) {
+  const auto it = GetRegistrationMap()->find(op);
+  if (it == GetRegistrationMap()->end()) return nullptr;
+  return it->second.get();
+}
+
+void VectorizerRegistry::RegisterVectorizerOrDie(const string& op,
+                                                 const Creator& creator) {
+  const auto it = GetRegistrationMap()->find(op);
+  if (it != GetRegistrationMap()->end()) {
+    LOG(FATAL) << "Vectorizer is registered twice for op: " << op;
+  }
+  GetRegistrationMap()->emplace(op, std::unique_ptr<Vectorizer>(creator()));
+}
+
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
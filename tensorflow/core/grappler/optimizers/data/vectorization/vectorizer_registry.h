@@ -0,0 +1,65 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_VECTORIZER_REGISTRY_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_VECTORIZER_REGISTRY_H_
+
+#include <functional>
+#include <memory>
+
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+
+// A global registry of the vectorizers of ops, keyed by op name.
+class VectorizerRegistry {
+ public:
+  typedef std::function<Vectorizer*()> Creator;
+
+  // Returns the vectorizer of `op`, or nullptr if there is none.
+  static Vectorizer* Get(const string& op);
+
+  // Registers the vectorizer of `op`, which can be called during program
+  // initialization. This class is not thread-safe.
+  static void RegisterVectorizerOrDie(const string& op,
+                                      const Creator& creator);
+};
+
+class VectorizerRegistrar {
+ public:
+  VectorizerRegistrar(const string& op,
+                      const VectorizerRegistry::Creator& creator) {
+    VectorizerRegistry::RegisterVectorizerOrDie(op, creator);
+  }
+};
+
+#define REGISTER_VECTORIZER(op, MyVectorizerClass) \
+  REGISTER_VECTORIZER_UNIQ_HELPER(__COUNTER__, op, MyVectorizerClass)
+
+#define REGISTER_VECTORIZER_UNIQ_HELPER(ctr, op, MyVectorizerClass) \
+  REGISTER_VECTORIZER_UNIQ(ctr, op, MyVectorizerClass)
+
+#define REGISTER_VECTORIZER_UNIQ(ctr, op, MyVectorizerClass)               \
+  static ::tensorflow::grappler::vectorization_utils::VectorizerRegistrar \
+      vectorizer_registrar_##ctr((op),                                    \
+                                 []() { return new MyVectorizerClass; });
+
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_VECTORIZER_REGISTRY_H_
@@ -0,0 +1,277 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/vectorization_utils.h"
+
+#include <deque>
+#include <map>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer.h"
+#include "tensorflow/core/grappler/optimizers/data/vectorization/vectorizer_registry.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+namespace {
+
+// Maps the names of the tensors of the original function to their
+// counterparts in the vectorized function.
+typedef std::map<string, VectorizedTensor> TensorMap;
+
+// Returns the name of the node or argument that `input`, an input of a node
+// of a function, refers to: "^node", "node:output:0" and "arg" refer to
+// "node", "node" and "arg".
+StringPiece InputNodeName(StringPiece input) {
+  str_util::ConsumePrefix(&input, "^");
+  const auto pos = input.find(':');
+  return pos == StringPiece::npos ? input : input.substr(0, pos);
+}
+
+// Sorts the nodes of `function` so that each node comes after the nodes that
+// it depends on.
+Status SortNodes(const FunctionDef& function,
+                 std::vector<const NodeDef*>* sorted) {
+  const int num_nodes = function.node_def_size();
+  std::unordered_map<StringPiece, int, StringPieceHasher> node_index;
+  for (int i = 0; i < num_nodes; ++i) {
+    node_index[function.node_def(i).name()] = i;
+  }
+  std::vector<int> num_pending(num_nodes, 0);
+  std::vector<std::vector<int>> consumers(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    for (const string& input : function.node_def(i).input()) {
+      const auto it = node_index.find(InputNodeName(input));
+      if (it != node_index.end()) {
+        ++num_pending[i];
+        consumers[it->second].push_back(i);
+      }
+    }
+  }
+  std::deque<int> ready;
+  for (int i = 0; i < num_nodes; ++i) {
+    if (num_pending[i] == 0) ready.push_back(i);
+  }
+  sorted->clear();
+  while (!ready.empty()) {
+    const int i = ready.front();
+    ready.pop_front();
+    sorted->push_back(&function.node_def(i));
+    for (int consumer : consumers[i]) {
+      if (--num_pending[consumer] == 0) ready.push_back(consumer);
+    }
+  }
+  if (sorted->size() != static_cast<size_t>(num_nodes)) {
+    return errors::InvalidArgument("Function ", function.signature().name(),
+                                   " has a cycle");
+  }
+  return Status::OK();
+}
+
+// Fills in `ranks` with the ranks of the outputs of `node` for a single
+// element, given its `inputs`, or -1 where the shape function of its op
+// cannot tell.
+void InferOutputRanks(const NodeDef& node,
+                      const std::vector<VectorizedTensor>& inputs,
+                      int num_outputs, std::vector<int>* ranks) {
+  ranks->assign(num_outputs, -1);
+  const OpRegistrationData* op_reg_data;
+  if (!OpRegistry::Global()->LookUp(node.op(), &op_reg_data).ok() ||
+      op_reg_data->shape_inference_fn == nullptr) {
+    return;
+  }
+  std::vector<PartialTensorShape> input_shapes;
+  for (const VectorizedTensor& input : inputs) {
+    if (input.rank >= 0) {
+      input_shapes.emplace_back(std::vector<int64>(input.rank, -1));
+    } else {
+      input_shapes.emplace_back();
+    }
+  }
+  shape_inference::InferenceContext c(TF_GRAPH_DEF_VERSION, &node,
+                                      op_reg_data->op_def, input_shapes, {},
+                                      {}, {});
+  if (!c.construction_status().ok() ||
+      !c.Run(op_reg_data->shape_inference_fn).ok()) {
+    return;
+  }
+  for (int i = 0; i < c.num_outputs() && i < num_outputs; ++i) {
+    if (c.RankKnown(c.output(i))) (*ranks)[i] = c.Rank(c.output(i));
+  }
+}
+
+// Adds to `vectorized` the nodes that compute the outputs of `node` for a
+// batch and records them in `tensors`. `copied_nodes` maps the names of the
+// nodes that were copied as is to the names of their copies.
+Status VectorizeNode(const NodeDef& node, TensorMap* tensors,
+                     std::map<string, string>* copied_nodes,
+                     FunctionDef* vectorized) {
+  const OpDef* op_def;
+  if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok()) {
+    return errors::Unimplemented("Cannot vectorize node ", node.name(),
+                                 " whose op ", node.op(),
+                                 " is not a registered op");
+  }
+  // Vectorizing a stateful op, or running it once for the whole batch,
+  // would change how its state evolves.
+  if (op_def->is_stateful()) {
+    return errors::Unimplemented("Cannot vectorize node ", node.name(),
+                                 " of stateful op ", node.op());
+  }
+
+  std::vector<VectorizedTensor> inputs;
+  std::vector<string> control_inputs;
+  bool stacked = false;
+  for (const string& input : node.input()) {
+    if (str_util::StartsWith(input, "^")) {
+      const auto it = copied_nodes->find(input.substr(1));
+      if (it == copied_nodes->end()) {
+        return errors::Unimplemented("Cannot vectorize node ", node.name(),
+                                     " with a control dependency on ",
+                                     "vectorized node ", input.substr(1));
+      }
+      control_inputs.push_back(strings::StrCat("^", it->second));
+      continue;
+    }
+    const auto it = tensors->find(input);
+    if (it == tensors->end()) {
+      return errors::InvalidArgument("Node ", node.name(),
+                                     " has an unknown input ", input);
+    }
+    inputs.push_back(it->second);
+    stacked = stacked || it->second.stacked;
+  }
+
+  std::vector<string> output_names;
+  TF_RETURN_IF_ERROR(GetOutputTensorNames(node, &output_names));
+  std::vector<VectorizedTensor> outputs;
+  if (!stacked) {
+    // The outputs are the same for all the elements, so they are computed
+    // once for the batch.
+    std::vector<string> new_inputs;
+    for (const VectorizedTensor& input : inputs) {
+      new_inputs.push_back(input.name);
+    }
+    new_inputs.insert(new_inputs.end(), control_inputs.begin(),
+                      control_inputs.end());
+    NodeDef* copy = AddNodeCopy(node, new_inputs, vectorized);
+    (*copied_nodes)[node.name()] = copy->name();
+    std::vector<string> copy_output_names;
+    TF_RETURN_IF_ERROR(GetOutputTensorNames(*copy, &copy_output_names));
+    for (const string& name : copy_output_names) {
+      VectorizedTensor output;
+      output.name = name;
+      outputs.push_back(output);
+    }
+  } else {
+    if (!control_inputs.empty()) {
+      return errors::Unimplemented("Cannot vectorize node ", node.name(),
+                                   " with control dependencies");
+    }
+    Vectorizer* vectorizer = VectorizerRegistry::Get(node.op());
+    if (vectorizer == nullptr) {
+      return errors::Unimplemented("Cannot vectorize node ", node.name(),
+                                   ": no vectorizer is registered for op ",
+                                   node.op());
+    }
+    TF_RETURN_IF_ERROR(
+        vectorizer->Vectorize(node, inputs, vectorized, &outputs));
+  }
+  if (outputs.size() != output_names.size()) {
+    return errors::Internal("Vectorizing node ", node.name(), " produced ",
+                            outputs.size(), " outputs instead of ",
+                            output_names.size());
+  }
+  std::vector<int> output_ranks;
+  InferOutputRanks(node, inputs, outputs.size(), &output_ranks);
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    outputs[i].rank = output_ranks[i];
+    (*tensors)[output_names[i]] = outputs[i];
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+Status VectorizeFunction(const FunctionDef& function, int num_stacked_args,
+                         const std::vector<int>& arg_ranks,
+                         FunctionDef* vectorized) {
+  const OpDef& signature = function.signature();
+  if (arg_ranks.size() != static_cast<size_t>(signature.input_arg_size()) ||
+      num_stacked_args < 0 || num_stacked_args > signature.input_arg_size()) {
+    return errors::InvalidArgument(
+        "Function ", signature.name(), " has ", signature.input_arg_size(),
+        " arguments, but got ", arg_ranks.size(), " ranks and ",
+        num_stacked_args, " stacked arguments");
+  }
+  vectorized->Clear();
+  *vectorized->mutable_signature() = signature;
+  *vectorized->mutable_attr() = function.attr();
+
+  TensorMap tensors;
+  for (int i = 0; i < signature.input_arg_size(); ++i) {
+    VectorizedTensor arg;
+    arg.name = signature.input_arg(i).name();
+    arg.stacked = i < num_stacked_args;
+    arg.rank = arg_ranks[i];
+    tensors[arg.name] = arg;
+  }
+  std::map<string, string> copied_nodes;
+  std::vector<const NodeDef*> sorted_nodes;
+  TF_RETURN_IF_ERROR(SortNodes(function, &sorted_nodes));
+  for (const NodeDef* node : sorted_nodes) {
+    TF_RETURN_IF_ERROR(
+        VectorizeNode(*node, &tensors, &copied_nodes, vectorized));
+  }
+
+  for (const auto& output_arg : signature.output_arg()) {
+    const auto ret = function.ret().find(output_arg.name());
+    if (ret == function.ret().end()) {
+      return errors::InvalidArgument("Function ", signature.name(),
+                                     " does not define output ",
+                                     output_arg.name());
+    }
+    const auto it = tensors.find(ret->second);
+    if (it == tensors.end()) {
+      return errors::InvalidArgument("Output ", output_arg.name(),
+                                     " of function ", signature.name(),
+                                     " refers to unknown tensor ",
+                                     ret->second);
+    }
+    // Outputs that are the same for all the elements would have to be tiled
+    // along a new leading dimension of the batch size.
+    if (!it->second.stacked) {
+      return errors::Unimplemented("Cannot vectorize output ",
+                                   output_arg.name(), " of function ",
+                                   signature.name(),
+                                   ", which is the same for all elements");
+    }
+    (*vectorized->mutable_ret())[output_arg.name()] = it->second.name;
+  }
+  return Status::OK();
+}
+
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,50 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_UTILS_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_UTILS_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+
+// Converts `function`, which computes its outputs for a single element, into
+// `vectorized`, which computes them for a batch of elements at once.
+//
+// The first `num_stacked_args` arguments of `vectorized` are the arguments of
+// `function` for all the elements, stacked along a new leading dimension; the
+// remaining arguments are the same for all the elements and are passed as
+// is. `arg_ranks` holds the rank of each argument of `function`, or -1 if
+// unknown. The outputs of `vectorized` are the outputs of `function` for all
+// the elements, stacked along a new leading dimension.
+//
+// Nodes that only depend on unstacked values are copied, and the others are
+// converted by the vectorizer registered for their op. Returns an error if
+// some node cannot be vectorized, e.g. because its op has no vectorizer or
+// it is stateful; `vectorized` should then be discarded.
+Status VectorizeFunction(const FunctionDef& function, int num_stacked_args,
+                         const std::vector<int>& arg_ranks,
+                         FunctionDef* vectorized);
+
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_VECTORIZATION_UTILS_H_
@@ -0,0 +1,191 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/vectorization_utils.h"
+
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace vectorization_utils {
+namespace {
+
+using FDH = FunctionDefHelper;
+
+// Returns the node of `function` that computes the output `ret`.
+const NodeDef& GetRetNode(const FunctionDef& function, const string& ret) {
+  const string& tensor = function.ret().at(ret);
+  const int index = graph_utils::FindFunctionNodeWithName(
+      tensor.substr(0, tensor.find(':')), function);
+  CHECK_NE(index, -1) << "No node computes output " << ret;
+  return function.node_def(index);
+}
+
+TEST(VectorizeFunctionTest, VectorizesCwiseOps) {
+  FunctionDef function = test::function::XTimesTwoInt32();
+  FunctionDef vectorized;
+  TF_ASSERT_OK(VectorizeFunction(function, 1, {0}, &vectorized));
+
+  EXPECT_EQ(function.signature().DebugString(),
+            vectorized.signature().DebugString());
+  // The constant is computed once for the batch, and multiplies the stacked
+  // argument directly since both are scalars for each element.
+  const NodeDef& mul = GetRetNode(vectorized, "y");
+  EXPECT_EQ("Mul", mul.op());
+  EXPECT_EQ("x", mul.input(0));
+  EXPECT_TRUE(graph_utils::ContainsFunctionNodeWithOp("Cast", vectorized));
+  EXPECT_FALSE(
+      graph_utils::ContainsFunctionNodeWithOp("ExpandDims", vectorized));
+}
+
+TEST(VectorizeFunctionTest, ExpandsStackedOperandsForBroadcasting) {
+  // y = x + [1, 2, 3], where x is a scalar.
+  FunctionDef function = FDH::Create(
+      "AddVector", {"x: float"}, {"y: float"}, {},
+      {{{"c"},
+        "Const",
+        {},
+        {{"value", test::AsTensor<float>({1, 2, 3})}, {"dtype", DT_FLOAT}}},
+       {{"add"}, "Add", {"x", "c:output:0"}, {{"T", DT_FLOAT}}}},
+      {{"y", "add:z:0"}});
+  FunctionDef vectorized;
+  TF_ASSERT_OK(VectorizeFunction(function, 1, {0}, &vectorized));
+
+  // The stacked `x`, of shape [batch], is expanded to [batch, 1] so that it
+  // broadcasts to [batch, 3].
+  const NodeDef& add = GetRetNode(vectorized, "y");
+  EXPECT_EQ("Add", add.op());
+  const int index = graph_utils::FindFunctionNodeWithName(
+      add.input(0).substr(0, add.input(0).find(':')), vectorized);
+  ASSERT_NE(-1, index);
+  EXPECT_EQ("ExpandDims", vectorized.node_def(index).op());
+}
+
+TEST(VectorizeFunctionTest, ExpandsOperandsOfUnknownRank) {
+  // y = x * w, where w is captured and has an unknown rank.
+  FunctionDef function = FDH::Create(
+      "MulCaptured", {"x: float", "w: float"}, {"y: float"}, {},
+      {{{"mul"}, "Mul", {"x", "w"}, {{"T", DT_FLOAT}}}}, {{"y", "mul:z:0"}});
+  FunctionDef vectorized;
+  TF_ASSERT_OK(VectorizeFunction(function, 1, {0, -1}, &vectorized));
+
+  const NodeDef& mul = GetRetNode(vectorized, "y");
+  EXPECT_EQ("Mul", mul.op());
+  EXPECT_EQ("w", mul.input(1));
+  EXPECT_TRUE(graph_utils::ContainsFunctionNodeWithOp("Rank", vectorized));
+  EXPECT_TRUE(graph_utils::ContainsFunctionNodeWithOp("Fill", vectorized));
+}
+
+TEST(VectorizeFunctionTest, VectorizesReshapeAndDecodeRaw) {
+  FunctionDef function = FDH::Create(
+      "DecodeAndReshape", {"x: string"}, {"y: uint8"}, {},
+      {{{"shape"},
+        "Const",
+        {},
+        {{"value", test::AsTensor<int32>({2, -1})}, {"dtype", DT_INT32}}},
+       {{"decode"},
+        "DecodeRaw",
+        {"x"},
+        {{"out_type", DT_UINT8}, {"little_endian", true}}},
+       {{"reshape"},
+        "Reshape",
+        {"decode:output:0", "shape:output:0"},
+        {{"T", DT_UINT8}, {"Tshape", DT_INT32}}}},
+      {{"y", "reshape:output:0"}});
+  FunctionDef vectorized;
+  TF_ASSERT_OK(VectorizeFunction(function, 1, {0}, &vectorized));
+
+  const NodeDef& reshape = GetRetNode(vectorized, "y");
+  EXPECT_EQ("Reshape", reshape.op());
+  // The shape gets the leading dimension of the batch prepended.
+  const int index = graph_utils::FindFunctionNodeWithName(
+      reshape.input(1).substr(0, reshape.input(1).find(':')), vectorized);
+  ASSERT_NE(-1, index);
+  EXPECT_EQ("ConcatV2", vectorized.node_def(index).op());
+  EXPECT_TRUE(
+      graph_utils::ContainsFunctionNodeWithOp("DecodeRaw", vectorized));
+}
+
+TEST(VectorizeFunctionTest, StackedReshapeShapeIsUnimplemented) {
+  FunctionDef function = FDH::Create(
+      "ReshapeToArg", {"x: float", "shape: int32"}, {"y: float"}, {},
+      {{{"reshape"},
+        "Reshape",
+        {"x", "shape"},
+        {{"T", DT_FLOAT}, {"Tshape", DT_INT32}}}},
+      {{"y", "reshape:output:0"}});
+  FunctionDef vectorized;
+  EXPECT_TRUE(errors::IsUnimplemented(
+      VectorizeFunction(function, 2, {1, 1}, &vectorized)));
+}
+
+TEST(VectorizeFunctionTest, OpWithoutVectorizerIsUnimplemented) {
+  FunctionDef function = FDH::Create(
+      "MatMulSelf", {"x: float"}, {"y: float"}, {},
+      {{{"matmul"},
+        "MatMul",
+        {"x", "x"},
+        {{"T", DT_FLOAT}, {"transpose_a", false}, {"transpose_b", false}}}},
+      {{"y", "matmul:product:0"}});
+  FunctionDef vectorized;
+  EXPECT_TRUE(errors::IsUnimplemented(
+      VectorizeFunction(function, 1, {2}, &vectorized)));
+}
+
+TEST(VectorizeFunctionTest, FunctionCallIsUnimplemented) {
+  FunctionDef vectorized;
+  EXPECT_TRUE(errors::IsUnimplemented(
+      VectorizeFunction(test::function::XTimesFour(), 1, {0}, &vectorized)));
+}
+
+TEST(VectorizeFunctionTest, StatefulOpIsUnimplemented) {
+  // Even if it does not depend on the element, a stateful op must run once
+  // per element.
+  FunctionDef function = FDH::Create(
+      "AddNoise", {"x: float"}, {"y: float"}, {},
+      {{{"shape"},
+        "Const",
+        {},
+        {{"value", test::AsTensor<int32>({})}, {"dtype", DT_INT32}}},
+       {{"noise"},
+        "RandomUniform",
+        {"shape:output:0"},
+        {{"T", DT_INT32}, {"dtype", DT_FLOAT}, {"seed", 0}, {"seed2", 0}}},
+       {{"add"}, "Add", {"x", "noise:output:0"}, {{"T", DT_FLOAT}}}},
+      {{"y", "add:z:0"}});
+  FunctionDef vectorized;
+  EXPECT_TRUE(errors::IsUnimplemented(
+      VectorizeFunction(function, 1, {0}, &vectorized)));
+}
+
+TEST(VectorizeFunctionTest, UnstackedOutputIsUnimplemented) {
+  FunctionDef function = FDH::Create(
+      "ReturnCaptured", {"x: float", "w: float"}, {"y: float", "z: float"},
+      {}, {{{"neg"}, "Neg", {"x"}, {{"T", DT_FLOAT}}}},
+      {{"y", "neg:y:0"}, {"z", "w"}});
+  FunctionDef vectorized;
+  EXPECT_TRUE(errors::IsUnimplemented(
+      VectorizeFunction(function, 1, {0, 0}, &vectorized)));
+}
+
+}  // namespace
+}  // namespace vectorization_utils
+}  // namespace grappler
+}  // namespace tensorflow
@@ -87,6 +87,18 @@ class CollectiveReduceOpKernel : public CollectiveOpKernel {
                     "final_op must be one of {\"Id\", \"Div\"} but got ",
                     final_op_name));
     OP_REQUIRES_OK(c, c->GetAttr("T", &col_params_.instance.data_type));
+    string compression;
+    OP_REQUIRES_OK(c, c->GetAttr("compression", &compression));
+    if (compression == "bfloat16") {
+      col_params_.instance.compression = COMPRESSION_BFLOAT16;
+    } else if (compression == "float16") {
+      col_params_.instance.compression = COMPRESSION_FLOAT16;
+    } else if (compression == "topk") {
+      col_params_.instance.compression = COMPRESSION_TOPK;
+      col_params_.residuals.reset(new CollectiveResiduals);
+    }
+    OP_REQUIRES_OK(c, c->GetAttr("topk_fraction",
+                                 &col_params_.instance.topk_fraction));
 
     const NodeDef& real_node = c->def();
     col_params_.name = strings::StrCat(real_node.name(), ": Reduce(",
@@ -156,6 +168,61 @@ REGISTER_KERNEL_BUILDER(Name("CollectiveReduce").Device(DEVICE_CPU),
 REGISTER_KERNEL_BUILDER(Name("CollectiveReduce").Device(DEVICE_GPU),
                         CollectiveReduceOpKernel);
 
+class CollectiveGatherOpKernel : public CollectiveOpKernel {
+ public:
+  explicit CollectiveGatherOpKernel(OpKernelConstruction* c)
+      : CollectiveOpKernel(c) {
+    col_params_.instance.type = GATHER_COLLECTIVE;
+    OP_REQUIRES_OK(c, c->GetAttr("group_size", &col_params_.group.group_size));
+    OP_REQUIRES_OK(c, c->GetAttr("group_key", &col_params_.group.group_key));
+    OP_REQUIRES_OK(
+        c, c->GetAttr("instance_key", &col_params_.instance.instance_key));
+    OP_REQUIRES_OK(c, c->GetAttr("T", &col_params_.instance.data_type));
+    col_params_.instance.impl_details.subdiv_offsets = {0};
+
+    col_params_.name = strings::StrCat(name(), ": Gather");
+    col_params_.group.device_type = c->device_type();
+  }
+
+  void ComputeAsync(OpKernelContext* c, DoneCallback done) override {
+    CollectiveExecutor* col_exec = c->collective_executor();
+    OP_REQUIRES_ASYNC(
+        c, col_exec,
+        errors::Internal(
+            "Failed to get CollectiveExecutor from OpKernelContext for Op ",
+            col_params_.name),
+        done);
+    OP_REQUIRES_ASYNC(c, c->input(0).dims() >= 1,
+                      errors::InvalidArgument(
+                          "Input of ", col_params_.name,
+                          " must have at least one dimension, got shape ",
+                          c->input(0).shape().DebugString()),
+                      done);
+    if (!CanProceedWithCompute(c, col_exec, done)) return;
+    // The inputs of all devices are concatenated along the first dimension.
+    TensorShape output_shape = c->input(0).shape();
+    output_shape.set_dim(
+        0, output_shape.dim_size(0) * col_params_.group.group_size);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK_ASYNC(c, c->allocate_output(0, output_shape, &output),
+                         done);
+
+    auto actual_done = [c, col_exec, done](const Status& s) {
+      OP_REQUIRES_OK_ASYNC(c, s, done);
+      done();
+    };
+    col_exec->ExecuteAsync(c, col_params_, GetCollectiveKey(c), actual_done);
+  }
+
+ private:
+  TF_DISALLOW_COPY_AND_ASSIGN(CollectiveGatherOpKernel);
+};
+
+REGISTER_KERNEL_BUILDER(Name("CollectiveGather").Device(DEVICE_CPU),
+                        CollectiveGatherOpKernel);
+REGISTER_KERNEL_BUILDER(Name("CollectiveGather").Device(DEVICE_GPU),
+                        CollectiveGatherOpKernel);
+
 class CollectiveBcastSendOpKernel : public CollectiveOpKernel {
  public:
   explicit CollectiveBcastSendOpKernel(OpKernelConstruction* c)
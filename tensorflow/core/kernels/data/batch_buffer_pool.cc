@@ -0,0 +1,99 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/data/batch_buffer_pool.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+BatchBufferPool::BatchBufferPool(Allocator* allocator, int max_cached_buffers)
+    : allocator_(allocator), max_cached_buffers_(max_cached_buffers) {}
+
+BatchBufferPool::~BatchBufferPool() {
+  DCHECK(outstanding_.empty());
+  for (auto& entry : cached_) {
+    for (void* ptr : entry.second) {
+      allocator_->DeallocateRaw(ptr);
+    }
+  }
+}
+
+void* BatchBufferPool::AllocateRaw(size_t alignment, size_t num_bytes) {
+  void* ptr = nullptr;
+  {
+    mutex_lock l(mu_);
+    auto it = cached_.find(num_bytes);
+    if (it != cached_.end()) {
+      std::vector<void*>& buffers = it->second;
+      auto aligned = std::find_if(
+          buffers.begin(), buffers.end(), [alignment](void* buffer) {
+            return reinterpret_cast<uintptr_t>(buffer) % alignment == 0;
+          });
+      if (aligned != buffers.end()) {
+        ptr = *aligned;
+        buffers.erase(aligned);
+        if (buffers.empty()) cached_.erase(it);
+        --num_cached_;
+        ++num_reuses_;
+      }
+    }
+  }
+  const bool reused = ptr != nullptr;
+  if (!reused) {
+    ptr = allocator_->AllocateRaw(
+        std::max(alignment, Allocator::kAllocatorAlignment), num_bytes);
+    if (ptr == nullptr) return nullptr;
+  }
+  // The buffer keeps the pool alive until it is deallocated.
+  Ref();
+  mutex_lock l(mu_);
+  if (!reused) ++num_allocations_;
+  outstanding_.emplace(ptr, num_bytes);
+  return ptr;
+}
+
+void BatchBufferPool::DeallocateRaw(void* ptr) {
+  bool cached = false;
+  {
+    mutex_lock l(mu_);
+    auto it = outstanding_.find(ptr);
+    CHECK(it != outstanding_.end());
+    if (num_cached_ < max_cached_buffers_) {
+      cached_[it->second].push_back(ptr);
+      ++num_cached_;
+      cached = true;
+    }
+    outstanding_.erase(it);
+  }
+  if (!cached) {
+    allocator_->DeallocateRaw(ptr);
+  }
+  Unref();
+}
+
+int64 BatchBufferPool::num_allocations() const {
+  mutex_lock l(mu_);
+  return num_allocations_;
+}
+
+int64 BatchBufferPool::num_reuses() const {
+  mutex_lock l(mu_);
+  return num_reuses_;
+}
+
+}  // namespace tensorflow
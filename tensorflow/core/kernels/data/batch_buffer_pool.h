@@ -0,0 +1,80 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_BATCH_BUFFER_POOL_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_BATCH_BUFFER_POOL_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// BatchBufferPool is an Allocator that recycles the buffers of the batches an
+// iterator produces.
+//
+// When the consumer of a batch drops its last reference to a buffer, the
+// buffer is kept for the next allocation of the same size instead of being
+// returned to the underlying allocator, so that a steady stream of
+// same-shaped batches stops allocating (and faulting in) fresh memory for
+// every batch. At most `max_cached_buffers` released buffers are kept;
+// further ones are freed.
+//
+// Each outstanding buffer holds a reference on the pool, so the pool outlives
+// both its owner and every tensor allocated from it. The owner releases its
+// reference with Unref().
+//
+// BatchBufferPool is thread safe.
+class BatchBufferPool : public Allocator, public core::RefCounted {
+ public:
+  // `allocator` must outlive the pool.
+  BatchBufferPool(Allocator* allocator, int max_cached_buffers);
+
+  string Name() override { return "batch_buffer_pool"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  // The number of buffers allocated from the underlying allocator, and the
+  // number of allocations served by a recycled buffer.
+  int64 num_allocations() const;
+  int64 num_reuses() const;
+
+ private:
+  ~BatchBufferPool() override;
+
+  Allocator* const allocator_;  // Not owned.
+  const int max_cached_buffers_;
+
+  mutable mutex mu_;
+  // Sizes of the buffers handed out and not yet deallocated.
+  std::unordered_map<void*, size_t> outstanding_ GUARDED_BY(mu_);
+  // Released buffers, by size.
+  std::unordered_map<size_t, std::vector<void*>> cached_ GUARDED_BY(mu_);
+  int num_cached_ GUARDED_BY(mu_) = 0;
+  int64 num_allocations_ GUARDED_BY(mu_) = 0;
+  int64 num_reuses_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BatchBufferPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_BATCH_BUFFER_POOL_H_
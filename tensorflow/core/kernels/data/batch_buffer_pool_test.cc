@@ -0,0 +1,149 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/data/batch_buffer_pool.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the buffers that are allocated and not yet freed.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_live_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    --num_live_;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+  int num_live() const { return num_live_; }
+
+ private:
+  int num_live_ = 0;
+};
+
+TEST(BatchBufferPool, ReusesReleasedBuffers) {
+  CountingAllocator base;
+  BatchBufferPool* pool = new BatchBufferPool(&base, 2);
+  const void* first_data;
+  {
+    Tensor t(pool, DT_FLOAT, TensorShape({32, 1024}));
+    first_data = t.tensor_data().data();
+  }
+  for (int i = 0; i < 10; ++i) {
+    Tensor t(pool, DT_FLOAT, TensorShape({32, 1024}));
+    EXPECT_EQ(first_data, t.tensor_data().data());
+  }
+  EXPECT_EQ(1, pool->num_allocations());
+  EXPECT_EQ(10, pool->num_reuses());
+  EXPECT_EQ(1, base.num_live());
+  pool->Unref();
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(BatchBufferPool, OnlyReusesBuffersOfTheSameSize) {
+  CountingAllocator base;
+  BatchBufferPool* pool = new BatchBufferPool(&base, 2);
+  { Tensor t(pool, DT_FLOAT, TensorShape({32, 1024})); }
+  { Tensor t(pool, DT_FLOAT, TensorShape({31, 1024})); }
+  EXPECT_EQ(2, pool->num_allocations());
+  EXPECT_EQ(0, pool->num_reuses());
+  pool->Unref();
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(BatchBufferPool, CachesAtMostMaxCachedBuffers) {
+  CountingAllocator base;
+  BatchBufferPool* pool = new BatchBufferPool(&base, 2);
+  {
+    std::vector<Tensor> batches;
+    for (int i = 0; i < 5; ++i) {
+      batches.emplace_back(pool, DT_INT64, TensorShape({64}));
+    }
+    EXPECT_EQ(5, base.num_live());
+  }
+  EXPECT_EQ(2, base.num_live());
+  pool->Unref();
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(BatchBufferPool, OutlivesItsOwner) {
+  CountingAllocator base;
+  BatchBufferPool* pool = new BatchBufferPool(&base, 2);
+  Tensor t(pool, DT_INT32, TensorShape({16}));
+  t.flat<int32>().setConstant(7);
+  // The owner goes away while a batch is still referenced downstream.
+  pool->Unref();
+  EXPECT_EQ(7, t.flat<int32>()(15));
+  EXPECT_EQ(1, base.num_live());
+  t = Tensor();
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(BatchBufferPool, RecyclesStringBuffers) {
+  CountingAllocator base;
+  BatchBufferPool* pool = new BatchBufferPool(&base, 2);
+  for (int i = 0; i < 3; ++i) {
+    Tensor t(pool, DT_STRING, TensorShape({4}));
+    EXPECT_EQ("", t.flat<string>()(0));
+    t.flat<string>()(0) = string(1024, 'a');
+  }
+  EXPECT_EQ(1, pool->num_allocations());
+  pool->Unref();
+  EXPECT_EQ(0, base.num_live());
+}
+
+// Allocates a batch of `batch_size` 224x224x3 float images, fills it, and
+// drops it, as a BatchDataset iterator and its consumer do.
+static void BM_BatchBuffers(int iters, int batch_size, bool use_pool) {
+  testing::StopTiming();
+  const TensorShape shape({batch_size, 224, 224, 3});
+  BatchBufferPool* pool = new BatchBufferPool(cpu_allocator(), 2);
+  Allocator* allocator = use_pool ? pool : cpu_allocator();
+  testing::BytesProcessed(static_cast<int64>(iters) * shape.num_elements() *
+                          sizeof(float));
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Tensor batch(allocator, DT_FLOAT, shape);
+    batch.flat<float>().setConstant(static_cast<float>(i));
+  }
+  testing::StopTiming();
+  if (use_pool) {
+    testing::SetLabel(strings::StrCat(pool->num_allocations(),
+                                      " allocations for ", iters, " batches"));
+  }
+  pool->Unref();
+}
+
+static void BM_BatchBuffersUnpooled(int iters, int batch_size) {
+  BM_BatchBuffers(iters, batch_size, false);
+}
+
+static void BM_BatchBuffersPooled(int iters, int batch_size) {
+  BM_BatchBuffers(iters, batch_size, true);
+}
+
+BENCHMARK(BM_BatchBuffersUnpooled)->Arg(1)->Arg(32)->Arg(128);
+BENCHMARK(BM_BatchBuffersPooled)->Arg(1)->Arg(32)->Arg(128);
+
+}  // namespace
+}  // namespace tensorflow
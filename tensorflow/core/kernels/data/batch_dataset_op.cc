@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/batch_buffer_pool.h"
 #include "tensorflow/core/kernels/data/dataset.h"
 #include "tensorflow/core/util/batch_util.h"
 
@@ -24,6 +25,12 @@ namespace {
 // See documentation in ../ops/dataset_ops.cc for a high-level
 // description of the following op.
 
+// Batches of at most this many bytes are allocated up front from a pool that
+// recycles their buffers. Larger batches (typically a huge `batch_size` used
+// to gather a whole input) gather their elements first and are allocated at
+// their actual size.
+constexpr int64 kMaxPooledBatchBytes = 1LL << 30;
+
 class BatchDatasetOp : public UnaryDatasetOpKernel {
  public:
   explicit BatchDatasetOp(OpKernelConstruction* ctx)
@@ -116,6 +123,10 @@ class BatchDatasetOp : public UnaryDatasetOpKernel {
       explicit Iterator(const Params& params)
           : DatasetIterator<Dataset>(params) {}
 
+      ~Iterator() override {
+        if (pool_ != nullptr) pool_->Unref();
+      }
+
       Status Initialize(IteratorContext* ctx) override {
         return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
       }
@@ -123,74 +134,80 @@ class BatchDatasetOp : public UnaryDatasetOpKernel {
       Status GetNextInternal(IteratorContext* ctx,
                              std::vector<Tensor>* out_tensors,
                              bool* end_of_sequence) override {
-        // Each row of `batch_elements` is a tuple of tensors from the
-        // input iterator.
-        std::vector<std::vector<Tensor>> batch_elements;
+        // Each input element is copied into its slice of the batch as soon
+        // as it is produced, so that its buffers are released before the
+        // next element is produced, rather than after the whole batch of
+        // elements has been gathered.
+        std::vector<Tensor> batch;
+        // The elements of a batch too large to pool, gathered until the
+        // input produces the whole batch or ends.
+        std::vector<std::vector<Tensor>> gathered_elements;
+        bool pooled = false;
+        int64 num_batch_elements = 0;
         {
           mutex_lock l(mu_);
           if (!input_impl_) {
             *end_of_sequence = true;
             return Status::OK();
           }
-          batch_elements.reserve(dataset()->batch_size_);
           *end_of_sequence = false;
-          for (int i = 0; i < dataset()->batch_size_ && !*end_of_sequence;
-               ++i) {
+          while (num_batch_elements < dataset()->batch_size_) {
             std::vector<Tensor> batch_element_tuple;
             TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &batch_element_tuple,
                                                     end_of_sequence));
-            if (!*end_of_sequence) {
-              batch_elements.emplace_back(std::move(batch_element_tuple));
-            } else {
+            if (*end_of_sequence) {
               input_impl_.reset();
+              break;
             }
+            if (num_batch_elements == 0) {
+              pooled = CanPoolBatch(batch_element_tuple);
+              if (pooled) {
+                if (pool_ == nullptr) {
+                  // Keep two batches worth of buffers: one being filled
+                  // while the consumer holds on to the previous one.
+                  pool_ = new BatchBufferPool(
+                      ctx->allocator({}),
+                      2 * dataset()->output_dtypes().size());
+                }
+                AllocateBatch(pool_, dataset()->batch_size_,
+                              batch_element_tuple, &batch);
+              }
+            }
+            if (pooled) {
+              TF_RETURN_IF_ERROR(CopyElementToBatch(
+                  std::move(batch_element_tuple), num_batch_elements, &batch));
+            } else {
+              gathered_elements.emplace_back(std::move(batch_element_tuple));
+            }
+            ++num_batch_elements;
           }
         }
 
-        if (batch_elements.empty()) {
+        if (num_batch_elements == 0) {
           DCHECK(*end_of_sequence);
           return Status::OK();
         }
 
         if (dataset()->drop_remainder_ &&
-            batch_elements.size() < dataset()->batch_size_) {
+            num_batch_elements < dataset()->batch_size_) {
           *end_of_sequence = true;
           return Status::OK();
         }
 
-        // Copy the retrieved batch elements into one output tensor
-        // per tuple component.
-        // NOTE(mrry): If the input or output sizes are statically
-        // known, we could potentially read the input values in-place
-        // into their respective slice locations. This would require a
-        // different GetNext() overload that supports zero-copy, and might
-        // make sense in an optimization pass.
-        const size_t num_tuple_components = batch_elements[0].size();
-        const int64 num_batch_elements = batch_elements.size();
-        for (size_t component_index = 0; component_index < num_tuple_components;
-             ++component_index) {
-          const Tensor& first_element = batch_elements[0][component_index];
-          TensorShape batch_component_shape({num_batch_elements});
-          batch_component_shape.AppendShape(first_element.shape());
-          Tensor batch_component(ctx->allocator({}), first_element.dtype(),
-                                 batch_component_shape);
-          // Build the output tuple component by copying one slice
-          // from each input element in the batch.
-          for (size_t i = 0; i < num_batch_elements; ++i) {
-            if (batch_elements[i][component_index].shape() !=
-                first_element.shape()) {
-              return errors::InvalidArgument(
-                  "Cannot batch tensors with different shapes in component ",
-                  component_index, ". First element had shape ",
-                  first_element.shape().DebugString(), " and element ", i,
-                  " had shape ",
-                  batch_elements[i][component_index].shape().DebugString(),
-                  ".");
-            }
-            TF_RETURN_IF_ERROR(batch_util::CopyElementToSlice(
-                std::move(batch_elements[i][component_index]), &batch_component,
-                i));
+        if (!pooled) {
+          AllocateBatch(ctx->allocator({}), num_batch_elements,
+                        gathered_elements[0], &batch);
+          for (int64 i = 0; i < num_batch_elements; ++i) {
+            TF_RETURN_IF_ERROR(CopyElementToBatch(
+                std::move(gathered_elements[i]), i, &batch));
           }
+        } else if (num_batch_elements < dataset()->batch_size_) {
+          // Copy a partial batch out, so that the full-sized buffer goes
+          // straight back to the pool.
+          TF_RETURN_IF_ERROR(CopyOutPartialBatch(ctx, num_batch_elements,
+                                                 &batch));
+        }
+        for (Tensor& batch_component : batch) {
           out_tensors->emplace_back(std::move(batch_component));
         }
         *end_of_sequence = false;
@@ -221,8 +238,92 @@ class BatchDatasetOp : public UnaryDatasetOpKernel {
       }
 
      private:
+      // Returns whether a full batch of elements like `first_element` is
+      // small enough to be allocated up front from the pool.
+      bool CanPoolBatch(const std::vector<Tensor>& first_element) const {
+        if (dataset()->batch_size_ == 1) return false;
+        int64 element_bytes = 0;
+        for (const Tensor& component : first_element) {
+          element_bytes += component.TotalBytes();
+        }
+        return element_bytes == 0 ||
+               dataset()->batch_size_ <= kMaxPooledBatchBytes / element_bytes;
+      }
+
+      // Allocates one tensor per tuple component from `allocator`, with room
+      // for `num_elements` elements of the same shape as `first_element`. A
+      // batch of one element shares the buffers of the element instead.
+      void AllocateBatch(Allocator* allocator, int64 num_elements,
+                         const std::vector<Tensor>& first_element,
+                         std::vector<Tensor>* batch) {
+        batch->reserve(first_element.size());
+        for (const Tensor& component : first_element) {
+          TensorShape batch_component_shape({num_elements});
+          batch_component_shape.AppendShape(component.shape());
+          if (dataset()->batch_size_ == 1) {
+            batch->emplace_back();
+            CHECK(batch->back().CopyFrom(component, batch_component_shape));
+          } else {
+            batch->emplace_back(allocator, component.dtype(),
+                                batch_component_shape);
+          }
+        }
+      }
+
+      // Replaces the components of `batch` by tensors holding only their
+      // first `num_elements` elements.
+      Status CopyOutPartialBatch(IteratorContext* ctx, int64 num_elements,
+                                 std::vector<Tensor>* batch) {
+        for (Tensor& batch_component : *batch) {
+          TensorShape shape = batch_component.shape();
+          shape.set_dim(0, num_elements);
+          Tensor partial(ctx->allocator({}), batch_component.dtype(), shape);
+          TF_RETURN_IF_ERROR(batch_util::MaybeMoveLeadingSlices(
+              &batch_component, &partial, num_elements));
+          batch_component = std::move(partial);
+        }
+        return Status::OK();
+      }
+
+      // Copies the components of `element` into the `index`-th slice of the
+      // components of `batch`.
+      Status CopyElementToBatch(std::vector<Tensor> element, int64 index,
+                                std::vector<Tensor>* batch) {
+        if (element.size() != batch->size()) {
+          return errors::InvalidArgument(
+              "Cannot batch tuples with different numbers of components. "
+              "First element had ",
+              batch->size(), " components and element ", index, " had ",
+              element.size(), " components.");
+        }
+        for (size_t component_index = 0; component_index < element.size();
+             ++component_index) {
+          Tensor* batch_component = &(*batch)[component_index];
+          TensorShape element_shape = batch_component->shape();
+          element_shape.RemoveDim(0);
+          if (element[component_index].shape() != element_shape) {
+            return errors::InvalidArgument(
+                "Cannot batch tensors with different shapes in component ",
+                component_index, ". First element had shape ",
+                element_shape.DebugString(), " and element ", index,
+                " had shape ", element[component_index].shape().DebugString(),
+                ".");
+          }
+          if (dataset()->batch_size_ == 1) {
+            // The component already shares the buffer of the element.
+            continue;
+          }
+          TF_RETURN_IF_ERROR(batch_util::CopyElementToSlice(
+              std::move(element[component_index]), batch_component, index));
+        }
+        return Status::OK();
+      }
+
       mutex mu_;
       std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+      // Created for the first pooled batch. Each outstanding batch buffer
+      // also holds a reference to it.
+      BatchBufferPool* pool_ GUARDED_BY(mu_) = nullptr;
     };
 
     const int64 batch_size_;
@@ -0,0 +1,472 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/dataset.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+// See documentation in ../ops/dataset_ops.cc for a high-level
+// description of the following op.
+
+// A rough cost, in cycles, of decoding one image. It only needs to be large
+// enough for `Shard` to decode each image of a batch on its own thread.
+constexpr int64 kCostPerImage = 1 << 24;
+
+// Returns the denominator of the smallest scale, among 1/8, 1/4, 1/2 and 1,
+// at which a `crop_height` x `crop_width` window is still at least
+// `output_height` x `output_width`. Decoding at that scale skips most of the
+// inverse DCT without losing resolution that the resize would keep.
+int ChooseRatio(int crop_height, int crop_width, int output_height,
+                int output_width) {
+  for (int ratio = 8; ratio > 1; ratio /= 2) {
+    if (crop_height / ratio >= output_height &&
+        crop_width / ratio >= output_width) {
+      return ratio;
+    }
+  }
+  return 1;
+}
+
+// Maps the range [`start`, `start` + `size`) of an image dimension of
+// `image_size` pixels to the image scaled down by `ratio`, into which libjpeg
+// crops. The end is rounded rather than the size, so that the range does not
+// shift from the one requested.
+void ScaleCropRange(int start, int size, int image_size, int ratio,
+                    int* scaled_start, int* scaled_size) {
+  const int scaled_end = std::min((start + size + ratio / 2) / ratio,
+                                  (image_size + ratio - 1) / ratio);
+  *scaled_start = start / ratio;
+  *scaled_size = scaled_end - *scaled_start;
+}
+
+// Resizes the `in_height` x `in_width` image `in` to the `out_height` x
+// `out_width` image `out`, both with `channels` interleaved channels, with
+// the bilinear interpolation of `ResizeBilinear` without `align_corners`.
+void ResizeBilinear(const uint8* in, int in_height, int in_width,
+                    int channels, uint8* out, int out_height, int out_width) {
+  const float height_scale = static_cast<float>(in_height) / out_height;
+  const float width_scale = static_cast<float>(in_width) / out_width;
+  std::vector<int> x_lower(out_width);
+  std::vector<int> x_upper(out_width);
+  std::vector<float> x_lerp(out_width);
+  for (int x = 0; x < out_width; ++x) {
+    const float in_x = x * width_scale;
+    const int lower = static_cast<int>(std::floor(in_x));
+    x_lower[x] = lower * channels;
+    x_upper[x] = std::min(lower + 1, in_width - 1) * channels;
+    x_lerp[x] = in_x - lower;
+  }
+  const int64 in_row_size = static_cast<int64>(in_width) * channels;
+  for (int y = 0; y < out_height; ++y) {
+    const float in_y = y * height_scale;
+    const int top = static_cast<int>(std::floor(in_y));
+    const int bottom = std::min(top + 1, in_height - 1);
+    const float y_lerp = in_y - top;
+    const uint8* top_row = in + top * in_row_size;
+    const uint8* bottom_row = in + bottom * in_row_size;
+    uint8* out_pixel = out + static_cast<int64>(y) * out_width * channels;
+    for (int x = 0; x < out_width; ++x) {
+      for (int c = 0; c < channels; ++c) {
+        const float top_left = top_row[x_lower[x] + c];
+        const float top_right = top_row[x_upper[x] + c];
+        const float bottom_left = bottom_row[x_lower[x] + c];
+        const float bottom_right = bottom_row[x_upper[x] + c];
+        const float top_value = top_left + (top_right - top_left) * x_lerp[x];
+        const float bottom_value =
+            bottom_left + (bottom_right - bottom_left) * x_lerp[x];
+        *out_pixel++ = static_cast<uint8>(
+            top_value + (bottom_value - top_value) * y_lerp + 0.5f);
+      }
+    }
+  }
+}
+
+class DecodeAndCropJpegBatchDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit DecodeAndCropJpegBatchDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("channels", &channels_));
+    OP_REQUIRES(ctx, channels_ == 1 || channels_ == 3,
+                errors::InvalidArgument("channels must be 1 or 3, got ",
+                                        channels_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("dct_method", &dct_method_));
+    OP_REQUIRES(
+        ctx,
+        (dct_method_.empty() || dct_method_ == "INTEGER_FAST" ||
+         dct_method_ == "INTEGER_ACCURATE"),
+        errors::InvalidArgument("dct_method must be one of "
+                                "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
+  }
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    const DataTypeVector& input_types = input->output_dtypes();
+    OP_REQUIRES(
+        ctx,
+        input_types == DataTypeVector({DT_STRING}) ||
+            input_types == DataTypeVector({DT_STRING, DT_INT32}),
+        errors::InvalidArgument(
+            "DecodeAndCropJpegBatchDataset expects elements of type string, "
+            "or (string, int32) with a crop window, got ",
+            DataTypeVectorString(input_types)));
+
+    int64 batch_size = 0;
+    OP_REQUIRES_OK(ctx,
+                   ParseScalarArgument<int64>(ctx, "batch_size", &batch_size));
+    OP_REQUIRES(
+        ctx, batch_size > 0,
+        errors::InvalidArgument("Batch size must be greater than zero."));
+
+    const Tensor* output_size_t;
+    OP_REQUIRES_OK(ctx, ctx->input("output_size", &output_size_t));
+    OP_REQUIRES(ctx,
+                TensorShapeUtils::IsVector(output_size_t->shape()) &&
+                    output_size_t->NumElements() == 2,
+                errors::InvalidArgument(
+                    "output_size must be a vector of two elements, got shape ",
+                    output_size_t->shape().DebugString()));
+    const int32 output_height = output_size_t->vec<int32>()(0);
+    const int32 output_width = output_size_t->vec<int32>()(1);
+    OP_REQUIRES(ctx, output_height > 0 && output_width > 0,
+                errors::InvalidArgument("output_size must be positive, got [",
+                                        output_height, ", ", output_width,
+                                        "]"));
+
+    bool drop_remainder = false;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<bool>(ctx, "drop_remainder",
+                                                  &drop_remainder));
+
+    *output = new Dataset(ctx, batch_size, output_height, output_width,
+                          drop_remainder, channels_, dct_method_,
+                          ctx->device()->tensorflow_cpu_worker_threads(),
+                          input);
+  }
+
+ private:
+  class Dataset : public GraphDatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, int64 batch_size, int32 output_height,
+            int32 output_width, bool drop_remainder, int channels,
+            const string& dct_method,
+            const DeviceBase::CpuWorkerThreads* worker_threads,
+            const DatasetBase* input)
+        : GraphDatasetBase(ctx),
+          batch_size_(batch_size),
+          output_height_(output_height),
+          output_width_(output_width),
+          drop_remainder_(drop_remainder),
+          channels_(channels),
+          dct_method_(dct_method),
+          worker_threads_(worker_threads),
+          input_(input),
+          output_dtypes_({DT_UINT8}),
+          output_shapes_({PartialTensorShape(
+              {drop_remainder_ ? batch_size_ : -1, output_height_,
+               output_width_, channels_})}) {
+      input_->Ref();
+      flags_.components = channels_;
+      flags_.crop = true;
+      // The defaults of `DecodeJpeg`.
+      flags_.dct_method = JDCT_IFAST;
+      if (dct_method_ == "INTEGER_ACCURATE") {
+        flags_.dct_method = JDCT_ISLOW;
+      }
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return std::unique_ptr<IteratorBase>(new Iterator(
+          {this, strings::StrCat(prefix, "::DecodeAndCropJpegBatch")}));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return output_dtypes_;
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return output_shapes_;
+    }
+
+    string DebugString() const override {
+      return strings::StrCat("DecodeAndCropJpegBatchDatasetOp(", batch_size_,
+                             ", ", output_height_, ", ", output_width_,
+                             ")::Dataset");
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+      Node* batch_size = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size));
+      Node* output_size = nullptr;
+      TF_RETURN_IF_ERROR(
+          b->AddVector<int32>({output_height_, output_width_}, &output_size));
+      Node* drop_remainder = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(drop_remainder_, &drop_remainder));
+      AttrValue channels;
+      b->BuildAttrValue(channels_, &channels);
+      AttrValue dct_method;
+      b->BuildAttrValue(dct_method_, &dct_method);
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this, {input_graph_node, batch_size, output_size, drop_remainder},
+          {{"channels", channels}, {"dct_method", dct_method}}, output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status Initialize(IteratorContext* ctx) override {
+        return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        // The encoded images of the batch are gathered sequentially, since
+        // the input iterator is, and then decoded in parallel straight into
+        // their slices of the batch.
+        std::vector<std::vector<Tensor>> elements;
+        {
+          mutex_lock l(mu_);
+          if (!input_impl_) {
+            *end_of_sequence = true;
+            return Status::OK();
+          }
+          elements.reserve(dataset()->batch_size_);
+          *end_of_sequence = false;
+          while (static_cast<int64>(elements.size()) < dataset()->batch_size_) {
+            std::vector<Tensor> element;
+            TF_RETURN_IF_ERROR(
+                input_impl_->GetNext(ctx, &element, end_of_sequence));
+            if (*end_of_sequence) {
+              input_impl_.reset();
+              break;
+            }
+            elements.push_back(std::move(element));
+          }
+        }
+
+        if (elements.empty()) {
+          DCHECK(*end_of_sequence);
+          return Status::OK();
+        }
+
+        const int64 num_images = elements.size();
+        if (dataset()->drop_remainder_ && num_images < dataset()->batch_size_) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+
+        Tensor batch(ctx->allocator({}), DT_UINT8,
+                     {num_images, dataset()->output_height_,
+                      dataset()->output_width_, dataset()->channels_});
+        std::vector<Status> statuses(num_images);
+        auto decode_images = [this, &elements, &batch, &statuses](
+                                 int64 start, int64 limit) {
+          for (int64 i = start; i < limit; ++i) {
+            statuses[i] = DecodeImage(elements[i], &batch, i);
+          }
+        };
+        const DeviceBase::CpuWorkerThreads* worker_threads =
+            dataset()->worker_threads_;
+        Shard(worker_threads->num_threads, worker_threads->workers,
+              num_images, kCostPerImage, decode_images);
+        for (const Status& status : statuses) {
+          TF_RETURN_IF_ERROR(status);
+        }
+
+        out_tensors->push_back(std::move(batch));
+        *end_of_sequence = false;
+        return Status::OK();
+      }
+
+     protected:
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        if (!input_impl_) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name("input_impl_empty"), ""));
+        } else {
+          TF_RETURN_IF_ERROR(SaveInput(writer, input_impl_));
+        }
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        if (!reader->Contains(full_name("input_impl_empty"))) {
+          TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+        } else {
+          input_impl_.reset();
+        }
+        return Status::OK();
+      }
+
+     private:
+      // Decodes the image of `element` into the `index`-th slice of `batch`.
+      // The crop window is decoded at the smallest DCT scale that keeps it at
+      // least the output size, and written to the slice directly when that
+      // is exactly the output size, which spares the resize.
+      Status DecodeImage(const std::vector<Tensor>& element, Tensor* batch,
+                         int64 index) const {
+        const Tensor& contents = element[0];
+        if (!TensorShapeUtils::IsScalar(contents.shape())) {
+          return errors::InvalidArgument(
+              "JPEG contents must be a scalar, got shape ",
+              contents.shape().DebugString());
+        }
+        const string& input = contents.scalar<string>()();
+        if (input.size() > std::numeric_limits<int>::max()) {
+          return errors::InvalidArgument("JPEG contents are too large.");
+        }
+        int image_width;
+        int image_height;
+        if (!jpeg::GetImageInfo(input.data(), input.size(), &image_width,
+                                &image_height, nullptr)) {
+          return errors::InvalidArgument("Invalid JPEG data, size ",
+                                         input.size());
+        }
+
+        int crop_y = 0;
+        int crop_x = 0;
+        int crop_height = image_height;
+        int crop_width = image_width;
+        if (element.size() > 1) {
+          const Tensor& crop_window = element[1];
+          if (!TensorShapeUtils::IsVector(crop_window.shape()) ||
+              crop_window.NumElements() != 4) {
+            return errors::InvalidArgument(
+                "crop_window must be a vector of four elements, got shape ",
+                crop_window.shape().DebugString());
+          }
+          auto crop_window_vec = crop_window.vec<int32>();
+          crop_y = crop_window_vec(0);
+          crop_x = crop_window_vec(1);
+          crop_height = crop_window_vec(2);
+          crop_width = crop_window_vec(3);
+          if (crop_height <= 0 || crop_width <= 0 || crop_y < 0 ||
+              crop_x < 0 || crop_y + crop_height > image_height ||
+              crop_x + crop_width > image_width) {
+            return errors::InvalidArgument(
+                "Invalid crop window [", crop_y, ", ", crop_x, ", ",
+                crop_height, ", ", crop_width, "] for an image of size ",
+                image_height, "x", image_width);
+          }
+        }
+
+        const int output_height = dataset()->output_height_;
+        const int output_width = dataset()->output_width_;
+        const int channels = dataset()->channels_;
+        jpeg::UncompressFlags flags = dataset()->flags_;
+        flags.ratio = ChooseRatio(crop_height, crop_width, output_height,
+                                  output_width);
+        // libjpeg crops in the coordinates of the scaled image.
+        ScaleCropRange(crop_y, crop_height, image_height, flags.ratio,
+                       &flags.crop_y, &flags.crop_height);
+        ScaleCropRange(crop_x, crop_width, image_width, flags.ratio,
+                       &flags.crop_x, &flags.crop_width);
+
+        uint8* slice = batch->flat<uint8>().data() +
+                       index * output_height * output_width * channels;
+        if (flags.crop_height == output_height &&
+            flags.crop_width == output_width) {
+          // Anything but the expected dimensions would overflow the slice.
+          if (!jpeg::Uncompress(
+                  input.data(), input.size(), flags, nullptr /* nwarn */,
+                  [slice, output_height, output_width, channels](
+                      int width, int height, int components) -> uint8* {
+                    if (width != output_width || height != output_height ||
+                        components != channels) {
+                      return nullptr;
+                    }
+                    return slice;
+                  })) {
+            return errors::InvalidArgument(
+                "Invalid JPEG data or crop window, data size ", input.size());
+          }
+          return Status::OK();
+        }
+
+        std::vector<uint8> cropped;
+        int cropped_height = 0;
+        int cropped_width = 0;
+        if (!jpeg::Uncompress(
+                input.data(), input.size(), flags, nullptr /* nwarn */,
+                [&cropped, &cropped_height, &cropped_width, channels](
+                    int width, int height, int components) -> uint8* {
+                  if (components != channels) return nullptr;
+                  cropped_height = height;
+                  cropped_width = width;
+                  cropped.resize(static_cast<int64>(width) * height *
+                                 components);
+                  return cropped.data();
+                })) {
+          return errors::InvalidArgument(
+              "Invalid JPEG data or crop window, data size ", input.size());
+        }
+        ResizeBilinear(cropped.data(), cropped_height, cropped_width, channels,
+                       slice, output_height, output_width);
+        return Status::OK();
+      }
+
+      mutex mu_;
+      std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+    };
+
+    const int64 batch_size_;
+    const int32 output_height_;
+    const int32 output_width_;
+    const bool drop_remainder_;
+    const int channels_;
+    const string dct_method_;
+    const DeviceBase::CpuWorkerThreads* const worker_threads_;  // not owned
+    const DatasetBase* const input_;
+    const DataTypeVector output_dtypes_;
+    const std::vector<PartialTensorShape> output_shapes_;
+    jpeg::UncompressFlags flags_;
+  };
+
+  int channels_;
+  string dct_method_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("DecodeAndCropJpegBatchDataset").Device(DEVICE_CPU),
+    DecodeAndCropJpegBatchDatasetOp);
+
+}  // namespace
+
+}  // namespace tensorflow
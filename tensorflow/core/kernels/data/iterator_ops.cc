@@ -17,7 +17,9 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/graph_runner.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/framework/dataset_thread_pool.h"
 #include "tensorflow/core/framework/iterator.pb.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_op_kernel.h"
 #include "tensorflow/core/framework/stats_aggregator.h"
@@ -32,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -81,21 +84,34 @@ Status VerifyShapesCompatible(const std::vector<PartialTensorShape>& expected,
   return Status::OK();
 }
 
+// Returns the name under which the iterators of the resource `cinfo` of
+// `kernel` export their metrics: the shared name of the resource, or else the
+// name of the kernel's node. Unlike the name of a private resource, these stay
+// the same when the kernel is re-created, so that the labels of the metrics
+// stay bounded.
+string MetricsPipelineName(const ContainerInfo& cinfo, const OpKernel& kernel) {
+  return cinfo.resource_is_private_to_kernel() ? kernel.name() : cinfo.name();
+}
+
 }  // namespace
 
 class IteratorResource : public ResourceBase {
  public:
-  IteratorResource(const DataTypeVector& output_dtypes,
+  IteratorResource(const string& name, const DataTypeVector& output_dtypes,
                    const std::vector<PartialTensorShape>& output_shapes,
                    const int /*unused: graph_def_version*/,
                    std::unique_ptr<DeviceMgr> device_mgr,
                    std::unique_ptr<FunctionLibraryDefinition> flib_def,
                    std::unique_ptr<ProcessFunctionLibraryRuntime> pflr,
                    FunctionLibraryRuntime* lib)
-      : device_mgr_(std::move(device_mgr)),
+      : name_(name),
+        device_mgr_(std::move(device_mgr)),
         flib_def_(std::move(flib_def)),
         pflr_(std::move(pflr)),
         lib_(lib),
+        model_(std::make_shared<model::Model>(Env::Default(),
+                                              port::NumSchedulableCPUs())),
+        pipeline_id_(DatasetThreadPool::NewPipelineId()),
         iterator_(nullptr),
         output_dtypes_(output_dtypes),
         output_shapes_(output_shapes) {}
@@ -107,6 +123,9 @@ class IteratorResource : public ResourceBase {
       if (lib_ != nullptr) {
         ctx->set_lib(lib_);
       }
+      ctx->set_model(model_);
+      ctx->set_thread_pool(DatasetThreadPool::Global(), pipeline_id_);
+      ctx->set_pipeline_name(name_);
       return captured_iterator->GetNext(ctx, out_tensors, end_of_sequence);
     } else {
       return errors::FailedPrecondition(
@@ -219,6 +238,8 @@ class IteratorResource : public ResourceBase {
   }
 
  private:
+  // The name under which the iterators of the pipeline export their metrics.
+  const string name_;
   // The following (device_mgr_, flib_def_, pflr_) are only used when the
   // IteratorResource is shared between sessions and in that case we create
   // a new FLR. Otherwise these are set to null.
@@ -226,6 +247,12 @@ class IteratorResource : public ResourceBase {
   std::unique_ptr<FunctionLibraryDefinition> flib_def_;
   std::unique_ptr<ProcessFunctionLibraryRuntime> pflr_;
   FunctionLibraryRuntime* lib_ = nullptr;  // not owned.
+  // The performance model of the input pipeline, which tunes the parameters
+  // that were left to the runtime.
+  const std::shared_ptr<model::Model> model_;
+  // The id of the input pipeline in the shared `DatasetThreadPool`, if it is
+  // enabled.
+  const int64 pipeline_id_;
   std::shared_ptr<IteratorBase> iterator_;
   mutex mu_;
   std::shared_ptr<const FunctionLibraryDefinition> lib_def_ GUARDED_BY(mu_);
@@ -497,7 +524,8 @@ void IteratorHandleOp::Compute(OpKernelContext* context) LOCKS_EXCLUDED(mu_) {
               [lib, &device_mgr, &flib_def, &pflr, this](IteratorResource** ret)
                   EXCLUSIVE_LOCKS_REQUIRED(mu_) {
                     *ret = new IteratorResource(
-                        output_dtypes_, output_shapes_, graph_def_version_,
+                        MetricsPipelineName(cinfo_, *this), output_dtypes_,
+                        output_shapes_, graph_def_version_,
                         std::move(device_mgr), std::move(flib_def),
                         std::move(pflr), lib);
                     return Status::OK();
@@ -584,8 +612,10 @@ void AnonymousIteratorHandleOp::Compute(OpKernelContext* context) {
       OP_REQUIRES_OK(context, status);
       existing_resource->Unref();
     }
+    // Anonymous iterators share a name in the metrics, whose labels must not
+    // grow without bound.
     IteratorResource* new_resource = new IteratorResource(
-        output_dtypes_, output_shapes_, graph_def_version_,
+        container_name, output_dtypes_, output_shapes_, graph_def_version_,
         std::move(device_mgr), std::move(flib_def), std::move(pflr), lib);
     // Create the resource with our chosen name under the resource lookup
     // mutex to avoid another kernel racily creating a resource with this
@@ -781,11 +811,12 @@ class OneShotIteratorOp : public AsyncOpKernel {
     TF_RETURN_IF_ERROR(
         ctx->resource_manager()->LookupOrCreate<IteratorResource>(
             cinfo->container(), cinfo->name(), iterator,
-            [lib, this, &flib_def, &pflr](IteratorResource** ret)
+            [lib, this, cinfo, &flib_def, &pflr](IteratorResource** ret)
                 EXCLUSIVE_LOCKS_REQUIRED(mu_) {
                   *ret = new IteratorResource(
-                      output_dtypes_, output_shapes_, graph_def_version_,
-                      nullptr, std::move(flib_def), std::move(pflr), lib);
+                      MetricsPipelineName(*cinfo, *this), output_dtypes_,
+                      output_shapes_, graph_def_version_, nullptr,
+                      std::move(flib_def), std::move(pflr), lib);
                   return Status::OK();
                 }));
 
@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/tracing.h"
+#include "tensorflow/core/util/batch_util.h"
 
 namespace tensorflow {
 
@@ -44,6 +45,9 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("f", &func_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("output_types", &output_types_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("output_shapes", &output_shapes_));
+    if (op_version_ == 2) {
+      OP_REQUIRES_OK(ctx, ctx->GetAttr("sloppy", &sloppy_));
+    }
   }
 
  protected:
@@ -96,15 +100,16 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
                             func_, std::move(other_arguments), &captured_func));
 
     *output = new Dataset(ctx, input, batch_size, num_parallel_calls,
-                          drop_remainder, output_types_, output_shapes_, func_,
-                          std::move(captured_func), &ctx->eigen_cpu_device());
+                          drop_remainder, sloppy_, output_types_,
+                          output_shapes_, func_, std::move(captured_func),
+                          &ctx->eigen_cpu_device());
   }
 
  private:
   class Dataset : public GraphDatasetBase {
    public:
     Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 batch_size,
-            int64 num_parallel_calls, bool drop_remainder,
+            int64 num_parallel_calls, bool drop_remainder, bool sloppy,
             const DataTypeVector& output_types,
             const std::vector<PartialTensorShape>& output_shapes,
             const NameAttrList& func,
@@ -115,6 +120,7 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
           batch_size_(batch_size),
           num_parallel_calls_(num_parallel_calls),
           drop_remainder_(drop_remainder),
+          sloppy_(sloppy),
           output_types_(output_types),
           output_shapes_(output_shapes),
           map_fn_(func),
@@ -172,6 +178,15 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
       b->BuildAttrValue(map_fn_, &f);
       AttrValue other_arguments_types_attr;
       b->BuildAttrValue(other_arguments_types, &other_arguments_types_attr);
+      std::vector<std::pair<StringPiece, AttrValue>> attrs = {
+          std::make_pair("f", f),
+          std::make_pair("Targuments", other_arguments_types_attr)};
+      // Only "MapAndBatchDatasetV2" has the attr, and it defaults to false.
+      if (sloppy_) {
+        AttrValue sloppy_attr;
+        b->BuildAttrValue(sloppy_, &sloppy_attr);
+        attrs.emplace_back("sloppy", sloppy_attr);
+      }
 
       TF_RETURN_IF_ERROR(b->AddDataset(
           this,
@@ -180,9 +195,7 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
            std::make_pair(3, num_parallel_calls_node),
            std::make_pair(4, drop_remainder_node)},  // Single tensor inputs.
           {std::make_pair(1, other_arguments)},      // Tensor list inputs.
-          {std::make_pair("f", f),
-           std::make_pair("Targuments", other_arguments_types_attr)},  // Attrs
-          output));
+          attrs, output));
       return Status::OK();
     }
 
@@ -214,12 +227,18 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
         {
           mutex_lock l(mu_);
           EnsureRunnerThreadStarted(ctx);
-          while (batch_results_.empty() ||
-                 batch_results_.front()->num_calls > 0) {
-            cond_var_.wait(l);
+          if (dataset()->sloppy_) {
+            while (!(result = TakeCompletedBatch())) {
+              cond_var_.wait(l);
+            }
+          } else {
+            while (batch_results_.empty() ||
+                   batch_results_.front()->num_calls > 0) {
+              cond_var_.wait(l);
+            }
+            std::swap(result, batch_results_.front());
+            batch_results_.pop_front();
           }
-          std::swap(result, batch_results_.front());
-          batch_results_.pop_front();
         }
         cond_var_.notify_all();
         return ProcessResult(ctx, result, out_tensors, end_of_sequence);
@@ -292,7 +311,7 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
         if (status.ok()) {
           EnsureOutputAllocated(ctx, result, return_values);
           for (size_t i = 0; i < return_values->size(); ++i) {
-            const Tensor& tensor = return_values->at(i);
+            Tensor& tensor = return_values->at(i);
             Tensor* batch = &(result->output)[i];
             if (tensor.NumElements() !=
                 (batch->NumElements() / batch->dim_size(0))) {
@@ -305,10 +324,17 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
                   ", [batch]: ", batch_shape.DebugString()));
               break;
             }
-            // TODO(mrry): Add a version of DoParallelConcat that allows us to
-            // move `tensor` where possible, to speed up string tensor batching.
-            Status copy_status = ::tensorflow::functor::DoParallelConcat(
-                *dataset()->device_, tensor, offset, batch);
+            Status copy_status;
+            if (DataTypeCanUseMemcpy(tensor.dtype())) {
+              copy_status = ::tensorflow::functor::DoParallelConcat(
+                  *dataset()->device_, tensor, offset, batch);
+            } else {
+              // `return_values` holds the only reference to the values of
+              // `f`, so the strings and variants in `tensor` can be moved
+              // into the batch rather than copied.
+              copy_status = batch_util::CopyElementToSlice(std::move(tensor),
+                                                           batch, offset);
+            }
             if (!copy_status.ok()) {
               result->UpdateStatus(copy_status);
               break;
@@ -425,6 +451,29 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
                dataset()->batch_size_;
       }
 
+      // Removes and returns the first batch in `batch_results_` whose calls
+      // have all completed, or nullptr if there is none. Only full batches
+      // are returned out of order, so that a partial batch, an error or the
+      // end of the sequence does not overtake the batches before it.
+      std::shared_ptr<BatchResult> TakeCompletedBatch()
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        for (auto it = batch_results_.begin(); it != batch_results_.end();
+             ++it) {
+          if ((*it)->num_calls > 0) continue;
+          if (it != batch_results_.begin()) {
+            mutex_lock l((*it)->mu);
+            if ((*it)->num_elements < dataset()->batch_size_ ||
+                !(*it)->status.ok()) {
+              continue;
+            }
+          }
+          std::shared_ptr<BatchResult> result = std::move(*it);
+          batch_results_.erase(it);
+          return result;
+        }
+        return nullptr;
+      }
+
       Status ProcessResult(IteratorContext* ctx,
                            const std::shared_ptr<BatchResult>& result,
                            std::vector<Tensor>* out_tensors,
@@ -449,6 +498,8 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
             *end_of_sequence = true;
             return Status::OK();
           }
+          // Copy the partial batch out, rather than returning a slice that
+          // would keep the whole output buffer alive.
           const std::vector<Tensor>& output = result->output;
           for (size_t i = 0; i < output.size(); ++i) {
             TensorShape component_shape(result->output[i].shape());
@@ -652,6 +703,7 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
     const int64 batch_size_;
     const int64 num_parallel_calls_;
     const bool drop_remainder_;
+    const bool sloppy_;
     const DataTypeVector output_types_;
     const std::vector<PartialTensorShape> output_shapes_;
     const NameAttrList map_fn_;
@@ -664,6 +716,7 @@ class MapAndBatchDatasetOp : public UnaryDatasetOpKernel {
   DataTypeVector output_types_;
   std::vector<PartialTensorShape> output_shapes_;
   NameAttrList func_;
+  bool sloppy_ = false;
 };
 
 REGISTER_KERNEL_BUILDER(Name("MapAndBatchDataset").Device(DEVICE_CPU),
@@ -156,6 +156,10 @@ class OptimizeDatasetOp : public UnaryDatasetOpKernel {
         params.lib = ctx->lib();
         params.function_library = dataset()->flib_def_;
         params.allocator_getter = ctx->allocator_getter();
+        params.model = ctx->model();
+        params.thread_pool = ctx->thread_pool();
+        params.pipeline_id = ctx->pipeline_id();
+        params.pipeline_name = ctx->pipeline_name();
         IteratorContext iter_ctx(params);
         return input_impl_->GetNext(&iter_ctx, out_tensors, end_of_sequence);
       }
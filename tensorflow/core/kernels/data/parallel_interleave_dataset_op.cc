@@ -15,6 +15,8 @@ limitations under the License.
 #include <deque>
 
 #include "tensorflow/core/common_runtime/function.h"
+#include "tensorflow/core/framework/dataset_metrics.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/captured_function.h"
@@ -31,6 +33,9 @@ namespace {
 // See documentation in ../ops/dataset_ops.cc for a high-level
 // description of the following op.
 
+// The largest per-worker buffer that the performance model may pick.
+constexpr int64 kMaxAutoTunedBufferOutputElements = 64;
+
 class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
  public:
   explicit ParallelInterleaveDatasetOp(OpKernelConstruction* ctx)
@@ -70,7 +75,9 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
     OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "buffer_output_elements",
                                             &buffer_output_elements));
     OP_REQUIRES(
-        ctx, buffer_output_elements > 0,
+        ctx,
+        buffer_output_elements > 0 ||
+            buffer_output_elements == model::kAutoTune,
         errors::InvalidArgument("`buffer_output_elements` must be > 0"));
 
     int64 prefetch_input_elements = 0;
@@ -242,6 +249,15 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
             worker_thread_states_(dataset()->num_threads()) {}
 
       ~Iterator() override {
+        // Stop the optimizer from calling into `this` before tearing down.
+        std::shared_ptr<model::Tunable> tunable;
+        model::Node* tunable_node;
+        {
+          mutex_lock l(mu_);
+          tunable = tunable_;
+          tunable_node = tunable_node_;
+        }
+        if (tunable) tunable_node->remove_tunable(tunable.get());
         mutex_lock l(mu_);
         cancelled_ = true;
         // Notify all workers in case they are blocked.
@@ -260,6 +276,7 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
       Status GetNextInternal(IteratorContext* ctx,
                              std::vector<Tensor>* out_tensors,
                              bool* end_of_sequence) override {
+        model::Node* node = model_node(ctx);
         mutex_lock l(mu_);
         TF_RETURN_IF_ERROR(EnsureWorkerThreadsStarted(ctx));
         while (!cancelled_) {
@@ -289,6 +306,11 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
                 block_count_ = 0;
               }
               *end_of_sequence = false;
+              if (node != nullptr) {
+                node->record_buffer_size(current_worker->outputs.size(),
+                                         BufferOutputElements());
+              }
+              RecordBufferSize(ctx, current_worker->outputs.size());
               Status s = current_worker->outputs.front().status;
               current_worker->outputs.front().output.swap(*out_tensors);
               current_worker->outputs.pop_front();
@@ -343,6 +365,8 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
 
           if (must_wait_for_input) {
             // Wait for elements to become available.
+            model::ScopedWait wait(ctx->env(), node);
+            dataset_metrics::ScopedInputWait input_wait(ctx->env());
             if (dataset()->sloppy_) {
               sloppy_cond_var_.wait(l);
             } else {
@@ -562,8 +586,31 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
         WorkerThreadState() : output_elem(Status::OK()) {}
       };
 
+      // The size of each worker's output buffer.
+      int64 BufferOutputElements() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (tunable_) return tunable_->value.load();
+        if (dataset()->buffer_output_elements_ == model::kAutoTune) return 1;
+        return dataset()->buffer_output_elements_;
+      }
+
       Status EnsureWorkerThreadsStarted(IteratorContext* ctx)
           EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        // The output order depends on `cycle_length`, so the performance
+        // model only sizes the output buffers.
+        if (dataset()->buffer_output_elements_ == model::kAutoTune &&
+            !tunable_ && ctx->model()) {
+          ctx->model()->StartOptimization();
+          tunable_node_ = model_node(ctx);
+          tunable_ = std::make_shared<model::Tunable>(
+              model::Tunable::Type::kBufferSize, 1,
+              kMaxAutoTunedBufferOutputElements, [this]() {
+                mutex_lock l(mu_);
+                for (auto& worker : workers_) {
+                  worker.cond_var.notify_all();
+                }
+              });
+          tunable_node_->add_tunable(tunable_);
+        }
         if (worker_threads_.empty()) {
           worker_threads_.reserve(dataset()->num_threads());
           for (int64 i = 0; i < dataset()->num_threads(); ++i) {
@@ -705,8 +752,8 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
           if (!iterator_creation_status.ok()) {
             mutex_lock l(mu_);
             // Wait for space in the prefetch queue.
-            while (!cancelled_ && workers_[thread_index].outputs.size() ==
-                                      dataset()->buffer_output_elements_) {
+            while (!cancelled_ && workers_[thread_index].outputs.size() >=
+                                      BufferOutputElements()) {
               workers_[thread_index].cond_var.wait(l);
             }
             if (cancelled_) return;
@@ -754,8 +801,8 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
                 mutex_lock l(mu_);
 
                 // Wait for space in the prefetch queue.
-                while (!cancelled_ && workers_[thread_index].outputs.size() ==
-                                          dataset()->buffer_output_elements_) {
+                while (!cancelled_ && workers_[thread_index].outputs.size() >=
+                                          BufferOutputElements()) {
                   workers_[thread_index].cond_var.wait(l);
                 }
                 if (cancelled_) return;
@@ -1034,6 +1081,10 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
       size_t block_count_ GUARDED_BY(mu_) = 0;
       // Flag to instruct the worker threads to exit.
       bool cancelled_ GUARDED_BY(mu_) = false;
+      // The size of the output buffers, if it is tuned by the performance
+      // model.
+      std::shared_ptr<model::Tunable> tunable_ GUARDED_BY(mu_);
+      model::Node* tunable_node_ GUARDED_BY(mu_) = nullptr;
       // The worker threads. This must be last to ensure the
       // threads have exited before any other members are deallocated.
       // TODO(b/65178177): Avoid allocating additional threads.
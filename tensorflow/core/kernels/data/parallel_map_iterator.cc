@@ -19,6 +19,11 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "tensorflow/core/framework/dataset_metrics.h"
+#include "tensorflow/core/framework/dataset_thread_pool.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/platform/cpu_info.h"
+
 namespace tensorflow {
 namespace {
 
@@ -27,13 +32,26 @@ class ParallelMapIterator : public DatasetBaseIterator {
   explicit ParallelMapIterator(
       const typename DatasetBaseIterator::BaseParams& params,
       const DatasetBase* input_dataset, ParallelMapIteratorFunction map_func,
-      int32 num_parallel_calls)
+      int32 num_parallel_calls, bool sloppy)
       : DatasetBaseIterator(params),
         input_dataset_(input_dataset),
         map_func_(std::move(map_func)),
-        num_parallel_calls_(num_parallel_calls) {}
+        autotune_(num_parallel_calls == model::kAutoTune),
+        num_parallel_calls_(autotune_ ? port::NumSchedulableCPUs()
+                                      : num_parallel_calls),
+        sloppy_(sloppy) {}
 
   ~ParallelMapIterator() override {
+    // Stop the optimizer from calling into `this` before tearing down.
+    std::shared_ptr<model::Tunable> tunable;
+    model::Node* tunable_node;
+    {
+      mutex_lock l(mu_);
+      tunable = tunable_;
+      tunable_node = tunable_node_;
+    }
+    if (tunable) tunable_node->remove_tunable(tunable.get());
+
     // TODO(mrry): Replace this cancellation logic with a
     // CancellationManager. The syntax would be more heavyweight,
     // but it would be possible to thread a cancellation manager
@@ -43,8 +61,8 @@ class ParallelMapIterator : public DatasetBaseIterator {
     // Cancel the runner thread.
     cancelled_ = true;
     cond_var_.notify_all();
-    // Wait for all in-flight calls to complete.
-    while (num_calls_ > 0) {
+    // Wait for all in-flight calls, and the runner task if any, to complete.
+    while (num_calls_ > 0 || runner_running_) {
       cond_var_.wait(l);
     }
   }
@@ -56,17 +74,39 @@ class ParallelMapIterator : public DatasetBaseIterator {
   Status GetNextInternal(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
                          bool* end_of_sequence) override {
     std::shared_ptr<InvocationResult> result;
+    model::Node* node = model_node(ctx);
     {
       mutex_lock l(mu_);
       EnsureRunnerThreadStarted(ctx);
-      while (invocation_results_.empty()) {
-        cond_var_.wait(l);
+      if (node != nullptr) {
+        node->record_buffer_size(invocation_results_.size(),
+                                 MaxInvocationResults());
+      }
+      RecordBufferSize(ctx, invocation_results_.size());
+      model::ScopedWait wait(ctx->env(), node);
+      dataset_metrics::ScopedInputWait input_wait(ctx->env());
+      if (sloppy_) {
+        while (!(result = TakeCompletedResult())) {
+          DatasetThreadPool::ScopedBlocking blocking;
+          cond_var_.wait(l);
+        }
+      } else {
+        while (invocation_results_.empty()) {
+          DatasetThreadPool::ScopedBlocking blocking;
+          cond_var_.wait(l);
+        }
+        std::swap(result, invocation_results_.front());
+        invocation_results_.pop_front();
       }
-      std::swap(result, invocation_results_.front());
-      invocation_results_.pop_front();
+      MaybeScheduleRunner();
     }
     cond_var_.notify_all();
-    result->notification.WaitForNotification();
+    if (!result->notification.HasBeenNotified()) {
+      model::ScopedWait wait(ctx->env(), node);
+      dataset_metrics::ScopedInputWait input_wait(ctx->env());
+      DatasetThreadPool::ScopedBlocking blocking;
+      result->notification.WaitForNotification();
+    }
     return ProcessResult(result, out_tensors, end_of_sequence);
   }
 
@@ -155,7 +195,24 @@ class ParallelMapIterator : public DatasetBaseIterator {
 
   void EnsureRunnerThreadStarted(IteratorContext* ctx)
       EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-    if (!runner_thread_) {
+    if (autotune_ && !tunable_ && ctx->model()) {
+      ctx->model()->StartOptimization();
+      tunable_node_ = model_node(ctx);
+      tunable_ = std::make_shared<model::Tunable>(
+          model::Tunable::Type::kParallelism, 1, num_parallel_calls_, [this]() {
+            mutex_lock l(mu_);
+            MaybeScheduleRunner();
+            cond_var_.notify_all();
+          });
+      tunable_node_->add_tunable(tunable_);
+    }
+    if (ctx->thread_pool() != nullptr) {
+      // Start calls from tasks on the shared pool.
+      if (!runner_ctx_) {
+        runner_ctx_.reset(new IteratorContext(*ctx));
+        MaybeScheduleRunner();
+      }
+    } else if (!runner_thread_) {
       std::shared_ptr<IteratorContext> ctx_copy(new IteratorContext(*ctx));
       runner_thread_.reset(ctx->env()->StartThread(
           {}, "runner_thread",
@@ -168,8 +225,11 @@ class ParallelMapIterator : public DatasetBaseIterator {
     {
       mutex_lock l(mu_);
       num_calls_--;
+      MaybeScheduleRunner();
+      // Notified under `mu_` so that a sloppy consumer that did not find the
+      // result completed is already waiting on `cond_var_`.
+      result->notification.Notify();
     }
-    result->notification.Notify();
     cond_var_.notify_all();
   }
 
@@ -188,7 +248,13 @@ class ParallelMapIterator : public DatasetBaseIterator {
     // Call `func_(input_element)`, store the result in
     // `result->return_values`, and notify `result->notification` to unblock
     // a consumer.
-    auto done = [this, result](Status status) {
+    model::Node* node = model_node(ctx.get());
+    Env* env = ctx->env();
+    const uint64 start = node != nullptr ? env->NowNanos() : 0;
+    auto done = [this, result, node, env, start](Status status) {
+      if (node != nullptr) {
+        node->add_processing_time(env->NowNanos() - start);
+      }
       result->status.Update(status);
       CallCompleted(result);
     };
@@ -197,7 +263,35 @@ class ParallelMapIterator : public DatasetBaseIterator {
               std::move(done));
   }
 
-  int64 MaxInvocationResults() { return num_parallel_calls_; }
+  // The current degree of parallelism.
+  int64 NumParallelCalls() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return tunable_ ? tunable_->value.load() : num_parallel_calls_;
+  }
+
+  int64 MaxInvocationResults() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return NumParallelCalls();
+  }
+
+  // Removes and returns the first result in `invocation_results_` whose call
+  // has completed, or nullptr if there is none. The end of the sequence, or
+  // an early termination by `f`, is only returned once all the results before
+  // it have been.
+  std::shared_ptr<InvocationResult> TakeCompletedResult()
+      EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    for (auto it = invocation_results_.begin();
+         it != invocation_results_.end(); ++it) {
+      const InvocationResult& result = **it;
+      if (!result.notification.HasBeenNotified() ||
+          (it != invocation_results_.begin() &&
+           (result.end_of_input || errors::IsOutOfRange(result.status)))) {
+        continue;
+      }
+      std::shared_ptr<InvocationResult> completed = std::move(*it);
+      invocation_results_.erase(it);
+      return completed;
+    }
+    return nullptr;
+  }
 
   Status ProcessResult(const std::shared_ptr<InvocationResult>& result,
                        std::vector<Tensor>* out_tensors,
@@ -224,14 +318,14 @@ class ParallelMapIterator : public DatasetBaseIterator {
       {
         mutex_lock l(mu_);
         while (!cancelled_ &&
-               (num_calls_ >= num_parallel_calls_ ||
+               (num_calls_ >= NumParallelCalls() ||
                 invocation_results_.size() >= MaxInvocationResults())) {
           cond_var_.wait(l);
         }
         if (cancelled_) {
           return;
         }
-        while (num_calls_ < num_parallel_calls_ &&
+        while (num_calls_ < NumParallelCalls() &&
                invocation_results_.size() < MaxInvocationResults()) {
           invocation_results_.emplace_back(new InvocationResult());
           new_calls.push_back(invocation_results_.back());
@@ -246,6 +340,45 @@ class ParallelMapIterator : public DatasetBaseIterator {
     }
   }
 
+  // Schedules a task on the shared pool to start calls, if the pool is in
+  // use, a call can be started, and no such task is pending.
+  void MaybeScheduleRunner() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (!runner_ctx_ || runner_running_ || cancelled_ ||
+        num_calls_ >= NumParallelCalls() ||
+        invocation_results_.size() >= MaxInvocationResults()) {
+      return;
+    }
+    runner_running_ = true;
+    runner_ctx_->thread_pool()->Schedule(runner_ctx_->pipeline_id(),
+                                         [this]() { RunnerTask(); });
+  }
+
+  // Starts as many calls as there is room for, as a task on the shared pool
+  // in place of `RunnerThread`. Input elements are read by one task at a
+  // time, so that the calls see them in order.
+  void RunnerTask() {
+    std::vector<std::shared_ptr<InvocationResult>> new_calls;
+    {
+      mutex_lock l(mu_);
+      while (!cancelled_ && num_calls_ < NumParallelCalls() &&
+             invocation_results_.size() < MaxInvocationResults()) {
+        invocation_results_.emplace_back(new InvocationResult());
+        new_calls.push_back(invocation_results_.back());
+        num_calls_++;
+      }
+    }
+    cond_var_.notify_all();
+    for (const auto& call : new_calls) {
+      CallFunction(runner_ctx_, call);
+    }
+    // The destructor may run as soon as `runner_running_` is cleared, so this
+    // must be the task's last use of `this`.
+    mutex_lock l(mu_);
+    runner_running_ = false;
+    MaybeScheduleRunner();
+    cond_var_.notify_all();
+  }
+
   Status WriteStatusLocked(IteratorStateWriter* writer, size_t index,
                            const Status& status) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     TF_RETURN_IF_ERROR(
@@ -286,7 +419,13 @@ class ParallelMapIterator : public DatasetBaseIterator {
 
   const DatasetBase* const input_dataset_;  // Not owned.
   const ParallelMapIteratorFunction map_func_;
+  // Whether the degree of parallelism is tuned by the performance model.
+  const bool autotune_;
+  // The degree of parallelism, or its upper bound if `autotune_`.
   const int32 num_parallel_calls_;
+  // Whether results are returned as soon as their calls complete, rather
+  // than in the order of the input.
+  const bool sloppy_;
   // Used for coordination between the main thread and the runner thread.
   mutex mu_;
   // Used for coordination between the main thread and the runner thread. In
@@ -302,7 +441,14 @@ class ParallelMapIterator : public DatasetBaseIterator {
   std::deque<std::shared_ptr<InvocationResult>> invocation_results_
       GUARDED_BY(mu_);
   std::unique_ptr<Thread> runner_thread_ GUARDED_BY(mu_);
+  // The context of the tasks that start calls on the shared pool, in place of
+  // `runner_thread_`; set once.
+  std::shared_ptr<IteratorContext> runner_ctx_;
+  bool runner_running_ GUARDED_BY(mu_) = false;
   bool cancelled_ GUARDED_BY(mu_) = false;
+  // The degree of parallelism, if `autotune_` and the iterator has a model.
+  std::shared_ptr<model::Tunable> tunable_ GUARDED_BY(mu_);
+  model::Node* tunable_node_ GUARDED_BY(mu_) = nullptr;
 };
 
 }  // namespace
@@ -310,9 +456,10 @@ class ParallelMapIterator : public DatasetBaseIterator {
 std::unique_ptr<IteratorBase> NewParallelMapIterator(
     const DatasetBaseIterator::BaseParams& params,
     const DatasetBase* input_dataset, ParallelMapIteratorFunction map_func,
-    int32 num_parallel_calls) {
-  return std::unique_ptr<IteratorBase>(new ParallelMapIterator(
-      params, input_dataset, std::move(map_func), num_parallel_calls));
+    int32 num_parallel_calls, bool sloppy) {
+  return std::unique_ptr<IteratorBase>(
+      new ParallelMapIterator(params, input_dataset, std::move(map_func),
+                              num_parallel_calls, sloppy));
 }
 
 }  // namespace tensorflow
@@ -33,11 +33,17 @@ using ParallelMapIteratorFunction =
                        std::vector<Tensor>*, StatusCallback)>;
 
 // Returns a new iterator that applies `map_func` to the elements of
-// `input_dataset` using the given degree of parallelism.
+// `input_dataset` using the given degree of parallelism. If
+// `num_parallel_calls` is `model::kAutoTune`, the degree of parallelism is
+// tuned by the performance model of the iterator's context, or is the number
+// of schedulable CPUs if the context has no model. If `sloppy` is true, the
+// results are returned in the order in which they are produced, so that a slow
+// call does not hold back the results of the calls after it; saving the
+// iterator is still supported, since it waits for the calls in flight.
 std::unique_ptr<IteratorBase> NewParallelMapIterator(
     const DatasetBaseIterator::BaseParams& params,
     const DatasetBase* input_dataset, ParallelMapIteratorFunction map_func,
-    int32 num_parallel_calls);
+    int32 num_parallel_calls, bool sloppy);
 
 }  // namespace tensorflow
 
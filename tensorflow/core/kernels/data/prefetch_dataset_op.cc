@@ -16,6 +16,9 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/data/prefetch_dataset_op.h"
 
+#include "tensorflow/core/framework/dataset_metrics.h"
+#include "tensorflow/core/framework/dataset_thread_pool.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/error_codes.pb.h"
@@ -25,6 +28,13 @@ namespace tensorflow {
 // See documentation in ../ops/dataset_ops.cc for a high-level
 // description of the following op.
 
+namespace {
+
+// The largest buffer that the performance model may pick.
+constexpr int64 kMaxAutoTunedBufferSize = 1024;
+
+}  // namespace
+
 class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size)
@@ -71,6 +81,15 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
           auto_tuner_(params.dataset->buffer_size_) {}
 
     ~Iterator() override {
+      // Stop the optimizer from calling into `this` before tearing down.
+      std::shared_ptr<model::Tunable> tunable;
+      model::Node* tunable_node;
+      {
+        mutex_lock l(mu_);
+        tunable = tunable_;
+        tunable_node = tunable_node_;
+      }
+      if (tunable) tunable_node->remove_tunable(tunable.get());
       // Signal the prefetch thread to terminate it. We will then
       // join that thread when we delete `this->prefetch_thread_`.
       //
@@ -83,6 +102,11 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
         mutex_lock l(mu_);
         cancelled_ = true;
         cond_var_.notify_all();
+        // A producer on the shared pool cannot be joined, so wait for it to
+        // finish.
+        while (producer_running_) {
+          cond_var_.wait(l);
+        }
       }
     }
 
@@ -93,14 +117,23 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
+      model::Node* node = model_node(ctx);
       {
         mutex_lock l(mu_);
         TF_RETURN_IF_ERROR(EnsurePrefetchThreadStarted(ctx));
+        if (node != nullptr) {
+          node->record_buffer_size(buffer_.size(), BufferLimit());
+        }
+        RecordBufferSize(ctx, buffer_.size());
         // Wait until the next element in the buffer has been
         // produced, or we are shutting down.
+        model::ScopedWait wait(ctx->env(), node);
+        dataset_metrics::ScopedInputWait input_wait(ctx->env());
         while (!cancelled_ && buffer_.empty() && !prefetch_thread_finished_ &&
-               auto_tuner_.buffer_limit() != 0) {
+               BufferLimit() != 0) {
           auto_tuner_.RecordEmpty();
+          MaybeScheduleProducer();
+          DatasetThreadPool::ScopedBlocking blocking;
           cond_var_.wait(l);
         }
 
@@ -118,7 +151,7 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
           return Status::OK();
         }
 
-        DCHECK_EQ(auto_tuner_.buffer_limit(), 0);
+        DCHECK_EQ(BufferLimit(), 0);
       }
 
       mutex_lock parent_l(parent_mu_);
@@ -208,6 +241,7 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
       }
       buffer_.pop_front();
       *end_of_sequence = false;
+      MaybeScheduleProducer();
 
       // Wake the prefetch thread, in case it has been waiting for space
       // in the buffer. Also wake up threads from other calls to GetNext.
@@ -218,9 +252,35 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
       return s;
     }
 
+    // The current size of the buffer.
+    int64 BufferLimit() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return tunable_ ? tunable_->value.load() : auto_tuner_.buffer_limit();
+    }
+
     Status EnsurePrefetchThreadStarted(IteratorContext* ctx)
         EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-      if (!prefetch_thread_) {
+      // Let the performance model of the pipeline, if any, size the buffer
+      // in place of `auto_tuner_`.
+      if (dataset()->buffer_size_ == model::kAutoTune && !tunable_ &&
+          ctx->model()) {
+        ctx->model()->StartOptimization();
+        tunable_node_ = model_node(ctx);
+        tunable_ = std::make_shared<model::Tunable>(
+            model::Tunable::Type::kBufferSize, 1, kMaxAutoTunedBufferSize,
+            [this]() {
+              mutex_lock l(mu_);
+              MaybeScheduleProducer();
+              cond_var_.notify_all();
+            });
+        tunable_node_->add_tunable(tunable_);
+      }
+      if (ctx->thread_pool() != nullptr) {
+        // Produce elements on the shared pool, one task per element.
+        if (!producer_ctx_) {
+          producer_ctx_.reset(new IteratorContext(*ctx));
+          MaybeScheduleProducer();
+        }
+      } else if (!prefetch_thread_) {
         prefetch_thread_.reset(
             ctx->env()->StartThread({}, "prefetch_thread",
                                     std::bind(&Iterator::PrefetchThread, this,
@@ -241,7 +301,7 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
         // 1. Wait for a slot in the buffer.
         {
           mutex_lock l(mu_);
-          while (!cancelled_ && buffer_.size() >= auto_tuner_.buffer_limit()) {
+          while (!cancelled_ && buffer_.size() >= BufferLimit()) {
             cond_var_.wait(l);
           }
 
@@ -277,6 +337,51 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
       }
     }
 
+    // Schedules a task on the shared pool to produce the next element, if
+    // the pool is in use, there is space in the buffer, and no such task is
+    // pending.
+    void MaybeScheduleProducer() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!producer_ctx_ || producer_running_ || cancelled_ ||
+          prefetch_thread_finished_ || buffer_.size() >= BufferLimit()) {
+        return;
+      }
+      producer_running_ = true;
+      producer_ctx_->thread_pool()->Schedule(producer_ctx_->pipeline_id(),
+                                             [this]() { ProduceElement(); });
+    }
+
+    // Reads the next element of the input into the buffer, as a task on the
+    // shared pool, then schedules the task for the element after it.
+    void ProduceElement() {
+      {
+        mutex_lock l(mu_);
+        if (cancelled_) {
+          producer_running_ = false;
+          cond_var_.notify_all();
+          return;
+        }
+      }
+      {
+        mutex_lock parent_l(parent_mu_);
+        bool end_of_sequence;
+        BufferElement buffer_element;
+        buffer_element.status = input_impl_->GetNext(
+            producer_ctx_.get(), &buffer_element.value, &end_of_sequence);
+        mutex_lock l(mu_);
+        if (buffer_element.status.ok() && end_of_sequence) {
+          prefetch_thread_finished_ = true;
+        } else {
+          buffer_.push_back(std::move(buffer_element));
+        }
+      }
+      // The destructor may run as soon as `producer_running_` is cleared, so
+      // this must be the task's last use of `this`.
+      mutex_lock l(mu_);
+      producer_running_ = false;
+      MaybeScheduleProducer();
+      cond_var_.notify_all();
+    }
+
     Status WriteStatus(IteratorStateWriter* writer, size_t index,
                        const Status& status) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       TF_RETURN_IF_ERROR(writer->WriteScalar(
@@ -325,8 +430,15 @@ class PrefetchDatasetOp::Dataset : public GraphDatasetBase {
     PrefetchAutotuner auto_tuner_ GUARDED_BY(mu_);
     std::deque<BufferElement> buffer_ GUARDED_BY(mu_);
     std::unique_ptr<Thread> prefetch_thread_ GUARDED_BY(mu_);
+    // The context of the tasks that produce elements on the shared pool, in
+    // place of `prefetch_thread_`; set once.
+    std::unique_ptr<IteratorContext> producer_ctx_;
+    bool producer_running_ GUARDED_BY(mu_) = false;
     bool cancelled_ GUARDED_BY(mu_) = false;
     bool prefetch_thread_finished_ GUARDED_BY(mu_) = false;
+    // The buffer size, if it is tuned by the performance model.
+    std::shared_ptr<model::Tunable> tunable_ GUARDED_BY(mu_);
+    model::Node* tunable_node_ GUARDED_BY(mu_) = nullptr;
   };
   const DatasetBase* const input_;
   const int64 buffer_size_;
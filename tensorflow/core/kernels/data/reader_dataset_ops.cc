@@ -500,7 +500,12 @@ REGISTER_KERNEL_BUILDER(Name("FixedLengthRecordDataset").Device(DEVICE_CPU),
 
 class TFRecordDatasetOp : public DatasetOpKernel {
  public:
-  using DatasetOpKernel::DatasetOpKernel;
+  explicit TFRecordDatasetOp(OpKernelConstruction* ctx)
+      : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("read_ahead_blocks", &read_ahead_blocks_));
+    OP_REQUIRES(ctx, read_ahead_blocks_ >= 0,
+                errors::InvalidArgument("`read_ahead_blocks` must be >= 0"));
+  }
 
   void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
     const Tensor* filenames_tensor;
@@ -526,15 +531,16 @@ class TFRecordDatasetOp : public DatasetOpKernel {
                 errors::InvalidArgument(
                     "`buffer_size` must be >= 0 (0 == no buffering)"));
 
-    *output =
-        new Dataset(ctx, std::move(filenames), compression_type, buffer_size);
+    *output = new Dataset(ctx, std::move(filenames), compression_type,
+                          buffer_size, read_ahead_blocks_);
   }
 
  private:
   class Dataset : public GraphDatasetBase {
    public:
     explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
-                     const string& compression_type, int64 buffer_size)
+                     const string& compression_type, int64 buffer_size,
+                     int64 read_ahead_blocks)
         : GraphDatasetBase(ctx),
           filenames_(std::move(filenames)),
           compression_type_(compression_type),
@@ -543,6 +549,7 @@ class TFRecordDatasetOp : public DatasetOpKernel {
       if (buffer_size > 0) {
         options_.buffer_size = buffer_size;
       }
+      options_.read_ahead_blocks = read_ahead_blocks;
     }
 
     std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -574,8 +581,11 @@ class TFRecordDatasetOp : public DatasetOpKernel {
       TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
       Node* buffer_size = nullptr;
       TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
-      TF_RETURN_IF_ERROR(b->AddDataset(
-          this, {filenames, compression_type, buffer_size}, output));
+      AttrValue read_ahead_blocks;
+      b->BuildAttrValue(options_.read_ahead_blocks, &read_ahead_blocks);
+      TF_RETURN_IF_ERROR(
+          b->AddDataset(this, {filenames, compression_type, buffer_size},
+                        {{"read_ahead_blocks", read_ahead_blocks}}, output));
       return Status::OK();
     }
 
@@ -685,6 +695,8 @@ class TFRecordDatasetOp : public DatasetOpKernel {
     const string compression_type_;
     io::RecordReaderOptions options_;
   };
+
+  int64 read_ahead_blocks_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("TFRecordDataset").Device(DEVICE_CPU),
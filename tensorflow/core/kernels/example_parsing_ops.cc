@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/example_proto_helper.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 #include "tensorflow/core/util/work_sharder.h"
@@ -38,6 +39,9 @@ class ParseExampleOp : public OpKernel {
  public:
   explicit ParseExampleOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
     OP_REQUIRES_OK(ctx, attrs_.Init(ctx));
+    // The columnar parser is opt-in: TF_PARSE_EXAMPLE_COLUMNAR=1 enables it.
+    OP_REQUIRES_OK(ctx, ReadBoolFromEnvVar("TF_PARSE_EXAMPLE_COLUMNAR", false,
+                                           &use_columnar_parser_));
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -137,11 +141,15 @@ class ParseExampleOp : public OpKernel {
     gtl::ArraySlice<string> slice(serialized_t.data(), serialized_t.size());
     gtl::ArraySlice<string> names_slice(names_t.data(), names_t.size());
 
-    OP_REQUIRES_OK(
-        ctx,
-        FastParseExample(
-            config, slice, names_slice,
-            ctx->device()->tensorflow_cpu_worker_threads()->workers, &result));
+    thread::ThreadPool* thread_pool =
+        ctx->device()->tensorflow_cpu_worker_threads()->workers;
+    if (use_columnar_parser_) {
+      OP_REQUIRES_OK(ctx, FastParseExampleColumnar(config, slice, names_slice,
+                                                   thread_pool, &result));
+    } else {
+      OP_REQUIRES_OK(ctx, FastParseExample(config, slice, names_slice,
+                                           thread_pool, &result));
+    }
 
     OpOutputList dense_values;
     OpOutputList sparse_indices;
@@ -163,6 +171,7 @@ class ParseExampleOp : public OpKernel {
 
  protected:
   ParseExampleAttrs attrs_;
+  bool use_columnar_parser_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("ParseExample").Device(DEVICE_CPU),
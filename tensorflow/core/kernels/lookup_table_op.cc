@@ -16,9 +16,13 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
@@ -26,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace lookup {
@@ -642,6 +647,321 @@ class MutableDenseHashTable final : public LookupInterface {
   uint64 empty_key_hash_;
 };
 
+namespace {
+
+// Mixes the bits of a key hash. HashScalar is the identity for integer keys,
+// and both the stripe and the slot within a stripe are taken from the hash.
+// Zero is reserved to mark empty slots.
+inline uint64 MixHash(uint64 h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h == 0 ? 1 : h;
+}
+
+}  // namespace
+
+// Lookup table with the same semantics as MutableHashTableOfScalars, built
+// for many concurrent readers.
+//
+// Keys are partitioned by hash into "num_stripes" stripes. Each stripe is an
+// open addressing table with linear probing that stores hashes, keys and
+// values in separate flat arrays, and is guarded by its own reader/writer
+// lock. Find only takes shared locks, so concurrent lookups never wait on
+// each other. A batch of keys is grouped by stripe so that each stripe lock
+// is taken once per batch, and large batches are spread over the intra-op
+// thread pool one group of stripes per shard.
+template <class K, class V>
+class MutableStripedHashTable final : public LookupInterface {
+ public:
+  MutableStripedHashTable(OpKernelContext* ctx, OpKernel* kernel) {
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "num_stripes", &num_stripes_));
+    stripes_.reset(new Stripe[num_stripes_]);
+    for (int64 i = 0; i < num_stripes_; ++i) {
+      mutex_lock l(stripes_[i].mu);
+      stripes_[i].Resize(kMinStripeCapacity);
+    }
+  }
+
+  size_t size() const override {
+    size_t ret = 0;
+    for (int64 i = 0; i < num_stripes_; ++i) {
+      tf_shared_lock l(stripes_[i].mu);
+      ret += stripes_[i].num_entries;
+    }
+    return ret;
+  }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const V default_val = default_value.flat<V>()(0);
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat<V>();
+
+    StripedBatch batch;
+    PartitionByStripe(key_values, &batch);
+    auto find = [this, &batch, &key_values, &value_values, &default_val](
+                    int64 s, const int64* begin, const int64* end) {
+      const Stripe& stripe = stripes_[s];
+      tf_shared_lock l(stripe.mu);
+      for (const int64* it = begin; it != end; ++it) {
+        const int64 i = *it;
+        const K& key_value = SubtleMustCopyIfIntegral(key_values(i));
+        const int64 slot = stripe.FindSlot(batch.hashes[i], key_value);
+        value_values(i) =
+            stripe.hashes[slot] != 0 ? stripe.values[slot] : default_val;
+      }
+    };
+    ForEachStripe(ctx, batch, kFindCostPerKey, find);
+    return Status::OK();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+
+    StripedBatch batch;
+    PartitionByStripe(key_values, &batch);
+    auto insert = [this, &batch, &key_values, &value_values](
+                      int64 s, const int64* begin, const int64* end) {
+      Stripe& stripe = stripes_[s];
+      mutex_lock l(stripe.mu);
+      InsertIntoStripe(batch, key_values, value_values, begin, end, &stripe);
+    };
+    ForEachStripe(ctx, batch, kInsertCostPerKey, insert);
+    return Status::OK();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+
+    StripedBatch batch;
+    PartitionByStripe(key_values, &batch);
+    // Replacing the contents holds every stripe lock so that concurrent
+    // lookups observe either the old or the new table.
+    LockAllStripes();
+    for (int64 s = 0; s < num_stripes_; ++s) {
+      Stripe& stripe = stripes_[s];
+      stripe.Resize(kMinStripeCapacity);
+      InsertIntoStripe(batch, key_values, value_values,
+                       batch.order.data() + batch.offsets[s],
+                       batch.order.data() + batch.offsets[s + 1], &stripe);
+    }
+    UnlockAllStripes();
+    return Status::OK();
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    LockAllStripesShared();
+    Status s = ExportValuesLocked(ctx);
+    UnlockAllStripesShared();
+    return s;
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return TensorShape(); }
+
+  int64 MemoryUsed() const override {
+    int64 ret = sizeof(MutableStripedHashTable) + num_stripes_ * sizeof(Stripe);
+    for (int64 i = 0; i < num_stripes_; ++i) {
+      tf_shared_lock l(stripes_[i].mu);
+      ret += stripes_[i].hashes.size() *
+             (sizeof(uint64) + sizeof(K) + sizeof(V));
+    }
+    return ret;
+  }
+
+ private:
+  // Stripes never shrink below this many slots.
+  static constexpr int64 kMinStripeCapacity = 8;
+  // Rough per-key costs, in cycles, handed to Shard().
+  static constexpr int64 kFindCostPerKey = 100;
+  static constexpr int64 kInsertCostPerKey = 200;
+
+  struct Stripe {
+    mutable mutex mu;
+    // The capacity is a power of two and at most half of the slots are in
+    // use, so every probe sequence ends at an empty slot. hashes[i] == 0 marks
+    // slot i as empty.
+    std::vector<uint64> hashes GUARDED_BY(mu);
+    std::vector<K> keys GUARDED_BY(mu);
+    std::vector<V> values GUARDED_BY(mu);
+    int64 num_entries GUARDED_BY(mu) = 0;
+
+    // Returns the slot holding "key", or the empty slot where it belongs.
+    int64 FindSlot(uint64 hash, const K& key) const SHARED_LOCKS_REQUIRED(mu) {
+      const int64 mask = hashes.size() - 1;
+      int64 slot = hash & mask;
+      while (hashes[slot] != 0 &&
+             (hashes[slot] != hash || keys[slot] != key)) {
+        slot = (slot + 1) & mask;
+      }
+      return slot;
+    }
+
+    // Grows the stripe, if needed, so that it can hold "num_new_entries"
+    // more entries.
+    void Reserve(int64 num_new_entries) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+      const int64 pending_num_entries = num_entries + num_new_entries;
+      int64 capacity = hashes.size();
+      if (2 * pending_num_entries <= capacity) return;
+      while (2 * pending_num_entries > capacity) capacity <<= 1;
+      std::vector<uint64> old_hashes(capacity, 0);
+      std::vector<K> old_keys(capacity);
+      std::vector<V> old_values(capacity);
+      old_hashes.swap(hashes);
+      old_keys.swap(keys);
+      old_values.swap(values);
+      const int64 mask = capacity - 1;
+      for (size_t i = 0; i < old_hashes.size(); ++i) {
+        if (old_hashes[i] == 0) continue;
+        int64 slot = old_hashes[i] & mask;
+        while (hashes[slot] != 0) slot = (slot + 1) & mask;
+        hashes[slot] = old_hashes[i];
+        keys[slot] = std::move(old_keys[i]);
+        values[slot] = std::move(old_values[i]);
+      }
+    }
+
+    // Drops all entries and sets the capacity to "capacity" slots.
+    void Resize(int64 capacity) EXCLUSIVE_LOCKS_REQUIRED(mu) {
+      hashes.assign(capacity, 0);
+      keys.assign(capacity, K());
+      values.assign(capacity, V());
+      num_entries = 0;
+    }
+  };
+
+  // A batch of keys grouped by stripe: the positions of the keys belonging
+  // to stripe s are order[offsets[s]] .. order[offsets[s + 1] - 1], in their
+  // original order so that the last of several equal keys wins on insert.
+  struct StripedBatch {
+    std::vector<uint64> hashes;
+    std::vector<int64> offsets;
+    std::vector<int64> order;
+  };
+
+  void PartitionByStripe(typename TTypes<K>::ConstFlat key_values,
+                         StripedBatch* batch) const {
+    const int64 num_keys = key_values.size();
+    batch->hashes.resize(num_keys);
+    batch->offsets.assign(num_stripes_ + 1, 0);
+    batch->order.resize(num_keys);
+    std::vector<int64> stripe_ids(num_keys);
+    for (int64 i = 0; i < num_keys; ++i) {
+      const uint64 hash = MixHash(HashScalar(key_values(i)));
+      batch->hashes[i] = hash;
+      stripe_ids[i] = (hash >> 32) % num_stripes_;
+      ++batch->offsets[stripe_ids[i] + 1];
+    }
+    for (int64 s = 0; s < num_stripes_; ++s) {
+      batch->offsets[s + 1] += batch->offsets[s];
+    }
+    std::vector<int64> next(batch->offsets.begin(), batch->offsets.end() - 1);
+    for (int64 i = 0; i < num_keys; ++i) {
+      batch->order[next[stripe_ids[i]]++] = i;
+    }
+  }
+
+  // Calls fn(s, begin, end) for every stripe s that has keys in "batch",
+  // where [begin, end) are the positions of those keys. Stripes are spread
+  // over the intra-op thread pool when the batch is large enough.
+  void ForEachStripe(
+      OpKernelContext* ctx, const StripedBatch& batch, int64 cost_per_key,
+      const std::function<void(int64, const int64*, const int64*)>& fn) {
+    auto work = [&batch, &fn](int64 start, int64 limit) {
+      for (int64 s = start; s < limit; ++s) {
+        const int64 begin = batch.offsets[s];
+        const int64 end = batch.offsets[s + 1];
+        if (begin < end) {
+          fn(s, batch.order.data() + begin, batch.order.data() + end);
+        }
+      }
+    };
+    const int64 cost_per_stripe =
+        cost_per_key * std::max<int64>(1, batch.order.size() / num_stripes_);
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_stripes_,
+          cost_per_stripe, work);
+  }
+
+  void InsertIntoStripe(const StripedBatch& batch,
+                        typename TTypes<K>::ConstFlat key_values,
+                        typename TTypes<V>::ConstFlat value_values,
+                        const int64* begin, const int64* end, Stripe* stripe)
+      EXCLUSIVE_LOCKS_REQUIRED(stripe->mu) {
+    // As in MutableDenseHashTable, assume every key is new when growing.
+    stripe->Reserve(end - begin);
+    for (const int64* it = begin; it != end; ++it) {
+      const int64 i = *it;
+      const K& key_value = SubtleMustCopyIfIntegral(key_values(i));
+      const int64 slot = stripe->FindSlot(batch.hashes[i], key_value);
+      if (stripe->hashes[slot] == 0) {
+        stripe->hashes[slot] = batch.hashes[i];
+        stripe->keys[slot] = key_value;
+        ++stripe->num_entries;
+      }
+      stripe->values[slot] = SubtleMustCopyIfIntegral(value_values(i));
+    }
+  }
+
+  Status ExportValuesLocked(OpKernelContext* ctx) {
+    int64 size = 0;
+    for (int64 s = 0; s < num_stripes_; ++s) {
+      size += stripes_[s].num_entries;
+    }
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("values", TensorShape({size}), &values));
+
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->flat<V>();
+    int64 i = 0;
+    for (int64 s = 0; s < num_stripes_; ++s) {
+      const Stripe& stripe = stripes_[s];
+      for (size_t slot = 0; slot < stripe.hashes.size(); ++slot) {
+        if (stripe.hashes[slot] != 0) {
+          keys_data(i) = stripe.keys[slot];
+          values_data(i) = stripe.values[slot];
+          ++i;
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  // Stripe locks are always acquired in increasing stripe order.
+  void LockAllStripes() NO_THREAD_SAFETY_ANALYSIS {
+    for (int64 s = 0; s < num_stripes_; ++s) stripes_[s].mu.lock();
+  }
+  void UnlockAllStripes() NO_THREAD_SAFETY_ANALYSIS {
+    for (int64 s = 0; s < num_stripes_; ++s) stripes_[s].mu.unlock();
+  }
+  void LockAllStripesShared() NO_THREAD_SAFETY_ANALYSIS {
+    for (int64 s = 0; s < num_stripes_; ++s) stripes_[s].mu.lock_shared();
+  }
+  void UnlockAllStripesShared() NO_THREAD_SAFETY_ANALYSIS {
+    for (int64 s = 0; s < num_stripes_; ++s) stripes_[s].mu.unlock_shared();
+  }
+
+  int64 num_stripes_ = 1;
+  std::unique_ptr<Stripe[]> stripes_;
+};
+
 }  // namespace lookup
 
 // Table lookup op. Perform the lookup operation on the given table.
@@ -903,4 +1223,24 @@ REGISTER_KERNEL(int64, Variant);
 
 #undef REGISTER_KERNEL
 
+// Register the MutableStripedHashTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                              \
+  REGISTER_KERNEL_BUILDER(                                                   \
+      Name("MutableStripedHashTable")                                        \
+          .Device(DEVICE_CPU)                                                \
+          .TypeConstraint<key_dtype>("key_dtype")                            \
+          .TypeConstraint<value_dtype>("value_dtype"),                       \
+      LookupTableOp<lookup::MutableStripedHashTable<key_dtype, value_dtype>, \
+                    key_dtype, value_dtype>)
+
+REGISTER_KERNEL(int64, int64);
+REGISTER_KERNEL(int64, float);
+REGISTER_KERNEL(int64, double);
+REGISTER_KERNEL(int64, string);
+REGISTER_KERNEL(string, float);
+REGISTER_KERNEL(string, int64);
+REGISTER_KERNEL(string, bool);
+
+#undef REGISTER_KERNEL
+
 }  // namespace tensorflow
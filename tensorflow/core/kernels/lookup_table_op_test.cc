@@ -0,0 +1,252 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+// The mutable int64 -> float tables that can be compared against each other.
+enum class TableType {
+  kHashTable,
+  kHashTableOfTensors,
+  kDenseHashTable,
+  kStripedHashTable,
+};
+
+Node* Table(Graph* g, TableType type) {
+  Node* table;
+  switch (type) {
+    case TableType::kHashTable:
+      TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableHashTableV2")
+                      .Attr("key_dtype", DT_INT64)
+                      .Attr("value_dtype", DT_FLOAT)
+                      .Finalize(g, &table));
+      break;
+    case TableType::kHashTableOfTensors:
+      TF_CHECK_OK(
+          NodeBuilder(g->NewName("table"), "MutableHashTableOfTensorsV2")
+              .Attr("key_dtype", DT_INT64)
+              .Attr("value_dtype", DT_FLOAT)
+              .Attr("value_shape", TensorShape({1}))
+              .Finalize(g, &table));
+      break;
+    case TableType::kDenseHashTable: {
+      Node* empty_key = test::graph::Constant(g, test::AsScalar<int64>(-1));
+      TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableDenseHashTableV2")
+                      .Input(empty_key)
+                      .Attr("value_dtype", DT_FLOAT)
+                      .Finalize(g, &table));
+      break;
+    }
+    case TableType::kStripedHashTable:
+      TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableStripedHashTable")
+                      .Attr("key_dtype", DT_INT64)
+                      .Attr("value_dtype", DT_FLOAT)
+                      .Finalize(g, &table));
+      break;
+  }
+  return table;
+}
+
+// Values of MutableHashTableOfTensors are vectors of length one.
+TensorShape ValueShape(TableType type, int64 num_keys) {
+  if (type == TableType::kHashTableOfTensors) {
+    return TensorShape({num_keys, 1});
+  }
+  return TensorShape({num_keys});
+}
+
+Node* Insert(Graph* g, Node* table, TableType type,
+             const std::vector<int64>& keys, const std::vector<float>& values) {
+  const int64 num_keys = keys.size();
+  Node* insert;
+  TF_CHECK_OK(
+      NodeBuilder(g->NewName("insert"), "LookupTableInsertV2")
+          .Input(table)
+          .Input(test::graph::Constant(
+              g, test::AsTensor<int64>(keys, TensorShape({num_keys}))))
+          .Input(test::graph::Constant(
+              g, test::AsTensor<float>(values, ValueShape(type, num_keys))))
+          .Finalize(g, &insert));
+  return insert;
+}
+
+Node* Find(Graph* g, Node* table, TableType type,
+           const std::vector<int64>& keys) {
+  const int64 num_keys = keys.size();
+  Tensor default_value = type == TableType::kHashTableOfTensors
+                             ? test::AsTensor<float>({-1.0f}, {1})
+                             : test::AsScalar<float>(-1.0f);
+  Node* find;
+  TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                  .Input(table)
+                  .Input(test::graph::Constant(
+                      g, test::AsTensor<int64>(keys, TensorShape({num_keys}))))
+                  .Input(test::graph::Constant(g, default_value))
+                  .Finalize(g, &find));
+  return find;
+}
+
+std::vector<int64> RandomKeys(random::SimplePhilox* rnd, int num_keys,
+                              int64 max_key) {
+  std::vector<int64> keys;
+  for (int i = 0; i < num_keys; ++i) {
+    keys.push_back(rnd->Uniform64(max_key));
+  }
+  return keys;
+}
+
+// Inserts the same keys, with duplicates, into each table type and checks
+// that lookups, sizes and exports agree with MutableHashTableV2.
+TEST(MutableStripedHashTableTest, MatchesMutableHashTable) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<int64> keys = RandomKeys(&rnd, 5000, 4000);
+  std::vector<float> values;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    values.push_back(i);
+  }
+  std::vector<int64> queries = RandomKeys(&rnd, 2000, 8000);
+
+  std::vector<Tensor> expected;
+  for (TableType type :
+       {TableType::kHashTable, TableType::kStripedHashTable}) {
+    Graph g(OpRegistry::Global());
+    Node* table = Table(&g, type);
+    Node* insert = Insert(&g, table, type, keys, values);
+    Node* find = Find(&g, table, type, queries);
+    Node* size;
+    TF_ASSERT_OK(NodeBuilder(g.NewName("size"), "LookupTableSizeV2")
+                     .Input(table)
+                     .Finalize(&g, &size));
+    Node* table_export;
+    TF_ASSERT_OK(NodeBuilder(g.NewName("export"), "LookupTableExportV2")
+                     .Input(table)
+                     .Attr("Tkeys", DT_INT64)
+                     .Attr("Tvalues", DT_FLOAT)
+                     .Finalize(&g, &table_export));
+    GraphDef gd;
+    g.ToGraphDef(&gd);
+    std::unique_ptr<Session> session(NewSession(SessionOptions()));
+    TF_ASSERT_OK(session->Create(gd));
+    TF_ASSERT_OK(session->Run({}, {}, {insert->name()}, nullptr));
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({},
+                              {find->name(), size->name(),
+                               table_export->name() + ":0",
+                               table_export->name() + ":1"},
+                              {}, &outputs));
+
+    // Exports are unordered, so compare them as maps.
+    std::map<int64, float> exported;
+    for (int64 i = 0; i < outputs[2].NumElements(); ++i) {
+      exported[outputs[2].flat<int64>()(i)] = outputs[3].flat<float>()(i);
+    }
+    EXPECT_EQ(exported.size(), outputs[1].scalar<int64>()());
+    std::map<int64, float> inserted;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      inserted[keys[i]] = values[i];
+    }
+    EXPECT_EQ(inserted, exported);
+
+    if (expected.empty()) {
+      expected = outputs;
+    } else {
+      test::ExpectTensorEqual<float>(expected[0], outputs[0]);
+      test::ExpectTensorEqual<int64>(expected[1], outputs[1]);
+    }
+  }
+}
+
+// "num_finds" LookupTableFindV2 ops, each looking up 1000 keys, run
+// concurrently against one table holding 100000 entries.
+void BM_LookupTableFind(int iters, int num_finds, TableType type) {
+  testing::StopTiming();
+  const int kNumEntries = 100000;
+  const int kKeysPerFind = 1000;
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<int64> keys;
+  std::vector<float> values;
+  for (int i = 0; i < kNumEntries; ++i) {
+    keys.push_back(i);
+    values.push_back(i);
+  }
+
+  Graph g(OpRegistry::Global());
+  Node* table = Table(&g, type);
+  Node* insert = Insert(&g, table, type, keys, values);
+  std::vector<string> targets;
+  for (int i = 0; i < num_finds; ++i) {
+    // Roughly one lookup in ten misses.
+    Node* find = Find(&g, table, type,
+                      RandomKeys(&rnd, kKeysPerFind, kNumEntries * 11 / 10));
+    targets.push_back(find->name());
+  }
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+  SessionOptions opts;
+  opts.config.set_inter_op_parallelism_threads(num_finds);
+  std::unique_ptr<Session> session(NewSession(opts));
+  TF_CHECK_OK(session->Create(gd));
+  TF_CHECK_OK(session->Run({}, {}, {insert->name()}, nullptr));
+  TF_CHECK_OK(session->Run({}, {}, targets, nullptr));
+
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(session->Run({}, {}, targets, nullptr));
+  }
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_finds *
+                          kKeysPerFind);
+}
+
+void BM_MutableHashTableFind(int iters, int num_finds) {
+  BM_LookupTableFind(iters, num_finds, TableType::kHashTable);
+}
+void BM_MutableHashTableOfTensorsFind(int iters, int num_finds) {
+  BM_LookupTableFind(iters, num_finds, TableType::kHashTableOfTensors);
+}
+void BM_MutableDenseHashTableFind(int iters, int num_finds) {
+  BM_LookupTableFind(iters, num_finds, TableType::kDenseHashTable);
+}
+void BM_MutableStripedHashTableFind(int iters, int num_finds) {
+  BM_LookupTableFind(iters, num_finds, TableType::kStripedHashTable);
+}
+
+BENCHMARK(BM_MutableHashTableFind)->Arg(1)->Arg(8)->Arg(32);
+BENCHMARK(BM_MutableHashTableOfTensorsFind)->Arg(1)->Arg(8)->Arg(32);
+BENCHMARK(BM_MutableDenseHashTableFind)->Arg(1)->Arg(8)->Arg(32);
+BENCHMARK(BM_MutableStripedHashTableFind)->Arg(1)->Arg(8)->Arg(32);
+
+}  // namespace
+}  // namespace tensorflow
@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace {
@@ -482,5 +483,35 @@ static Graph* RollGraph(const TensorShape& shape, int isd) {
 
 BM_ROLL_OUTER(cpu);
 BM_ROLL_ALL(cpu);
+
+// The same as BM_cpu_roll_outer and BM_cpu_roll_all, with adaptive sharding.
+static void BM_cpu_roll_adaptive(int iters, int rows, int columns, int isd) {
+  TensorShape shape{rows, columns};
+  const int64 num_items = static_cast<int64>(iters) * shape.num_elements();
+  testing::ItemsProcessed(num_items);
+  testing::BytesProcessed(num_items * sizeof(float));
+  testing::UseRealTime();
+  SetAdaptiveShardingEnabled(true);
+  test::Benchmark("cpu", RollGraph(shape, isd)).Run(iters);
+  SetAdaptiveShardingEnabled(false);
+}
+
+static void BM_cpu_roll_outer_adaptive(int iters, int rows, int columns) {
+  BM_cpu_roll_adaptive(iters, rows, columns, 0);
+}
+BENCHMARK(BM_cpu_roll_outer_adaptive)
+    ->ArgPair(256, 256)
+    ->ArgPair(512, 512)
+    ->ArgPair(1024, 1024)
+    ->ArgPair(2048, 2048);
+
+static void BM_cpu_roll_all_adaptive(int iters, int rows, int columns) {
+  BM_cpu_roll_adaptive(iters, rows, columns, 1);
+}
+BENCHMARK(BM_cpu_roll_all_adaptive)
+    ->ArgPair(256, 256)
+    ->ArgPair(512, 512)
+    ->ArgPair(1024, 1024)
+    ->ArgPair(2048, 2048);
 }  // namespace
 }  // namespace tensorflow
@@ -0,0 +1,297 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/parallel_record_reader.h"
+
+#include <limits.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace io {
+
+namespace {
+
+const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+const size_t kFooterSize = sizeof(uint32);
+
+// Returns true if the last 4 bytes of "data" are the masked checksum of the
+// bytes before them.
+bool ChecksumMatches(StringPiece data) {
+  const size_t n = data.size() - sizeof(uint32);
+  const uint32 masked_crc = core::DecodeFixed32(data.data() + n);
+  return crc32c::Unmask(masked_crc) == crc32c::Value(data.data(), n);
+}
+
+}  // namespace
+
+struct ParallelRecordReader::Range {
+  Range(uint64 start, uint64 limit, bool known_start)
+      : start(start), limit(limit), known_start(known_start) {}
+
+  // The range holds the records whose headers start in [start, limit).
+  const uint64 start;
+  const uint64 limit;
+  // True if a record starts at "start", so there is no need to scan for it.
+  const bool known_start;
+
+  // The results of ParseRange(), which are only read once "done" is set.
+  bool done = false;  // Guarded by the reader's mu_.
+  uint64 first_offset = 0;  // The offset of the first record, if any.
+  std::vector<StringPiece> records;
+  Status status;  // The error that ends the records, if any.
+
+  string buffer;  // The bytes of [start, limit).
+  // Records that extend past "buffer".
+  std::deque<string> copies;
+};
+
+ParallelRecordReader::ParallelRecordReader(
+    RandomAccessFile* file, uint64 file_size, uint64 offset,
+    const ParallelRecordReaderOptions& options, thread::ThreadPool* pool)
+    : file_(file),
+      file_size_(file_size),
+      options_(options),
+      pool_(pool),
+      start_offset_(offset),
+      offset_(offset),
+      next_range_start_(offset) {
+  mutex_lock l(mu_);
+  num_parallel_reads_ = options.num_parallel_reads;
+  ScheduleRangesLocked();
+}
+
+ParallelRecordReader::~ParallelRecordReader() {
+  mutex_lock l(mu_);
+  cancelled_ = true;
+  while (num_running_ > 0) {
+    cond_var_.wait(l);
+  }
+}
+
+Status ParallelRecordReader::ReadRecord(StringPiece* record) {
+  while (true) {
+    if (current_ != nullptr) {
+      if (next_record_ < current_->records.size()) {
+        *record = current_->records[next_record_++];
+        offset_ += kHeaderSize + record->size() + kFooterSize;
+        return Status::OK();
+      }
+      if (!current_->status.ok()) {
+        return current_->status;
+      }
+      current_.reset();
+    }
+
+    std::shared_ptr<Range> range;
+    {
+      mutex_lock l(mu_);
+      if (ranges_.empty()) {
+        return errors::OutOfRange("eof");
+      }
+      range = ranges_.front();
+      ranges_.pop_front();
+      ScheduleRangesLocked();
+      while (!range->done) {
+        cond_var_.wait(l);
+      }
+    }
+    if (offset_ >= range->limit) {
+      // The last record of an earlier range covers this one.
+      continue;
+    }
+    if (range->first_offset != offset_) {
+      // The scan took bytes inside a record for its first record, so parse
+      // the range again from where the previous range ends.
+      range = std::make_shared<Range>(offset_, range->limit, true);
+      ParseRange(range.get());
+    }
+    current_ = std::move(range);
+    next_record_ = 0;
+  }
+}
+
+Status ParallelRecordReader::ReadRecord(string* record) {
+  StringPiece piece;
+  TF_RETURN_IF_ERROR(ReadRecord(&piece));
+  record->assign(piece.data(), piece.size());
+  return Status::OK();
+}
+
+int64 ParallelRecordReader::NumRangesAhead(bool* all_scheduled) {
+  mutex_lock l(mu_);
+  *all_scheduled = next_range_start_ >= file_size_;
+  return ranges_.size();
+}
+
+void ParallelRecordReader::SetNumParallelReads(int64 num_parallel_reads) {
+  mutex_lock l(mu_);
+  num_parallel_reads_ = num_parallel_reads;
+  ScheduleRangesLocked();
+}
+
+void ParallelRecordReader::ScheduleRangesLocked() {
+  while (!cancelled_ &&
+         ranges_.size() < static_cast<size_t>(num_parallel_reads_) &&
+         next_range_start_ < file_size_) {
+    const uint64 start = next_range_start_;
+    const uint64 limit =
+        std::min<uint64>(file_size_, start + options_.range_size);
+    next_range_start_ = limit;
+    std::shared_ptr<Range> range =
+        std::make_shared<Range>(start, limit, start == start_offset_);
+    ranges_.push_back(range);
+    ++num_running_;
+    pool_->Schedule([this, range]() {
+      bool cancelled;
+      {
+        mutex_lock l(mu_);
+        cancelled = cancelled_;
+      }
+      if (!cancelled) {
+        ParseRange(range.get());
+      }
+      mutex_lock l(mu_);
+      range->done = true;
+      --num_running_;
+      cond_var_.notify_all();
+    });
+  }
+}
+
+void ParallelRecordReader::ParseRange(Range* range) {
+  const size_t n = range->limit - range->start;
+  range->buffer.resize(n);
+  StringPiece data;
+  Status s = file_->Read(range->start, n, &data, &range->buffer[0]);
+  if (data.data() == range->buffer.data()) {
+    range->buffer.resize(data.size());
+  } else {
+    range->buffer.assign(data.data(), data.size());
+  }
+  if (!s.ok() && !errors::IsOutOfRange(s)) {
+    range->first_offset = range->known_start ? range->start : range->limit;
+    range->status = s;
+    return;
+  }
+
+  uint64 offset = range->start;
+  if (!range->known_start) {
+    while (offset < range->limit && ProbeRecord(*range, offset) < 0) {
+      ++offset;
+    }
+  }
+  range->first_offset = offset;
+
+  s = Status::OK();
+  string scratch;
+  while (offset < range->limit) {
+    StringPiece header;
+    s = ReadBytes(*range, offset, kHeaderSize, &scratch, &header);
+    if (errors::IsOutOfRange(s)) {
+      if (header.empty()) {
+        s = errors::OutOfRange("eof");
+      } else {
+        s = errors::DataLoss("truncated record at ", offset);
+      }
+    }
+    if (!s.ok()) break;
+    if (!ChecksumMatches(header)) {
+      s = errors::DataLoss("corrupted record at ", offset);
+      break;
+    }
+    const uint64 length = core::DecodeFixed64(header.data());
+    if (length >= SIZE_MAX - kFooterSize) {
+      s = errors::DataLoss("record size too large");
+      break;
+    }
+    const uint64 end = offset + kHeaderSize + length + kFooterSize;
+    if (end > file_size_ || end < offset) {
+      s = errors::DataLoss("truncated record at ", offset);
+      break;
+    }
+
+    StringPiece data;
+    s = ReadBytes(*range, offset + kHeaderSize, length + kFooterSize,
+                  &scratch, &data);
+    if (errors::IsOutOfRange(s)) {
+      s = errors::DataLoss("truncated record at ", offset);
+    }
+    if (!s.ok()) break;
+    if (!ChecksumMatches(data)) {
+      s = errors::DataLoss("corrupted record at ", offset + kHeaderSize);
+      break;
+    }
+    if (data.data() == scratch.data()) {
+      // The record extends past the range, so keep the copy.
+      range->copies.push_back(std::move(scratch));
+      scratch.clear();
+      data = range->copies.back();
+    }
+    range->records.emplace_back(data.data(), length);
+    offset = end;
+  }
+  range->status = s;
+}
+
+Status ParallelRecordReader::ReadBytes(const Range& range, uint64 offset,
+                                       size_t n, string* scratch,
+                                       StringPiece* result) {
+  if (offset >= range.start && offset - range.start <= range.buffer.size() &&
+      n <= range.buffer.size() - (offset - range.start)) {
+    *result = StringPiece(range.buffer.data() + (offset - range.start), n);
+    return Status::OK();
+  }
+  scratch->resize(n);
+  Status s = file_->Read(offset, n, result, &(*scratch)[0]);
+  if (result->data() == scratch->data()) {
+    scratch->resize(result->size());
+  } else {
+    scratch->assign(result->data(), result->size());
+  }
+  *result = *scratch;
+  return s;
+}
+
+int64 ParallelRecordReader::ProbeRecord(const Range& range, uint64 offset) {
+  string scratch;
+  StringPiece header;
+  if (!ReadBytes(range, offset, kHeaderSize, &scratch, &header).ok() ||
+      !ChecksumMatches(header)) {
+    return -1;
+  }
+  const uint64 length = core::DecodeFixed64(header.data());
+  if (length > file_size_ - offset ||
+      file_size_ - offset - length < kHeaderSize + kFooterSize) {
+    return -1;
+  }
+  StringPiece data;
+  if (!ReadBytes(range, offset + kHeaderSize, length + kFooterSize, &scratch,
+                 &data)
+           .ok() ||
+      !ChecksumMatches(data)) {
+    return -1;
+  }
+  return length;
+}
+
+}  // namespace io
+}  // namespace tensorflow
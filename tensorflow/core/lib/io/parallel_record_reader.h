@@ -0,0 +1,147 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LIB_IO_PARALLEL_RECORD_READER_H_
+#define TENSORFLOW_LIB_IO_PARALLEL_RECORD_READER_H_
+
+#include <deque>
+#include <memory>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+class RandomAccessFile;
+
+namespace io {
+
+class ParallelRecordReaderOptions {
+ public:
+  // The maximum number of ranges that are read and parsed concurrently ahead
+  // of the consumer.
+  int64 num_parallel_reads = 4;
+
+  // The size in bytes of the ranges into which the file is split. About
+  // (num_parallel_reads + 1) * range_size bytes of the file are held in
+  // memory.
+  int64 range_size = 16 << 20;
+};
+
+// Reads the records of an uncompressed TFRecord file on several threads.
+//
+// The file is split into byte ranges of "range_size" bytes, which are read,
+// split into records and checksummed on a thread pool, with up to
+// "num_parallel_reads" ranges in flight ahead of the consumer. A range holds
+// the records whose headers start in it. As the first of them is not known
+// in advance, a range is scanned for the first offset with valid header and
+// data checksums. By the time the consumer reaches a range, the offset of its
+// first record is known from the range before it; if the scan guessed wrong
+// (e.g. because a record contains TFRecords itself), the range is parsed
+// again from that offset. Records are thus returned in file order, with the
+// same results and errors as SequentialRecordReader.
+//
+// A reader only reads one file. Callers that read several files can keep the
+// reads going across files with NumRangesAhead() and SetNumParallelReads(),
+// by opening the next file while the ranges of the current one finish.
+//
+// Note: this class is not thread safe; external synchronization required.
+class ParallelRecordReader {
+ public:
+  // Create a reader that will return the records of "*file", whose size is
+  // "file_size", starting at the record at "offset". The work is scheduled on
+  // "*pool". "*file" and "*pool" must remain live while this reader is in
+  // use.
+  ParallelRecordReader(RandomAccessFile* file, uint64 file_size,
+                       uint64 offset,
+                       const ParallelRecordReaderOptions& options,
+                       thread::ThreadPool* pool);
+
+  // Waits for the ranges that are still being read.
+  ~ParallelRecordReader();
+
+  // Points *record at the contents of the next record in the file, which
+  // remain valid until the next call on this reader. Returns OK on success,
+  // OUT_OF_RANGE for end of file, or something else for an error.
+  Status ReadRecord(StringPiece* record);
+
+  // Same as above, but copies the next record into *record.
+  Status ReadRecord(string* record);
+
+  // Returns the offset of the record that the next ReadRecord() call
+  // returns.
+  uint64 TellOffset() const { return offset_; }
+
+  // Returns the number of ranges that are read or being read ahead of the
+  // consumer, and sets *all_scheduled to whether the last range of the file
+  // is among those scheduled so far.
+  int64 NumRangesAhead(bool* all_scheduled);
+
+  // Changes the maximum number of ranges read ahead of the consumer, which
+  // starts at "options.num_parallel_reads".
+  void SetNumParallelReads(int64 num_parallel_reads);
+
+ private:
+  struct Range;
+
+  // Schedules the parsing of the next ranges, up to "num_parallel_reads".
+  void ScheduleRangesLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Fills in the records and the status of "*range".
+  void ParseRange(Range* range);
+
+  // Points *result at the "n" bytes of the file at "offset", which are either
+  // in the buffer of "range" or read into *scratch. Returns OUT_OF_RANGE,
+  // with *result holding the remaining bytes, if the file ends before "n"
+  // bytes.
+  Status ReadBytes(const Range& range, uint64 offset, size_t n,
+                   string* scratch, StringPiece* result);
+
+  // Returns the length of the record at "offset" if its header and data
+  // checksums match, or -1 otherwise.
+  int64 ProbeRecord(const Range& range, uint64 offset);
+
+  RandomAccessFile* const file_;
+  const uint64 file_size_;
+  const ParallelRecordReaderOptions options_;
+  thread::ThreadPool* const pool_;
+  const uint64 start_offset_;
+
+  // Only accessed by the consumer.
+  uint64 offset_;
+  std::shared_ptr<Range> current_;
+  size_t next_record_ = 0;
+
+  mutex mu_;
+  condition_variable cond_var_;
+  bool cancelled_ GUARDED_BY(mu_) = false;
+  int64 num_parallel_reads_ GUARDED_BY(mu_);
+  int64 num_running_ GUARDED_BY(mu_) = 0;
+  // Ranges in file order, including those still being parsed.
+  std::deque<std::shared_ptr<Range>> ranges_ GUARDED_BY(mu_);
+  uint64 next_range_start_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ParallelRecordReader);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_PARALLEL_RECORD_READER_H_
@@ -0,0 +1,279 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/parallel_record_reader.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+// Returns the contents of a TFRecord file that holds "records".
+string MakeRecords(const std::vector<string>& records) {
+  const string fname = strings::StrCat(testing::TmpDir(), "/records_tmp");
+  std::unique_ptr<WritableFile> file;
+  TF_CHECK_OK(Env::Default()->NewWritableFile(fname, &file));
+  RecordWriter writer(file.get());
+  for (const string& record : records) {
+    TF_CHECK_OK(writer.WriteRecord(record));
+  }
+  TF_CHECK_OK(writer.Close());
+  TF_CHECK_OK(file->Close());
+  string contents;
+  TF_CHECK_OK(ReadFileToString(Env::Default(), fname, &contents));
+  return contents;
+}
+
+class ParallelRecordReaderTest : public ::testing::Test {
+ protected:
+  ParallelRecordReaderTest()
+      : fname_(strings::StrCat(testing::TmpDir(), "/parallel_records")),
+        pool_(Env::Default(), "test", 4) {}
+
+  void WriteFile(const string& contents) {
+    TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname_, contents));
+    size_ = contents.size();
+  }
+
+  // Reads the records from "offset" on, and returns the status that ends
+  // them.
+  Status ReadAll(uint64 offset, int64 num_parallel_reads, int64 range_size,
+                 std::vector<string>* records) {
+    std::unique_ptr<RandomAccessFile> file;
+    TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(fname_, &file));
+    ParallelRecordReaderOptions options;
+    options.num_parallel_reads = num_parallel_reads;
+    options.range_size = range_size;
+    ParallelRecordReader reader(file.get(), size_, offset, options, &pool_);
+    records->clear();
+    while (true) {
+      const uint64 record_offset = reader.TellOffset();
+      string record;
+      Status s = reader.ReadRecord(&record);
+      if (!s.ok()) {
+        EXPECT_EQ(record_offset, reader.TellOffset());
+        return s;
+      }
+      records->push_back(record);
+    }
+  }
+
+  const string fname_;
+  uint64 size_ = 0;
+  thread::ThreadPool pool_;
+};
+
+TEST_F(ParallelRecordReaderTest, Empty) {
+  WriteFile("");
+  std::vector<string> records;
+  EXPECT_TRUE(errors::IsOutOfRange(ReadAll(0, 4, 16, &records)));
+  EXPECT_TRUE(records.empty());
+}
+
+TEST_F(ParallelRecordReaderTest, MatchesWrittenRecords) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<string> expected;
+  for (int i = 0; i < 500; ++i) {
+    // Some records span several ranges.
+    const int size = i % 50 == 0 ? 5000 : rnd.Uniform(200);
+    expected.push_back(string(size, 'a' + i % 26));
+  }
+  WriteFile(MakeRecords(expected));
+  for (int64 num_parallel_reads : {1, 3, 8}) {
+    for (int64 range_size : {64, 1000, 1 << 20}) {
+      std::vector<string> records;
+      EXPECT_TRUE(errors::IsOutOfRange(
+          ReadAll(0, num_parallel_reads, range_size, &records)));
+      EXPECT_EQ(expected, records)
+          << num_parallel_reads << " " << range_size;
+    }
+  }
+}
+
+TEST_F(ParallelRecordReaderTest, RecordsThatContainRecords) {
+  // The scan for the first record of a range finds the records inside the
+  // outer records, which the reader must skip.
+  std::vector<string> inner;
+  for (int i = 0; i < 20; ++i) {
+    inner.push_back(strings::StrCat("inner record ", i));
+  }
+  std::vector<string> expected;
+  for (int i = 0; i < 20; ++i) {
+    expected.push_back(MakeRecords(inner));
+  }
+  WriteFile(MakeRecords(expected));
+  for (int64 range_size : {7, 64, 500}) {
+    std::vector<string> records;
+    EXPECT_TRUE(errors::IsOutOfRange(ReadAll(0, 4, range_size, &records)));
+    EXPECT_EQ(expected, records) << range_size;
+  }
+}
+
+TEST_F(ParallelRecordReaderTest, StartsAtOffset) {
+  WriteFile(MakeRecords({"foo", "bar", "baz"}));
+  // Each record takes 12 + 3 + 4 bytes.
+  std::vector<string> records;
+  EXPECT_TRUE(errors::IsOutOfRange(ReadAll(19, 2, 8, &records)));
+  EXPECT_EQ(std::vector<string>({"bar", "baz"}), records);
+  EXPECT_TRUE(errors::IsOutOfRange(ReadAll(57, 2, 8, &records)));
+  EXPECT_TRUE(records.empty());
+}
+
+TEST_F(ParallelRecordReaderTest, CorruptData) {
+  string contents = MakeRecords({"foo", "bar", "baz"});
+  contents[19 + 12] ^= 1;
+  WriteFile(contents);
+  for (int64 range_size : {5, 1 << 20}) {
+    std::vector<string> records;
+    Status s = ReadAll(0, 4, range_size, &records);
+    EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+    EXPECT_TRUE(str_util::StrContains(s.error_message(),
+                                      "corrupted record at 31"))
+        << s;
+    EXPECT_EQ(std::vector<string>({"foo"}), records);
+  }
+}
+
+TEST_F(ParallelRecordReaderTest, CorruptHeader) {
+  string contents = MakeRecords({"foo", "bar", "baz"});
+  contents[19] ^= 1;
+  WriteFile(contents);
+  for (int64 range_size : {5, 1 << 20}) {
+    std::vector<string> records;
+    Status s = ReadAll(0, 4, range_size, &records);
+    EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+    EXPECT_TRUE(
+        str_util::StrContains(s.error_message(), "corrupted record at 19"))
+        << s;
+    EXPECT_EQ(std::vector<string>({"foo"}), records);
+  }
+}
+
+TEST_F(ParallelRecordReaderTest, Truncated) {
+  string contents = MakeRecords({"foo", "bar"});
+  contents.resize(contents.size() - 2);
+  WriteFile(contents);
+  for (int64 range_size : {5, 1 << 20}) {
+    std::vector<string> records;
+    Status s = ReadAll(0, 4, range_size, &records);
+    EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+    EXPECT_TRUE(str_util::StrContains(s.error_message(), "truncated record"))
+        << s;
+    EXPECT_EQ(std::vector<string>({"foo"}), records);
+  }
+}
+
+TEST_F(ParallelRecordReaderTest, SetNumParallelReads) {
+  std::vector<string> expected;
+  for (int i = 0; i < 100; ++i) {
+    expected.push_back(strings::StrCat("record ", i));
+  }
+  WriteFile(MakeRecords(expected));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname_, &file));
+  ParallelRecordReaderOptions options;
+  options.num_parallel_reads = 1;
+  options.range_size = 64;
+  ParallelRecordReader reader(file.get(), size_, 0, options, &pool_);
+  bool all_scheduled;
+  EXPECT_EQ(1, reader.NumRangesAhead(&all_scheduled));
+  EXPECT_FALSE(all_scheduled);
+  reader.SetNumParallelReads(1000);
+  EXPECT_EQ((size_ + 63) / 64, reader.NumRangesAhead(&all_scheduled));
+  EXPECT_TRUE(all_scheduled);
+  std::vector<string> records;
+  string record;
+  while (reader.ReadRecord(&record).ok()) {
+    records.push_back(record);
+  }
+  EXPECT_EQ(expected, records);
+  EXPECT_EQ(0, reader.NumRangesAhead(&all_scheduled));
+}
+
+// Reads a file of about 2GB worth of "record_size" byte records with
+// SequentialRecordReader if "num_parallel_reads" is 0, or with
+// ParallelRecordReader otherwise. Set TEST_TMPDIR to a directory on the
+// device to measure.
+void BM_ReadRecords(int iters, int record_size, int num_parallel_reads) {
+  testing::StopTiming();
+  Env* env = Env::Default();
+  const string fname = strings::StrCat(testing::TmpDir(),
+                                       "/parallel_record_reader_bm_",
+                                       record_size);
+  const int64 num_records = (2LL << 30) / record_size;
+  if (!env->FileExists(fname).ok()) {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    RecordWriter writer(file.get());
+    const string record(record_size, 'x');
+    for (int64 i = 0; i < num_records; ++i) {
+      TF_CHECK_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Close());
+    TF_CHECK_OK(file->Close());
+  }
+  uint64 file_size;
+  TF_CHECK_OK(env->GetFileSize(fname, &file_size));
+  thread::ThreadPool pool(env, "bench", std::max(1, num_parallel_reads));
+  ParallelRecordReaderOptions options;
+  options.num_parallel_reads = num_parallel_reads;
+  testing::BytesProcessed(static_cast<int64>(iters) * file_size);
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    std::unique_ptr<RandomAccessFile> file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+    StringPiece record;
+    if (num_parallel_reads == 0) {
+      SequentialRecordReader reader(file.get());
+      for (int64 j = 0; j < num_records; ++j) {
+        TF_CHECK_OK(reader.ReadRecord(&record));
+      }
+    } else {
+      ParallelRecordReader reader(file.get(), file_size, 0, options, &pool);
+      for (int64 j = 0; j < num_records; ++j) {
+        TF_CHECK_OK(reader.ReadRecord(&record));
+      }
+    }
+  }
+  testing::StopTiming();
+}
+BENCHMARK(BM_ReadRecords)
+    ->ArgPair(1 << 10, 0)
+    ->ArgPair(1 << 10, 1)
+    ->ArgPair(1 << 10, 4)
+    ->ArgPair(1 << 10, 16)
+    ->ArgPair(100 << 10, 0)
+    ->ArgPair(100 << 10, 1)
+    ->ArgPair(100 << 10, 4)
+    ->ArgPair(100 << 10, 16);
+
+}  // namespace
+}  // namespace io
+}  // namespace tensorflow
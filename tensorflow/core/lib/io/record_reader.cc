@@ -17,13 +17,22 @@ limitations under the License.
 
 #include <limits.h>
 
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 namespace io {
@@ -54,11 +63,393 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
   return options;
 }
 
+namespace {
+
+const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+const size_t kFooterSize = sizeof(uint32);
+
+// Returns true if the last 4 bytes of "data" are the masked checksum of the
+// bytes before them.
+bool ChecksumMatches(StringPiece data) {
+  const size_t n = data.size() - sizeof(uint32);
+  const uint32 masked_crc = core::DecodeFixed32(data.data() + n);
+  return crc32c::Unmask(masked_crc) == crc32c::Value(data.data(), n);
+}
+
+// The threads that read ahead for all RecordReaders. The reads mostly wait
+// for I/O, so small machines get more threads than cores.
+thread::ThreadPool* ReadAheadPool() {
+  static thread::ThreadPool* pool = new thread::ThreadPool(
+      Env::Default(), "record_read_ahead",
+      std::max(16, port::NumSchedulableCPUs()));
+  return pool;
+}
+
+}  // namespace
+
+// Reads a TFRecord file ahead of its consumer, starting at a given offset.
+//
+// Blocks of the file are read on ReadAheadPool() with up to "num_blocks"
+// reads in flight. A parsing task, also on the pool, takes the blocks in file
+// order and splits them into batches of records, and each batch has its
+// checksums verified by a task of its own, so that the checksums of a file
+// are computed on several threads. Records that lie within one block point
+// into that block; only records that straddle a block boundary are copied.
+// The consumer takes the verified batches in file order, and the batches
+// waiting for it hold at most about "num_blocks" blocks worth of records, so
+// a slow consumer stalls the parsing and the reads.
+//
+// The first error (including the end of the file) ends the last batch and
+// the read-ahead.
+class RecordReadAhead {
+ public:
+  RecordReadAhead(RandomAccessFile* file, uint64 offset, int64 num_blocks,
+                  int64 block_size)
+      : file_(file),
+        num_blocks_(num_blocks),
+        block_size_(block_size),
+        max_queued_bytes_(num_blocks * block_size),
+        offset_(offset),
+        parse_offset_(offset),
+        parse_batch_(std::make_shared<Batch>()),
+        read_offset_(offset) {
+    mutex_lock l(mu_);
+    ScheduleReadsLocked();
+  }
+
+  ~RecordReadAhead() {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    // Waits for the reads and tasks that are still running.
+    while (num_tasks_ > 0) {
+      cond_var_.wait(l);
+    }
+  }
+
+  // Returns the offset of the record that the next GetNext() call returns.
+  uint64 offset() const { return offset_; }
+
+  // Points *record at the next record in the file. *record remains valid
+  // until the next call.
+  Status GetNext(StringPiece* record) {
+    while (batch_ == nullptr || next_record_ == batch_->records.size()) {
+      if (batch_ != nullptr && !batch_->status.ok()) {
+        return batch_->status;
+      }
+      mutex_lock l(mu_);
+      while (batches_.empty() || !batches_.front()->verified) {
+        cond_var_.wait(l);
+      }
+      batch_ = std::move(batches_.front());
+      batches_.pop_front();
+      next_record_ = 0;
+      queued_bytes_ -= batch_->bytes;
+      MaybeStartParsingLocked();
+    }
+    const Record& next = batch_->records[next_record_++];
+    *record = next.data;
+    offset_ += kHeaderSize + next.data.size() + kFooterSize;
+    return Status::OK();
+  }
+
+ private:
+  typedef std::shared_ptr<const string> Buffer;
+
+  struct Block {
+    Buffer data;
+    Status status;
+    bool done = false;
+  };
+
+  struct Record {
+    Buffer buffer;  // Owns the memory "data" points into.
+    // Followed by the checksum of the data in "buffer".
+    StringPiece data;
+    uint64 offset;
+  };
+
+  // Consecutive records of the file. "status" follows the records.
+  struct Batch {
+    std::vector<Record> records;
+    Status status;
+    size_t bytes = 0;
+    bool verified = false;
+  };
+
+  // The outcome of Gather().
+  enum GatherResult { kGathered, kNeedBlock, kEnd };
+
+  // Schedules "fn" on ReadAheadPool(). The destructor waits for it to end.
+  void ScheduleLocked(std::function<void()> fn) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    ++num_tasks_;
+    ReadAheadPool()->Schedule([this, fn]() {
+      fn();
+      mutex_lock l(mu_);
+      if (--num_tasks_ == 0) {
+        cond_var_.notify_all();
+      }
+    });
+  }
+
+  // Keeps "num_blocks_" reads ahead of the parsing.
+  void ScheduleReadsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    while (!saw_end_ && blocks_.size() < static_cast<size_t>(num_blocks_)) {
+      std::shared_ptr<Block> block = std::make_shared<Block>();
+      blocks_.push_back(block);
+      const uint64 offset = read_offset_;
+      read_offset_ += block_size_;
+      ScheduleLocked([this, block, offset]() { Read(block.get(), offset); });
+    }
+  }
+
+  void Read(Block* block, uint64 offset) {
+    {
+      mutex_lock l(mu_);
+      if (cancelled_) return;
+    }
+    std::unique_ptr<string> data(new string(block_size_, '\0'));
+    StringPiece result;
+    Status s = file_->Read(offset, block_size_, &result, &(*data)[0]);
+    if (result.data() == data->data()) {
+      data->resize(result.size());
+    } else {
+      data->assign(result.data(), result.size());
+    }
+    mutex_lock l(mu_);
+    block->data = std::move(data);
+    block->status = s;
+    block->done = true;
+    MaybeStartParsingLocked();
+  }
+
+  // Starts the parsing task unless it is running, done, or has no room to
+  // queue records. The task stops itself when it needs a block that has not
+  // been read yet, so this is called whenever a read ends or the consumer
+  // takes a batch.
+  void MaybeStartParsingLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (parsing_ || parse_done_ || cancelled_ || QueueFullLocked()) return;
+    parsing_ = true;
+    ScheduleLocked([this]() { Parse(); });
+  }
+
+  bool QueueFullLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return queued_bytes_ >= max_queued_bytes_;
+  }
+
+  // Runs while "parsing_" is set, so that the parsing state below is only
+  // accessed by one task at a time. Splits records until it needs a block
+  // that has not been read yet, the queue is full, or the read-ahead ends.
+  void Parse() {
+    while (true) {
+      Status status;
+      const GatherResult result = ParseRecord(&status);
+      if (result == kEnd) {
+        parse_batch_->status = status;
+        mutex_lock l(mu_);
+        parse_done_ = true;
+        parsing_ = false;
+        QueueBatchLocked();
+        return;
+      }
+      if (result == kNeedBlock || parse_batch_->bytes >= block_size_) {
+        mutex_lock l(mu_);
+        if (!parse_batch_->records.empty()) QueueBatchLocked();
+        if (cancelled_ || QueueFullLocked() ||
+            (result == kNeedBlock && !blocks_.front()->done)) {
+          parsing_ = false;
+          return;
+        }
+      }
+    }
+  }
+
+  // Splits off the record at the parsing cursor into "parse_batch_", or
+  // returns kEnd with *status set to why the read-ahead ends.
+  GatherResult ParseRecord(Status* status) {
+    if (!parse_in_data_) {
+      StringPiece header;
+      Buffer header_buffer;
+      const GatherResult result =
+          Gather(kHeaderSize, &header, &header_buffer, status);
+      if (result == kEnd && errors::IsOutOfRange(*status) && !header.empty()) {
+        *status = errors::DataLoss("truncated record at ", parse_offset_);
+      }
+      if (result != kGathered) return result;
+      if (!ChecksumMatches(header)) {
+        *status = errors::DataLoss("corrupted record at ", parse_offset_);
+        return kEnd;
+      }
+      parse_length_ = core::DecodeFixed64(header.data());
+      if (parse_length_ >= SIZE_MAX - kFooterSize) {
+        *status = errors::DataLoss("record size too large");
+        return kEnd;
+      }
+      parse_in_data_ = true;
+    }
+    Record record;
+    StringPiece data;
+    const GatherResult result =
+        Gather(parse_length_ + kFooterSize, &data, &record.buffer, status);
+    if (result == kEnd && errors::IsOutOfRange(*status)) {
+      *status = errors::DataLoss(
+          "truncated record at ",
+          data.empty() ? parse_offset_ : parse_offset_ + kHeaderSize);
+    }
+    if (result != kGathered) return result;
+    parse_in_data_ = false;
+    record.data = StringPiece(data.data(), parse_length_);
+    record.offset = parse_offset_;
+    parse_offset_ += kHeaderSize + parse_length_ + kFooterSize;
+    parse_batch_->bytes += kHeaderSize + parse_length_ + kFooterSize;
+    parse_batch_->records.push_back(std::move(record));
+    return kGathered;
+  }
+
+  // Points *result at the next "n" bytes of the file and advances the
+  // cursor past them. The bytes stay valid as long as *buffer is alive.
+  // Returns kNeedBlock if they are not all read yet; the next call with the
+  // same "n" continues where this one stopped. Returns kEnd with *status
+  // set, and *result holding the remaining bytes, if the file ends (with
+  // OUT_OF_RANGE) or a read fails before "n" bytes.
+  GatherResult Gather(size_t n, StringPiece* result, Buffer* buffer,
+                      Status* status) {
+    while (true) {
+      if (block_ == nullptr || block_pos_ == block_->size()) {
+        const GatherResult next = NextBlock(status);
+        if (next == kEnd) {
+          *result = straddle_ == nullptr ? StringPiece() : *straddle_;
+        }
+        if (next != kGathered) return next;
+      }
+      const size_t available = block_->size() - block_pos_;
+      if (straddle_ == nullptr && available >= n) {
+        *result = StringPiece(block_->data() + block_pos_, n);
+        *buffer = block_;
+        block_pos_ += n;
+        return kGathered;
+      }
+      // The bytes straddle a block boundary, so copy them.
+      if (straddle_ == nullptr) {
+        straddle_ = std::make_shared<string>();
+        straddle_->reserve(n);
+      }
+      const size_t m = std::min(n - straddle_->size(), available);
+      straddle_->append(block_->data() + block_pos_, m);
+      block_pos_ += m;
+      if (straddle_->size() == n) {
+        *result = StringPiece(*straddle_);
+        *buffer = std::move(straddle_);
+        straddle_.reset();
+        return kGathered;
+      }
+    }
+  }
+
+  // Moves the cursor to the start of the next block if it has been read.
+  GatherResult NextBlock(Status* status) {
+    block_.reset();
+    block_pos_ = 0;
+    mutex_lock l(mu_);
+    if (blocks_.empty()) {
+      *status = errors::OutOfRange("eof");
+      return kEnd;
+    }
+    std::shared_ptr<Block> block = blocks_.front();
+    if (!block->done) {
+      return kNeedBlock;
+    }
+    blocks_.pop_front();
+    // A short block marks the end of the file. Later reads are dropped.
+    if (!block->status.ok() || block->data->size() < block_size_) {
+      saw_end_ = true;
+      blocks_.clear();
+    }
+    ScheduleReadsLocked();
+    if (!block->status.ok() && !errors::IsOutOfRange(block->status)) {
+      *status = block->status;
+      return kEnd;
+    }
+    if (block->data->empty()) {
+      *status = errors::OutOfRange("eof");
+      return kEnd;
+    }
+    block_ = block->data;
+    return kGathered;
+  }
+
+  // Hands "parse_batch_" to a task that verifies its checksums.
+  void QueueBatchLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    std::shared_ptr<Batch> batch = std::move(parse_batch_);
+    parse_batch_ = std::make_shared<Batch>();
+    batches_.push_back(batch);
+    queued_bytes_ += batch->bytes;
+    ScheduleLocked([this, batch]() { Verify(batch.get()); });
+  }
+
+  // Ends "batch" at its first record with a bad checksum.
+  void Verify(Batch* batch) {
+    for (size_t i = 0; i < batch->records.size(); ++i) {
+      const Record& record = batch->records[i];
+      if (!ChecksumMatches(StringPiece(record.data.data(),
+                                       record.data.size() + kFooterSize))) {
+        batch->status = errors::DataLoss("corrupted record at ",
+                                         record.offset + kHeaderSize);
+        batch->records.resize(i);
+        break;
+      }
+    }
+    mutex_lock l(mu_);
+    batch->verified = true;
+    cond_var_.notify_all();
+  }
+
+  RandomAccessFile* const file_;
+  const int64 num_blocks_;
+  const size_t block_size_;
+  const size_t max_queued_bytes_;
+
+  // Only accessed by the consumer.
+  uint64 offset_;
+  std::shared_ptr<Batch> batch_;
+  size_t next_record_ = 0;
+
+  // Only accessed by the parsing task.
+  uint64 parse_offset_;
+  std::shared_ptr<Batch> parse_batch_;
+  bool parse_in_data_ = false;
+  uint64 parse_length_ = 0;
+  Buffer block_;
+  size_t block_pos_ = 0;
+  std::shared_ptr<string> straddle_;
+
+  mutex mu_;
+  condition_variable cond_var_;
+  bool cancelled_ GUARDED_BY(mu_) = false;
+  int num_tasks_ GUARDED_BY(mu_) = 0;
+  bool parsing_ GUARDED_BY(mu_) = false;
+  bool parse_done_ GUARDED_BY(mu_) = false;
+  // Batches in file order, including those still being verified.
+  std::deque<std::shared_ptr<Batch>> batches_ GUARDED_BY(mu_);
+  size_t queued_bytes_ GUARDED_BY(mu_) = 0;
+  // Reads in file order, including those still in flight.
+  std::deque<std::shared_ptr<Block>> blocks_ GUARDED_BY(mu_);
+  uint64 read_offset_ GUARDED_BY(mu_);
+  bool saw_end_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecordReadAhead);
+};
+
 RecordReader::RecordReader(RandomAccessFile* file,
                            const RecordReaderOptions& options)
-    : options_(options),
+    : file_(file),
+      options_(options),
       input_stream_(new RandomAccessInputStream(file)),
       last_read_failed_(false) {
+  if (options_.read_ahead_blocks > 0 &&
+      options_.compression_type != RecordReaderOptions::NONE) {
+    LOG(WARNING) << "Read-ahead is not supported for compressed records.";
+    options_.read_ahead_blocks = 0;
+  }
   if (options.buffer_size > 0) {
     input_stream_.reset(new BufferedInputStream(input_stream_.release(),
                                                 options.buffer_size, true));
@@ -108,9 +499,15 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n, string* result) {
   return Status::OK();
 }
 
+RecordReader::~RecordReader() = default;
+
 Status RecordReader::ReadRecord(uint64* offset, string* record) {
-  static const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
-  static const size_t kFooterSize = sizeof(uint32);
+  if (options_.read_ahead_blocks > 0) {
+    StringPiece piece;
+    TF_RETURN_IF_ERROR(ReadRecord(offset, &piece));
+    record->assign(piece.data(), piece.size());
+    return Status::OK();
+  }
 
   // Position the input stream.
   int64 curr_pos = input_stream_->Tell();
@@ -148,6 +545,29 @@ Status RecordReader::ReadRecord(uint64* offset, string* record) {
   return Status::OK();
 }
 
+Status RecordReader::ReadRecord(uint64* offset, StringPiece* record) {
+  if (options_.read_ahead_blocks <= 0) {
+    TF_RETURN_IF_ERROR(ReadRecord(offset, &record_));
+    *record = record_;
+    return Status::OK();
+  }
+  if (read_ahead_ == nullptr || read_ahead_->offset() != *offset) {
+    read_ahead_.reset();
+    read_ahead_.reset(new RecordReadAhead(file_, *offset,
+                                          options_.read_ahead_blocks,
+                                          options_.read_ahead_block_size));
+  }
+  Status s = read_ahead_->GetNext(record);
+  if (!s.ok()) {
+    // Start over at the same offset on the next call, as a retry might
+    // succeed, e.g. if the file has grown.
+    read_ahead_.reset();
+    return s;
+  }
+  *offset = read_ahead_->offset();
+  return Status::OK();
+}
+
 SequentialRecordReader::SequentialRecordReader(
     RandomAccessFile* file, const RecordReaderOptions& options)
     : underlying_(file, options), offset_(0) {}
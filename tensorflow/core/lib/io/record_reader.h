@@ -32,6 +32,8 @@ class RandomAccessFile;
 
 namespace io {
 
+class RecordReadAhead;
+
 class RecordReaderOptions {
  public:
   enum CompressionType { NONE = 0, ZLIB_COMPRESSION = 1 };
@@ -42,6 +44,15 @@ class RecordReaderOptions {
   // compressed files.) Consider using SequentialRecordReader.
   int64 buffer_size = 0;
 
+  // If read_ahead_blocks is non-zero, up to read_ahead_blocks reads of
+  // read_ahead_block_size bytes are kept in flight on a thread pool shared by
+  // all readers, and records are split out and their checksums verified on
+  // that pool before they are requested. Reads are expected to be
+  // sequential; reading at any other offset restarts the read-ahead there.
+  // Takes precedence over buffer_size, and is ignored for compressed files.
+  int64 read_ahead_blocks = 0;
+  int64 read_ahead_block_size = 1 << 20;
+
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
@@ -64,20 +75,32 @@ class RecordReader {
       RandomAccessFile* file,
       const RecordReaderOptions& options = RecordReaderOptions());
 
-  virtual ~RecordReader() = default;
+  virtual ~RecordReader();
 
   // Read the record at "*offset" into *record and update *offset to
   // point to the offset of the next record.  Returns OK on success,
   // OUT_OF_RANGE for end of file, or something else for an error.
   Status ReadRecord(uint64* offset, string* record);
 
+  // Same as above, but points *record at the contents of the record instead
+  // of copying them out. With read-ahead enabled, records are returned
+  // directly from the read buffers. *record remains valid until the next
+  // call on this reader.
+  Status ReadRecord(uint64* offset, StringPiece* record);
+
  private:
   Status ReadChecksummed(uint64 offset, size_t n, string* result);
 
+  RandomAccessFile* const file_;
   RecordReaderOptions options_;
   std::unique_ptr<InputStreamInterface> input_stream_;
   bool last_read_failed_;
 
+  // Set when read-ahead is enabled and a read is in progress.
+  std::unique_ptr<RecordReadAhead> read_ahead_;
+  // Holds the last record returned as a StringPiece without read-ahead.
+  string record_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(RecordReader);
 };
 
@@ -100,6 +123,12 @@ class SequentialRecordReader {
     return underlying_.ReadRecord(&offset_, record);
   }
 
+  // Same as above, but points *record at the contents of the record, which
+  // remain valid until the next call on this reader.
+  Status ReadRecord(StringPiece* record) {
+    return underlying_.ReadRecord(&offset_, record);
+  }
+
   // Returns the current offset in the file.
   uint64 TellOffset() { return offset_; }
 
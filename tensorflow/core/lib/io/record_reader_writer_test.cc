@@ -17,6 +17,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_writer.h"
 
 #include <zlib.h>
+#include <algorithm>
 #include <vector>
 #include "tensorflow/core/platform/env.h"
 
@@ -26,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
@@ -212,4 +214,50 @@ TEST(RecordReaderWriterTest, TestUseAfterClose) {
   }
 }
 
+// Reads a file of 64MB worth of "record_size" byte records.
+static void BM_ReadRecords(int iters, int record_size, int read_ahead_blocks) {
+  testing::StopTiming();
+  Env* env = Env::Default();
+  const string fname = testing::TmpDir() + "/record_reader_writer_bm";
+  const int num_records = std::max(1, (64 << 20) / record_size);
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    const string record(record_size, 'x');
+    for (int i = 0; i < num_records; ++i) {
+      TF_CHECK_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Close());
+  }
+  io::RecordReaderOptions options;
+  options.buffer_size = 256 << 10;
+  options.read_ahead_blocks = read_ahead_blocks;
+  testing::BytesProcessed(static_cast<int64>(iters) * num_records *
+                          record_size);
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::SequentialRecordReader reader(read_file.get(), options);
+    StringPiece record;
+    for (int j = 0; j < num_records; ++j) {
+      TF_CHECK_OK(reader.ReadRecord(&record));
+    }
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(env->DeleteFile(fname));
+}
+
+static void BM_SequentialRecordReader(int iters, int record_size) {
+  BM_ReadRecords(iters, record_size, 0);
+}
+BENCHMARK(BM_SequentialRecordReader)->Arg(100)->Arg(10 << 10)->Arg(1 << 20);
+
+static void BM_ReadAheadRecordReader(int iters, int record_size) {
+  BM_ReadRecords(iters, record_size, 4);
+}
+BENCHMARK(BM_ReadAheadRecordReader)->Arg(100)->Arg(10 << 10)->Arg(1 << 20);
+
 }  // namespace tensorflow
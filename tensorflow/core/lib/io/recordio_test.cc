@@ -121,6 +121,14 @@ class RecordioTest : public ::testing::Test {
     delete reader_;
   }
 
+  void UseReadAhead(int64 num_blocks, int64 block_size) {
+    RecordReaderOptions options;
+    options.read_ahead_blocks = num_blocks;
+    options.read_ahead_block_size = block_size;
+    delete reader_;
+    reader_ = new RecordReader(&source_, options);
+  }
+
   void Write(const string& msg) {
     ASSERT_TRUE(!reading_) << "Write() after starting to read";
     TF_ASSERT_OK(writer_->WriteRecord(StringPiece(msg)));
@@ -216,6 +224,41 @@ TEST_F(RecordioTest, RandomRead) {
   ASSERT_EQ("EOF", Read());
 }
 
+TEST_F(RecordioTest, ReadWriteWithReadAhead) {
+  UseReadAhead(4, 8);
+  Write("foo");
+  Write("bar");
+  Write("");
+  Write("xxxx");
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ("bar", Read());
+  ASSERT_EQ("", Read());
+  ASSERT_EQ("xxxx", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ("EOF", Read());
+}
+
+TEST_F(RecordioTest, RandomReadWithReadAhead) {
+  // Most records straddle one or more block boundaries.
+  UseReadAhead(3, 1000);
+  const int N = 500;
+  {
+    random::PhiloxRandom philox(301, 17);
+    random::SimplePhilox rnd(&philox);
+    for (int i = 0; i < N; i++) {
+      Write(RandomSkewedString(i, &rnd));
+    }
+  }
+  {
+    random::PhiloxRandom philox(301, 17);
+    random::SimplePhilox rnd(&philox);
+    for (int i = 0; i < N; i++) {
+      ASSERT_EQ(RandomSkewedString(i, &rnd), Read());
+    }
+  }
+  ASSERT_EQ("EOF", Read());
+}
+
 void TestNonSequentialReads(const RecordWriterOptions& writer_options,
                             const RecordReaderOptions& reader_options) {
   string contents;
@@ -260,6 +303,13 @@ TEST_F(RecordioTest, NonSequentialReadsWithReadBuffer) {
   TestNonSequentialReads(RecordWriterOptions(), options);
 }
 
+TEST_F(RecordioTest, NonSequentialReadsWithReadAhead) {
+  RecordReaderOptions options;
+  options.read_ahead_blocks = 2;
+  options.read_ahead_block_size = 16;
+  TestNonSequentialReads(RecordWriterOptions(), options);
+}
+
 TEST_F(RecordioTest, NonSequentialReadsWithCompression) {
   TestNonSequentialReads(
       RecordWriterOptions::CreateRecordWriterOptions("ZLIB"),
@@ -307,6 +357,14 @@ TEST_F(RecordioTest, ReadErrorWithBuffering) {
   TestReadError(RecordWriterOptions(), options);
 }
 
+TEST_F(RecordioTest, ReadErrorWithReadAhead) {
+  RecordReaderOptions options;
+  // With a single block in flight the forced error hits the first read.
+  options.read_ahead_blocks = 1;
+  options.read_ahead_block_size = 64;
+  TestReadError(RecordWriterOptions(), options);
+}
+
 TEST_F(RecordioTest, ReadErrorWithCompression) {
   TestReadError(RecordWriterOptions::CreateRecordWriterOptions("ZLIB"),
                 RecordReaderOptions::CreateRecordReaderOptions("ZLIB"));
@@ -336,10 +394,33 @@ TEST_F(RecordioTest, CorruptDataCrc) {
   AssertHasSubstr(Read(), "Data loss");
 }
 
+TEST_F(RecordioTest, CorruptDataWithReadAhead) {
+  UseReadAhead(2, 8);
+  Write("foo");
+  Write("bar");
+  IncrementByte(WrittenBytes() - 5, 10);
+  ASSERT_EQ("foo", Read());
+  AssertHasSubstr(Read(), "Data loss");
+}
+
+TEST_F(RecordioTest, TruncatedWithReadAhead) {
+  UseReadAhead(2, 8);
+  Write("foo");
+  Write("bar");
+  ShrinkSize(2);
+  ASSERT_EQ("foo", Read());
+  AssertHasSubstr(Read(), "truncated record");
+}
+
 TEST_F(RecordioTest, ReadEnd) { CheckOffsetPastEndReturnsNoRecords(0); }
 
 TEST_F(RecordioTest, ReadPastEnd) { CheckOffsetPastEndReturnsNoRecords(5); }
 
+TEST_F(RecordioTest, ReadPastEndWithReadAhead) {
+  UseReadAhead(2, 64);
+  CheckOffsetPastEndReturnsNoRecords(5);
+}
+
 }  // namespace
 }  // namespace io
 }  // namespace tensorflow
@@ -28,9 +28,34 @@ REGISTER_OP("CollectiveReduce")
     .Attr("merge_op: {'Min', 'Max', 'Mul', 'Add'}")
     .Attr("final_op: {'Id', 'Div'}")
     .Attr("subdiv_offsets: list(int)")
+    .Attr("compression: {'none', 'bfloat16', 'float16', 'topk'} = 'none'")
+    .Attr("topk_fraction: float = 0.01")
     .SetIsStateful()
     .SetShapeFn(shape_inference::UnchangedShape);
 
+REGISTER_OP("CollectiveGather")
+    .Input("input: T")
+    .Output("data: T")
+    .Attr("T: {float, float16, float64, int32, int64}")
+    .Attr("group_size: int")
+    .Attr("group_key: int")
+    .Attr("instance_key: int")
+    .SetIsStateful()
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      // The inputs are concatenated along their first dimension.
+      shape_inference::ShapeHandle input;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &input));
+      int group_size;
+      TF_RETURN_IF_ERROR(c->GetAttr("group_size", &group_size));
+      shape_inference::DimensionHandle first_dim;
+      TF_RETURN_IF_ERROR(
+          c->Multiply(c->Dim(input, 0), group_size, &first_dim));
+      shape_inference::ShapeHandle output;
+      TF_RETURN_IF_ERROR(c->ReplaceDim(input, 0, first_dim, &output));
+      c->set_output(0, output);
+      return Status::OK();
+    });
+
 REGISTER_OP("CollectiveBcastSend")
     .Input("input: T")
     .Output("data: T")
@@ -15,6 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/platform/numa.h"
 
+#include <vector>
+
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
 
@@ -57,5 +62,40 @@ TEST(Numa, SetNodeAffinity) {
   }
 }
 
+TEST(Numa, ThreadPoolAffinity) {
+  const int num_nodes = port::NUMAEnabled() ? port::NUMANumNodes() : 1;
+  for (int request_node = 0; request_node < num_nodes; ++request_node) {
+    ThreadOptions thread_options;
+    thread_options.numa_node =
+        port::NUMAEnabled() ? request_node : port::kNUMANoAffinity;
+    thread::ThreadPool pool(Env::Default(), thread_options, "numa", 4);
+    const int kNumTasks = 16;
+    BlockingCounter counter(kNumTasks);
+    std::vector<int> affinity(kNumTasks, -2);
+    for (int i = 0; i < kNumTasks; ++i) {
+      pool.Schedule([&affinity, &counter, i]() {
+        affinity[i] = port::NUMAGetThreadNodeAffinity();
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    for (int a : affinity) {
+      EXPECT_EQ(thread_options.numa_node, a);
+    }
+  }
+}
+
+TEST(Numa, MallocPageRounding) {
+  // Sizes that are not a multiple of the page size must round trip.
+  for (size_t size : {1, 4095, 4097, 1 << 20}) {
+    char* ptr = static_cast<char*>(port::NUMAMalloc(0, size, 64));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(ptr) % 64);
+    ptr[0] = 1;
+    ptr[size - 1] = 2;
+    port::NUMAFree(ptr, size);
+  }
+}
+
 }  // namespace internal
 }  // namespace tensorflow
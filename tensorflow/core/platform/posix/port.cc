@@ -30,12 +30,16 @@ limitations under the License.
 
 #if defined(__linux__) && !defined(__ANDROID__)
 #include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
 #endif
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <vector>
 #ifdef TF_USE_SNAPPY
 #include "snappy.h"
 #endif
@@ -80,16 +84,151 @@ int NumHyperthreadsPerCore() {
   return (ht_per_core > 0) ? ht_per_core : 1;
 }
 
+#if defined(__linux__) && !defined(__ANDROID__) && defined(SYS_mbind) && \
+    defined(SYS_get_mempolicy)
+#define TF_HAVE_LINUX_NUMA 1
+
+namespace {
+
+// Values from <numaif.h>, which is not part of libc.
+constexpr int kMpolPreferred = 1;
+constexpr int kMpolFNode = 1 << 0;
+constexpr int kMpolFAddr = 1 << 1;
+
+// Parses a sysfs cpu or node list such as "0-3,8-11" into *set. Returns the
+// largest id seen, or -1 if the list is empty or malformed.
+int ParseIdList(const char* list, cpu_set_t* set) {
+  CPU_ZERO(set);
+  int max_id = -1;
+  const char* p = list;
+  while (*p != '\0' && *p != '\n') {
+    char* end;
+    long first = strtol(p, &end, 10);
+    if (end == p || first < 0) return -1;
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      ++p;
+      last = strtol(p, &end, 10);
+      if (end == p || last < first) return -1;
+      p = end;
+    }
+    for (long id = first; id <= last && id < CPU_SETSIZE; ++id) {
+      CPU_SET(id, set);
+      max_id = static_cast<int>(id);
+    }
+    if (*p == ',') ++p;
+  }
+  return max_id;
+}
+
+bool ReadIdList(const char* path, cpu_set_t* set, int* max_id) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) return false;
+  char buf[4096];
+  const bool ok = fgets(buf, sizeof(buf), f) != nullptr;
+  fclose(f);
+  if (!ok) return false;
+  *max_id = ParseIdList(buf, set);
+  return *max_id >= 0;
+}
+
+// The cpus of each NUMA node, read once from sysfs. Nodes are assumed to be
+// numbered densely from 0.
+struct NUMATopology {
+  NUMATopology() {
+    CPU_ZERO(&all_cpus);
+    cpu_set_t online;
+    int max_node;
+    if (!ReadIdList("/sys/devices/system/node/online", &online, &max_node)) {
+      return;
+    }
+    for (int node = 0; node <= max_node; ++node) {
+      cpu_set_t cpus;
+      int max_cpu;
+      char path[64];
+      snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+               node);
+      if (!CPU_ISSET(node, &online) || !ReadIdList(path, &cpus, &max_cpu)) {
+        CPU_ZERO(&cpus);
+      }
+      CPU_OR(&all_cpus, &all_cpus, &cpus);
+      node_cpus.push_back(cpus);
+    }
+  }
+
+  std::vector<cpu_set_t> node_cpus;
+  cpu_set_t all_cpus;
+};
+
+const NUMATopology& GetNUMATopology() {
+  static const NUMATopology* topology = new NUMATopology;
+  return *topology;
+}
+
+size_t PageSize() {
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  return page_size;
+}
+
+size_t RoundUpToPageSize(size_t size) {
+  const size_t page_size = PageSize();
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+}  // namespace
+#endif  // defined(__linux__) && !defined(__ANDROID__) && ...
+
 bool NUMAEnabled() {
-  // Not yet implemented: coming soon.
+#ifdef TF_HAVE_LINUX_NUMA
+  return GetNUMATopology().node_cpus.size() > 1;
+#else
   return false;
+#endif
 }
 
-int NUMANumNodes() { return 1; }
+int NUMANumNodes() {
+#ifdef TF_HAVE_LINUX_NUMA
+  if (NUMAEnabled()) return GetNUMATopology().node_cpus.size();
+#endif
+  return 1;
+}
 
-void NUMASetThreadNodeAffinity(int node) {}
+void NUMASetThreadNodeAffinity(int node) {
+#ifdef TF_HAVE_LINUX_NUMA
+  if (!NUMAEnabled()) return;
+  const NUMATopology& topology = GetNUMATopology();
+  const cpu_set_t* cpus = &topology.all_cpus;
+  if (node != kNUMANoAffinity) {
+    if (node < 0 || node >= NUMANumNodes() ||
+        CPU_COUNT(&topology.node_cpus[node]) == 0) {
+      LOG(ERROR) << "NUMASetThreadNodeAffinity: invalid node " << node;
+      return;
+    }
+    cpus = &topology.node_cpus[node];
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set_t), cpus) != 0) {
+    LOG(ERROR) << "NUMASetThreadNodeAffinity: sched_setaffinity failed: "
+               << strerror(errno);
+  }
+#endif
+}
 
 int NUMAGetThreadNodeAffinity() {
+#ifdef TF_HAVE_LINUX_NUMA
+  if (!NUMAEnabled()) return kNUMANoAffinity;
+  cpu_set_t cpus;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpus) != 0) {
+    return kNUMANoAffinity;
+  }
+  const NUMATopology& topology = GetNUMATopology();
+  for (int node = 0; node < NUMANumNodes(); ++node) {
+    cpu_set_t outside;
+    CPU_XOR(&outside, &cpus, &topology.node_cpus[node]);
+    CPU_AND(&outside, &outside, &cpus);
+    if (CPU_COUNT(&outside) == 0) return node;
+  }
+#endif
   return kNUMANoAffinity;
 }
 
@@ -143,12 +282,49 @@ void Free(void* ptr) {
 }
 
 void* NUMAMalloc(int node, size_t size, int minimum_alignment) {
+#ifdef TF_HAVE_LINUX_NUMA
+  if (NUMAEnabled()) {
+    // Whole pages are mapped so that the memory policy set below applies
+    // to this allocation only.
+    void* ptr = mmap(nullptr, RoundUpToPageSize(size), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return nullptr;
+    if (node >= 0 && node < NUMANumNodes()) {
+      // MPOL_PREFERRED rather than MPOL_BIND, so that a full node spills
+      // over to its neighbours instead of failing the allocation.
+      unsigned long nodemask = 1UL << node;  // NOLINT
+      if (syscall(SYS_mbind, ptr, RoundUpToPageSize(size), kMpolPreferred,
+                  &nodemask, sizeof(nodemask) * 8, 0) != 0) {
+        VLOG(1) << "NUMAMalloc: mbind to node " << node
+                << " failed: " << strerror(errno);
+      }
+    }
+    return ptr;
+  }
+#endif
   return AlignedMalloc(size, minimum_alignment);
 }
 
-void NUMAFree(void* ptr, size_t size) { Free(ptr); }
+void NUMAFree(void* ptr, size_t size) {
+#ifdef TF_HAVE_LINUX_NUMA
+  if (NUMAEnabled()) {
+    if (ptr != nullptr) munmap(ptr, RoundUpToPageSize(size));
+    return;
+  }
+#endif
+  Free(ptr);
+}
 
 int NUMAGetMemAffinity(const void* addr) {
+#ifdef TF_HAVE_LINUX_NUMA
+  if (NUMAEnabled() && addr != nullptr) {
+    int node = kNUMANoAffinity;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, addr,
+                kMpolFNode | kMpolFAddr) == 0) {
+      return node;
+    }
+  }
+#endif
   return kNUMANoAffinity;
 }
 
@@ -124,6 +124,19 @@ void HandleSliceToElement<Variant>(Tensor* parent, Tensor* element, int64 index,
 Status CopyElementToSlice(Tensor element, Tensor* parent, int64 index) {
   TF_RETURN_IF_ERROR(ValidateInput(*parent, element, index));
 
+  if (DataTypeCanUseMemcpy(element.dtype()) &&
+      element.dtype() == parent->dtype()) {
+    // The slice is a contiguous range of the buffer of `parent`, which can be
+    // copied without evaluating an Eigen expression.
+    const StringPiece element_data = element.tensor_data();
+    if (!element_data.empty()) {
+      char* parent_data = const_cast<char*>(parent->tensor_data().data());
+      memcpy(parent_data + index * element_data.size(), element_data.data(),
+             element_data.size());
+    }
+    return Status::OK();
+  }
+
   bool can_move = element.RefCountIsOne();
 #define HANDLE_TYPE(T)                                                \
   case DataTypeToEnum<T>::value: {                                    \
@@ -187,6 +200,57 @@ Status MaybeMoveSliceToElement(Tensor* parent, Tensor* element, int64 index) {
   }
 }
 
+Status MaybeMoveLeadingSlices(Tensor* src, Tensor* dst, int64 num_slices) {
+  if (src->dtype() != dst->dtype() || src->dims() < 1 ||
+      src->dims() != dst->dims() || num_slices < 0 ||
+      num_slices > src->dim_size(0) || num_slices > dst->dim_size(0)) {
+    return errors::Internal(
+        "MaybeMoveLeadingSlices Cannot copy ", num_slices, " slices from ",
+        src->shape().DebugString(), " to ", dst->shape().DebugString());
+  }
+  for (int d = 1; d < src->dims(); ++d) {
+    if (src->dim_size(d) != dst->dim_size(d)) {
+      return errors::Internal("MaybeMoveLeadingSlices Slices of ",
+                              src->shape().DebugString(), " and ",
+                              dst->shape().DebugString(), " differ");
+    }
+  }
+  if (num_slices == 0 || src->NumElements() == 0) return Status::OK();
+
+  if (DataTypeCanUseMemcpy(src->dtype())) {
+    const StringPiece src_data = src->tensor_data();
+    const size_t num_bytes = src_data.size() / src->dim_size(0) * num_slices;
+    memcpy(const_cast<char*>(dst->tensor_data().data()), src_data.data(),
+           num_bytes);
+    return Status::OK();
+  }
+
+  const bool can_move = src->RefCountIsOne();
+  const int64 num_values = src->NumElements() / src->dim_size(0) * num_slices;
+#define HANDLE_TYPE(T)                        \
+  case DataTypeToEnum<T>::value: {            \
+    auto src_flat = src->flat<T>();           \
+    auto dst_flat = dst->flat<T>();           \
+    for (int64 i = 0; i < num_values; ++i) {  \
+      if (can_move) {                         \
+        dst_flat(i) = std::move(src_flat(i)); \
+      } else {                                \
+        dst_flat(i) = src_flat(i);            \
+      }                                       \
+    }                                         \
+    return Status::OK();                      \
+  }
+
+  switch (src->dtype()) {
+    TF_CALL_ALL_TYPES(HANDLE_TYPE);
+    TF_CALL_QUANTIZED_TYPES(HANDLE_TYPE);
+#undef HANDLE_TYPE
+    default:
+      return errors::Unimplemented(
+          "MaybeMoveLeadingSlices Unhandled data type: ", src->dtype());
+  }
+}
+
 // The following five functions are copied from padding_fifo_queue.cc.
 // TODO(mrry): Reconcile these functions with the similar methods in the
 // queue implementation.
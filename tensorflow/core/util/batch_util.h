@@ -38,6 +38,12 @@ Status CopySliceToElement(const Tensor& parent, Tensor* element, int64 index);
 // This is particularly important for DT_STRING tensors.
 Status MaybeMoveSliceToElement(Tensor* parent, Tensor* element, int64 index);
 
+// Copies the first `num_slices` slices of `src` (in the 0th dimension) into
+// the first slices of `dst`, which must have the same dtype and slice shape.
+// The values are moved if `src` holds the only reference to its buffer, which
+// leaves them unspecified in `src`.
+Status MaybeMoveLeadingSlices(Tensor* src, Tensor* dst, int64 num_slices);
+
 // Zero-initializes the tensor `element` using the scalar stored in `padding`.
 // Both `element` and `padding` must have matching `dtype`.
 Status SetElementZero(Tensor* element, const Tensor& padding);
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <cstring>
 #include <vector>
 
 #include "tensorflow/core/example/example.pb.h"
@@ -22,11 +23,15 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/core/casts.h"
+#include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/raw_coding.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/presized_cuckoo_map.h"
@@ -843,6 +848,60 @@ Status CheckConfigDataType(DataType dtype) {
   }
 }
 
+// Builds the index from hashed feature name to position in "config", changing
+// the seed of "hasher" until there are no collisions.
+Status BuildConfigIndex(
+    const Config& config, SeededHasher* hasher,
+    PresizedCuckooMap<std::pair<size_t, Type>>* config_index) {
+  const size_t config_size = config.dense.size() + config.sparse.size();
+  bool ok = true;
+  for (size_t i = 0; i < 1000; ++i) {
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(config.dense[d].feature_name),
+                                       {d, Type::Dense});
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      ok &= config_index->InsertUnique((*hasher)(config.sparse[d].feature_name),
+                                       {d, Type::Sparse});
+    }
+    if (ok) break;
+    LOG(WARNING) << "Collision found. This should happen only if you have "
+                    "around 2^32 entries in your config.";
+    hasher->seed++;
+    config_index->Clear(config_size);
+  }
+  if (!ok) {
+    return errors::Internal(
+        "Could not avoid collision. This should not happen.");
+  }
+  return Status::OK();
+}
+
+// Returns the number of minibatches "serialized" is split into for parsing.
+size_t NumMiniBatches(gtl::ArraySlice<string> serialized) {
+  // This parameter affects performance in a big and data-dependent way.
+  const size_t kMiniBatchSizeBytes = 50000;
+
+  // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
+  // Apply 'special logic' below for small and big regimes.
+  size_t result = 0;
+  size_t minibatch_bytes = 0;
+  for (size_t i = 0; i < serialized.size(); i++) {
+    if (minibatch_bytes == 0) {  // start minibatch
+      result++;
+    }
+    minibatch_bytes += serialized[i].size() + 1;
+    if (minibatch_bytes > kMiniBatchSizeBytes) {
+      minibatch_bytes = 0;
+    }
+  }
+  // 'special logic'
+  const size_t min_minibatches = std::min<size_t>(8, serialized.size());
+  const size_t max_minibatches = 64;
+  return std::max<size_t>(min_minibatches,
+                          std::min<size_t>(max_minibatches, result));
+}
+
 template <typename T>
 const SmallVector<T>& GetListFromBuffer(const SparseBuffer& buffer);
 
@@ -935,26 +994,7 @@ Status FastParseExample(const Config& config,
   SeededHasher hasher;
   // Build config index.
   PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  TF_RETURN_IF_ERROR(BuildConfigIndex(config, &hasher, &config_index));
 
   // Allocate dense output for fixed length dense values
   // (variable-length dense and sparse have to be buffered).
@@ -969,30 +1009,8 @@ Status FastParseExample(const Config& config,
     fixed_dense_values[d] = Tensor(config.dense[d].dtype, out_shape);
   }
 
-  // This parameter affects performance in a big and data-dependent way.
-  const size_t kMiniBatchSizeBytes = 50000;
-
   // Calculate number of minibatches.
-  // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
-  // Apply 'special logic' below for small and big regimes.
-  const size_t num_minibatches = [&] {
-    size_t result = 0;
-    size_t minibatch_bytes = 0;
-    for (size_t i = 0; i < serialized.size(); i++) {
-      if (minibatch_bytes == 0) {  // start minibatch
-        result++;
-      }
-      minibatch_bytes += serialized[i].size() + 1;
-      if (minibatch_bytes > kMiniBatchSizeBytes) {
-        minibatch_bytes = 0;
-      }
-    }
-    // 'special logic'
-    const size_t min_minibatches = std::min<size_t>(8, serialized.size());
-    const size_t max_minibatches = 64;
-    return std::max<size_t>(min_minibatches,
-                            std::min<size_t>(max_minibatches, result));
-  }();
+  const size_t num_minibatches = NumMiniBatches(serialized);
 
   auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
     return (serialized.size() * minibatch) / num_minibatches;
@@ -1185,6 +1203,565 @@ Status FastParseExample(const Config& config,
   return Status::OK();
 }
 
+namespace {
+
+// Where the values of one configured feature are in one serialized example,
+// as found by the first pass of FastParseExampleColumnar.
+struct FeatureLocation {
+  enum Encoding : uint8 {
+    kMissing,   // The feature is not in the example.
+    kEmpty,     // The feature is present but has no values.
+    kPacked,    // "values" is the payload of a packed float or int64 list.
+    kUnpacked,  // "values" is a sequence of tagged values.
+  };
+  Encoding encoding = kMissing;
+  StringPiece values;
+  size_t num_values = 0;
+};
+
+// Reads a varint32 from the front of "*s" and removes it.
+inline bool ConsumeVarint32(StringPiece* s, uint32* value) {
+  const char* p = core::GetVarint32Ptr(s->data(), s->data() + s->size(), value);
+  if (p == nullptr) return false;
+  s->remove_prefix(p - s->data());
+  return true;
+}
+
+// Reads a varint64 of at most ten bytes from "*p", advancing it.
+inline bool DecodeVarint64(const uint8** p, const uint8* end, uint64* value) {
+  uint64 result = 0;
+  for (int shift = 0; shift < 70 && *p < end; shift += 7) {
+    const uint8 byte = *(*p)++;
+    result |= static_cast<uint64>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the number of varints ending in [p, end), i.e. the number of bytes
+// without the continuation bit. Written as a plain loop over bytes so that
+// the compiler vectorizes it.
+inline size_t CountVarints(const uint8* p, const uint8* end) {
+  size_t count = 0;
+  for (; p < end; ++p) count += (*p & 0x80) == 0;
+  return count;
+}
+
+constexpr uint64 kContinuationBits = 0x8080808080808080ULL;
+
+// Decodes the packed varints in [p, end), which must hold exactly "count"
+// values, into "out". Eight bytes are examined at a time: eight one-byte
+// varints are widened in one step, and otherwise the continuation bits locate
+// the end of the next varint so that its 7-bit groups are gathered with
+// masks and shifts rather than a loop over its bytes.
+bool DecodePackedVarint64s(const uint8* p, const uint8* end, size_t count,
+                           int64* out) {
+  int64* const out_end = out + count;
+  while (end - p >= 8 && out < out_end) {
+    const uint64 word = core::DecodeFixed64(reinterpret_cast<const char*>(p));
+    if ((word & kContinuationBits) == 0) {
+      if (out_end - out < 8) return false;
+      for (int i = 0; i < 8; ++i) {
+        out[i] = (word >> (8 * i)) & 0xff;
+      }
+      out += 8;
+      p += 8;
+      continue;
+    }
+    const uint64 stops = ~word & kContinuationBits;
+    if (stops == 0) {
+      // Longer than eight bytes.
+      uint64 value;
+      if (!DecodeVarint64(&p, end, &value)) return false;
+      *out++ = static_cast<int64>(value);
+      continue;
+    }
+    const int num_bytes = (Log2Floor64(stops & (~stops + 1)) + 1) / 8;
+    uint64 value = word & (~uint64{0} >> (64 - 8 * num_bytes));
+    value &= ~kContinuationBits;
+    value = (value & 0x007f007f007f007fULL) |
+            ((value & 0x7f007f007f007f00ULL) >> 1);
+    value = (value & 0x00003fff00003fffULL) |
+            ((value & 0x3fff00003fff0000ULL) >> 2);
+    value = (value & 0x000000000fffffffULL) |
+            ((value & 0x0fffffff00000000ULL) >> 4);
+    *out++ = static_cast<int64>(value);
+    p += num_bytes;
+  }
+  while (p < end && out < out_end) {
+    uint64 value;
+    if (!DecodeVarint64(&p, end, &value)) return false;
+    *out++ = static_cast<int64>(value);
+  }
+  return p == end && out == out_end;
+}
+
+// Finds the values of "feature", a serialized Feature whose dtype has already
+// been parsed, and counts them without decoding them. Unpacked lists are fully
+// validated here, so that decoding them later cannot fail.
+bool LocateFeatureValues(DataType dtype, const parsed::Feature& feature,
+                         FeatureLocation* location) {
+  StringPiece list = feature.GetSerialized();
+  uint32 length;
+  if (!ConsumeVarint32(&list, &length)) return false;
+  if (length < list.size()) list = StringPiece(list.data(), length);
+  location->num_values = 0;
+  if (list.empty()) {
+    location->encoding = FeatureLocation::kEmpty;
+    return true;
+  }
+
+  const uint8 tag = static_cast<uint8>(list[0]);
+  if (dtype != DT_STRING && tag == kDelimitedTag(1)) {
+    list.remove_prefix(1);
+    uint32 packed_length;
+    if (!ConsumeVarint32(&list, &packed_length)) return false;
+    if (packed_length < list.size()) {
+      list = StringPiece(list.data(), packed_length);
+    }
+    location->encoding = FeatureLocation::kPacked;
+    location->values = list;
+    const uint8* p = reinterpret_cast<const uint8*>(list.data());
+    if (dtype == DT_FLOAT) {
+      if (list.size() % sizeof(float) != 0) return false;
+      location->num_values = list.size() / sizeof(float);
+    } else {
+      if (!list.empty() && (p[list.size() - 1] & 0x80) != 0) return false;
+      location->num_values = CountVarints(p, p + list.size());
+    }
+    return true;
+  }
+
+  location->encoding = FeatureLocation::kUnpacked;
+  location->values = list;
+  const uint8* p = reinterpret_cast<const uint8*>(list.data());
+  const uint8* const end = p + list.size();
+  while (p < end) {
+    switch (dtype) {
+      case DT_FLOAT:
+        if (*p != kFixed32Tag(1) || end - p < 5) return false;
+        p += 5;
+        break;
+      case DT_INT64: {
+        if (*p++ != kVarintTag(1)) return false;
+        uint64 unused;
+        if (!DecodeVarint64(&p, end, &unused)) return false;
+        break;
+      }
+      case DT_STRING: {
+        if (*p++ != kDelimitedTag(1)) return false;
+        StringPiece rest(reinterpret_cast<const char*>(p), end - p);
+        uint32 bytes_length;
+        if (!ConsumeVarint32(&rest, &bytes_length)) return false;
+        if (bytes_length > rest.size()) return false;
+        p = reinterpret_cast<const uint8*>(rest.data()) + bytes_length;
+        break;
+      }
+      default:
+        LOG(FATAL) << "Should not happen.";
+    }
+    ++location->num_values;
+  }
+  return true;
+}
+
+// Decodes the "location->num_values" values found by LocateFeatureValues()
+// into "out".
+bool DecodeValues(const FeatureLocation& location, float* out) {
+  const char* p = location.values.data();
+  if (location.encoding == FeatureLocation::kPacked) {
+    if (port::kLittleEndian) {
+      std::memcpy(out, p, location.num_values * sizeof(float));
+    } else {
+      for (size_t i = 0; i < location.num_values; ++i) {
+        out[i] = bit_cast<float>(core::DecodeFixed32(p + i * sizeof(float)));
+      }
+    }
+  } else if (location.encoding == FeatureLocation::kUnpacked) {
+    for (size_t i = 0; i < location.num_values; ++i) {
+      out[i] = bit_cast<float>(core::DecodeFixed32(p + 1));
+      p += 5;
+    }
+  }
+  return true;
+}
+
+bool DecodeValues(const FeatureLocation& location, int64* out) {
+  const uint8* p = reinterpret_cast<const uint8*>(location.values.data());
+  const uint8* const end = p + location.values.size();
+  if (location.encoding == FeatureLocation::kPacked) {
+    return DecodePackedVarint64s(p, end, location.num_values, out);
+  } else if (location.encoding == FeatureLocation::kUnpacked) {
+    for (size_t i = 0; i < location.num_values; ++i) {
+      uint64 value;
+      ++p;  // Skips the tag.
+      if (!DecodeVarint64(&p, end, &value)) return false;
+      out[i] = static_cast<int64>(value);
+    }
+  }
+  return true;
+}
+
+bool DecodeValues(const FeatureLocation& location, string* out) {
+  StringPiece rest = location.values;
+  for (size_t i = 0; i < location.num_values; ++i) {
+    rest.remove_prefix(1);  // Skips the tag.
+    uint32 length;
+    if (!ConsumeVarint32(&rest, &length)) return false;
+    out[i].assign(rest.data(), length);
+    rest.remove_prefix(length);
+  }
+  return true;
+}
+
+// Decodes one example of a dense feature into "out", which has room for
+// "num_elements" values, padding or defaulting as ParseExample does.
+template <typename T>
+bool DecodeDenseValues(const FeatureLocation& location,
+                       const Config::Dense& config, size_t num_elements,
+                       T* out) {
+  const Tensor& default_value = config.default_value;
+  if (!config.variable_length &&
+      location.encoding == FeatureLocation::kMissing) {
+    std::copy_n(default_value.flat<T>().data(), num_elements, out);
+    return true;
+  }
+  if (!DecodeValues(location, out)) return false;
+  if (config.variable_length) {
+    std::fill(out + location.num_values, out + num_elements,
+              default_value.flat<T>()(0));
+  }
+  return true;
+}
+
+bool DecodeDenseFeature(const FeatureLocation& location,
+                        const Config::Dense& config, size_t num_elements,
+                        size_t offset, Tensor* out) {
+  switch (config.dtype) {
+    case DT_INT64:
+      return DecodeDenseValues(location, config, num_elements,
+                               out->flat<int64>().data() + offset);
+    case DT_FLOAT:
+      return DecodeDenseValues(location, config, num_elements,
+                               out->flat<float>().data() + offset);
+    case DT_STRING:
+      return DecodeDenseValues(location, config, num_elements,
+                               out->flat<string>().data() + offset);
+    default:
+      LOG(FATAL) << "Should not happen.";
+  }
+  return false;
+}
+
+bool DecodeSparseFeature(const FeatureLocation& location, DataType dtype,
+                         size_t offset, Tensor* out) {
+  switch (dtype) {
+    case DT_INT64:
+      return DecodeValues(location, out->flat<int64>().data() + offset);
+    case DT_FLOAT:
+      return DecodeValues(location, out->flat<float>().data() + offset);
+    case DT_STRING:
+      return DecodeValues(location, out->flat<string>().data() + offset);
+    default:
+      LOG(FATAL) << "Should not happen.";
+  }
+  return false;
+}
+
+// The name of the values of "dtype" in error messages.
+string ValuesTypeName(DataType dtype) {
+  return dtype == DT_STRING ? "bytes" : DataTypeString(dtype);
+}
+
+// The first pass of FastParseExampleColumnar over one example: records where
+// each configured feature is in "serialized_example" and checks its dtype and
+// number of values, without decoding the values.
+Status LocateExampleFeatures(
+    const string& serialized_example, StringPiece example_name,
+    const size_t example_index, const Config& config,
+    const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
+    SeededHasher hasher, parsed::Example* parsed_example,
+    std::vector<std::vector<FeatureLocation>>* dense_locations,
+    std::vector<std::vector<FeatureLocation>>* sparse_locations,
+    PerExampleFeatureStats* output_stats) {
+  parsed_example->clear();
+  if (!ParseExample(serialized_example, parsed_example)) {
+    return errors::InvalidArgument("Could not parse example input, value: '",
+                                   serialized_example, "'");
+  }
+  const size_t parsed_example_size = parsed_example->size();
+  if (output_stats) {
+    output_stats->features_count = parsed_example_size;
+  }
+
+  for (size_t i = 0; i < parsed_example_size; ++i) {
+    // The last entry in the map overwrites all the previous ones.
+    parsed::FeatureMapEntry& name_and_feature =
+        (*parsed_example)[parsed_example_size - i - 1];
+    const StringPiece feature_name = name_and_feature.first;
+    parsed::Feature& feature = name_and_feature.second;
+
+    std::pair<size_t, Type> d_and_type;
+    if (!config_index.Find(hasher(feature_name), &d_and_type)) continue;
+    const size_t d = d_and_type.first;
+    const bool is_dense = d_and_type.second == Type::Dense;
+    const string& config_feature_name = is_dense
+                                            ? config.dense[d].feature_name
+                                            : config.sparse[d].feature_name;
+    if (feature_name != config_feature_name) continue;
+
+    auto example_error = [&](StringPiece suffix) {
+      return errors::InvalidArgument("Name: ", example_name,
+                                     ", Key: ", feature_name,
+                                     ", Index: ", example_index, ".  ", suffix);
+    };
+
+    DataType example_dtype;
+    TF_RETURN_IF_ERROR(feature.ParseDataType(&example_dtype));
+
+    if (is_dense) {
+      if (example_dtype == DT_INVALID) continue;
+      const Config::Dense& dense = config.dense[d];
+      FeatureLocation& location = (*dense_locations)[d][example_index];
+      if (location.encoding != FeatureLocation::kMissing) {
+        LogDenseFeatureDataLoss(feature_name);
+        continue;
+      }
+      if (example_dtype != dense.dtype) {
+        if (!dense.variable_length) {
+          return example_error(strings::StrCat(
+              "Data types don't match. Data type: ",
+              DataTypeString(example_dtype),
+              " but expected type: ", DataTypeString(dense.dtype)));
+        }
+        return example_error(
+            strings::StrCat("Data types don't match. ",
+                            "Expected type: ", DataTypeString(dense.dtype)));
+      }
+      if (!LocateFeatureValues(example_dtype, feature, &location)) {
+        return example_error("Can't parse serialized Example.");
+      }
+      const size_t num_values = location.num_values;
+      if (!dense.variable_length) {
+        if (num_values != dense.elements_per_stride) {
+          return example_error(strings::StrCat(
+              "Number of ", ValuesTypeName(dense.dtype),
+              " values != expected.  Values size: ", num_values,
+              " but output shape: ", dense.shape.DebugString()));
+        }
+      } else if (num_values % dense.elements_per_stride != 0) {
+        return example_error(strings::StrCat(
+            "Number of ", ValuesTypeName(dense.dtype),
+            " values is not a multiple of stride length. Saw ", num_values,
+            " values but output shape is: ", dense.shape.DebugString()));
+      }
+      if (output_stats) output_stats->feature_values_count += num_values;
+    } else {
+      FeatureLocation& location = (*sparse_locations)[d][example_index];
+      if (location.encoding != FeatureLocation::kMissing) {
+        LogSparseFeatureDataLoss(feature_name);
+        continue;
+      }
+      if (example_dtype == DT_INVALID) {
+        location.encoding = FeatureLocation::kEmpty;
+        continue;
+      }
+      if (example_dtype != config.sparse[d].dtype) {
+        return example_error(strings::StrCat(
+            "Data types don't match. ",
+            "Expected type: ", DataTypeString(config.sparse[d].dtype),
+            ", Actual type: ", DataTypeString(example_dtype)));
+      }
+      if (!LocateFeatureValues(example_dtype, feature, &location)) {
+        return example_error("Can't parse serialized Example.");
+      }
+      if (output_stats) {
+        output_stats->feature_values_count += location.num_values;
+      }
+    }
+  }
+
+  for (size_t d = 0; d < config.dense.size(); ++d) {
+    if (config.dense[d].variable_length) continue;
+    if ((*dense_locations)[d][example_index].encoding !=
+        FeatureLocation::kMissing) {
+      continue;
+    }
+    if (config.dense[d].default_value.NumElements() == 0) {
+      return errors::InvalidArgument(
+          "Name: ", example_name, ", Feature: ", config.dense[d].feature_name,
+          " (data type: ", DataTypeString(config.dense[d].dtype), ")",
+          " is required but could not be found.");
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+Status FastParseExampleColumnar(const Config& config,
+                                gtl::ArraySlice<string> serialized,
+                                gtl::ArraySlice<string> example_names,
+                                thread::ThreadPool* thread_pool,
+                                Result* result) {
+  DCHECK(result != nullptr);
+  // Check config so we can safely CHECK(false) in switches on config.*.dtype
+  for (auto& c : config.sparse) {
+    TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
+  }
+  for (auto& c : config.dense) {
+    TF_RETURN_IF_ERROR(CheckConfigDataType(c.dtype));
+  }
+
+  if (config.collect_feature_stats) {
+    result->feature_stats.resize(serialized.size());
+  }
+
+  size_t config_size = config.dense.size() + config.sparse.size();
+  SeededHasher hasher;
+  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
+  TF_RETURN_IF_ERROR(BuildConfigIndex(config, &hasher, &config_index));
+
+  const size_t batch_size = serialized.size();
+  const size_t num_minibatches = NumMiniBatches(serialized);
+  auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
+    return (batch_size * minibatch) / num_minibatches;
+  };
+  auto example_name = [&](size_t e) -> StringPiece {
+    return !example_names.empty() ? StringPiece(example_names[e])
+                                  : StringPiece("<unknown>");
+  };
+
+  // First pass: find every configured feature in every example.
+  std::vector<std::vector<FeatureLocation>> dense_locations(
+      config.dense.size(), std::vector<FeatureLocation>(batch_size));
+  std::vector<std::vector<FeatureLocation>> sparse_locations(
+      config.sparse.size(), std::vector<FeatureLocation>(batch_size));
+  std::vector<Status> status_of_minibatch(num_minibatches);
+  auto LocateMiniBatch = [&](size_t minibatch) {
+    parsed::Example parsed_example;
+    const size_t end = first_example_of_minibatch(minibatch + 1);
+    for (size_t e = first_example_of_minibatch(minibatch); e < end; ++e) {
+      PerExampleFeatureStats* stats = nullptr;
+      if (config.collect_feature_stats) {
+        stats = &result->feature_stats[e];
+      }
+      status_of_minibatch[minibatch] = LocateExampleFeatures(
+          serialized[e], example_name(e), e, config, config_index, hasher,
+          &parsed_example, &dense_locations, &sparse_locations, stats);
+      if (!status_of_minibatch[minibatch].ok()) break;
+    }
+  };
+  ParallelFor(LocateMiniBatch, num_minibatches, thread_pool);
+  for (Status& status : status_of_minibatch) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  // Allocate every output at its final size.
+  std::vector<size_t> dense_elements_per_example(config.dense.size());
+  for (size_t d = 0; d < config.dense.size(); ++d) {
+    const Config::Dense& dense = config.dense[d];
+    TensorShape out_shape;
+    out_shape.AddDim(batch_size);
+    if (!dense.variable_length) {
+      for (const int64 dim : dense.shape.dim_sizes()) {
+        out_shape.AddDim(dim);
+      }
+      dense_elements_per_example[d] = dense.elements_per_stride;
+    } else {
+      size_t max_num_values = 0;
+      for (const FeatureLocation& location : dense_locations[d]) {
+        max_num_values = std::max(max_num_values, location.num_values);
+      }
+      out_shape.AddDim(max_num_values / dense.elements_per_stride);
+      for (int i = 1; i < dense.shape.dims(); ++i) {
+        out_shape.AddDim(dense.shape.dim_size(i));
+      }
+      dense_elements_per_example[d] = max_num_values;
+    }
+    result->dense_values.emplace_back(dense.dtype, out_shape);
+  }
+
+  // Offsets of each minibatch's first value in the sparse outputs.
+  std::vector<std::vector<size_t>> sparse_minibatch_offsets(
+      config.sparse.size(), std::vector<size_t>(num_minibatches + 1));
+  for (size_t d = 0; d < config.sparse.size(); ++d) {
+    std::vector<size_t>& offsets = sparse_minibatch_offsets[d];
+    size_t max_num_values = 0;
+    for (size_t minibatch = 0; minibatch < num_minibatches; ++minibatch) {
+      size_t num_values = 0;
+      const size_t end = first_example_of_minibatch(minibatch + 1);
+      for (size_t e = first_example_of_minibatch(minibatch); e < end; ++e) {
+        const size_t example_values = sparse_locations[d][e].num_values;
+        num_values += example_values;
+        max_num_values = std::max(max_num_values, example_values);
+      }
+      offsets[minibatch + 1] = offsets[minibatch] + num_values;
+    }
+    const size_t total_num_values = offsets[num_minibatches];
+    result->sparse_indices.emplace_back(
+        DT_INT64, TensorShape({static_cast<int64>(total_num_values), 2}));
+    result->sparse_values.emplace_back(
+        config.sparse[d].dtype,
+        TensorShape({static_cast<int64>(total_num_values)}));
+    result->sparse_shapes.emplace_back(DT_INT64, TensorShape({2}));
+    auto shape_t = result->sparse_shapes.back().vec<int64>();
+    shape_t(0) = batch_size;
+    shape_t(1) = max_num_values;
+  }
+
+  // Second pass: decode the values straight into the outputs.
+  auto DecodeMiniBatch = [&](size_t minibatch) {
+    const size_t start = first_example_of_minibatch(minibatch);
+    const size_t end = first_example_of_minibatch(minibatch + 1);
+    auto parse_error = [&](size_t e, StringPiece feature_name) {
+      return errors::InvalidArgument(
+          "Name: ", example_name(e), ", Key: ", feature_name, ", Index: ", e,
+          ".  Can't parse serialized Example.");
+    };
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      const size_t num_elements = dense_elements_per_example[d];
+      if (num_elements == 0) continue;
+      Tensor* out = &result->dense_values[d];
+      for (size_t e = start; e < end; ++e) {
+        if (!DecodeDenseFeature(dense_locations[d][e], config.dense[d],
+                                num_elements, e * num_elements, out)) {
+          status_of_minibatch[minibatch] =
+              parse_error(e, config.dense[d].feature_name);
+          return;
+        }
+      }
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      size_t offset = sparse_minibatch_offsets[d][minibatch];
+      auto indices = result->sparse_indices[d].matrix<int64>();
+      Tensor* values = &result->sparse_values[d];
+      for (size_t e = start; e < end; ++e) {
+        const FeatureLocation& location = sparse_locations[d][e];
+        if (!DecodeSparseFeature(location, config.sparse[d].dtype, offset,
+                                 values)) {
+          status_of_minibatch[minibatch] =
+              parse_error(e, config.sparse[d].feature_name);
+          return;
+        }
+        for (size_t i = 0; i < location.num_values; ++i) {
+          indices(offset + i, 0) = e;
+          indices(offset + i, 1) = i;
+        }
+        offset += location.num_values;
+      }
+    }
+  };
+  ParallelFor(DecodeMiniBatch, num_minibatches, thread_pool);
+  for (Status& status : status_of_minibatch) {
+    TF_RETURN_IF_ERROR(status);
+  }
+  return Status::OK();
+}
+
 Status FastParseSingleExample(const Config& config, const string& serialized,
                               Result* result) {
   DCHECK(result != nullptr);
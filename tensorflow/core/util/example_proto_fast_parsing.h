@@ -103,6 +103,17 @@ Status FastParseExample(const FastParseExampleConfig& config,
                         gtl::ArraySlice<string> example_names,
                         thread::ThreadPool* thread_pool, Result* result);
 
+// Same as FastParseExample, but parses the batch column by column. A first
+// pass over all examples finds each configured feature and counts its values
+// without decoding them. The outputs are then allocated at their final sizes,
+// and a second pass decodes the values straight into them: packed float lists
+// are copied in one block and packed int64 lists are decoded a word at a time.
+Status FastParseExampleColumnar(const FastParseExampleConfig& config,
+                                gtl::ArraySlice<string> serialized,
+                                gtl::ArraySlice<string> example_names,
+                                thread::ThreadPool* thread_pool,
+                                Result* result);
+
 // TODO(mrry): Move the hash table construction into the config object.
 typedef FastParseExampleConfig FastParseSingleExampleConfig;
 
@@ -19,8 +19,11 @@ limitations under the License.
 
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -311,6 +314,17 @@ TEST(FastParse, StatsCollection) {
       }
     }
 
+    {
+      Result result;
+      TF_CHECK_OK(
+          FastParseExampleColumnar(config, serialized, {}, nullptr, &result));
+      EXPECT_EQ(kNumExamples, result.feature_stats.size());
+      for (const PerExampleFeatureStats& stats : result.feature_stats) {
+        EXPECT_EQ(7, stats.features_count);
+        EXPECT_EQ(7, stats.feature_values_count);
+      }
+    }
+
     {
       Result result;
       TF_CHECK_OK(FastParseSingleExample(config, serialized[0], &result));
@@ -420,8 +434,314 @@ TEST(TestFastParseExample, Empty) {
   Status status = FastParseExample(config, gtl::ArraySlice<string>(),
                                    gtl::ArraySlice<string>(), nullptr, &result);
   EXPECT_TRUE(status.ok()) << status;
+  status =
+      FastParseExampleColumnar(config, gtl::ArraySlice<string>(),
+                               gtl::ArraySlice<string>(), nullptr, &result);
+  EXPECT_TRUE(status.ok()) << status;
+}
+
+void ExpectResultsEqual(const Result& expected, const Result& actual) {
+  auto expect_equal = [](const std::vector<Tensor>& expected,
+                         const std::vector<Tensor>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].DebugString(), actual[i].DebugString());
+      EXPECT_EQ(expected[i].SummarizeValue(expected[i].NumElements()),
+                actual[i].SummarizeValue(actual[i].NumElements()));
+    }
+  };
+  expect_equal(expected.dense_values, actual.dense_values);
+  expect_equal(expected.sparse_indices, actual.sparse_indices);
+  expect_equal(expected.sparse_values, actual.sparse_values);
+  expect_equal(expected.sparse_shapes, actual.sparse_shapes);
+}
+
+// Parses "serialized" with both FastParseExample and FastParseExampleColumnar
+// and checks that they agree. Returns the status of FastParseExample.
+Status TestColumnarMatches(const FastParseExampleConfig& config,
+                           const std::vector<string>& serialized,
+                           thread::ThreadPool* thread_pool) {
+  Result expected;
+  Status expected_status =
+      FastParseExample(config, serialized, {}, thread_pool, &expected);
+  Result actual;
+  Status actual_status =
+      FastParseExampleColumnar(config, serialized, {}, thread_pool, &actual);
+  EXPECT_EQ(expected_status, actual_status);
+  if (expected_status.ok() && actual_status.ok()) {
+    ExpectResultsEqual(expected, actual);
+  }
+  return expected_status;
+}
+
+FastParseExampleConfig MixedConfig() {
+  FastParseExampleConfig config;
+  AddDenseFeature("dense_float", DT_FLOAT, {2}, false, 2, &config);
+  config.dense.back().default_value = Tensor(DT_FLOAT, {2});
+  config.dense.back().default_value.flat<float>().setConstant(-1.f);
+  AddDenseFeature("dense_int64", DT_INT64, {1}, false, 1, &config);
+  config.dense.back().default_value = Tensor(DT_INT64, {1});
+  config.dense.back().default_value.flat<int64>().setConstant(-1);
+  AddDenseFeature("dense_string", DT_STRING, {1}, false, 1, &config);
+  config.dense.back().default_value = Tensor(DT_STRING, {1});
+  config.dense.back().default_value.flat<string>()(0) = "default";
+  AddDenseFeature("varlen_float", DT_FLOAT, {-1, 2}, true, 2, &config);
+  AddDenseFeature("varlen_int64", DT_INT64, {-1}, true, 1, &config);
+  AddDenseFeature("varlen_string", DT_STRING, {-1}, true, 1, &config);
+  AddSparseFeature("sparse_float", DT_FLOAT, &config);
+  AddSparseFeature("sparse_int64", DT_INT64, &config);
+  AddSparseFeature("sparse_string", DT_STRING, &config);
+  return config;
 }
 
+// An example with a random subset of the features of MixedConfig(), with
+// int64 values spanning every varint length.
+string RandomMixedExample(random::SimplePhilox* rng) {
+  Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  auto random_int64 = [rng]() -> int64 {
+    return static_cast<int64>(rng->Rand64() >> (rng->Rand32() % 64));
+  };
+  if (rng->OneIn(4)) features["unused"].mutable_int64_list()->add_value(1);
+  if (!rng->OneIn(4)) {
+    features["dense_float"].mutable_float_list()->add_value(rng->RandFloat());
+    features["dense_float"].mutable_float_list()->add_value(rng->RandFloat());
+  }
+  if (!rng->OneIn(4)) {
+    features["dense_int64"].mutable_int64_list()->add_value(random_int64());
+  }
+  if (!rng->OneIn(4)) {
+    features["dense_string"].mutable_bytes_list()->add_value(RandStr(rng));
+  }
+  for (int i = 2 * (rng->Rand32() % 4); i > 0; --i) {
+    features["varlen_float"].mutable_float_list()->add_value(rng->RandFloat());
+  }
+  for (int i = rng->Rand32() % 20; i > 0; --i) {
+    features["varlen_int64"].mutable_int64_list()->add_value(random_int64());
+  }
+  for (int i = rng->Rand32() % 3; i > 0; --i) {
+    features["varlen_string"].mutable_bytes_list()->add_value(RandStr(rng));
+  }
+  for (int i = rng->Rand32() % 5; i > 0; --i) {
+    features["sparse_float"].mutable_float_list()->add_value(rng->RandFloat());
+  }
+  for (int i = rng->Rand32() % 40; i > 0; --i) {
+    features["sparse_int64"].mutable_int64_list()->add_value(random_int64());
+  }
+  if (rng->OneIn(2)) features["sparse_string"].mutable_bytes_list();
+  for (int i = rng->Rand32() % 3; i > 0; --i) {
+    features["sparse_string"].mutable_bytes_list()->add_value(RandStr(rng));
+  }
+  return Serialize(example);
+}
+
+TEST(FastParseExampleColumnar, MatchesFastParseExample) {
+  random::PhiloxRandom philox(1337);
+  random::SimplePhilox rng(&philox);
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  const FastParseExampleConfig config = MixedConfig();
+  for (int batch_size : {0, 1, 7, 100, 1000}) {
+    std::vector<string> serialized;
+    for (int i = 0; i < batch_size; ++i) {
+      serialized.push_back(RandomMixedExample(&rng));
+      // Concatenated examples, where the last value of a feature wins.
+      if (rng.OneIn(10)) serialized.back() += RandomMixedExample(&rng);
+    }
+    TF_EXPECT_OK(TestColumnarMatches(config, serialized, nullptr));
+    TF_EXPECT_OK(TestColumnarMatches(config, serialized, &thread_pool));
+  }
+}
+
+TEST(FastParseExampleColumnar, NonPacked) {
+  FastParseExampleConfig config;
+  AddDenseFeature("age", DT_INT64, {1}, false, 1, &config);
+  TF_EXPECT_OK(TestColumnarMatches(
+      config,
+      {"\x0a\x0d\x0a\x0b\x0a\x03\x61\x67\x65\x12\x04\x1a\x02\x08\x0d"},
+      nullptr));
+  config.dense.clear();
+  AddSparseFeature("age", DT_INT64, &config);
+  TF_EXPECT_OK(TestColumnarMatches(
+      config,
+      {"\x0a\x10\x0a\x0e\x0a\x03\x61\x67\x65\x12\x07"
+       "\x1a\x05\x08\x0d\x08\x96\x01"},
+      nullptr));
+}
+
+TEST(FastParseExampleColumnar, Errors) {
+  const FastParseExampleConfig config = MixedConfig();
+  auto expect_error = [&config](const Example& example,
+                                const string& expected_message) {
+    Result result;
+    Status status = FastParseExampleColumnar(config, {Serialize(example)}, {},
+                                             nullptr, &result);
+    EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+    EXPECT_TRUE(str_util::StrContains(status.error_message(),
+                                      expected_message))
+        << status;
+    TestColumnarMatches(config, {Serialize(example)}, nullptr);
+  };
+
+  Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  features["dense_float"].mutable_int64_list()->add_value(1);
+  expect_error(example, "Data types don't match");
+
+  features.clear();
+  features["dense_float"].mutable_float_list()->add_value(1.f);
+  expect_error(example, "Number of float values != expected");
+
+  features.clear();
+  features["varlen_float"].mutable_float_list()->add_value(1.f);
+  expect_error(example, "is not a multiple of stride length");
+
+  features.clear();
+  features["sparse_string"].mutable_float_list()->add_value(1.f);
+  expect_error(example, "Data types don't match");
+
+  FastParseExampleConfig required;
+  AddDenseFeature("required", DT_FLOAT, {1}, false, 1, &required);
+  required.dense.back().default_value = Tensor();
+  Result result;
+  Status status = FastParseExampleColumnar(required, {Serialize(Example())},
+                                           {}, nullptr, &result);
+  EXPECT_TRUE(str_util::StrContains(status.error_message(), "is required"))
+      << status;
+
+  // Truncated packed varints.
+  const string truncated =
+      "\x0a\x0e\x0a\x0c\x0a\x03\x61\x67\x65\x12\x05\x1a\x03\x0a\x01\x8d";
+  FastParseExampleConfig age;
+  AddSparseFeature("age", DT_INT64, &age);
+  EXPECT_FALSE(
+      FastParseExampleColumnar(age, {truncated}, {}, nullptr, &result).ok());
+}
+
+// Feature mixes for the parsing benchmarks.
+enum class FeatureMix {
+  // Click-through-rate style: scalar dense floats, lists of hashed int64 ids
+  // (six-byte varints) and a few strings.
+  kSparseIds = 0,
+  // Embedding style: long dense float vectors and a small int64 vector.
+  kDenseVectors = 1,
+  // Variable-length lists of small int64 ids (one-byte varints).
+  kVarLenIds = 2,
+};
+
+void MakeBenchmarkBatch(FeatureMix mix, int batch_size,
+                        FastParseExampleConfig* config,
+                        std::vector<string>* serialized) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rng(&philox);
+  std::vector<Example> examples(batch_size);
+  auto add_dense = [config](const string& name, DataType dtype, int64 size) {
+    AddDenseFeature(name.c_str(), dtype, {size}, false, size, config);
+    config->dense.back().default_value = Tensor(dtype, {size});
+  };
+  switch (mix) {
+    case FeatureMix::kSparseIds:
+      for (int f = 0; f < 20; ++f) {
+        add_dense(strings::StrCat("float", f), DT_FLOAT, 1);
+        AddSparseFeature(strings::StrCat("ids", f).c_str(), DT_INT64, config);
+      }
+      AddSparseFeature("query", DT_STRING, config);
+      AddSparseFeature("country", DT_STRING, config);
+      for (Example& example : examples) {
+        auto& features = *example.mutable_features()->mutable_feature();
+        for (int f = 0; f < 20; ++f) {
+          features[strings::StrCat("float", f)].mutable_float_list()->add_value(
+              rng.RandFloat());
+          auto* ids = features[strings::StrCat("ids", f)].mutable_int64_list();
+          for (int i = rng.Uniform(20); i > 0; --i) {
+            ids->add_value(rng.Uniform64(int64{1} << 40));
+          }
+        }
+        features["query"].mutable_bytes_list()->add_value("some search query");
+        features["country"].mutable_bytes_list()->add_value("CH");
+      }
+      break;
+    case FeatureMix::kDenseVectors:
+      for (int f = 0; f < 4; ++f) {
+        add_dense(strings::StrCat("embedding", f), DT_FLOAT, 128);
+      }
+      add_dense("counts", DT_INT64, 64);
+      for (Example& example : examples) {
+        auto& features = *example.mutable_features()->mutable_feature();
+        for (int f = 0; f < 4; ++f) {
+          auto* values =
+              features[strings::StrCat("embedding", f)].mutable_float_list();
+          for (int i = 0; i < 128; ++i) values->add_value(rng.RandFloat());
+        }
+        auto* counts = features["counts"].mutable_int64_list();
+        for (int i = 0; i < 64; ++i) counts->add_value(rng.Uniform(1000));
+      }
+      break;
+    case FeatureMix::kVarLenIds:
+      for (int f = 0; f < 10; ++f) {
+        AddDenseFeature(strings::StrCat("ids", f).c_str(), DT_INT64, {-1}, true,
+                        1, config);
+      }
+      for (Example& example : examples) {
+        auto& features = *example.mutable_features()->mutable_feature();
+        for (int f = 0; f < 10; ++f) {
+          auto* ids = features[strings::StrCat("ids", f)].mutable_int64_list();
+          for (int i = rng.Uniform(100); i > 0; --i) {
+            ids->add_value(rng.Uniform(128));
+          }
+        }
+      }
+      break;
+  }
+  for (const Example& example : examples) {
+    serialized->push_back(Serialize(example));
+  }
+}
+
+void BM_Parse(int iters, int batch_size, int mix, bool columnar) {
+  testing::StopTiming();
+  FastParseExampleConfig config;
+  std::vector<string> serialized;
+  MakeBenchmarkBatch(static_cast<FeatureMix>(mix), batch_size, &config,
+                     &serialized);
+  int64 bytes = 0;
+  for (const string& s : serialized) bytes += s.size();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Result result;
+    if (columnar) {
+      TF_CHECK_OK(
+          FastParseExampleColumnar(config, serialized, {}, nullptr, &result));
+    } else {
+      TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+    }
+  }
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters) * batch_size);
+  testing::BytesProcessed(static_cast<int64>(iters) * bytes);
+}
+
+void BM_FastParseExample(int iters, int batch_size, int mix) {
+  BM_Parse(iters, batch_size, mix, false);
+}
+void BM_FastParseExampleColumnar(int iters, int batch_size, int mix) {
+  BM_Parse(iters, batch_size, mix, true);
+}
+
+BENCHMARK(BM_FastParseExample)
+    ->ArgPair(32, 0)
+    ->ArgPair(512, 0)
+    ->ArgPair(32, 1)
+    ->ArgPair(512, 1)
+    ->ArgPair(32, 2)
+    ->ArgPair(512, 2);
+BENCHMARK(BM_FastParseExampleColumnar)
+    ->ArgPair(32, 0)
+    ->ArgPair(512, 0)
+    ->ArgPair(32, 1)
+    ->ArgPair(512, 1)
+    ->ArgPair(32, 2)
+    ->ArgPair(512, 2);
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
@@ -21,6 +21,7 @@ limitations under the License.
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb_text.h"
@@ -365,6 +366,33 @@ Status PadAlignment(FileOutputBuffer* out, int alignment, int64* size) {
   return status;
 }
 
+// A read-only buffer aliasing part of a memory-mapped data file, which it keeps
+// mapped for as long as the buffer is alive.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region, char* data,
+                     size_t size)
+      : region_(std::move(region)), data_(data), size_(size) {}
+
+  void* data() const override { return data_; }
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("BundleReaderMemoryMap");
+  }
+  // The mapping is read-only, so the buffer must never be forwarded to an
+  // output or updated in place.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  char* const data_;
+  const size_t size_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MappedTensorBuffer);
+};
+
 }  // namespace
 
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
@@ -696,8 +724,13 @@ Status MergeBundles(Env* env, gtl::ArraySlice<string> prefixes,
 // Interface for reading a tensor bundle.
 
 BundleReader::BundleReader(Env* env, StringPiece prefix)
+    : BundleReader(env, prefix, Options()) {}
+
+BundleReader::BundleReader(Env* env, StringPiece prefix,
+                           const Options& options)
     : env_(env),
       prefix_(std::string(prefix)),
+      options_(options),
       metadata_(nullptr),
       table_(nullptr),
       iter_(nullptr) {
@@ -775,7 +808,74 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return Status::OK();
 }
 
+Status BundleReader::GetMappedDataFile(
+    int32 shard_id, std::shared_ptr<ReadOnlyMemoryRegion>* region) {
+  auto it = mapped_data_.find(shard_id);
+  if (it == mapped_data_.end()) {
+    std::unique_ptr<ReadOnlyMemoryRegion> mapped;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(
+        DataFilename(prefix_, shard_id, num_shards_), &mapped);
+    if (errors::IsUnimplemented(s)) {
+      VLOG(1) << "Memory-mapping is not supported for " << prefix_
+              << ", reading through a buffer instead: " << s;
+    } else if (!s.ok()) {
+      return s;
+    }
+    it = mapped_data_.emplace(shard_id, std::move(mapped)).first;
+  }
+  *region = it->second;
+  return Status::OK();
+}
+
+Status BundleReader::GetMappedValue(
+    const BundleEntryProto& entry,
+    const std::shared_ptr<ReadOnlyMemoryRegion>& region, Tensor* val) {
+  const TensorShape stored_shape(TensorShape(entry.shape()));
+  const TensorShape& shape =
+      val->NumElements() == 0 ? stored_shape : val->shape();
+  const uint64 expected_size =
+      shape.num_elements() * DataTypeSize(entry.dtype());
+  if (entry.size() != expected_size) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+                            "; stored size ", entry.size(),
+                            "; expected size ", expected_size);
+  }
+  if (entry.offset() > region->length() ||
+      entry.size() > region->length() - entry.offset()) {
+    return errors::DataLoss("Invalid offset in bundle entry: key ", key(),
+                            "; offset ", entry.offset(), ", size ",
+                            entry.size(), "; data file size ",
+                            region->length());
+  }
+  const char* data = static_cast<const char*>(region->data()) + entry.offset();
+  const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the mapped bytes ", actual_crc32c);
+  }
+
+  if (reinterpret_cast<uintptr_t>(data) % EIGEN_MAX_ALIGN_BYTES == 0) {
+    MappedTensorBuffer* buf = new MappedTensorBuffer(
+        region, const_cast<char*>(data), entry.size());
+    *val = Tensor(entry.dtype(), shape, buf);
+    buf->Unref();
+  } else {
+    // Eigen requires aligned buffers, so unaligned data is still copied.
+    if (val->NumElements() == 0) *val = Tensor(entry.dtype(), stored_shape);
+    memcpy(const_cast<char*>(val->tensor_data().data()), data, entry.size());
+  }
+  return Status::OK();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
+  if (options_.memory_map_data && DataTypeCanUseMemcpy(entry.dtype())) {
+    std::shared_ptr<ReadOnlyMemoryRegion> region;
+    TF_RETURN_IF_ERROR(GetMappedDataFile(entry.shard_id(), &region));
+    if (region != nullptr) return GetMappedValue(entry, region, val);
+  }
+
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
   if (val->NumElements() == 0) {
@@ -64,6 +64,7 @@ limitations under the License.
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -181,7 +182,18 @@ Status MergeBundles(Env* env, gtl::ArraySlice<string> prefixes,
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
+  struct Options {
+    // If true, data files are memory-mapped (where the file system supports
+    // it) instead of read through a buffer. Tensors of memcpy-able types
+    // whose data is stored at an offset aligned to EIGEN_MAX_ALIGN_BYTES (see
+    // BundleWriter::Options::data_alignment) are then returned aliasing the
+    // mapping rather than copied. Such tensors are read-only: they are never
+    // forwarded or updated in place, and they keep the mapping alive after
+    // the reader is destroyed.
+    bool memory_map_data = false;
+  };
   BundleReader(Env* const env, StringPiece prefix);
+  BundleReader(Env* const env, StringPiece prefix, const Options& options);
   ~BundleReader();
 
   // Is ok() iff the reader construction is successful (completed the read of
@@ -210,6 +222,8 @@ class BundleReader {
   // Caller must make sure "val" has the same shape and dtype as the
   // corresponding contents, so that its buffer can be filled without needing
   // extra allocation.  These can be queried via "LookupDtypeAndShape()".
+  // With Options::memory_map_data, the buffer of "val" may instead be
+  // replaced by one aliasing the data file.
   //
   // On error, "val" may contain nonsense data.  Returns a NotFound error if
   // tensor keyed by "key" does not exist in this bundle.
@@ -274,6 +288,18 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Returns the memory-mapped data file "shard_id" in *region, or nullptr if
+  // the file system does not support memory-mapping.
+  Status GetMappedDataFile(int32 shard_id,
+                           std::shared_ptr<ReadOnlyMemoryRegion>* region)
+      TF_MUST_USE_RESULT;
+
+  // Reads the tensor described by "entry" from the memory-mapped data file
+  // "region", aliasing the mapping if its data is suitably aligned.
+  Status GetMappedValue(const BundleEntryProto& entry,
+                        const std::shared_ptr<ReadOnlyMemoryRegion>& region,
+                        Tensor* val) TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -284,6 +310,7 @@ class BundleReader {
 
   Env* env_;  // Not owned.
   const string prefix_;
+  const Options options_;
 
   Status status_;
   RandomAccessFile* metadata_;  // Owned.
@@ -291,6 +318,9 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // Data files that have been memory-mapped, with Options::memory_map_data.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
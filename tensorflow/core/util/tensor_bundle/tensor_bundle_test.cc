@@ -825,6 +825,96 @@ TEST_F(TensorBundleAlignmentTest, AlignmentTest) {
   }
 }
 
+TEST(TensorBundleTest, MemoryMapped) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("mmap"), opts);
+    TF_EXPECT_OK(writer.Add("bool", Constant(true, TensorShape({3}))));
+    TF_EXPECT_OK(writer.Add("float", Constant_2x3<float>(1.5)));
+    TF_EXPECT_OK(writer.Add("int64", Constant_2x3<int64>(-7)));
+    TF_EXPECT_OK(
+        writer.Add("string", test::AsTensor<string>({"hello", "world"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options opts;
+  opts.memory_map_data = true;
+  BundleReader reader(Env::Default(), Prefix("mmap"), opts);
+  TF_ASSERT_OK(reader.status());
+  Expect<bool>(&reader, "bool", Constant(true, TensorShape({3})));
+  Expect<float>(&reader, "float", Constant_2x3<float>(1.5));
+  Expect<int64>(&reader, "int64", Constant_2x3<int64>(-7));
+  Expect<string>(&reader, "string", test::AsTensor<string>({"hello", "world"}));
+  Tensor slice(DT_FLOAT, TensorShape({1, 3}));
+  TF_ASSERT_OK(reader.LookupSlice("float", TensorSlice({{1, 1}, {0, 3}}),
+                                  &slice));
+  test::ExpectTensorEqual<float>(slice, Constant(1.5f, TensorShape({1, 3})));
+
+  // Aligned tensors alias the mapping, so repeated lookups share their data,
+  // which outlives the reader.
+  Tensor a, b;
+  TF_ASSERT_OK(reader.Lookup("float", &a));
+  TF_ASSERT_OK(reader.Lookup("float", &b));
+  EXPECT_EQ(a.tensor_data().data(), b.tensor_data().data());
+  Tensor c;
+  {
+    BundleReader other_reader(Env::Default(), Prefix("mmap"), opts);
+    TF_ASSERT_OK(other_reader.Lookup("int64", &c));
+  }
+  test::ExpectTensorEqual<int64>(c, Constant_2x3<int64>(-7));
+}
+
+TEST(TensorBundleTest, MemoryMappedUnaligned) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("mmap_unaligned"));
+    TF_EXPECT_OK(writer.Add("a", Constant(true, TensorShape({1}))));
+    TF_EXPECT_OK(writer.Add("b", Constant_2x3<float>(2.5)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options opts;
+  opts.memory_map_data = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_unaligned"), opts);
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "b", Constant_2x3<float>(2.5));
+
+  // Unaligned data is copied instead of aliased.
+  Tensor a, b;
+  TF_ASSERT_OK(reader.Lookup("b", &a));
+  TF_ASSERT_OK(reader.Lookup("b", &b));
+  EXPECT_NE(a.tensor_data().data(), b.tensor_data().data());
+  test::ExpectTensorEqual<float>(a, Constant_2x3<float>(2.5));
+}
+
+TEST(TensorBundleTest, MemoryMappedChecksum) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("mmap_checksum"));
+    TF_EXPECT_OK(writer.Add("foo", Constant_2x3(1.f)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  const string datafile = DataFilename(Prefix("mmap_checksum"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), datafile, &data));
+  data[0] = ~data[0];
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile, data));
+
+  BundleReader::Options opts;
+  opts.memory_map_data = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_checksum"), opts);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  Status status = reader.Lookup("foo", &val);
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(
+      str_util::StrContains(status.ToString(), "Checksum does not match"));
+
+  // Truncating the data file is caught before reading past the mapping.
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile,
+                                 StringPiece(data.data(), data.size() - 1)));
+  BundleReader truncated_reader(Env::Default(), Prefix("mmap_checksum"), opts);
+  TF_ASSERT_OK(truncated_reader.status());
+  EXPECT_TRUE(errors::IsDataLoss(truncated_reader.Lookup("foo", &val)));
+}
+
 static void BM_BundleAlignmentByteOff(int iters, int alignment,
                                       int tensor_size) {
   testing::StopTiming();
@@ -859,4 +949,47 @@ BM_BundleAlignment(4096, 512);
 BM_BundleAlignment(4096, 4096);
 BM_BundleAlignment(4096, 1048576);
 
+// Loads "num_tensors" float tensors of "tensor_size" elements each, as a
+// restore would, from a bundle written with 64-byte alignment.
+static void BM_BundleLoad(int iters, int num_tensors, int tensor_size,
+                          bool memory_map_data) {
+  testing::StopTiming();
+  const string prefix = Prefix(strings::StrCat("load_", num_tensors));
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), prefix, opts);
+    for (int i = 0; i < num_tensors; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("t", i),
+                             Constant(1.f, TensorShape({tensor_size}))));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  BundleReader::Options opts;
+  opts.memory_map_data = memory_map_data;
+  testing::BytesProcessed(static_cast<int64>(iters) * num_tensors *
+                          tensor_size * sizeof(float));
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    BundleReader reader(Env::Default(), prefix, opts);
+    TF_CHECK_OK(reader.status());
+    std::vector<Tensor> tensors(num_tensors);
+    for (int j = 0; j < num_tensors; ++j) {
+      TF_CHECK_OK(reader.Lookup(strings::StrCat("t", j), &tensors[j]));
+    }
+  }
+  testing::StopTiming();
+}
+
+static void BM_BundleLoadCopy(int iters, int num_tensors) {
+  BM_BundleLoad(iters, num_tensors, 1 << 20, false);
+}
+BENCHMARK(BM_BundleLoadCopy)->Arg(1)->Arg(16)->Arg(64);
+
+static void BM_BundleLoadMemoryMapped(int iters, int num_tensors) {
+  BM_BundleLoad(iters, num_tensors, 1 << 20, true);
+}
+BENCHMARK(BM_BundleLoadMemoryMapped)->Arg(1)->Arg(16)->Arg(64);
+
 }  // namespace tensorflow
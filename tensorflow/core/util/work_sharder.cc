@@ -15,8 +15,18 @@ limitations under the License.
 
 #include "tensorflow/core/util/work_sharder.h"
 
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+
+#include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -29,13 +39,79 @@ void SetPerThreadMaxParallelism(int max_parallelism) {
 
 int GetPerThreadMaxParallelism() { return per_thread_max_parallism; }
 
-void Shard(int max_parallelism, thread::ThreadPool* workers, int64 total,
-           int64 cost_per_unit, std::function<void(int64, int64)> work) {
-  CHECK_GE(total, 0);
-  if (total == 0) {
-    return;
+namespace {
+
+std::atomic<bool>* AdaptiveShardingFlag() {
+  static std::atomic<bool>* flag = [] {
+    bool enabled = false;
+    Status status =
+        ReadBoolFromEnvVar("TF_ADAPTIVE_SHARDING", false, &enabled);
+    if (!status.ok()) {
+      LOG(ERROR) << "AdaptiveShardingFlag: " << status.error_message();
+    }
+    return new std::atomic<bool>(enabled);
+  }();
+  return flag;
+}
+
+/* ABSL_CONST_INIT */ thread_local const string* per_thread_sharding_kernel =
+    nullptr;
+
+// Measured costs are kept in fixed point, so that cheap element-wise work
+// below a nanosecond per unit is still told apart.
+const int64 kCostScale = 16;
+
+// Used when the platform does not report the CPU frequency.
+const double kDefaultCyclesPerNano = 3.0;
+
+// "cost_per_unit" is in CPU cycles but the model measures nanoseconds.
+double CyclesPerNano() {
+  static const double cycles_per_nano = [] {
+    const double cycles_per_nano = port::NominalCPUFrequency() * 1e-9;
+    // NominalCPUFrequency() returns 1.0 when unknown.
+    return cycles_per_nano >= 0.1 ? cycles_per_nano : kDefaultCyclesPerNano;
+  }();
+  return cycles_per_nano;
+}
+
+// Per kernel type and log2(total), an exponential moving average of the
+// measured nanoseconds per unit of work (times kCostScale), or 0 if none.
+class ShardCostModel {
+ public:
+  static ShardCostModel* Global() {
+    static ShardCostModel* model = new ShardCostModel;
+    return model;
   }
-  max_parallelism = std::min(max_parallelism, GetPerThreadMaxParallelism());
+
+  std::atomic<int64>* Cost(const string& kernel_type, int64 total) {
+    const int bucket = Log2Floor64(total);
+    {
+      tf_shared_lock l(mu_);
+      auto it = kernels_.find(kernel_type);
+      if (it != kernels_.end()) return &it->second->cost[bucket];
+    }
+    mutex_lock l(mu_);
+    std::unique_ptr<KernelCosts>& costs = kernels_[kernel_type];
+    if (costs == nullptr) costs.reset(new KernelCosts);
+    return &costs->cost[bucket];
+  }
+
+ private:
+  struct KernelCosts {
+    KernelCosts() {
+      for (auto& c : cost) c = 0;
+    }
+    std::atomic<int64> cost[64];
+  };
+
+  mutex mu_;
+  std::unordered_map<string, std::unique_ptr<KernelCosts>> kernels_
+      GUARDED_BY(mu_);
+};
+
+void ShardInternal(int max_parallelism, thread::ThreadPool* workers,
+                   int64 total, int64 cost_per_unit,
+                   const std::function<void(int64, int64)>& work) {
   if (max_parallelism <= 1) {
     // Just inline the whole work since we only have 1 thread (core).
     work(0, total);
@@ -50,6 +126,76 @@ void Shard(int max_parallelism, thread::ThreadPool* workers, int64 total,
               max_parallelism);
 }
 
+}  // namespace
+
+void SetAdaptiveShardingEnabled(bool enabled) {
+  AdaptiveShardingFlag()->store(enabled, std::memory_order_relaxed);
+}
+
+bool AdaptiveShardingEnabled() {
+  return AdaptiveShardingFlag()->load(std::memory_order_relaxed);
+}
+
+ScopedShardingKernel::ScopedShardingKernel(const string& kernel_type)
+    : previous_(per_thread_sharding_kernel) {
+  per_thread_sharding_kernel = &kernel_type;
+}
+
+ScopedShardingKernel::~ScopedShardingKernel() {
+  per_thread_sharding_kernel = previous_;
+}
+
+void SetShardCostForTesting(const string& kernel_type, int64 total,
+                            int64 cost_per_unit) {
+  const int64 measured =
+      std::llround(cost_per_unit * kCostScale / CyclesPerNano());
+  ShardCostModel::Global()
+      ->Cost(kernel_type, total)
+      ->store(std::max<int64>(1, measured), std::memory_order_relaxed);
+}
+
+void Shard(int max_parallelism, thread::ThreadPool* workers, int64 total,
+           int64 cost_per_unit, std::function<void(int64, int64)> work) {
+  CHECK_GE(total, 0);
+  if (total == 0) {
+    return;
+  }
+  max_parallelism = std::min(max_parallelism, GetPerThreadMaxParallelism());
+  if (per_thread_sharding_kernel == nullptr || !AdaptiveShardingEnabled()) {
+    ShardInternal(max_parallelism, workers, total, cost_per_unit, work);
+    return;
+  }
+
+  std::atomic<int64>* cost =
+      ShardCostModel::Global()->Cost(*per_thread_sharding_kernel, total);
+  const int64 measured = cost->load(std::memory_order_relaxed);
+  if (measured > 0) {
+    // Only a lower measured cost is used. It merges shards whose overhead
+    // outweighs their work, which pays off on any machine. A higher one
+    // would add shards, which only pays off with idle cores to run them, and
+    // is slower than the caller's estimate otherwise.
+    cost_per_unit = std::min(
+        cost_per_unit,
+        std::max<int64>(
+            1, std::llround(measured * CyclesPerNano() / kCostScale)));
+  }
+  // Every shard times itself, so the sum is the cost of the work alone,
+  // independent of how it was split and scheduled.
+  Env* env = Env::Default();
+  std::atomic<int64> elapsed_nanos(0);
+  ShardInternal(max_parallelism, workers, total, cost_per_unit,
+                [env, &elapsed_nanos, &work](int64 start, int64 limit) {
+                  const uint64 start_nanos = env->NowNanos();
+                  work(start, limit);
+                  elapsed_nanos.fetch_add(env->NowNanos() - start_nanos,
+                                          std::memory_order_relaxed);
+                });
+  const int64 sample =
+      std::max(int64{1}, elapsed_nanos.load() * kCostScale / total);
+  cost->store(measured == 0 ? sample : measured + (sample - measured) / 4,
+              std::memory_order_relaxed);
+}
+
 void Sharder::Do(int64 total, int64 cost_per_unit, const Work& work,
                  const Runner& runner, int max_parallelism) {
   cost_per_unit = std::max(int64{1}, cost_per_unit);
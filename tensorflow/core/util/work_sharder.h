@@ -19,6 +19,7 @@ limitations under the License.
 #include <functional>
 
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
@@ -79,6 +80,36 @@ class ScopedPerThreadMaxParallelism {
   int previous_ = -1;
 };
 
+// Adaptive sharding. When enabled, Shard() calls made on behalf of a kernel
+// (see ScopedShardingKernel) time the work they run, and later calls from
+// the same kernel type with a similar "total" (same power of two) use the
+// measured cost per unit instead of the caller's "cost_per_unit" if it is
+// lower, so that work the caller overestimates is not split into shards that
+// cost more than they compute. The measured nanoseconds are converted to
+// cycles with the nominal CPU frequency. Disabled by default; the
+// TF_ADAPTIVE_SHARDING environment variable sets the initial value.
+void SetAdaptiveShardingEnabled(bool enabled);
+bool AdaptiveShardingEnabled();
+
+// Records "cost_per_unit" cycles as the measured cost of "kernel_type" for
+// inputs of a size similar to "total". Only for tests.
+void SetShardCostForTesting(const string& kernel_type, int64 total,
+                            int64 cost_per_unit);
+
+// Names the kernel type on whose behalf the current thread calls Shard(),
+// for adaptive sharding. ThreadPoolDevice sets it around OpKernel::Compute.
+// "kernel_type" must outlive this object.
+class ScopedShardingKernel {
+ public:
+  explicit ScopedShardingKernel(const string& kernel_type);
+  ~ScopedShardingKernel();
+
+ private:
+  const string* previous_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedShardingKernel);
+};
+
 // Implementation details for Shard().
 class Sharder {
  public:
@@ -89,6 +89,58 @@ TEST(Shard, OverflowTest) {
   }
 }
 
+int64 AdaptiveNumShards(const string& kernel_type, int64 total,
+                        int64 cost_per_unit, int64 measured_cost_per_unit,
+                        thread::ThreadPool* threads) {
+  SetShardCostForTesting(kernel_type, total, measured_cost_per_unit);
+  std::atomic<int64> num_shards(0);
+  std::atomic<int64> num_done_work(0);
+  Shard(4, threads, total, cost_per_unit,
+        [&num_shards, &num_done_work](int64 start, int64 limit) {
+          ++num_shards;
+          num_done_work += limit - start;
+        });
+  EXPECT_EQ(total, num_done_work.load());
+  return num_shards.load();
+}
+
+TEST(Shard, AdaptiveUsesMeasuredCost) {
+  thread::ThreadPool threads(Env::Default(), "test", 16);
+  SetAdaptiveShardingEnabled(true);
+  const string kernel_type = "AdaptiveUsesMeasuredCost";
+  ScopedShardingKernel sharding_kernel(kernel_type);
+  ScopedPerThreadMaxParallelism s(4);
+  // 1000 units of 5 cycles fit in one shard, whatever the caller claims.
+  EXPECT_EQ(1, AdaptiveNumShards(kernel_type, 1000, 1000000, 5, &threads));
+  // 1000 units of 35 cycles are split in 3 shards of at least 10000 cycles.
+  EXPECT_EQ(3, AdaptiveNumShards(kernel_type, 1000, 1000000, 35, &threads));
+  // 1000 units of 1000 cycles use all 4 threads.
+  EXPECT_EQ(4, AdaptiveNumShards(kernel_type, 1000, 1000000, 1000, &threads));
+  // A higher measured cost does not add shards.
+  EXPECT_EQ(1, AdaptiveNumShards(kernel_type, 1000, 1, 1000, &threads));
+  SetAdaptiveShardingEnabled(false);
+}
+
+TEST(Shard, AdaptiveBasic) {
+  thread::ThreadPool threads(Env::Default(), "test", 16);
+  SetAdaptiveShardingEnabled(true);
+  const string kernel_type = "AdaptiveBasic";
+  ScopedShardingKernel sharding_kernel(kernel_type);
+  for (auto workers : {0, 1, 2, 7, 100}) {
+    for (auto total : {0, 1, 7, 100, 9999}) {
+      for (auto cost_per_unit : {0, 11, 10005}) {
+        for (auto maxp : {1, 4, 100}) {
+          ScopedPerThreadMaxParallelism s(maxp);
+          // Twice, so that the second call uses the measured cost.
+          RunSharding(workers, total, cost_per_unit, maxp, &threads);
+          RunSharding(workers, total, cost_per_unit, maxp, &threads);
+        }
+      }
+    }
+  }
+  SetAdaptiveShardingEnabled(false);
+}
+
 void BM_Sharding(int iters, int arg) {
   thread::ThreadPool threads(Env::Default(), "test", 16);
   const int64 total = 1LL << 30;
@@ -100,5 +152,64 @@ void BM_Sharding(int iters, int arg) {
 }
 BENCHMARK(BM_Sharding)->Range(1, 128);
 
+// An element-wise add over "size" floats whose caller overestimates the cost
+// per element 1000x, so static sharding splits even small inputs.
+void BM_ShardCwise(int iters, int adaptive, int size) {
+  testing::StopTiming();
+  thread::ThreadPool threads(Env::Default(), "test", 16);
+  std::vector<float> a(size, 1.0f), b(size, 2.0f), out(size);
+  SetAdaptiveShardingEnabled(adaptive);
+  const string kernel_type = "BM_ShardCwise";
+  ScopedShardingKernel sharding_kernel(kernel_type);
+  auto work = [&a, &b, &out](int64 start, int64 limit) {
+    for (int64 i = start; i < limit; ++i) out[i] = a[i] + b[i];
+  };
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Shard(16, &threads, size, 1000, work);
+  }
+  testing::StopTiming();
+  SetAdaptiveShardingEnabled(false);
+  testing::ItemsProcessed(static_cast<int64>(iters) * size);
+}
+BENCHMARK(BM_ShardCwise)
+    ->ArgPair(0, 1 << 10)
+    ->ArgPair(1, 1 << 10)
+    ->ArgPair(0, 1 << 16)
+    ->ArgPair(1, 1 << 16);
+
+// Sums each of "rows" rows of 4096 floats, with the caller underestimating
+// the cost per row 1000x, so static sharding keeps large inputs serial.
+void BM_ShardReduction(int iters, int adaptive, int rows) {
+  testing::StopTiming();
+  const int kCols = 4096;
+  thread::ThreadPool threads(Env::Default(), "test", 16);
+  std::vector<float> in(static_cast<size_t>(rows) * kCols, 1.0f), out(rows);
+  SetAdaptiveShardingEnabled(adaptive);
+  const string kernel_type = "BM_ShardReduction";
+  ScopedShardingKernel sharding_kernel(kernel_type);
+  auto work = [&in, &out](int64 start, int64 limit) {
+    for (int64 r = start; r < limit; ++r) {
+      float sum = 0;
+      for (int c = 0; c < kCols; ++c) sum += in[r * kCols + c];
+      out[r] = sum;
+    }
+  };
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Shard(16, &threads, rows, 4, work);
+  }
+  testing::StopTiming();
+  SetAdaptiveShardingEnabled(false);
+  testing::ItemsProcessed(static_cast<int64>(iters) * rows * kCols);
+}
+BENCHMARK(BM_ShardReduction)
+    ->ArgPair(0, 16)
+    ->ArgPair(1, 16)
+    ->ArgPair(0, 256)
+    ->ArgPair(1, 256);
+
 }  // namespace
 }  // namespace tensorflow
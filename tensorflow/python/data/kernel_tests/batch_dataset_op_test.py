@@ -43,6 +43,7 @@ class BatchDatasetTest(test.TestCase, parameterized.TestCase):
       ('even', 28, 14, False),
       ('uneven_with_remainder', 28, 15, False),
       ('uneven_without_remainder', 28, 15, True),
+      ('batch_size_one', 28, 1, False),
       ('empty', 0, 14, False),
   )
   def testBatchDataset(self, count, batch_size, drop_remainder):
@@ -107,6 +108,49 @@ class BatchDatasetTest(test.TestCase, parameterized.TestCase):
       with self.assertRaises(errors.OutOfRangeError):
         sess.run(get_next)
 
+  def testBatchStrings(self):
+    components = np.array([b'a', b'bb', b'ccc', b'dddd', b'eeeee'])
+    iterator = (dataset_ops.Dataset.from_tensor_slices(components)
+                .batch(2).make_one_shot_iterator())
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      self.assertAllEqual(components[0:2], sess.run(get_next))
+      self.assertAllEqual(components[2:4], sess.run(get_next))
+      self.assertAllEqual(components[4:], sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testBatchSizeLargerThanInput(self):
+    # Only the elements that the input produces are allocated.
+    iterator = (dataset_ops.Dataset.range(10).batch(1 << 40)
+                .make_one_shot_iterator())
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      self.assertAllEqual(np.arange(10), sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testRecycledBatchesKeepTheirValues(self):
+    # Batch buffers are recycled once released, so batches that the consumer
+    # still holds must not be overwritten by later ones.
+    element_size = 1 << 10
+    dataset = dataset_ops.Dataset.range(23).map(
+        lambda x: array_ops.fill([element_size], math_ops.to_float(x)))
+    iterator = dataset.batch(5).make_one_shot_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      results = [sess.run(get_next) for _ in range(5)]
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+    for i, result in enumerate(results):
+      end = min(5 * (i + 1), 23)
+      self.assertEqual((end - 5 * i, element_size), result.shape)
+      self.assertAllEqual(np.arange(5 * i, end), result[:, 0])
+      self.assertAllEqual(np.arange(5 * i, end), result[:, -1])
+
   def testBatchDatasetInvalidBatchSize(self):
     iterator = (dataset_ops.Dataset.range(10).batch(0).make_one_shot_iterator())
     get_next = iterator.get_next()
@@ -513,6 +557,39 @@ class BatchDatasetBenchmark(test.Benchmark):
             name='benchmark_batch_sparse_dataset_nnz_%d_batch_size_%d' % (
                 non_zeros_per_row, batch_size))
 
+  def benchmarkBatchDense(self):
+    for element_exp in [10, 12, 14, 16, 18]:
+      element_size = 1 << element_exp
+      for batch_size in [1, 32, 128]:
+        dataset = dataset_ops.Dataset.from_tensors(
+            np.random.rand(element_size).astype(np.float32)).repeat(
+                ).batch(batch_size)
+        iterator = dataset.make_one_shot_iterator()
+        next_element = iterator.get_next()
+
+        with session.Session() as sess:
+          # Run five steps to warm up the session caches before taking the
+          # first measurement.
+          for _ in range(5):
+            sess.run(next_element.op)
+          deltas = []
+          for _ in range(100):
+            start = time.time()
+            for _ in range(10):
+              sess.run(next_element.op)
+            end = time.time()
+            deltas.append(end - start)
+
+        median_wall_time = np.median(deltas) / 10.0
+
+        print('Batch dense dataset element size: %d batch_size: %d '
+              'wall time: %f'
+              % (element_size, batch_size, median_wall_time))
+        self.report_benchmark(
+            iters=1000, wall_time=median_wall_time,
+            name='benchmark_batch_dense_dataset_elem_size_%d_batch_size_%d' % (
+                element_size, batch_size))
+
 
 if __name__ == '__main__':
   test.main()
@@ -180,8 +180,9 @@ class MapDatasetTest(test.TestCase):
                                                    results[i * 18 + j]):
               self.assertAllEqual(component[i]**2, result_component)
 
+      # `-1` lets the performance model of the pipeline pick the value.
       for num_parallel_calls_val, output_buffer_size_val in [
-          (1, 1), (1, 2), (2, 2), (2, 4), (8, 8), (8, 16)]:
+          (1, 1), (1, 2), (2, 2), (2, 4), (8, 8), (8, 16), (-1, -1)]:
         do_test(num_parallel_calls_val, output_buffer_size_val)
 
   def testImplicitDisposeParallelMapDataset(self):
@@ -732,5 +733,40 @@ class MapDatasetBenchmark(test.Benchmark):
               name="benchmark_map_dataset_fan_out_%d" % fan_out)
 
 
+  def benchmarkAutotuneParallelMap(self):
+    # A pipeline dominated by its map stage; the auto-tuned pipeline should
+    # approach the throughput of the best fixed degree of parallelism.
+    for num_parallel_calls in [1, 2, 4, 8, 16, -1]:
+      with ops.Graph().as_default():
+        dataset = dataset_ops.Dataset.from_tensors(
+            random_ops.random_uniform([64, 64])).repeat(None)
+        dataset = dataset.map(
+            lambda x: math_ops.matmul(math_ops.matmul(x, x), x),
+            num_parallel_calls=num_parallel_calls).prefetch(-1)
+        iterator = dataset.make_one_shot_iterator()
+        next_element = iterator.get_next()
+
+        with session.Session() as sess:
+          # Give the performance model time to converge.
+          for _ in range(2000):
+            sess.run(next_element.op)
+          deltas = []
+          for _ in range(20):
+            start = time.time()
+            for _ in range(100):
+              sess.run(next_element.op)
+            end = time.time()
+            deltas.append(end - start)
+
+          median_wall_time = np.median(deltas) / 100
+          name = ("autotune" if num_parallel_calls == -1 else
+                  "%d" % num_parallel_calls)
+          print("Parallel map num_parallel_calls: %s Median wall time: %f"
+                % (name, median_wall_time))
+          self.report_benchmark(
+              iters=2000, wall_time=median_wall_time,
+              name="benchmark_parallel_map_dataset_parallelism_%s" % name)
+
+
 if __name__ == "__main__":
   test.main()
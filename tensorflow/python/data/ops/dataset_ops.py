@@ -609,7 +609,8 @@ class Dataset(object):
 
     Args:
       buffer_size: A `tf.int64` scalar `tf.Tensor`, representing the
-        maximum number of elements that will be buffered when prefetching.
+        maximum number of elements that will be buffered when prefetching. If
+        the value `-1` is used, the buffer size is tuned dynamically.
 
     Returns:
       Dataset: A `Dataset`.
@@ -996,7 +997,10 @@ class Dataset(object):
        `self.output_types`) to another nested structure of tensors.
       num_parallel_calls: (Optional.) A `tf.int32` scalar `tf.Tensor`,
         representing the number elements to process in parallel. If not
-        specified, elements will be processed sequentially.
+        specified, elements will be processed sequentially. If the value `-1`
+        is used, the number of parallel calls is tuned dynamically, together
+        with the other tunable stages of the input pipeline, within the
+        number of available CPUs.
 
     Returns:
       Dataset: A `Dataset`.
@@ -2244,12 +2248,14 @@ class MapDataset(Dataset):
 class ParallelMapDataset(MapDataset):
   """A `Dataset` that maps a function over elements in its input in parallel."""
 
-  def __init__(self, input_dataset, map_func, num_parallel_calls):
+  def __init__(self, input_dataset, map_func, num_parallel_calls,
+               sloppy=False):
     """See `Dataset.map()` for details."""
     super(ParallelMapDataset, self).__init__(input_dataset, map_func)
 
     self._num_parallel_calls = ops.convert_to_tensor(
         num_parallel_calls, dtype=dtypes.int32, name="num_parallel_calls")
+    self._sloppy = sloppy
 
   def _as_variant_tensor(self):
     input_t = self._input_dataset._as_variant_tensor()  # pylint: disable=protected-access
@@ -2259,6 +2265,7 @@ class ParallelMapDataset(MapDataset):
         self._map_func.captured_inputs,
         f=self._map_func,
         num_parallel_calls=self._num_parallel_calls,
+        sloppy=self._sloppy,
         **flat_structure(self))
     # pylint: enable=protected-access
 
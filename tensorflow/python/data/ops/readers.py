@@ -77,7 +77,8 @@ class TextLineDataset(dataset_ops.Dataset):
 class _TFRecordDataset(dataset_ops.Dataset):
   """A `Dataset` comprising records from one or more TFRecord files."""
 
-  def __init__(self, filenames, compression_type=None, buffer_size=None):
+  def __init__(self, filenames, compression_type=None, buffer_size=None,
+               read_ahead_blocks=None):
     """Creates a `TFRecordDataset`.
 
     Args:
@@ -86,6 +87,8 @@ class _TFRecordDataset(dataset_ops.Dataset):
         `""` (no compression), `"ZLIB"`, or `"GZIP"`.
       buffer_size: (Optional.) A `tf.int64` scalar representing the number of
         bytes in the read buffer. 0 means no buffering.
+      read_ahead_blocks: (Optional.) A Python integer representing the number
+        of blocks to read and verify in the background. 0 disables read-ahead.
     """
     super(_TFRecordDataset, self).__init__()
     # Force the type to string even if filenames is an empty list.
@@ -100,10 +103,12 @@ class _TFRecordDataset(dataset_ops.Dataset):
         "buffer_size",
         buffer_size,
         argument_default=_DEFAULT_READER_BUFFER_SIZE_BYTES)
+    self._read_ahead_blocks = read_ahead_blocks or 0
 
   def _as_variant_tensor(self):
     return gen_dataset_ops.tf_record_dataset(
-        self._filenames, self._compression_type, self._buffer_size)
+        self._filenames, self._compression_type, self._buffer_size,
+        read_ahead_blocks=self._read_ahead_blocks)
 
   @property
   def output_classes(self):
@@ -160,11 +165,13 @@ class TFRecordDataset(dataset_ops.Dataset):
   """A `Dataset` comprising records from one or more TFRecord files."""
 
   def __init__(self, filenames, compression_type=None, buffer_size=None,
-               num_parallel_reads=None):
+               num_parallel_reads=None, read_ahead_blocks=None):
     """Creates a `TFRecordDataset` to read for one or more TFRecord files.
 
     NOTE: The `num_parallel_reads` argument can be used to improve performance
-    when reading from a remote filesystem.
+    when reading from a remote filesystem. The `read_ahead_blocks` argument
+    overlaps reading and checksum verification of uncompressed files with
+    consumption of their records.
 
     Args:
       filenames: A `tf.string` tensor or `tf.data.Dataset` containing one or
@@ -176,6 +183,9 @@ class TFRecordDataset(dataset_ops.Dataset):
       num_parallel_reads: (Optional.) A `tf.int64` scalar representing the
         number of files to read in parallel. Defaults to reading files
         sequentially.
+      read_ahead_blocks: (Optional.) A Python integer representing the number
+        of blocks to read and verify ahead of the reader in each file. Ignored
+        for compressed files. Defaults to no read-ahead.
 
     Raises:
       TypeError: If any argument does not have the expected type.
@@ -199,9 +209,11 @@ class TFRecordDataset(dataset_ops.Dataset):
     self._compression_type = compression_type
     self._buffer_size = buffer_size
     self._num_parallel_reads = num_parallel_reads
+    self._read_ahead_blocks = read_ahead_blocks
 
     def read_one_file(filename):
-      return _TFRecordDataset(filename, compression_type, buffer_size)
+      return _TFRecordDataset(filename, compression_type, buffer_size,
+                              read_ahead_blocks)
 
     if num_parallel_reads is None:
       self._impl = filenames.flat_map(read_one_file)
@@ -215,11 +227,13 @@ class TFRecordDataset(dataset_ops.Dataset):
              filenames=None,
              compression_type=None,
              buffer_size=None,
-             num_parallel_reads=None):
+             num_parallel_reads=None,
+             read_ahead_blocks=None):
     return TFRecordDataset(filenames or self._filenames,
                            compression_type or self._compression_type,
                            buffer_size or self._buffer_size,
-                           num_parallel_reads or self._num_parallel_reads)
+                           num_parallel_reads or self._num_parallel_reads,
+                           read_ahead_blocks or self._read_ahead_blocks)
 
   def _as_variant_tensor(self):
     return self._impl._as_variant_tensor()  # pylint: disable=protected-access
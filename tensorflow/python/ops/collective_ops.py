@@ -22,7 +22,7 @@ from tensorflow.python.ops import gen_collective_ops
 
 
 def all_reduce(t, group_size, group_key, instance_key, merge_op, final_op,
-               subdiv_offsets=(0,)):
+               subdiv_offsets=(0,), compression='none', topk_fraction=0.01):
   """Reduces tensors collectively, across devices.
 
   Args:
@@ -38,6 +38,13 @@ def all_reduce(t, group_size, group_key, instance_key, merge_op, final_op,
     subdiv_offsets: a list of integer offsets into the tensor at which each
       independent subdivision should begin.  Use [0] if no subdivision should
       be done.
+    compression: string naming the wire format of the values exchanged
+      between devices, which trades precision for bandwidth.  One of 'none',
+      or for float tensors on CPU devices, 'bfloat16' or 'float16' to round
+      them to 16 bits, or 'topk' to only send the fraction `topk_fraction` of
+      the values of largest magnitude and carry the rest over to the next
+      execution of the Op.  Must be the same for all members of the group.
+    topk_fraction: the fraction of the values that 'topk' compression sends.
 
   Returns:
     An Op implementing the distributed reduction.
@@ -55,7 +62,9 @@ def all_reduce(t, group_size, group_key, instance_key, merge_op, final_op,
                                               instance_key=instance_key,
                                               merge_op=merge_op,
                                               final_op=final_op,
-                                              subdiv_offsets=subdiv_offsets)
+                                              subdiv_offsets=subdiv_offsets,
+                                              compression=compression,
+                                              topk_fraction=topk_fraction)
 
 
 def broadcast_send(t, shape, dtype, group_size, group_key, instance_key):
@@ -131,3 +140,31 @@ def broadcast_recv(shape, dtype, group_size, group_key, instance_key):
                                                   group_size=group_size,
                                                   group_key=group_key,
                                                   instance_key=instance_key)
+
+
+def all_gather(t, group_size, group_key, instance_key):
+  """Concatenates tensors of identical shape from a group of devices.
+
+  Args:
+    t: the tensor to be gathered, of rank at least 1.
+    group_size: the total number of tensors to be gathered.  Each must
+      reside on a different device.
+    group_key: an integer identifying the group of devices.
+    instance_key: an integer identifying the participating group of Ops.
+
+  Returns:
+    An Op implementing the distributed all-gather, whose value is the
+    concatenation of the tensors of all devices along their first dimension,
+    in the rank order of the devices.
+
+  Raises:
+    ValueError: if any of the input parameter constraints are not met.
+  """
+  if not device.canonical_name(t.device):
+    raise ValueError('Device assignment required for collective ops')
+  if group_size <= 1:
+    raise ValueError('Parameter group_size to all_gather must be at least 2.')
+  return gen_collective_ops.collective_gather(t,
+                                              group_size=group_size,
+                                              group_key=group_key,
+                                              instance_key=instance_key)
@@ -18,6 +18,8 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+import numpy as np
+
 from tensorflow.core.protobuf import config_pb2
 from tensorflow.python.framework import constant_op
 from tensorflow.python.framework import ops
@@ -29,7 +31,8 @@ from tensorflow.python.platform import test
 
 class CollectiveOpTest(test.TestCase):
 
-  def _testCollectiveReduce(self, t0, t1, expected):
+  def _testCollectiveReduce(self, t0, t1, expected, compression='none',
+                            topk_fraction=0.01, tolerance=1e-5):
     group_key = 1
     instance_key = 1
     with self.test_session(
@@ -37,22 +40,76 @@ class CollectiveOpTest(test.TestCase):
       with ops.device('/CPU:0'):
         in0 = constant_op.constant(t0)
         colred0 = collective_ops.all_reduce(in0, 2, group_key, instance_key,
-                                            'Add', 'Div')
+                                            'Add', 'Div',
+                                            compression=compression,
+                                            topk_fraction=topk_fraction)
       with ops.device('/CPU:1'):
         in1 = constant_op.constant(t1)
         colred1 = collective_ops.all_reduce(in1, 2, group_key, instance_key,
-                                            'Add', 'Div')
+                                            'Add', 'Div',
+                                            compression=compression,
+                                            topk_fraction=topk_fraction)
       run_options = config_pb2.RunOptions()
       run_options.experimental.collective_graph_key = 1
       results = sess.run([colred0, colred1], options=run_options)
-    self.assertAllClose(results[0], expected, rtol=1e-5, atol=1e-5)
-    self.assertAllClose(results[1], expected, rtol=1e-5, atol=1e-5)
+    self.assertAllClose(results[0], expected, rtol=tolerance, atol=tolerance)
+    self.assertAllClose(results[1], expected, rtol=tolerance, atol=tolerance)
+    # Lossy compression still leaves every device with the same values.
+    self.assertAllEqual(results[0], results[1])
 
   def testCollectiveReduce(self):
     self._testCollectiveReduce([0.1, 1.1, 2.1, 3.1, 4.1, 5.1, 6.1, 7.1],
                                [0.3, 1.3, 2.3, 3.3, 4.3, 5.3, 6.3, 7.3],
                                [0.2, 1.2, 2.2, 3.2, 4.2, 5.2, 6.2, 7.2])
 
+  def testCollectiveReduceBfloat16(self):
+    self._testCollectiveReduce([0.1, 1.1, 2.1, 3.1, 4.1, 5.1, 6.1, 7.1],
+                               [0.3, 1.3, 2.3, 3.3, 4.3, 5.3, 6.3, 7.3],
+                               [0.2, 1.2, 2.2, 3.2, 4.2, 5.2, 6.2, 7.2],
+                               compression='bfloat16', tolerance=1e-2)
+
+  def testCollectiveReduceFloat16(self):
+    self._testCollectiveReduce([0.1, 1.1, 2.1, 3.1, 4.1, 5.1, 6.1, 7.1],
+                               [0.3, 1.3, 2.3, 3.3, 4.3, 5.3, 6.3, 7.3],
+                               [0.2, 1.2, 2.2, 3.2, 4.2, 5.2, 6.2, 7.2],
+                               compression='float16', tolerance=1e-2)
+
+  def testCollectiveReduceTopKOfEverything(self):
+    self._testCollectiveReduce([0.1, 1.1, 2.1, 3.1, 4.1, 5.1, 6.1, 7.1],
+                               [0.3, 1.3, 2.3, 3.3, 4.3, 5.3, 6.3, 7.3],
+                               [0.2, 1.2, 2.2, 3.2, 4.2, 5.2, 6.2, 7.2],
+                               compression='topk', topk_fraction=1.0)
+
+  def testCollectiveReduceTopKFeedsBackErrors(self):
+    group_key = 1
+    instance_key = 1
+    t0 = [0.1, 1.1, 2.1, 3.1, 4.1, 5.1, 6.1, 7.1]
+    t1 = [0.3, 1.3, 2.3, 3.3, 4.3, 5.3, 6.3, 7.3]
+    expected = np.array([0.2, 1.2, 2.2, 3.2, 4.2, 5.2, 6.2, 7.2])
+    num_steps = 100
+    with self.test_session(
+        config=config_pb2.ConfigProto(device_count={'CPU': 2})) as sess:
+      colred = []
+      for device, t in [('/CPU:0', t0), ('/CPU:1', t1)]:
+        with ops.device(device):
+          colred.append(collective_ops.all_reduce(
+              constant_op.constant(t), 2, group_key, instance_key, 'Add',
+              'Div', compression='topk', topk_fraction=0.25))
+      run_options = config_pb2.RunOptions()
+      run_options.experimental.collective_graph_key = 1
+      total = np.zeros(len(t0))
+      errors = []
+      for step in range(num_steps):
+        results = sess.run(colred, options=run_options)
+        self.assertAllEqual(results[0], results[1])
+        total += results[0]
+        errors.append(np.max(np.abs(total / (step + 1) - expected)))
+    # Each step only sends a quarter of the values, but the values that are
+    # not sent are carried over to later steps, so the mean of the results
+    # approaches the exact mean.
+    self.assertGreater(errors[0], 1)
+    self.assertLess(errors[-1], errors[0] / 10)
+
   def _testCollectiveBroadcast(self, t0):
     group_key = 1
     instance_key = 1
@@ -75,6 +132,26 @@ class CollectiveOpTest(test.TestCase):
   def testCollectiveBroadcast(self):
     self._testCollectiveBroadcast([0.1, 1.1, 2.1, 3.1, 4.1, 5.1, 6.1, 7.1])
 
+  def testCollectiveGather(self):
+    group_key = 1
+    instance_key = 1
+    t0 = [[0.1, 1.1], [2.1, 3.1]]
+    t1 = [[0.3, 1.3], [2.3, 3.3]]
+    with self.test_session(
+        config=config_pb2.ConfigProto(device_count={'CPU': 2})) as sess:
+      with ops.device('/CPU:0'):
+        in0 = constant_op.constant(t0)
+        out0 = collective_ops.all_gather(in0, 2, group_key, instance_key)
+      with ops.device('/CPU:1'):
+        in1 = constant_op.constant(t1)
+        out1 = collective_ops.all_gather(in1, 2, group_key, instance_key)
+      run_options = config_pb2.RunOptions()
+      run_options.experimental.collective_graph_key = 1
+      results = sess.run([out0, out1], options=run_options)
+    expected = t0 + t1
+    self.assertAllClose(results[0], expected, rtol=1e-5, atol=1e-5)
+    self.assertAllClose(results[1], expected, rtol=1e-5, atol=1e-5)
+
 
 if __name__ == '__main__':
   test.main()
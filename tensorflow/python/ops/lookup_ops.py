@@ -1317,3 +1317,4 @@ ops.NotDifferentiable("MutableHashTable")
 ops.NotDifferentiable("MutableHashTableV2")
 ops.NotDifferentiable("MutableHashTableOfTensors")
 ops.NotDifferentiable("MutableHashTableOfTensorsV2")
+ops.NotDifferentiable("MutableStripedHashTable")
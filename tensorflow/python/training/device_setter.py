@@ -31,7 +31,8 @@ STANDARD_PS_OPS = ("Variable", "VariableV2", "AutoReloadVariable",
                    "MutableHashTable", "MutableHashTableV2",
                    "MutableHashTableOfTensors", "MutableHashTableOfTensorsV2",
                    "MutableDenseHashTable", "MutableDenseHashTableV2",
-                   "VarHandleOp", "BoostedTreesEnsembleResourceHandleOp")
+                   "MutableStripedHashTable", "VarHandleOp",
+                   "BoostedTreesEnsembleResourceHandleOp")
 
 
 class _RoundRobinStrategy(object):